@@ -9,12 +9,20 @@ namespace Zyphrax
         public uint Level;
         public uint BlockSize;
         public uint Checksum;
+        public uint Flags;
     }
 
     public static class Compressor
     {
         const string LibName = "libzyphrax"; // Will look for libzyphrax.dylib, .so, .dll
 
+        public const uint FlagSeekTable = 1u << 0;
+        public const uint FlagContentSize = 1u << 1;
+        const ulong ContentSizeError = ulong.MaxValue;
+
+        [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+        private static extern ulong zyphrax_get_content_size(IntPtr src, IntPtr srcSize);
+
         [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
         private static extern IntPtr zyphrax_compress_bound(IntPtr srcSize);
 
@@ -38,7 +46,8 @@ namespace Zyphrax
             {
                 Level = 3,
                 BlockSize = 65536,
-                Checksum = 0
+                Checksum = 0,
+                Flags = FlagContentSize
             };
 
             GCHandle hSrc = GCHandle.Alloc(data, GCHandleType.Pinned);
@@ -79,11 +88,26 @@ namespace Zyphrax
         public static byte[] Decompress(byte[] data, int cap = 0)
         {
             if (data == null || data.Length == 0) return new byte[0];
-            if (cap == 0) cap = data.Length * 10;
 
-            byte[] buffer = new byte[cap];
-            
             GCHandle hSrc = GCHandle.Alloc(data, GCHandleType.Pinned);
+
+            if (cap == 0)
+            {
+                ulong contentSize = zyphrax_get_content_size(hSrc.AddrOfPinnedObject(), (IntPtr)data.Length);
+                if (contentSize == ContentSizeError)
+                {
+                    hSrc.Free();
+                    throw new Exception("Invalid frame");
+                }
+                if (contentSize == 0)
+                {
+                    hSrc.Free();
+                    return new byte[0];
+                }
+                cap = checked((int)contentSize);
+            }
+
+            byte[] buffer = new byte[cap];
             GCHandle hDst = GCHandle.Alloc(buffer, GCHandleType.Pinned);
             
             try
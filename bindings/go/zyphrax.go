@@ -12,6 +12,13 @@ import (
 	"unsafe"
 )
 
+const (
+	FlagSeekTable   = 1 << 0
+	FlagContentSize = 1 << 1
+
+	contentSizeError = ^uint64(0)
+)
+
 func Compress(data []byte) ([]byte, error) {
 	if len(data) == 0 {
 		return nil, nil
@@ -29,6 +36,7 @@ func Compress(data []byte) ([]byte, error) {
 	params.level = 3
 	params.block_size = 65536
 	params.checksum = 0
+	params.flags = FlagContentSize
 
 	res := C.zyphrax_compress(cSrc, cLen, cDst, bound, &params)
 
@@ -43,13 +51,20 @@ func Decompress(data []byte, cap int) ([]byte, error) {
 	if len(data) == 0 {
 		return nil, nil
 	}
-	if cap == 0 {
-		cap = len(data) * 10
-	}
-
 	cSrc := (*C.uchar)(unsafe.Pointer(&data[0]))
 	cLen := C.size_t(len(data))
 
+	if cap == 0 {
+		size := uint64(C.zyphrax_get_content_size(cSrc, cLen))
+		if size == contentSizeError {
+			return nil, errors.New("invalid frame")
+		}
+		if size == 0 {
+			return []byte{}, nil
+		}
+		cap = int(size)
+	}
+
 	dst := make([]byte, cap)
 	cDst := (*C.uchar)(unsafe.Pointer(&dst[0]))
 
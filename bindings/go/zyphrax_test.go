@@ -26,3 +26,18 @@ func TestCompressLarge(t *testing.T) {
 		t.Errorf("Compression poor: %d bytes", len(comp))
 	}
 }
+
+func TestRoundtripExactSize(t *testing.T) {
+	data := bytes.Repeat([]byte("Hello Go World "), 10000)
+	comp, err := Compress(data)
+	if err != nil {
+		t.Fatal(err)
+	}
+	dec, err := Decompress(comp, 0)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !bytes.Equal(dec, data) {
+		t.Errorf("Roundtrip mismatch: %d bytes", len(dec))
+	}
+}
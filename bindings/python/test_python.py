@@ -13,6 +13,11 @@ class TestZyphrax(unittest.TestCase):
         data = b"A" * 100000
         comp = zyphrax.compress(data)
         self.assertLess(len(comp), 2000) # Should be tiny
+
+    def test_roundtrip_exact_size(self):
+        data = bytes(range(256)) * 1000
+        comp = zyphrax.compress(data)
+        self.assertEqual(zyphrax.decompress(comp), data)
         
 if __name__ == "__main__":
     unittest.main()
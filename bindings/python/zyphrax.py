@@ -40,6 +40,7 @@ class ZyphraxParams(ctypes.Structure):
         ("level", ctypes.c_uint32),
         ("block_size", ctypes.c_uint32),
         ("checksum", ctypes.c_uint32),
+        ("flags", ctypes.c_uint32),
     ]
 
 # Signatures
@@ -63,6 +64,17 @@ _lib.zyphrax_decompress.argtypes = [
 ]
 _lib.zyphrax_decompress.restype = ctypes.c_size_t
 
+_lib.zyphrax_get_content_size.argtypes = [
+    ctypes.POINTER(ctypes.c_uint8), # src
+    ctypes.c_size_t                 # src_size
+]
+_lib.zyphrax_get_content_size.restype = ctypes.c_uint64
+
+FLAG_SEEK_TABLE = 1 << 0
+FLAG_CONTENT_SIZE = 1 << 1
+FLAG_SPLIT_BLOCKS = 1 << 2
+CONTENT_SIZE_ERROR = 2**64 - 1
+
 # Wrapper
 def compress(data: bytes, level=3, block_size=65536) -> bytes:
     src_len = len(data)
@@ -71,7 +83,7 @@ def compress(data: bytes, level=3, block_size=65536) -> bytes:
     # Alloc dst
     out_buf = ctypes.create_string_buffer(bound)
     
-    params = ZyphraxParams(level=level, block_size=block_size, checksum=0)
+    params = ZyphraxParams(level=level, block_size=block_size, checksum=0, flags=FLAG_CONTENT_SIZE)
     
     # Cast pointers
     src_ptr = (ctypes.c_uint8 * src_len).from_buffer_copy(data)
@@ -89,14 +101,18 @@ def compress(data: bytes, level=3, block_size=65536) -> bytes:
     return out_buf.raw[:encoded_size]
 
 def decompress(data: bytes, dst_cap: int = 0) -> bytes:
-    if dst_cap == 0:
-        # Estimation if not provided (safe bet usually)
-        dst_cap = len(data) * 10 
-        
     src_len = len(data)
-    out_buf = ctypes.create_string_buffer(dst_cap)
-    
     src_ptr = (ctypes.c_uint8 * src_len).from_buffer_copy(data)
+
+    if dst_cap == 0:
+        # Exact size from the frame (header field or block walk)
+        dst_cap = _lib.zyphrax_get_content_size(src_ptr, src_len)
+        if dst_cap == CONTENT_SIZE_ERROR:
+            raise RuntimeError("Invalid frame")
+        if dst_cap == 0:
+            return b""
+
+    out_buf = ctypes.create_string_buffer(dst_cap)
     dst_ptr = ctypes.cast(out_buf, ctypes.POINTER(ctypes.c_uint8))
     
     dec_size = _lib.zyphrax_decompress(src_ptr, src_len, dst_ptr, dst_cap)
@@ -7,7 +7,8 @@ import { ref } from 'ref-napi'; // conceptual
 // var ZyphraxParams = Struct({
 //   'level': 'uint32',
 //   'block_size': 'uint32',
-//   'checksum': 'uint32'
+//   'checksum': 'uint32',
+//   'flags': 'uint32'
 // });
 
 // const lib = Library('./libzyphrax', {
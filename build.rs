@@ -12,6 +12,16 @@ fn main() {
         .file("src/zyphrax_simd.c")
         .file("src/zyphrax_seq.c")
         .file("src/zyphrax_huff.c")
+        .file("src/zyphrax_dec.c")
+        .file("src/zyphrax_pool.c")
+        .file("src/zyphrax_mt.c")
+        .file("src/zyphrax_seek.c")
+        .file("src/zyphrax_stream.c")
+        .file("src/zyphrax_cctx.c")
+        .file("src/zyphrax_queue.c")
+        .file("src/zyphrax_iov.c")
+        .file("src/zyphrax_mem.c")
+        .file("src/zyphrax_hash.c")
         .include("src")
         .flag_if_supported("-O3");
 
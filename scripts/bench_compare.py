@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Compares two `make bench`, `make latency` or `make scaling` JSON results.
+
+Usage: scripts/bench_compare.py baseline.json current.json [--threshold PCT]
+                                [--metric median_mbps|p90_mbps|p99_mbps|
+                                          p50_ns|p99_ns|p999_ns|
+                                          aggregate_mbps|per_thread_mbps]
+
+Cases are matched by name. A case whose throughput drops (or, for the _ns
+latency metrics, whose latency grows) by more than the threshold (default
+5%) is a regression, as is a lower compression ratio; a higher one is only
+noted. Exits 1 if there is a regression.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    return data.get("config", {}), {r["name"]: r for r in data["results"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="allowed slowdown in percent (default 5)")
+    parser.add_argument("--metric", default="median_mbps",
+                        choices=["median_mbps", "p90_mbps", "p99_mbps",
+                                 "p50_ns", "p99_ns", "p999_ns",
+                                 "aggregate_mbps", "per_thread_mbps"])
+    args = parser.parse_args()
+    # Latencies: lower is better, so a slowdown is a positive change
+    sign = -1.0 if args.metric.endswith("_ns") else 1.0
+
+    base_cfg, base = load(args.baseline)
+    cur_cfg, cur = load(args.current)
+    for key in ("size", "runs", "calls", "threads", "level", "order", "numa",
+                "compiler"):
+        if base_cfg.get(key) != cur_cfg.get(key):
+            print(f"note: {key} differs: {base_cfg.get(key)} -> "
+                  f"{cur_cfg.get(key)}")
+
+    regressions = 0
+    print(f"{'Case':<32} {'Baseline':>10} {'Current':>10} {'Change':>8}")
+    for name, b in base.items():
+        c = cur.get(name)
+        if c is None:
+            print(f"{name:<32} {'':>10} {'missing':>10}")
+            continue
+        old, new = b[args.metric], c[args.metric]
+        change = (new - old) / old * 100.0 if old else 0.0
+        flag = ""
+        if sign * change < -args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        if abs(b["ratio"] - c["ratio"]) > 1e-4:
+            flag += f"  ratio {b['ratio']:.4f} -> {c['ratio']:.4f}"
+            if c["ratio"] < b["ratio"]:
+                regressions += 1
+        print(f"{name:<32} {old:>10.1f} {new:>10.1f} {change:>+7.1f}%{flag}")
+    for name in cur.keys() - base.keys():
+        print(f"{name:<32} {'new':>10} {cur[name][args.metric]:>10.1f}")
+
+    if regressions:
+        print(f"{regressions} regression(s) beyond {args.threshold}%")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -13,17 +13,26 @@ gcc -O3 -I src -c src/zyphrax_seq.c -o src/zyphrax_seq.o
 gcc -O3 -I src -c src/zyphrax_huff.c -o src/zyphrax_huff.o
 gcc -O3 -I src -c src/zyphrax_block.c -o src/zyphrax_block.o
 gcc -O3 -I src -c src/zyphrax_dec.c -o src/zyphrax_dec.o
+gcc -O3 -I src -c src/zyphrax_pool.c -o src/zyphrax_pool.o
+gcc -O3 -I src -c src/zyphrax_mt.c -o src/zyphrax_mt.o
+gcc -O3 -I src -c src/zyphrax_seek.c -o src/zyphrax_seek.o
+gcc -O3 -I src -c src/zyphrax_stream.c -o src/zyphrax_stream.o
+gcc -O3 -I src -c src/zyphrax_cctx.c -o src/zyphrax_cctx.o
+gcc -O3 -I src -c src/zyphrax_queue.c -o src/zyphrax_queue.o
+gcc -O3 -I src -c src/zyphrax_iov.c -o src/zyphrax_iov.o
+gcc -O3 -I src -c src/zyphrax_mem.c -o src/zyphrax_mem.o
+gcc -O3 -I src -c src/zyphrax_hash.c -o src/zyphrax_hash.o
 
 # Static Lib
-ar rcs libzyphrax.a src/zyphrax.o src/zyphrax_lz77.o src/zyphrax_simd.o src/zyphrax_seq.o src/zyphrax_huff.o src/zyphrax_block.o src/zyphrax_dec.o
+ar rcs libzyphrax.a src/zyphrax.o src/zyphrax_lz77.o src/zyphrax_simd.o src/zyphrax_seq.o src/zyphrax_huff.o src/zyphrax_block.o src/zyphrax_dec.o src/zyphrax_pool.o src/zyphrax_mt.o src/zyphrax_seek.o src/zyphrax_stream.o src/zyphrax_cctx.o src/zyphrax_queue.o src/zyphrax_iov.o src/zyphrax_mem.o src/zyphrax_hash.o
 Write-Host "Created libzyphrax.a"
 
 # Shared Lib (DLL)
-gcc -shared -o zyphrax.dll src/zyphrax.o src/zyphrax_lz77.o src/zyphrax_simd.o src/zyphrax_seq.o src/zyphrax_huff.o src/zyphrax_block.o src/zyphrax_dec.o
+gcc -shared -o zyphrax.dll src/zyphrax.o src/zyphrax_lz77.o src/zyphrax_simd.o src/zyphrax_seq.o src/zyphrax_huff.o src/zyphrax_block.o src/zyphrax_dec.o src/zyphrax_pool.o src/zyphrax_mt.o src/zyphrax_seek.o src/zyphrax_stream.o src/zyphrax_cctx.o src/zyphrax_queue.o src/zyphrax_iov.o src/zyphrax_mem.o src/zyphrax_hash.o -lpthread
 Write-Host "Created zyphrax.dll"
 
 # CLI
-gcc -O3 -I src src/cli.c -L. -lzyphrax -o zyphrax.exe
+gcc -O3 -I src src/cli.c -L. -lzyphrax -lpthread -o zyphrax.exe
 Write-Host "Created zyphrax.exe"
 
 # Installation (Local)
@@ -1,135 +1,937 @@
 #include "zyphrax.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #define CHUNK_SIZE (1024 * 1024)
+#define DEFAULT_WORKERS 4
+#define DEFAULT_LEVEL 3
 
-void print_usage(const char *prog) {
-  fprintf(stderr, "Usage: %s [-d] <input> <output>\n", prog);
+static unsigned cpu_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > 0)
+    return (unsigned)n;
+#endif
+  return DEFAULT_WORKERS;
 }
 
-int main(int argc, char **argv) {
-  int decompress = 0;
-  int arg_idx = 1;
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
 
-  if (argc < 3) {
-    print_usage(argv[0]);
-    return 1;
+#define MAX_BENCH_BLOCKS 16
+
+typedef struct {
+  int decompress;
+  zyphrax_params_t params;
+  unsigned threads;
+  const char *in_path;  // "-" = stdin
+  const char *out_path; // "-" = stdout
+
+  // Benchmark (-b): every level in [params.level, level_end] and every
+  // block size, on each file
+  int bench;
+  uint32_t level_end;
+  uint32_t blocks[MAX_BENCH_BLOCKS];
+  unsigned nb_blocks;
+  double bench_secs; // Minimum time per measurement
+  const char **files;
+  int nb_files;
+} options_t;
+
+static int is_std(const char *path) { return strcmp(path, "-") == 0; }
+
+// -------------------------------------------------------------------------
+// Input
+// -------------------------------------------------------------------------
+// Regular files are mapped rather than read: the compressor encodes blocks
+// straight from the mapping and the pages already consumed are dropped, so
+// memory stays at the stream's few blocks however large the file. Anything
+// else (pipes, terminals) is read ahead by a thread into two chunk buffers,
+// so the next read overlaps work on the current chunk.
+
+typedef struct {
+  FILE *f;
+  const uint8_t *map; // Whole file, or NULL when read ahead
+  uint64_t size;      // Mapped size
+  uint64_t released;  // Mapped bytes already handed back
+
+  // Read-ahead
+  uint8_t *buf[2];
+  size_t len[2];
+  int ready[2]; // Filled by the reader, not yet handed back
+  int held;     // Buffer the caller is working on, -1 if none
+  unsigned next;
+  int last;      // Short read seen: end of input or error
+  int error;     // Set with the short read
+  int drained;   // Caller has had the last buffer
+  int closing;   // Caller is done; the reader stops
+  int running;   // Reader thread created and not joined
+  pthread_mutex_t mu;
+  pthread_cond_t cv;
+  pthread_t thread;
+} input_t;
+
+static void *input_reader(void *arg) {
+  input_t *in = (input_t *)arg;
+  for (unsigned i = 0;; i ^= 1) {
+    pthread_mutex_lock(&in->mu);
+    while (in->ready[i] && !in->closing)
+      pthread_cond_wait(&in->cv, &in->mu);
+    int closing = in->closing;
+    pthread_mutex_unlock(&in->mu);
+    if (closing)
+      break;
+
+    size_t n = fread(in->buf[i], 1, CHUNK_SIZE, in->f);
+    pthread_mutex_lock(&in->mu);
+    in->len[i] = n;
+    in->ready[i] = 1;
+    if (n < CHUNK_SIZE) {
+      in->last = 1;
+      in->error = ferror(in->f) != 0;
+    }
+    pthread_cond_broadcast(&in->cv);
+    pthread_mutex_unlock(&in->mu);
+    if (n < CHUNK_SIZE)
+      break;
   }
+  return NULL;
+}
 
-  if (strcmp(argv[arg_idx], "-d") == 0) {
-    decompress = 1;
-    arg_idx++;
-    if (argc < 4) {
-      print_usage(argv[0]);
-      return 1;
+static int input_open(input_t *in, const char *path) {
+  memset(in, 0, sizeof(*in));
+  in->held = -1;
+  in->f = is_std(path) ? stdin : fopen(path, "rb");
+  if (!in->f)
+    return -1;
+#ifdef _WIN32
+  if (in->f == stdin)
+    _setmode(_fileno(stdin), _O_BINARY);
+#else
+  struct stat st;
+  if (fstat(fileno(in->f), &st) == 0 && S_ISREG(st.st_mode) &&
+      st.st_size > 0 && (uint64_t)st.st_size <= SIZE_MAX) {
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED,
+                     fileno(in->f), 0);
+    if (map != MAP_FAILED) {
+      madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+      in->map = map;
+      in->size = (uint64_t)st.st_size;
+      return 0;
     }
   }
+#endif
 
-  const char *in_path = argv[arg_idx];
-  const char *out_path = argv[arg_idx + 1];
+  in->buf[0] = malloc(CHUNK_SIZE);
+  in->buf[1] = malloc(CHUNK_SIZE);
+  if (!in->buf[0] || !in->buf[1])
+    return -1;
+  pthread_mutex_init(&in->mu, NULL);
+  pthread_cond_init(&in->cv, NULL);
+  if (pthread_create(&in->thread, NULL, input_reader, in) != 0) {
+    pthread_mutex_destroy(&in->mu);
+    pthread_cond_destroy(&in->cv);
+    return -1;
+  }
+  in->running = 1;
+  return 0;
+}
 
-  FILE *fin = fopen(in_path, "rb");
-  if (!fin) {
-    perror("Error opening input");
-    return 1;
+// Hands back the mapped pages before pos; they are not read again
+static void input_release(input_t *in, uint64_t pos) {
+#ifndef _WIN32
+  uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t end = pos / page * page;
+  if (in->map && end > in->released) {
+    madvise((void *)(in->map + in->released), (size_t)(end - in->released),
+            MADV_DONTNEED);
+    in->released = end;
   }
+#else
+  (void)in;
+  (void)pos;
+#endif
+}
 
-  fseek(fin, 0, SEEK_END);
-  long fsize = ftell(fin);
-  fseek(fin, 0, SEEK_SET);
+static void input_close(input_t *in) {
+#ifndef _WIN32
+  if (in->map)
+    munmap((void *)in->map, (size_t)in->size);
+#endif
+  int detached = 0;
+  if (in->running) {
+    pthread_mutex_lock(&in->mu);
+    in->closing = 1;
+    int early = !in->last;
+    pthread_cond_broadcast(&in->cv);
+    pthread_mutex_unlock(&in->mu);
+    if (early) {
+      // Stopped before the end: the reader may sit in fread on a pipe that
+      // never delivers, and the process is about to exit, so leave it be
+      pthread_detach(in->thread);
+      detached = 1;
+    } else {
+      pthread_join(in->thread, NULL);
+      pthread_mutex_destroy(&in->mu);
+      pthread_cond_destroy(&in->cv);
+    }
+  }
+  if (detached)
+    return;
+  free(in->buf[0]);
+  free(in->buf[1]);
+  if (in->f && in->f != stdin)
+    fclose(in->f);
+}
 
-  if (fsize < 0) {
-    fprintf(stderr, "Error input size\n");
-    fclose(fin);
-    return 1;
+// Next piece of input: a window of the mapping or the next read-ahead
+// buffer (which hands the previous one back to the reader).
+// Returns its size, 0 at the end, or -1 on a read error
+static long input_next(input_t *in, uint64_t *pos, const uint8_t **src) {
+  if (in->map) {
+    uint64_t left = in->size - *pos;
+    size_t n = left < CHUNK_SIZE ? (size_t)left : CHUNK_SIZE;
+    *src = in->map + *pos;
+    *pos += n;
+    return (long)n;
+  }
+  pthread_mutex_lock(&in->mu);
+  if (in->held >= 0) {
+    in->ready[in->held] = 0;
+    in->held = -1;
+    pthread_cond_broadcast(&in->cv);
+  }
+  if (in->drained) {
+    pthread_mutex_unlock(&in->mu);
+    return in->error ? -1 : 0;
+  }
+  unsigned i = in->next;
+  while (!in->ready[i])
+    pthread_cond_wait(&in->cv, &in->mu);
+  size_t n = in->len[i];
+  in->held = (int)i;
+  in->next ^= 1;
+  in->drained = n < CHUNK_SIZE;
+  pthread_mutex_unlock(&in->mu);
+
+  if (n == 0)
+    return in->error ? -1 : 0;
+  *src = in->buf[i];
+  *pos += n;
+  return (long)n;
+}
+
+// -------------------------------------------------------------------------
+// Output
+// -------------------------------------------------------------------------
+// Double-buffered: the caller fills out while a writer thread flushes the
+// other buffer, so writes overlap compression and at most two chunks are
+// ever held.
+
+typedef struct {
+  FILE *f;
+  zyphrax_out_buffer_t out; // Buffer the caller fills
+  uint8_t *buf[2];
+  size_t len[2];
+  int full[2]; // Handed to the writer, not yet written
+  unsigned cur;
+  int error;
+  int reported; // Write error already printed
+  int closing;
+  uint64_t total;
+  pthread_mutex_t mu;
+  pthread_cond_t cv;
+  pthread_t thread;
+} output_t;
+
+static void *output_writer(void *arg) {
+  output_t *o = (output_t *)arg;
+  for (unsigned i = 0;; i ^= 1) {
+    pthread_mutex_lock(&o->mu);
+    while (!o->full[i] && !o->closing)
+      pthread_cond_wait(&o->cv, &o->mu);
+    int have = o->full[i];
+    int failed = o->error;
+    pthread_mutex_unlock(&o->mu);
+    if (!have)
+      break;
+
+    int err = !failed && fwrite(o->buf[i], 1, o->len[i], o->f) != o->len[i];
+    pthread_mutex_lock(&o->mu);
+    o->error |= err;
+    o->full[i] = 0;
+    pthread_cond_broadcast(&o->cv);
+    pthread_mutex_unlock(&o->mu);
+  }
+  return NULL;
+}
+
+static int output_open(output_t *o, const char *path) {
+  memset(o, 0, sizeof(*o));
+  o->f = is_std(path) ? stdout : fopen(path, "wb");
+  if (!o->f)
+    return -1;
+#ifdef _WIN32
+  if (o->f == stdout)
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+  o->buf[0] = malloc(CHUNK_SIZE);
+  o->buf[1] = malloc(CHUNK_SIZE);
+  if (!o->buf[0] || !o->buf[1])
+    goto fail;
+  pthread_mutex_init(&o->mu, NULL);
+  pthread_cond_init(&o->cv, NULL);
+  if (pthread_create(&o->thread, NULL, output_writer, o) != 0) {
+    pthread_mutex_destroy(&o->mu);
+    pthread_cond_destroy(&o->cv);
+    goto fail;
   }
+  o->out = (zyphrax_out_buffer_t){o->buf[0], CHUNK_SIZE, 0};
+  return 0;
+
+fail:
+  free(o->buf[0]);
+  free(o->buf[1]);
+  if (o->f != stdout)
+    fclose(o->f);
+  o->f = NULL;
+  return -1;
+}
+
+// Hands the filled buffer to the writer and waits for the other one
+static int output_flush(output_t *o) {
+  pthread_mutex_lock(&o->mu);
+  if (o->out.pos > 0) {
+    o->len[o->cur] = o->out.pos;
+    o->full[o->cur] = 1;
+    o->total += o->out.pos;
+    o->cur ^= 1;
+    pthread_cond_broadcast(&o->cv);
+  }
+  while (o->full[o->cur])
+    pthread_cond_wait(&o->cv, &o->mu);
+  int err = o->error;
+  pthread_mutex_unlock(&o->mu);
+  o->out = (zyphrax_out_buffer_t){o->buf[o->cur], CHUNK_SIZE, 0};
+  if (err && !o->reported) {
+    fprintf(stderr, "Write error\n");
+    o->reported = 1;
+  }
+  return err ? -1 : 0;
+}
+
+// Call after each stream call: flushes out once it is full.
+// Returns 1 if it was (the stream may have more), 0, or -1 on error
+static int output_poll(output_t *o) {
+  if (o->out.pos < o->out.size)
+    return 0;
+  return output_flush(o) == 0 ? 1 : -1;
+}
+
+// Writes what is left and stops the writer. Returns 0, or -1 if any write
+// failed
+static int output_close(output_t *o, uint64_t *out_total) {
+  int ret = output_flush(o);
+  pthread_mutex_lock(&o->mu);
+  o->closing = 1;
+  pthread_cond_broadcast(&o->cv);
+  pthread_mutex_unlock(&o->mu);
+  pthread_join(o->thread, NULL);
+  pthread_mutex_destroy(&o->mu);
+  pthread_cond_destroy(&o->cv);
 
-  uint8_t *in_buf = malloc(fsize);
-  if (!in_buf) {
+  if ((o->f == stdout ? fflush(o->f) : fclose(o->f)) != 0) {
+    if (!o->reported)
+      perror("Write error");
+    ret = -1;
+  }
+  free(o->buf[0]);
+  free(o->buf[1]);
+  *out_total = o->total;
+  return ret;
+}
+
+// -------------------------------------------------------------------------
+// Compression
+// -------------------------------------------------------------------------
+// Pipelined: the next chunk is read (or paged in), earlier blocks compress
+// on the workers and finished blocks are written, all at once. A mapped
+// input has a known size, which is pledged so the header carries it.
+
+static int compress_file(input_t *in, output_t *o, const options_t *opt,
+                         uint64_t *in_total) {
+  zyphrax_params_t params = opt->params;
+  if (in->map)
+    params.flags |= ZYPHRAX_FLAG_CONTENT_SIZE;
+  zyphrax_cstream_t *cs = opt->threads > 1
+                              ? zyphrax_cstream_init_mt(&params, opt->threads, 0)
+                              : zyphrax_cstream_init(&params);
+  int ret = -1;
+  if (!cs) {
     fprintf(stderr, "Memory error\n");
-    fclose(fin);
-    return 1;
+    goto done;
+  }
+  if (in->map &&
+      zyphrax_cstream_pledge_size(cs, in->size) == ZYPHRAX_STREAM_ERROR) {
+    fprintf(stderr, "Compression failed\n");
+    goto done;
+  }
+
+  const uint8_t *src;
+  long n;
+  while ((n = input_next(in, in_total, &src)) > 0) {
+    zyphrax_in_buffer_t chunk = {src, (size_t)n, 0};
+    while (chunk.pos < chunk.size) {
+      if (zyphrax_cstream_update(cs, &o->out, &chunk) ==
+          ZYPHRAX_STREAM_ERROR) {
+        fprintf(stderr, "Compression failed\n");
+        goto done;
+      }
+      if (output_poll(o) < 0)
+        goto done;
+    }
+    // The stream has copied or encoded everything it was given
+    input_release(in, *in_total);
   }
-  if (fread(in_buf, 1, fsize, fin) != (size_t)fsize) {
+  if (n < 0) {
     fprintf(stderr, "Read error\n");
-    free(in_buf);
-    fclose(fin);
-    return 1;
+    goto done;
   }
-  fclose(fin);
 
-  FILE *fout = fopen(out_path, "wb");
-  if (!fout) {
-    perror("Error opening output");
-    free(in_buf);
-    return 1;
+  size_t left;
+  do {
+    left = zyphrax_cstream_end(cs, &o->out);
+    if (left == ZYPHRAX_STREAM_ERROR) {
+      fprintf(stderr, "Compression failed\n");
+      goto done;
+    }
+    if (output_poll(o) < 0)
+      goto done;
+  } while (left != 0);
+  ret = 0;
+
+done:
+  zyphrax_cstream_free(cs);
+  return ret;
+}
+
+// -------------------------------------------------------------------------
+// Decompression
+// -------------------------------------------------------------------------
+
+// Streams the frames through a dstream: one block in memory at a time
+static int decompress_stream(input_t *in, output_t *o, uint64_t *in_total) {
+  zyphrax_dstream_t *ds = zyphrax_dstream_init();
+  int ret = -1;
+  if (!ds) {
+    fprintf(stderr, "Memory error\n");
+    goto done;
   }
 
-  clock_t start = clock();
-  size_t out_sz = 0;
+  size_t hint = 1;
+  const uint8_t *src;
+  long n;
+  while ((n = input_next(in, in_total, &src)) > 0) {
+    zyphrax_in_buffer_t chunk = {src, (size_t)n, 0};
+    int more;
+    do {
+      hint = zyphrax_dstream_update(ds, &o->out, &chunk);
+      if (hint == ZYPHRAX_STREAM_ERROR) {
+        fprintf(stderr, "Invalid or corrupt frame\n");
+        goto done;
+      }
+      if ((more = output_poll(o)) < 0)
+        goto done;
+    } while (chunk.pos < chunk.size || more);
+    input_release(in, *in_total);
+  }
+  if (n < 0) {
+    fprintf(stderr, "Read error\n");
+    goto done;
+  }
+  if (hint != 0) {
+    fprintf(stderr, "Truncated frame\n");
+    goto done;
+  }
+  ret = 0;
 
-  if (!decompress) {
-    // Compress
-    size_t bound = zyphrax_compress_bound(fsize);
-    uint8_t *out_buf = malloc(bound);
-    if (!out_buf) {
-      fprintf(stderr, "Out mem error\n");
-      free(in_buf);
-      fclose(fout);
-      return 1;
+done:
+  zyphrax_dstream_free(ds);
+  return ret;
+}
+
+#ifndef _WIN32
+// Sum of the content sizes of every frame in src, skippable frames aside
+static uint64_t total_content_size(const uint8_t *src, uint64_t size) {
+  uint64_t total = 0;
+  while (size > 0) {
+    size_t n = zyphrax_find_frame_size(src, (size_t)size);
+    if (n == 0)
+      return ZYPHRAX_CONTENT_SIZE_ERROR;
+    uint32_t magic;
+    memcpy(&magic, src, 4);
+    if (magic != ZYPHRAX_SKIPPABLE_MAGIC) {
+      uint64_t c = zyphrax_get_content_size(src, n);
+      if (c == ZYPHRAX_CONTENT_SIZE_ERROR)
+        return c;
+      total += c;
     }
+    src += n;
+    size -= n;
+  }
+  return total;
+}
 
-    zyphrax_params_t params = {.level = 3, .block_size = 65536};
-    out_sz = zyphrax_compress(in_buf, fsize, out_buf, bound, &params);
+// Decodes the mapped input on all threads straight into the mapped output
+// file. The exact size comes from the headers, so nothing is guessed and no
+// output buffer is allocated; pages are written back as the kernel sees fit.
+static int decompress_mapped(input_t *in, const char *out_path,
+                             unsigned threads, uint64_t *out_total) {
+  uint64_t size = total_content_size(in->map, in->size);
+  if (size == ZYPHRAX_CONTENT_SIZE_ERROR || size > SIZE_MAX) {
+    fprintf(stderr, "Invalid or corrupt frame\n");
+    return -1;
+  }
+  int fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    perror("Error opening output");
+    return -1;
+  }
+  int ret = -1;
+  void *map = MAP_FAILED;
+  if (ftruncate(fd, (off_t)size) != 0) {
+    perror("Error sizing output");
+    goto done;
+  }
+  if (size == 0) {
+    ret = 0;
+    goto done;
+  }
+  map = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    perror("Error mapping output");
+    goto done;
+  }
+  if (zyphrax_decompress_mt(in->map, (size_t)in->size, map, (size_t)size,
+                            threads) != size) {
+    fprintf(stderr, "Decompression failed\n");
+    goto done;
+  }
+  *out_total = size;
+  ret = 0;
 
-    if (out_sz == 0 && fsize > 0) {
-      fprintf(stderr, "Compression failed\n");
-    } else {
-      fwrite(out_buf, 1, out_sz, fout);
-      double ratio = (double)out_sz * 100.0 / fsize;
-      printf("Compressed %ld -> %zu bytes (%.2f%%)\n", fsize, out_sz, ratio);
+done:
+  if (map != MAP_FAILED && munmap(map, (size_t)size) != 0)
+    ret = -1;
+  if (close(fd) != 0) {
+    perror("Write error");
+    ret = -1;
+  }
+  return ret;
+}
+
+// Mapped output needs a regular file (or a new one) to size up front
+static int output_mappable(const char *path) {
+  struct stat st;
+  return !is_std(path) && (stat(path, &st) != 0 || S_ISREG(st.st_mode));
+}
+#endif
+
+// -------------------------------------------------------------------------
+// Benchmark
+// -------------------------------------------------------------------------
+// Whole files are loaded up front and every configuration is timed in
+// memory, so only the codec is measured: compression through a cctx (its
+// workers and match finders persist between runs) and decompression through
+// a dctx, or zyphrax_decompress_mt with several threads. Each direction
+// repeats for at least bench_secs and keeps the fastest run; the first run
+// is a warm-up. Every configuration is decoded and compared with its input.
+
+typedef struct {
+  const uint8_t *src;
+  size_t size;
+  uint8_t *comp;
+  size_t comp_cap;
+  size_t comp_size;
+  uint8_t *dec;
+  zyphrax_params_t params;
+  unsigned threads;
+  zyphrax_cctx_t *cctx;
+  zyphrax_dctx_t *dctx;
+} bench_t;
+
+static size_t bench_compress(bench_t *b) {
+  return zyphrax_compress_cctx(b->cctx, b->src, b->size, b->comp, b->comp_cap,
+                               &b->params);
+}
+
+static size_t bench_decompress(bench_t *b) {
+  if (b->threads > 1)
+    return zyphrax_decompress_dctx_mt(b->dctx, b->comp, b->comp_size, b->dec,
+                                      b->size, b->threads);
+  return zyphrax_decompress_dctx(b->dctx, b->comp, b->comp_size, b->dec,
+                                 b->size);
+}
+
+// Fastest wall-clock time of one call. Calls are batched until a batch
+// takes 10 ms, so small inputs stay well above the clock's resolution.
+// Returns -1 if a call fails
+static double bench_best(size_t (*fn)(bench_t *), bench_t *b, double secs,
+                         size_t *result) {
+  *result = fn(b);
+  if (*result == 0 && b->size > 0)
+    return -1;
+  double best = 1e30, spent = 0;
+  unsigned reps = 1;
+  do {
+    double t0 = now_sec();
+    for (unsigned r = 0; r < reps; r++)
+      *result = fn(b);
+    double t = now_sec() - t0;
+    spent += t;
+    if (t / reps < best)
+      best = t / reps;
+    if (t < 0.01 && reps < (1u << 20))
+      reps *= 2;
+  } while (spent < secs);
+  return best;
+}
+
+static uint8_t *load_file(const char *path, size_t *size) {
+  FILE *f = is_std(path) ? stdin : fopen(path, "rb");
+  if (!f)
+    return NULL;
+  size_t cap = CHUNK_SIZE, len = 0;
+  uint8_t *buf = malloc(cap);
+  while (buf) {
+    len += fread(buf + len, 1, cap - len, f);
+    if (len < cap)
+      break;
+    uint8_t *grown = realloc(buf, cap * 2);
+    if (!grown)
+      free(buf);
+    buf = grown;
+    cap *= 2;
+  }
+  int err = ferror(f);
+  if (f != stdin)
+    fclose(f);
+  if (err) {
+    free(buf);
+    return NULL;
+  }
+  *size = len;
+  return buf;
+}
+
+static void format_size(char *out, size_t cap, uint32_t size) {
+  if (size % (1u << 20) == 0)
+    snprintf(out, cap, "%uM", size >> 20);
+  else if (size % 1024 == 0)
+    snprintf(out, cap, "%uK", size >> 10);
+  else
+    snprintf(out, cap, "%u", size);
+}
+
+static const char *base_name(const char *path) {
+  const char *name = path;
+  for (const char *p = path; *p; p++)
+    if (*p == '/' || *p == '\\')
+      name = p + 1;
+  return name;
+}
+
+// Returns 0, or 1 if a file could not be loaded or a round trip failed
+static int bench_files(const options_t *opt) {
+  zyphrax_cctx_t *cctx = zyphrax_cctx_create(opt->threads);
+  zyphrax_dctx_t *dctx = zyphrax_dctx_create(NULL);
+  if (!cctx || !dctx) {
+    fprintf(stderr, "Memory error\n");
+    zyphrax_cctx_free(cctx);
+    zyphrax_dctx_free(dctx);
+    return 1;
+  }
+  printf("%-20s %3s %6s %12s %12s %7s %11s %11s\n", "File", "Lvl", "Block",
+         "Size", "Compressed", "Ratio", "Comp MB/s", "Dec MB/s");
+  fflush(stdout);
+
+  int ret = 0;
+  for (int f = 0; f < opt->nb_files; f++) {
+    bench_t b = {.threads = opt->threads, .cctx = cctx, .dctx = dctx};
+    uint8_t *src = load_file(opt->files[f], &b.size);
+    if (!src) {
+      fprintf(stderr, "%s: ", opt->files[f]);
+      perror("Error reading input");
+      ret = 1;
+      continue;
     }
-    free(out_buf);
-  } else {
-    // Decompress
-    // We need to know original size?
-    // Header doesn't store full original size, only block sizes.
-    // Usually we decompress block by block.
-    // For CLI, let's guess output size * 10 or params?
-    // Zyphrax format doesn't have "Total Size" field in header.
-    // So we might need incremental decompression API (Phase 9+).
-    // Since we only have `zyphrax_decompress` doing oneshot (returning 0),
-    // we can't really implement CLI decompress fully yet.
-    // We will just call it and report result.
-
-    size_t cap = fsize * 10; // Simple guess
-    uint8_t *out_buf = malloc(cap);
-    if (!out_buf) {
-      fprintf(stderr, "Out mem error\n");
-      free(in_buf);
-      fclose(fout);
-      return 1;
+    b.src = src;
+    // Room for the smallest block size, the one with the most overhead
+    b.comp_cap = 0;
+    for (unsigned k = 0; k < opt->nb_blocks; k++) {
+      zyphrax_params_t p = opt->params;
+      p.block_size = opt->blocks[k];
+      size_t cap = zyphrax_compress_bound_params(b.size, &p);
+      if (cap > b.comp_cap)
+        b.comp_cap = cap;
+    }
+    b.comp = malloc(b.comp_cap);
+    b.dec = malloc(b.size ? b.size : 1);
+    if (!b.comp || !b.dec) {
+      fprintf(stderr, "Memory error\n");
+      ret = 1;
+      goto next;
+    }
+
+    for (uint32_t level = opt->params.level; level <= opt->level_end;
+         level++) {
+      for (unsigned k = 0; k < opt->nb_blocks; k++) {
+        b.params = opt->params;
+        b.params.level = level;
+        b.params.block_size = opt->blocks[k];
+        char block[16];
+        format_size(block, sizeof(block), b.params.block_size);
+
+        double ct = bench_best(bench_compress, &b, opt->bench_secs,
+                               &b.comp_size);
+        memset(b.dec, 0, b.size);
+        size_t dec_size = 0;
+        double dt = ct < 0 ? -1
+                           : bench_best(bench_decompress, &b,
+                                        opt->bench_secs, &dec_size);
+        if (ct < 0 || dt < 0 || dec_size != b.size ||
+            memcmp(b.dec, b.src, b.size) != 0) {
+          printf("%-20.20s %3u %6s  round trip FAILED\n",
+                 base_name(opt->files[f]), level, block);
+          ret = 1;
+          continue;
+        }
+        printf("%-20.20s %3u %6s %12zu %12zu %7.3f %11.1f %11.1f\n",
+               base_name(opt->files[f]), level, block, b.size, b.comp_size,
+               b.comp_size ? (double)b.size / b.comp_size : 0.0,
+               (double)b.size / ct / 1e6, (double)b.size / dt / 1e6);
+        fflush(stdout);
+      }
     }
 
-    out_sz = zyphrax_decompress(in_buf, fsize, out_buf, cap);
-    if (out_sz == 0) {
-      fprintf(stderr,
-              "Decompression not fully implemented or failed (Phase 9)\n");
+  next:
+    free(src);
+    free(b.comp);
+    free(b.dec);
+  }
+  zyphrax_cctx_free(cctx);
+  zyphrax_dctx_free(dctx);
+  return ret;
+}
+
+// -------------------------------------------------------------------------
+// Command Line
+// -------------------------------------------------------------------------
+
+static void print_usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-d] [-1..-9] [-B<size>] [-T<threads>] [input [output]]\n"
+          "       %s -b[#] [-e#] [-B<size>[,<size>...]] [-i<sec>] "
+          "[-T<threads>] file...\n"
+          "  -d          decompress\n"
+          "  -1..-9      compression level (default %d)\n"
+          "  -B<size>    block size, K/M suffixes allowed (default 64K, "
+          "max 16M-1)\n"
+          "  -T<n>       worker threads (default / 0: all cores)\n"
+          "  -b[#]       benchmark the files in memory, from level # (default: "
+          "the -# level)\n"
+          "  -e#         last benchmark level (default: the first)\n"
+          "  -B<a>,<b>   benchmark each block size\n"
+          "  -i<sec>     minimum time per measurement (default 1)\n"
+          "A missing or '-' input reads stdin; a missing or '-' output "
+          "writes stdout.\n",
+          prog, prog, DEFAULT_LEVEL);
+}
+
+// Size with an optional K or M suffix; 0 if malformed
+static uint64_t parse_size(const char *s, char **end) {
+  unsigned long long v = strtoull(s, end, 10);
+  if (*end == s)
+    return 0;
+  if (**end == 'K' || **end == 'k')
+    v <<= 10, (*end)++;
+  else if (**end == 'M' || **end == 'm')
+    v <<= 20, (*end)++;
+  return v;
+}
+
+// Comma-separated block sizes; -1 if any is malformed or out of range
+static int parse_blocks(const char *s, options_t *opt) {
+  opt->nb_blocks = 0;
+  for (;;) {
+    char *end;
+    uint64_t size = parse_size(s, &end);
+    if (size == 0 || size > 0xFFFFFF || opt->nb_blocks == MAX_BENCH_BLOCKS ||
+        (*end != '\0' && *end != ','))
+      return -1;
+    opt->blocks[opt->nb_blocks++] = (uint32_t)size;
+    if (*end == '\0')
+      return 0;
+    s = end + 1;
+  }
+}
+
+// Single digit level after a flag letter; 0 if malformed
+static uint32_t parse_level(const char *s) {
+  return s[0] >= '1' && s[0] <= '9' && s[1] == '\0' ? (uint32_t)(s[0] - '0')
+                                                     : 0;
+}
+
+static int parse_args(int argc, char **argv, options_t *opt) {
+  memset(opt, 0, sizeof(*opt));
+  opt->params.level = DEFAULT_LEVEL;
+  opt->blocks[0] = ZYPHRAX_BLOCK_SIZE;
+  opt->nb_blocks = 1;
+  opt->threads = cpu_count();
+  opt->in_path = "-";
+  opt->out_path = "-";
+  opt->bench_secs = 1.0;
+  // Paths are gathered at the front of argv, after the program name
+  opt->files = (const char **)argv + 1;
+
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    if (a[0] != '-' || a[1] == '\0') {
+      argv[1 + opt->nb_files++] = argv[i];
+    } else if (strcmp(a, "-d") == 0) {
+      opt->decompress = 1;
+    } else if (parse_level(a + 1)) {
+      opt->params.level = parse_level(a + 1);
+    } else if (a[1] == 'b') {
+      opt->bench = 1;
+      if (a[2] && !(opt->params.level = parse_level(a + 2))) {
+        fprintf(stderr, "Invalid level: %s\n", a + 2);
+        return -1;
+      }
+    } else if (a[1] == 'e') {
+      if (!(opt->level_end = parse_level(a + 2))) {
+        fprintf(stderr, "Invalid level: %s\n", a + 2);
+        return -1;
+      }
+    } else if (a[1] == 'B') {
+      if (parse_blocks(a + 2, opt) != 0) {
+        fprintf(stderr, "Invalid block size: %s\n", a + 2);
+        return -1;
+      }
+    } else if (a[1] == 'i') {
+      char *end;
+      double secs = strtod(a + 2, &end);
+      if (end == a + 2 || *end != '\0' || secs < 0) {
+        fprintf(stderr, "Invalid benchmark time: %s\n", a + 2);
+        return -1;
+      }
+      opt->bench_secs = secs;
+    } else if (a[1] == 'T') {
+      char *end;
+      unsigned long n = strtoul(a + 2, &end, 10);
+      if (end == a + 2 || *end != '\0' || n > 1024) {
+        fprintf(stderr, "Invalid thread count: %s\n", a + 2);
+        return -1;
+      }
+      opt->threads = n ? (unsigned)n : cpu_count();
     } else {
-      fwrite(out_buf, 1, out_sz, fout);
-      printf("Decompressed %ld -> %zu bytes\n", fsize, out_sz);
+      fprintf(stderr, "Unknown option: %s\n", a);
+      return -1;
     }
-    free(out_buf);
   }
 
-  clock_t end = clock();
-  double secs = (double)(end - start) / CLOCKS_PER_SEC;
-  printf("Time: %.3fs\n", secs);
+  opt->params.block_size = opt->blocks[0];
+  if (opt->bench) {
+    if (opt->level_end < opt->params.level)
+      opt->level_end = opt->params.level;
+    return opt->nb_files > 0 ? 0 : -1;
+  }
+  if (opt->nb_blocks > 1 || opt->nb_files > 2)
+    return -1;
+  if (opt->nb_files > 0)
+    opt->in_path = opt->files[0];
+  if (opt->nb_files > 1)
+    opt->out_path = opt->files[1];
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  options_t opt;
+  if (parse_args(argc, argv, &opt) != 0) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  if (opt.bench)
+    return bench_files(&opt);
+#ifndef _WIN32
+  if (!opt.decompress && is_std(opt.out_path) && isatty(STDOUT_FILENO)) {
+    fprintf(stderr, "Refusing to write compressed data to a terminal\n");
+    print_usage(argv[0]);
+    return 1;
+  }
+#endif
+
+  input_t in;
+  if (input_open(&in, opt.in_path) != 0) {
+    perror("Error opening input");
+    input_close(&in);
+    return 1;
+  }
 
-  free(in_buf);
-  fclose(fout);
+  double start = now_sec();
+  uint64_t in_sz = 0, out_sz = 0;
+  int err;
+#ifndef _WIN32
+  if (opt.decompress && in.map && opt.threads > 1 &&
+      output_mappable(opt.out_path)) {
+    err = decompress_mapped(&in, opt.out_path, opt.threads, &out_sz);
+    in_sz = in.size;
+  } else
+#endif
+  {
+    output_t out;
+    if (output_open(&out, opt.out_path) != 0) {
+      perror("Error opening output");
+      input_close(&in);
+      return 1;
+    }
+    err = opt.decompress ? decompress_stream(&in, &out, &in_sz)
+                         : compress_file(&in, &out, &opt, &in_sz);
+    if (output_close(&out, &out_sz) != 0)
+      err = -1;
+  }
+  input_close(&in);
+  if (err)
+    return 1;
+
+  // Reports go to stderr: stdout may be carrying the data
+  double secs = now_sec() - start;
+  // Throughput is measured on the uncompressed side either way
+  uint64_t raw = opt.decompress ? out_sz : in_sz;
+  double mbps = secs > 0 ? (double)raw / secs / 1e6 : 0.0;
+  if (opt.decompress) {
+    fprintf(stderr, "Decompressed %llu -> %llu bytes\n",
+            (unsigned long long)in_sz, (unsigned long long)out_sz);
+  } else {
+    double ratio = in_sz ? (double)out_sz * 100.0 / in_sz : 0.0;
+    fprintf(stderr, "Compressed %llu -> %llu bytes (%.2f%%)\n",
+            (unsigned long long)in_sz, (unsigned long long)out_sz, ratio);
+  }
+  fprintf(stderr, "Time: %.3fs (%.1f MB/s)\n", secs, mbps);
   return 0;
 }
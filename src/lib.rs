@@ -1,6 +1,15 @@
 use libc::{size_t, c_uint};
 use std::ptr;
 
+/// Append a block index footer (enables range decompression)
+pub const FLAG_SEEK_TABLE: u32 = 1 << 0;
+/// Store the total decompressed size in the frame header
+pub const FLAG_CONTENT_SIZE: u32 = 1 << 1;
+/// Cut blocks early where the data's statistics shift (mixed content)
+pub const FLAG_SPLIT_BLOCKS: u32 = 1 << 2;
+
+const CONTENT_SIZE_ERROR: u64 = u64::MAX;
+
 // Raw FFI
 #[repr(C)]
 #[derive(Debug, Clone, Copy)]
@@ -8,6 +17,7 @@ pub struct ZyphraxParams {
     pub level: u32,
     pub block_size: u32,
     pub checksum: u32,
+    pub flags: u32,
 }
 
 impl Default for ZyphraxParams {
@@ -16,12 +26,13 @@ impl Default for ZyphraxParams {
             level: 3,
             block_size: 64 * 1024,
             checksum: 0,
+            flags: FLAG_CONTENT_SIZE,
         }
     }
 }
 
 extern "C" {
-    fn zyphrax_compress_bound(src_size: size_t) -> size_t;
+    fn zyphrax_compress_bound_params(src_size: size_t, params: *const ZyphraxParams) -> size_t;
     fn zyphrax_compress(
         src: *const u8,
         src_size: size_t,
@@ -35,12 +46,13 @@ extern "C" {
         dst: *mut u8,
         dst_cap: size_t,
     ) -> size_t;
+    fn zyphrax_get_content_size(src: *const u8, src_size: size_t) -> u64;
 }
 
 // Safe Rust API
 pub fn compress(data: &[u8], params: Option<ZyphraxParams>) -> Vec<u8> {
     let params = params.unwrap_or_default();
-    let bound = unsafe { zyphrax_compress_bound(data.len()) };
+    let bound = unsafe { zyphrax_compress_bound_params(data.len(), &params) };
     let mut out = vec![0u8; bound];
     
     let compressed_size = unsafe {
@@ -62,10 +74,29 @@ pub fn compress(data: &[u8], params: Option<ZyphraxParams>) -> Vec<u8> {
     out
 }
 
+/// Exact decompressed size of a frame (header field, or a walk of the
+/// block headers for frames written without `FLAG_CONTENT_SIZE`).
+pub fn content_size(data: &[u8]) -> Option<u64> {
+    let size = unsafe { zyphrax_get_content_size(data.as_ptr(), data.len()) };
+    if size == CONTENT_SIZE_ERROR {
+        None
+    } else {
+        Some(size)
+    }
+}
+
+/// Decompresses a frame. Pass `original_size_guess = 0` to size the output
+/// exactly from the frame itself.
 pub fn decompress(data: &[u8], original_size_guess: usize) -> Option<Vec<u8>> {
-    // Phase 9 pending: Decompression currently returns 0 always.
-    // We allocate guess.
-    let mut out = vec![0u8; original_size_guess];
+    let cap = if original_size_guess == 0 {
+        usize::try_from(content_size(data)?).ok()?
+    } else {
+        original_size_guess
+    };
+    if cap == 0 {
+        return Some(Vec::new());
+    }
+    let mut out = vec![0u8; cap];
     
     let res = unsafe {
         zyphrax_decompress(
@@ -90,7 +121,7 @@ mod tests {
 
     #[test]
     fn test_params_layout() {
-        assert_eq!(std::mem::size_of::<ZyphraxParams>(), 12);
+        assert_eq!(std::mem::size_of::<ZyphraxParams>(), 16);
     }
 
     #[test]
@@ -111,4 +142,13 @@ mod tests {
         println!("Ratio: {:.2}%", ratio * 100.0);
         assert!(ratio < 0.1); 
     }
+
+    #[test]
+    fn test_roundtrip_exact_size() {
+        let data: Vec<u8> = (0..200_000u32).map(|i| (i % 251) as u8).collect();
+        let compressed = compress(&data, None);
+        assert_eq!(content_size(&compressed), Some(data.len() as u64));
+        let original = decompress(&compressed, 0).expect("decompress");
+        assert_eq!(original, data);
+    }
 }
@@ -1,5 +1,13 @@
 #include "zyphrax.h"
 #include "zyphrax_block.h"
+#include "zyphrax_dec.h"
+#include "zyphrax_frame.h"
+#include "zyphrax_hash.h"
+#include "zyphrax_mem.h"
+#include "zyphrax_seek.h"
+#include "zyphrax_stats.h"
+#include "zyphrax_trace.h"
+#include <stdlib.h>
 #include <string.h>
 
 // Internal helper to write 32-bit LE
@@ -16,25 +24,40 @@ static uint32_t read_u32_le(const uint8_t *p) {
          ((uint32_t)p[3] << 24);
 }
 
+static uint64_t read_u64_le(const uint8_t *p) {
+  return (uint64_t)read_u32_le(p) | ((uint64_t)read_u32_le(p + 4) << 32);
+}
+
 // -------------------------------------------------------------------------
 // Header Implementation
 // -------------------------------------------------------------------------
 
 #define HEADER_SIZE 12
 
-static void build_flags(const zyphrax_params_t *params, uint8_t *flags_out) {
-  uint8_t level = (params->level & 0x7);            // 3 bits
-  uint8_t checksum = (params->checksum & 0x1) << 3; // 1 bit
-  uint8_t raw = 0; // Not raw block in frame header usually
-  uint8_t reserved = 0;
+// Checksums: bit 4 set when the frame is checksummed, bit 3 then picks
+// XXH32 over CRC32C. Bit 4 was never set before checksums existed, so frames
+// from older writers that only set bit 3 still read as unchecksummed.
+#define FLAG_SUM_KIND (1u << 3)
+#define FLAG_SUM (1u << 4)
 
-  *flags_out = level | checksum | (raw << 4) | (reserved << 5);
+static void build_flags(const zyphrax_params_t *params, uint8_t *flags_out) {
+  uint8_t level = params->level < 7 ? params->level : 7; // 3 bits, 7 = 7+
+  uint8_t checksum = 0;
+  if (params->checksum != ZYPHRAX_CHECKSUM_NONE)
+    checksum = FLAG_SUM |
+               (params->checksum == ZYPHRAX_CHECKSUM_XXH32 ? FLAG_SUM_KIND : 0);
+  uint8_t features = (params->flags & 0x7); // 3 bits: ZYPHRAX_FLAG_*
+
+  *flags_out = level | checksum | (features << 5);
 }
 
 static void parse_flags(uint8_t flags_in, zyphrax_params_t *params) {
   params->level = flags_in & 0x7;
-  params->checksum = (flags_in >> 3) & 0x1;
-  // raw and reserved ignored for params struct
+  params->checksum = ZYPHRAX_CHECKSUM_NONE;
+  if (flags_in & FLAG_SUM)
+    params->checksum = (flags_in & FLAG_SUM_KIND) ? ZYPHRAX_CHECKSUM_XXH32
+                                                  : ZYPHRAX_CHECKSUM_CRC32C;
+  params->flags = (flags_in >> 5) & 0x7;
 }
 
 void zyphrax_write_header_internal(uint8_t *dst,
@@ -52,8 +75,11 @@ void zyphrax_write_header_internal(uint8_t *dst,
   uint32_t word1 = (block_size & 0xFFFFFF) | ((uint32_t)flags << 24);
   write_u32_le(dst + 4, word1);
 
-  // Checksum: Placeholder 0 for now (or TODO: Implement CRC)
-  write_u32_le(dst + 8, 0x00000000);
+  // Checksum of the magic and descriptor, 0 in unchecksummed frames
+  uint32_t sum = 0;
+  if (params->checksum != ZYPHRAX_CHECKSUM_NONE)
+    sum = zyphrax_hash((int)params->checksum, dst, 8);
+  write_u32_le(dst + 8, sum);
 }
 
 int zyphrax_read_header_internal(const uint8_t *src, zyphrax_params_t *params) {
@@ -68,25 +94,75 @@ int zyphrax_read_header_internal(const uint8_t *src, zyphrax_params_t *params) {
   parse_flags(flags, params);
   params->block_size = block_size;
 
-  // Checksum validation skipped for now
+  if (params->checksum != ZYPHRAX_CHECKSUM_NONE &&
+      read_u32_le(src + 8) != zyphrax_hash((int)params->checksum, src, 8))
+    return -1; // Corrupt header
 
   return 0;
 }
 
+size_t zyphrax_frame_header_size(const zyphrax_params_t *params) {
+  size_t size = HEADER_SIZE;
+  if (params->flags & ZYPHRAX_FLAG_CONTENT_SIZE)
+    size += ZYPHRAX_CONTENT_SIZE_FIELD;
+  return size;
+}
+
+int zyphrax_read_frame_internal(const uint8_t *src, size_t src_size,
+                                zyphrax_frame_t *frame) {
+  if (src_size < HEADER_SIZE)
+    return -1;
+  if (zyphrax_read_header_internal(src, &frame->params) != 0)
+    return -1;
+
+  frame->header_size = zyphrax_frame_header_size(&frame->params);
+  if (src_size < frame->header_size)
+    return -1;
+
+  frame->content_size = ZYPHRAX_CONTENT_SIZE_ERROR;
+  if (frame->params.flags & ZYPHRAX_FLAG_CONTENT_SIZE)
+    frame->content_size = read_u64_le(src + HEADER_SIZE);
+  return 0;
+}
+
 // -------------------------------------------------------------------------
 // Public API
 // -------------------------------------------------------------------------
 
+// Everything a frame of content_size bytes may add to its blocks' input:
+// header, block headers, checksums and seek table. Every block may fall
+// back to raw storage, [2][Size:4][Bytes], 5 bytes over its input.
+static uint64_t frame_overhead(uint64_t content_size,
+                               const zyphrax_params_t *params) {
+  uint64_t block_size = params->block_size ? params->block_size
+                                           : ZYPHRAX_BLOCK_SIZE;
+  uint64_t nb_blocks = (content_size + block_size - 1) / block_size;
+  if (params->flags & ZYPHRAX_FLAG_SPLIT_BLOCKS)
+    nb_blocks *= 4; // Each window may be cut in up to 4 blocks
+
+  uint64_t size = zyphrax_frame_header_size(params) +
+                  nb_blocks * ZYPHRAX_BLOCK_HDR_RAW;
+  if (params->checksum != ZYPHRAX_CHECKSUM_NONE)
+    size += nb_blocks * ZYPHRAX_BLOCK_SUM_SIZE + ZYPHRAX_SUM_BLOCK_SIZE;
+  if (params->flags & ZYPHRAX_FLAG_SEEK_TABLE)
+    size += zyphrax_seek_table_size(nb_blocks);
+  return size;
+}
+
 size_t zyphrax_compress_bound(size_t src_size) {
   // Header (12) + src_size + worst case overhead
-  // For raw storage worst case: src + header + block_headers (1 byte/block?)
-  // If block size is 64KB, we have src_size / 64KB blocks.
-  // Each block has 1 byte overhead for raw flag, plus potentially internal
-  // overhead logic. Huffman overhead is ~384 bytes per block if compressed. But
-  // we fallback to raw if expansion. Raw fallback is: src + 1. So per block
-  // worst case is src_block + 1. Num blocks = (src + 65535) / 65536. Total
-  // overhead = 12 + NumBlocks. Just to be safe: + 64 bytes base + src/255.
-  return src_size + (src_size / 255) + 256;
+  // Per block: raw fallback header (5), checksum (4), seek table entry
+  // (16): 25 bytes, under src/64 for blocks of 4KB and up. Smaller blocks
+  // need zyphrax_compress_bound_params.
+  // Base: header, last partial block, table overhead -> 512 bytes.
+  return src_size + (src_size / 64) + 512;
+}
+
+size_t zyphrax_compress_bound_params(size_t src_size,
+                                     const zyphrax_params_t *params) {
+  zyphrax_params_t defaults = {0};
+  return src_size +
+         (size_t)frame_overhead(src_size, params ? params : &defaults);
 }
 
 #ifndef min
@@ -95,247 +171,356 @@ size_t zyphrax_compress_bound(size_t src_size) {
 
 size_t zyphrax_compress(const uint8_t *src, size_t src_size, uint8_t *dst,
                         size_t dst_cap, const zyphrax_params_t *params) {
-  if (dst_cap < 12)
+  // Single-threaded context, used for this call only
+  zyphrax_cctx_t *cctx = zyphrax_cctx_create(1);
+  if (!cctx)
     return 0;
+  size_t res = zyphrax_compress_cctx(cctx, src, src_size, dst, dst_cap, params);
+  zyphrax_cctx_free(cctx);
+  return res;
+}
 
-  // Use defaults if params is NULL? Or assume valid.
-  // Let's copy to local to handle defaults
-  zyphrax_params_t p = *params;
-  if (p.block_size == 0)
-    p.block_size = ZYPHRAX_BLOCK_SIZE;
+// -------------------------------------------------------------------------
+// Frames
+// -------------------------------------------------------------------------
 
+size_t zyphrax_write_skippable_frame(const uint8_t *data, size_t size,
+                                     uint8_t *dst, size_t dst_cap) {
+  if (size > 0xFFFFFFFFu || dst_cap < ZYPHRAX_SKIPPABLE_HEADER_SIZE ||
+      size > dst_cap - ZYPHRAX_SKIPPABLE_HEADER_SIZE)
+    return 0;
+  write_u32_le(dst, ZYPHRAX_SKIPPABLE_MAGIC);
+  write_u32_le(dst + 4, (uint32_t)size);
+  if (size)
+    memcpy(dst + ZYPHRAX_SKIPPABLE_HEADER_SIZE, data, size);
+  return ZYPHRAX_SKIPPABLE_HEADER_SIZE + size;
+}
+
+size_t zyphrax_find_frame_size(const uint8_t *src, size_t src_size) {
+  size_t skip = zyphrax_skippable_frame_size(src, src_size);
+  if (skip)
+    return skip;
+
+  zyphrax_frame_t frame;
+  if (zyphrax_read_frame_internal(src, src_size, &frame) != 0)
+    return 0;
+  size_t pos = frame.header_size;
+  while (pos < src_size && !zyphrax_is_frame_start(src + pos, src_size - pos)) {
+    zyphrax_block_info_t info;
+    if (zyphrax_read_block_info(src + pos, src_size - pos,
+                                frame.params.block_size, &info) != 0)
+      return 0;
+    pos += info.hdr_size + info.comp_size;
+  }
+  return pos;
+}
+
+// Decodes the frame at src, which ends with src or where the next frame
+// starts. On success *in_size and *out_size are its compressed and decoded
+// sizes. With a sink, every block is passed on to it. Returns 0, or -1 on
+// error.
+static int decompress_frame_ws(zyphrax_dec_ws_t *ws, const uint8_t *src,
+                               size_t src_size, uint8_t *dst, size_t dst_cap,
+                               size_t *in_size, size_t *out_size,
+                               zyphrax_stats_sink_t *sink) {
+  zyphrax_frame_t frame;
+  if (zyphrax_read_frame_internal(src, src_size, &frame) != 0)
+    return -1;
+
+  // Known size: fail fast instead of decoding into a short buffer
+  if (frame.content_size != ZYPHRAX_CONTENT_SIZE_ERROR &&
+      frame.content_size > dst_cap)
+    return -1;
+
+  const uint8_t *in = src + frame.header_size; // Skip header
+  const uint8_t *in_end = src + src_size;
   uint8_t *out = dst;
   uint8_t *out_end = dst + dst_cap;
+  zyphrax_frame_sum_t sum;
+  zyphrax_frame_sum_init(&sum, (int)frame.params.checksum);
+
+  while (in < in_end && !zyphrax_is_frame_start(in, in_end - in)) {
+    zyphrax_block_info_t info;
+    if (zyphrax_read_block_info(in, in_end - in, frame.params.block_size,
+                                &info) != 0 ||
+        zyphrax_frame_sum_block(&sum, in, &info) != 0)
+      return -1;
+
+    size_t dec =
+        zyphrax_decompress_block_ws(ws, in, &info, out, out_end - out);
+    if (dec != info.orig_size)
+      return -1;
+    if (sink && sink->block.blocks) {
+      zyphrax_stats_done(sink, &sink->block);
+      memset(&sink->block, 0, sizeof(sink->block));
+    }
+
+    // Skip to next block using exact compressed size
+    in += info.hdr_size + info.comp_size;
+    out += dec;
+  }
 
-  zyphrax_write_header_internal(out, &p);
-  out += 12;
+  if (zyphrax_frame_sum_end(&sum) != 0)
+    return -1; // Checksum block missing
+  if (frame.content_size != ZYPHRAX_CONTENT_SIZE_ERROR &&
+      frame.content_size != (uint64_t)(out - dst))
+    return -1; // Frame disagrees with its own header
 
-  size_t pos = 0;
-  while (pos < src_size) {
-    size_t block_size = min(p.block_size, src_size - pos);
-    size_t rem_cap = out_end - out;
+  *in_size = in - src;
+  *out_size = out - dst;
+  return 0;
+}
 
-    size_t block_enc =
-        zyphrax_compress_block(src + pos, block_size, out, rem_cap, &p);
+// Every frame in src, skipping skippable frames
+static size_t decompress_frames_ws(zyphrax_dec_ws_t *ws, const uint8_t *src,
+                                   size_t src_size, uint8_t *dst,
+                                   size_t dst_cap,
+                                   zyphrax_stats_sink_t *sink) {
+  ws->stats = sink ? &sink->block : NULL;
+  size_t in = 0;
+  size_t out = 0;
+  while (in < src_size) {
+    size_t skip = zyphrax_skippable_frame_size(src + in, src_size - in);
+    if (skip) {
+      in += skip;
+      continue;
+    }
+    size_t in_size = 0, out_size = 0;
+    ZYPHRAX_PROBE2(frame_decompress_start, in, src_size - in);
+    int err = decompress_frame_ws(ws, src + in, src_size - in, dst + out,
+                                  dst_cap - out, &in_size, &out_size, sink);
+    ZYPHRAX_PROBE2(frame_decompress_end, in_size, out_size);
+    if (err)
+      return 0;
+    in += in_size;
+    out += out_size;
+  }
+  return out;
+}
 
-    if (block_enc == 0)
-      return 0; // Error / overflow
+size_t zyphrax_decompress(const uint8_t *src, size_t src_size, uint8_t *dst,
+                          size_t dst_cap) {
+  zyphrax_dec_ws_t ws;
+  return decompress_frames_ws(&ws, src, src_size, dst, dst_cap, NULL);
+}
 
-    out += block_enc;
-    pos += block_size;
+// Every item on ws: its tables are rebuilt per block but set up once
+static size_t decompress_batch_ws(zyphrax_dec_ws_t *ws,
+                                  zyphrax_batch_item_t *items, size_t count,
+                                  zyphrax_stats_sink_t *sink) {
+  size_t ok = 0;
+  for (size_t i = 0; i < count; i++) {
+    items[i].result = decompress_frames_ws(ws, items[i].src, items[i].src_size,
+                                           items[i].dst, items[i].dst_cap,
+                                           sink);
+    ok += items[i].result != 0;
   }
+  return ok;
+}
 
-  return out - dst;
+size_t zyphrax_decompress_batch(zyphrax_batch_item_t *items, size_t count) {
+  zyphrax_dec_ws_t ws;
+  return decompress_batch_ws(&ws, items, count, NULL);
 }
 
-#include "zyphrax_dec.h"
+// -------------------------------------------------------------------------
+// Decompression Context
+// -------------------------------------------------------------------------
 
-// Decompression Helper: Read Bits
-typedef struct {
-  const uint8_t *ptr;
-  const uint8_t *end;
-  uint64_t bit_buf;
-  int bit_count;
-} z_bit_reader;
-
-static inline void refill_bits(z_bit_reader *br) {
-  while (br->bit_count <= 56 && br->ptr < br->end) {
-    br->bit_buf |= ((uint64_t)(*br->ptr++)) << br->bit_count;
-    br->bit_count += 8;
-  }
+struct zyphrax_dctx_s {
+  zyphrax_dec_ws_t ws;
+  zyphrax_allocator_t alloc;
+  int is_static;
+  zyphrax_stats_sink_t stats;
+  zyphrax_dec_workers_t workers; // zyphrax_decompress_dctx_mt, kept
+};
+
+zyphrax_dctx_t *zyphrax_dctx_create(const zyphrax_allocator_t *alloc) {
+  zyphrax_dctx_t *dctx = zyphrax_malloc(alloc, sizeof(*dctx));
+  if (!dctx)
+    return NULL;
+  memset(&dctx->alloc, 0, sizeof(dctx->alloc));
+  if (alloc)
+    dctx->alloc = *alloc;
+  dctx->is_static = 0;
+  dctx->workers.pool = NULL;
+  dctx->workers.ws = NULL;
+  zyphrax_stats_set(&dctx->stats, 0, NULL, NULL);
+  return dctx;
 }
 
-static inline uint16_t peek_bits(z_bit_reader *br, int n) {
-  return (uint16_t)(br->bit_buf & ((1 << n) - 1));
+void zyphrax_dctx_free(zyphrax_dctx_t *dctx) {
+  if (!dctx || dctx->is_static)
+    return;
+  zyphrax_dec_workers_free(&dctx->workers, &dctx->alloc);
+  zyphrax_allocator_t alloc = dctx->alloc;
+  zyphrax_free(&alloc, dctx);
 }
 
-static inline void consume_bits(z_bit_reader *br, int n) {
-  br->bit_buf >>= n;
-  br->bit_count -= n;
+size_t zyphrax_dctx_workspace_size(void) {
+  return ZYPHRAX_ARENA_SLACK + zyphrax_arena_round(sizeof(zyphrax_dctx_t));
 }
 
-static inline uint16_t read_bits(z_bit_reader *br, int n) {
-  uint16_t val = peek_bits(br, n);
-  consume_bits(br, n);
-  return val;
+zyphrax_dctx_t *zyphrax_dctx_init_static(void *workspace, size_t size) {
+  zyphrax_arena_t arena;
+  zyphrax_arena_init(&arena, workspace, size);
+  zyphrax_allocator_t alloc = zyphrax_arena_allocator(&arena);
+  zyphrax_dctx_t *dctx = zyphrax_malloc(&alloc, sizeof(*dctx));
+  if (!dctx)
+    return NULL;
+  memset(&dctx->alloc, 0, sizeof(dctx->alloc));
+  dctx->is_static = 1;
+  dctx->workers.pool = NULL;
+  dctx->workers.ws = NULL;
+  zyphrax_stats_set(&dctx->stats, 0, NULL, NULL);
+  return dctx;
 }
 
-// Decode symbol using table
-static inline uint16_t decode_sym(z_bit_reader *br,
-                                  const zyphrax_huff_decoder *dec) {
-  refill_bits(br);
-  // Peek 15 bits max table size
-  uint16_t look = peek_bits(br, 15);
-  uint16_t entry = dec->table[look];
-  // Entry: [sym:8][bits:8]
-  uint8_t bits = entry & 0xFF;
-  uint8_t sym = entry >> 8;
-  consume_bits(br, bits);
-  return sym;
+size_t zyphrax_decompress_dctx(zyphrax_dctx_t *dctx, const uint8_t *src,
+                               size_t src_size, uint8_t *dst, size_t dst_cap) {
+  zyphrax_stats_sink_t *sink = NULL;
+  if (dctx->stats.on) {
+    sink = &dctx->stats;
+    zyphrax_stats_begin(sink, sizeof(*dctx));
+  }
+  return decompress_frames_ws(&dctx->ws, src, src_size, dst, dst_cap, sink);
 }
 
-static size_t read_start_extra(z_bit_reader *br) {
-  size_t val = 0;
-  int max_iter = 100; // Safety limit
-  while (max_iter-- > 0) {
-    refill_bits(br);
-    if (br->ptr >= br->end && br->bit_count < 8)
-      break; // No more data
-    uint8_t b = read_bits(br, 8);
-    val += b;
-    if (b < 255)
-      break;
+size_t zyphrax_decompress_batch_dctx(zyphrax_dctx_t *dctx,
+                                     zyphrax_batch_item_t *items,
+                                     size_t count) {
+  zyphrax_stats_sink_t *sink = NULL;
+  if (dctx->stats.on) {
+    sink = &dctx->stats;
+    zyphrax_stats_begin(sink, sizeof(*dctx));
   }
-  return val;
+  return decompress_batch_ws(&dctx->ws, items, count, sink);
 }
 
-size_t zyphrax_decompress(const uint8_t *src, size_t src_size, uint8_t *dst,
-                          size_t dst_cap) {
-  if (src_size < 12)
+size_t zyphrax_decompress_dctx_mt(zyphrax_dctx_t *dctx, const uint8_t *src,
+                                  size_t src_size, uint8_t *dst,
+                                  size_t dst_cap, unsigned nb_threads) {
+  if (nb_threads <= 1)
+    return zyphrax_decompress_dctx(dctx, src, src_size, dst, dst_cap);
+  if (dctx->is_static) // No room for workers: decode on the workspace
+    return zyphrax_decompress_dctx(dctx, src, src_size, dst, dst_cap);
+  if (dctx->workers.pool &&
+      zyphrax_pool_size(dctx->workers.pool) != nb_threads)
+    zyphrax_dec_workers_free(&dctx->workers, &dctx->alloc);
+  zyphrax_stats_sink_t *sink = NULL;
+  if (dctx->stats.on) {
+    sink = &dctx->stats;
+    zyphrax_stats_begin(sink, sizeof(*dctx) +
+                                  nb_threads * sizeof(zyphrax_dec_ws_t));
+  }
+  return zyphrax_decompress_frames_mt(src, src_size, dst, dst_cap, nb_threads,
+                                      &dctx->workers, &dctx->alloc, 1, sink);
+}
+
+void zyphrax_dctx_set_stats(zyphrax_dctx_t *dctx, int enable,
+                            zyphrax_stats_fn fn, void *opaque) {
+  zyphrax_stats_set(&dctx->stats, enable, fn, opaque);
+}
+
+void zyphrax_dctx_get_stats(const zyphrax_dctx_t *dctx,
+                            zyphrax_stats_t *stats) {
+  *stats = dctx->stats.total;
+}
+
+size_t zyphrax_decompress_range_dctx(zyphrax_dctx_t *dctx, const uint8_t *src,
+                                     size_t src_size, uint64_t offset,
+                                     size_t len, uint8_t *dst) {
+  if (dctx->is_static)
+    return 0; // The block index does not fit the workspace
+  return zyphrax_decompress_range_ws(&dctx->ws, src, src_size, offset, len,
+                                     dst, &dctx->alloc);
+}
+
+// -------------------------------------------------------------------------
+// In-place Decompression
+// -------------------------------------------------------------------------
+// Layout: [output grows ->          ][<- compressed frame at the tail]
+// Invariant: out <= in (write pointer never passes the read pointer).
+// Raw blocks keep it trivially (memmove, output <= input). A compressed block
+// is only decoded when its whole output ends before its payload starts, so
+// the bit reader never sees bytes the decoder has already overwritten.
+//
+// Margin: with the frame right-aligned in content + margin bytes, block k is
+// safe when margin >= enc_k + sum_{j>k}(enc_j - orig_j) + trailer. Blocks
+// never exceed orig + 5 (raw fallback), and the frame itself must fit, hence
+// header + block_size + 5 * nb_blocks + seek table (and, checksummed, 4 more
+// bytes per block plus the checksum block).
+
+size_t zyphrax_inplace_margin(uint64_t content_size,
+                              const zyphrax_params_t *params) {
+  uint64_t block_size = params->block_size ? params->block_size
+                                           : ZYPHRAX_BLOCK_SIZE;
+  uint64_t largest = content_size < block_size ? content_size : block_size;
+  return (size_t)(frame_overhead(content_size, params) + largest);
+}
+
+size_t zyphrax_decompress_inplace(uint8_t *buf, size_t buf_size,
+                                  size_t src_size) {
+  if (src_size > buf_size)
     return 0;
 
-  zyphrax_params_t params;
-  if (zyphrax_read_header_internal(src, &params) != 0)
+  const uint8_t *src = buf + (buf_size - src_size);
+  zyphrax_frame_t frame;
+  if (zyphrax_read_frame_internal(src, src_size, &frame) != 0)
     return 0;
 
-  const uint8_t *in = src + 12; // Skip header
+  const uint8_t *in = src + frame.header_size;
   const uint8_t *in_end = src + src_size;
-  uint8_t *out = dst;
-  uint8_t *out_end = dst + dst_cap;
+  uint8_t *out = buf;
+  zyphrax_frame_sum_t sum;
+  zyphrax_frame_sum_init(&sum, (int)frame.params.checksum);
 
   while (in < in_end) {
-    // Read Block Type
-    if (in >= in_end)
-      break;
-    uint8_t type = *in++;
-
-    if (type == 0) { // Raw
-      // We don't store raw block size in header.
-      // RAW format assumes we know size? Or "rest of stream"?
-      // Block format flaw here: Raw mode uses "store_raw" which writes
-      // [0][Bytes]. It doesn't write length! Assuming raw is ONLY used for
-      // fallback of entire buffer. Or fixed block size. Default block size
-      // check:
-      size_t rem_in = in_end - in;
-      size_t rem_out = out_end - out;
-      size_t chunk = (rem_in < params.block_size) ? rem_in : params.block_size;
-      if (chunk > rem_out)
-        return 0; // Overflow
-      memcpy(out, in, chunk);
-      in += chunk;
-      out += chunk;
-      continue;
-    }
-
-    // Compressed Block
-    // 1. Read OrigSize (4 bytes little-endian)
-    if (in + 8 > in_end)
-      return 0;
-    uint32_t orig_size = in[0] | (in[1] << 8) | (in[2] << 16) | (in[3] << 24);
-    in += 4;
-    // 2. Read CompSize (4 bytes little-endian)
-    uint32_t comp_size = in[0] | (in[1] << 8) | (in[2] << 16) | (in[3] << 24);
-    in += 4;
-
-    // Remember block data start
-    const uint8_t *block_data_start = in;
-
-    // 3. Read Tables
-    // [Token:128][Lit:128][Off:128] = 384 bytes
-    if (in + 384 > in_end)
+    zyphrax_block_info_t info;
+    if (zyphrax_read_block_info(in, in_end - in, frame.params.block_size,
+                                &info) != 0 ||
+        zyphrax_frame_sum_block(&sum, in, &info) != 0)
       return 0;
 
-    uint8_t token_lens[256];
-    uint8_t lit_lens[256];
-    uint8_t off_lens[256];
-
-    for (int i = 0; i < 256; i += 2) {
-      uint8_t b = *in++;
-      token_lens[i] = (b >> 4);
-      token_lens[i + 1] = (b & 0xF);
-    }
-    for (int i = 0; i < 256; i += 2) {
-      uint8_t b = *in++;
-      lit_lens[i] = (b >> 4);
-      lit_lens[i + 1] = (b & 0xF);
-    }
-    for (int i = 0; i < 256; i += 2) {
-      uint8_t b = *in++;
-      off_lens[i] = (b >> 4);
-      off_lens[i + 1] = (b & 0xF);
-    }
+    // Reads and writes must not converge inside a compressed block
+    if ((info.type == ZYPHRAX_BLOCK_COMPRESSED ||
+         info.type == ZYPHRAX_BLOCK_LZ) &&
+        (size_t)(in + info.hdr_size - out) < info.orig_size)
+      return 0; // Margin too small
 
-    // Build Decoders
-    zyphrax_huff_decoder token_dec, lit_dec, off_dec;
-    zyphrax_build_dec_table(&token_dec, token_lens);
-    zyphrax_build_dec_table(&lit_dec, lit_lens);
-    zyphrax_build_dec_table(&off_dec, off_lens);
-
-    // Init Reader
-    z_bit_reader br = {.ptr = in, .end = in_end, .bit_buf = 0, .bit_count = 0};
-
-    // Decode Loop - use orig_size for termination
-    uint8_t *block_start = out;
-
-    while ((size_t)(out - block_start) < orig_size) {
-      // Safety: exit if input exhausted
-      if (br.ptr >= br.end && br.bit_count < 15)
-        break;
-
-      // Decode Token
-      uint8_t token = (uint8_t)decode_sym(&br, &token_dec);
-      size_t t_ll = token >> 4;
-      size_t t_ml = token & 0xF;
-
-      // Lit Len
-      size_t ll = t_ll;
-      if (ll == 15)
-        ll += read_start_extra(&br);
-
-      // Copy Literals
-      if (out + ll > out_end)
-        return 0;
-      for (size_t i = 0; i < ll; i++) {
-        *out++ = (uint8_t)decode_sym(&br, &lit_dec);
-      }
-
-      if ((size_t)(out - block_start) >= orig_size)
-        break;
-
-      // Match - ml = t_ml + 3, plus extra if t_ml==15
-      // Order: Offset FIRST, then Extra Match Len
-      if (t_ml > 0) {
-        // Offset first
-        uint8_t off_hi = (uint8_t)decode_sym(&br, &off_dec);
-        refill_bits(&br);
-        uint8_t off_lo = (uint8_t)read_bits(&br, 8);
-        uint16_t offset = (off_hi << 8) | off_lo;
-
-        if (offset == 0)
-          return 0; // Error
-
-        // Match length
-        size_t ml = t_ml + 3;
-        if (t_ml == 15)
-          ml += read_start_extra(&br);
-
-        // Execute Match
-        if (out + ml > out_end)
-          return 0;
-        const uint8_t *match_src = out - offset;
-        if (match_src < dst)
-          return 0; // Underflow
-
-        for (size_t k = 0; k < ml; k++) {
-          out[k] = match_src[k];
-        }
-        out += ml;
-      }
-    }
+    size_t dec = zyphrax_decompress_block(in, &info, out, info.orig_size);
+    if (dec != info.orig_size)
+      return 0;
 
-    // Skip to next block using exact compressed size
-    in = block_data_start + comp_size;
+    in += info.hdr_size + info.comp_size;
+    out += dec;
   }
 
-  return out - dst;
+  if (zyphrax_frame_sum_end(&sum) != 0)
+    return 0;
+  if (frame.content_size != ZYPHRAX_CONTENT_SIZE_ERROR &&
+      frame.content_size != (uint64_t)(out - buf))
+    return 0;
+
+  return out - buf;
+}
+
+uint64_t zyphrax_get_content_size(const uint8_t *src, size_t src_size) {
+  zyphrax_frame_t frame;
+  if (zyphrax_read_frame_internal(src, src_size, &frame) != 0)
+    return ZYPHRAX_CONTENT_SIZE_ERROR;
+
+  if (frame.content_size != ZYPHRAX_CONTENT_SIZE_ERROR)
+    return frame.content_size;
+
+  zyphrax_seek_entry_t *entries;
+  size_t count;
+  if (zyphrax_frame_entries(src, src_size, &frame, &entries, &count,
+                            NULL) != 0)
+    return ZYPHRAX_CONTENT_SIZE_ERROR;
+  uint64_t total = 0;
+  for (size_t i = 0; i < count; i++)
+    total += entries[i].orig_size;
+  free(entries);
+  return total;
 }
@@ -6,22 +6,427 @@
 #define ZYPHRAX_MAGIC 0x58594659u  // "ZYFX" little-endian
 #define ZYPHRAX_BLOCK_SIZE (64 << 10)  // 64KB
 
+// Skippable frame: [ZYPHRAX_SKIPPABLE_MAGIC][Size:4][Size bytes of metadata]
+// Decoders step over it; it may sit before, between or after frames.
+#define ZYPHRAX_SKIPPABLE_MAGIC 0x53594659u
+#define ZYPHRAX_SKIPPABLE_HEADER_SIZE 8
+
+// Optional frame features (zyphrax_params_t.flags)
+#define ZYPHRAX_FLAG_SEEK_TABLE (1u << 0)   // Append a block index footer
+#define ZYPHRAX_FLAG_CONTENT_SIZE (1u << 1) // Store total size in the header
+#define ZYPHRAX_FLAG_SPLIT_BLOCKS (1u << 2) // Cut blocks where statistics shift
+
+// Compression levels: 1 is fastest, 9 searches hardest; 0 picks the default.
+// Level 1 skips entropy coding (byte-aligned LZ blocks) for speed on both
+// sides at some cost in ratio.
+#define ZYPHRAX_LEVEL_MIN 1
+#define ZYPHRAX_LEVEL_MAX 9
+#define ZYPHRAX_LEVEL_DEFAULT 6
+
+// Checksums (zyphrax_params_t.checksum): every block carries one over its
+// decoded bytes, checked as it is decoded, and the frame one over the block
+// checksums, so missing or reordered blocks fail too
+#define ZYPHRAX_CHECKSUM_NONE 0
+#define ZYPHRAX_CHECKSUM_CRC32C 1 // SSE4.2 / ARMv8 CRC instructions
+#define ZYPHRAX_CHECKSUM_XXH32 2
+
 typedef struct {
-    uint32_t level;      // 1-9
+    uint32_t level;      // 1 = LZ blocks, 2-9 full search, 0 = default
     uint32_t block_size; // 64KB default
-    uint32_t checksum;   // CRC type: 0=None, 1=Adler32, 2=xxHash32 (impl specific)
+    uint32_t checksum;   // ZYPHRAX_CHECKSUM_*
+    uint32_t flags;      // ZYPHRAX_FLAG_* (0 = plain frame)
 } zyphrax_params_t;
 
-// Returns the maximum compressed size for a given input size
+// Returns the maximum compressed size for a given input size, with any
+// params whose block_size is 4KB or more (0 = the 64KB default)
 size_t zyphrax_compress_bound(size_t src_size);
 
+// Maximum compressed size of src_size bytes written with params (NULL =
+// defaults), for any block_size: every block is charged the raw fallback
+// header, its checksum and its seek table entry, as params asks for them
+size_t zyphrax_compress_bound_params(size_t src_size,
+                                     const zyphrax_params_t *params);
+
 // Compresses data into the destination buffer
 // Returns compressed size, or 0 on error (e.g. dst_cap too small)
 size_t zyphrax_compress(const uint8_t *src, size_t src_size,
                         uint8_t *dst, size_t dst_cap,
                         const zyphrax_params_t *params);
 
+// Compression context
+// Keeps the worker pool and per-worker workspaces alive between calls, so
+// repeated compression skips thread and match-finder setup. nb_workers <= 1
+// compresses on the calling thread. Returns NULL on failure
+typedef struct zyphrax_cctx_s zyphrax_cctx_t;
+
+zyphrax_cctx_t *zyphrax_cctx_create(unsigned nb_workers);
+void zyphrax_cctx_free(zyphrax_cctx_t *cctx);
+
+// Custom allocator
+// Every allocation a context makes goes through alloc / free, which get
+// opaque back. alloc returns NULL on failure; memory needs malloc alignment.
+typedef struct {
+    void *(*alloc)(void *opaque, size_t size);
+    void (*free)(void *opaque, void *ptr);
+    void *opaque;
+} zyphrax_allocator_t;
+
+// Same as zyphrax_cctx_create, allocating through alloc (NULL = malloc).
+// Worker thread stacks still come from the system.
+zyphrax_cctx_t *zyphrax_cctx_create_advanced(unsigned nb_workers,
+                                             const zyphrax_allocator_t *alloc);
+
+// Static mode: a single-threaded context living entirely in a caller
+// buffer of zyphrax_cctx_workspace_size(params) bytes. The library never
+// allocates through it; calls with a larger block_size than params fail.
+// The workspace must outlive the context and needs no freeing (passing the
+// context to zyphrax_cctx_free is harmless). Returns NULL if too small
+size_t zyphrax_cctx_workspace_size(const zyphrax_params_t *params);
+zyphrax_cctx_t *zyphrax_cctx_init_static(void *workspace, size_t size,
+                                         const zyphrax_params_t *params);
+
+// Same as zyphrax_compress, on the context's workers. Blocks are compressed
+// in parallel and written in order: the output is byte-identical to
+// zyphrax_compress. Not reentrant: one call per context at a time.
+size_t zyphrax_compress_cctx(zyphrax_cctx_t *cctx, const uint8_t *src,
+                             size_t src_size, uint8_t *dst, size_t dst_cap,
+                             const zyphrax_params_t *params);
+
+// Same as zyphrax_append, on the context's workers
+size_t zyphrax_append_cctx(zyphrax_cctx_t *cctx, uint8_t *dst, size_t dst_size,
+                           size_t dst_cap, const uint8_t *src,
+                           size_t src_size, const zyphrax_params_t *params);
+
+// Batch of independent messages
+// Each item is compressed into its own frame (decodable on its own with
+// zyphrax_decompress). The context's workspaces are reused across items and
+// items are spread over its workers. Every frame carries its own Huffman
+// tables: the format has no table dictionary for a batch to share. result
+// receives the output size, 0 on error. Returns the number of items that
+// succeeded.
+typedef struct {
+    const uint8_t *src;
+    size_t src_size;
+    uint8_t *dst;
+    size_t dst_cap;
+    size_t result;
+} zyphrax_batch_item_t;
+
+size_t zyphrax_compress_batch(zyphrax_cctx_t *cctx,
+                              zyphrax_batch_item_t *items, size_t count,
+                              const zyphrax_params_t *params);
+
+// Decompresses each item's frame into its dst (see zyphrax_compress_batch),
+// all on one set of decoder tables
+size_t zyphrax_decompress_batch(zyphrax_batch_item_t *items, size_t count);
+
+// One-shot multithreaded compression (temporary context)
+size_t zyphrax_compress_mt(const uint8_t *src, size_t src_size,
+                           uint8_t *dst, size_t dst_cap,
+                           const zyphrax_params_t *params,
+                           unsigned nb_threads);
+
+// Fast append
+// Adds src as new blocks at the end of the last frame in dst[0, dst_size)
+// without touching the blocks already there: only the checksum block, the
+// seek table and the content size field (whichever the frame has) are
+// rewritten. The frame keeps its block size, checksum and flags; params
+// (NULL = frame's) only sets the level of the new blocks. The frame must be
+// the last thing in dst. A dst_cap of dst_size +
+// zyphrax_compress_bound_params(src_size, <the frame's params>) always
+// suffices; on error dst[0, dst_size) is left as it was.
+// Returns the new size of dst, or 0 on error
+size_t zyphrax_append(uint8_t *dst, size_t dst_size, size_t dst_cap,
+                      const uint8_t *src, size_t src_size,
+                      const zyphrax_params_t *params);
+
 // Decompresses data into the destination buffer
+// src may hold several frames back to back (and skippable frames): their
+// output is concatenated.
 // Returns decompressed size, or 0 on error
 size_t zyphrax_decompress(const uint8_t *src, size_t src_size,
                           uint8_t *dst, size_t dst_cap);
+
+// Concatenated Frames
+// Size of the frame (or skippable frame) starting at src, found by walking
+// its block headers. Returns 0 if src does not start with a valid one.
+size_t zyphrax_find_frame_size(const uint8_t *src, size_t src_size);
+
+// Writes a skippable frame holding data. Returns its size
+// (ZYPHRAX_SKIPPABLE_HEADER_SIZE + size), or 0 if dst_cap is too small
+size_t zyphrax_write_skippable_frame(const uint8_t *data, size_t size,
+                                     uint8_t *dst, size_t dst_cap);
+
+// Decompression context
+// Holds the Huffman decoding tables (about 200 KB), which zyphrax_decompress
+// otherwise keeps on the stack. Useful on small stacks and in static mode.
+typedef struct zyphrax_dctx_s zyphrax_dctx_t;
+
+zyphrax_dctx_t *zyphrax_dctx_create(const zyphrax_allocator_t *alloc);
+void zyphrax_dctx_free(zyphrax_dctx_t *dctx);
+
+// Static mode: the context lives in a caller buffer of
+// zyphrax_dctx_workspace_size() bytes. Returns NULL if too small
+size_t zyphrax_dctx_workspace_size(void);
+zyphrax_dctx_t *zyphrax_dctx_init_static(void *workspace, size_t size);
+
+// Same as zyphrax_decompress, using the context's tables
+size_t zyphrax_decompress_dctx(zyphrax_dctx_t *dctx, const uint8_t *src,
+                               size_t src_size, uint8_t *dst, size_t dst_cap);
+
+// Same as zyphrax_decompress_batch, using the context's tables (statistics
+// cover the whole batch)
+size_t zyphrax_decompress_batch_dctx(zyphrax_dctx_t *dctx,
+                                     zyphrax_batch_item_t *items,
+                                     size_t count);
+
+// Statistics
+// What a context did with each block, to explain a ratio or a speed without
+// a rebuild. Off by default; when on, every block costs a few clock reads
+// (and every 4 KB a checksummed block hashes, two more).
+// The sequence and match finder counts are filled by compression only.
+// Stage times, summed over blocks:
+//   parse_ns     match finding (level 1: all of the LZ block coding)
+//   tables_ns    histograms and Huffman codes, or decoder tables
+//   coding_ns    bit packing, or decoding (raw copies included)
+//   checksum_ns  block checksums
+typedef struct {
+  uint64_t blocks;        // Blocks written or decoded
+  uint64_t raw_blocks;    // Of those, stored: coding did not pay
+  uint64_t src_bytes;     // Uncompressed bytes
+  uint64_t dst_bytes;     // Compressed bytes, block headers included
+  uint64_t table_bytes;   // Code length tables, part of dst_bytes
+  uint64_t sequences;     // Literal run + match pairs coded
+  uint64_t matches;       // Sequences that end with a match
+  uint64_t literal_bytes; // Coded as literals
+  uint64_t match_bytes;   // Coded as matches; / matches = average length
+  uint64_t searches;      // Match finder lookups
+  uint64_t chain_steps;   // Chain links walked; / searches = average depth
+  uint64_t parse_ns;
+  uint64_t tables_ns;
+  uint64_t coding_ns;
+  uint64_t checksum_ns;
+  uint64_t mem_peak; // Most bytes the context has held (0 in a block's stats)
+} zyphrax_stats_t;
+
+// Called with the stats of one block_size window of input (blocks > 1 when
+// ZYPHRAX_FLAG_SPLIT_BLOCKS cut it), or of one block when decoding
+typedef void (*zyphrax_stats_fn)(const zyphrax_stats_t *block, void *opaque);
+
+// Turns statistics on (enable != 0) or off for the context's later calls.
+// fn, if not NULL, sees every block of zyphrax_compress_cctx and
+// zyphrax_append_cctx in frame order, on the calling thread; batches only
+// add to the totals.
+void zyphrax_cctx_set_stats(zyphrax_cctx_t *cctx, int enable,
+                            zyphrax_stats_fn fn, void *opaque);
+
+// Totals of the context's last call (all zero while statistics are off)
+void zyphrax_cctx_get_stats(const zyphrax_cctx_t *cctx,
+                            zyphrax_stats_t *stats);
+
+// Same for decompression: fn sees every block of zyphrax_decompress_dctx
+void zyphrax_dctx_set_stats(zyphrax_dctx_t *dctx, int enable,
+                            zyphrax_stats_fn fn, void *opaque);
+void zyphrax_dctx_get_stats(const zyphrax_dctx_t *dctx,
+                            zyphrax_stats_t *stats);
+
+// Multithreaded decompression
+// Indexes the block headers, then decodes blocks in parallel directly into
+// dst. nb_threads <= 1 falls back to zyphrax_decompress.
+// Returns decompressed size, or 0 on error
+size_t zyphrax_decompress_mt(const uint8_t *src, size_t src_size,
+                             uint8_t *dst, size_t dst_cap,
+                             unsigned nb_threads);
+
+// zyphrax_decompress_mt starts its threads per call (the frames of one call
+// share them). This keeps them in dctx instead, each with its own decoder
+// workspace: created on the first call, reused while nb_threads stays the
+// same and freed with the context, so a call costs a wake-up rather than
+// thread spawns. nb_threads <= 1 is zyphrax_decompress_dctx. Statistics
+// count every block as with zyphrax_decompress_dctx; the callback sees them
+// in frame order once the frame is decoded. A static context has no room for
+// the workers and decodes on its own workspace, as zyphrax_decompress_dctx.
+size_t zyphrax_decompress_dctx_mt(zyphrax_dctx_t *dctx, const uint8_t *src,
+                                  size_t src_size, uint8_t *dst,
+                                  size_t dst_cap, unsigned nb_threads);
+
+// Random access
+// Decodes bytes [offset, offset + len) of the original data into dst,
+// decoding only the blocks that overlap the range. Uses the seek table when
+// the frame has one (ZYPHRAX_FLAG_SEEK_TABLE), otherwise walks the block
+// headers. Returns bytes written (short if the range passes the end), or 0
+// on error
+size_t zyphrax_decompress_range(const uint8_t *src, size_t src_size,
+                                uint64_t offset, size_t len, uint8_t *dst);
+
+// Same on dctx: its decoder workspace, and its allocator for the block index
+// and for the block a range starts or ends inside. Returns 0 for a static
+// context, which has no room for either.
+size_t zyphrax_decompress_range_dctx(zyphrax_dctx_t *dctx, const uint8_t *src,
+                                     size_t src_size, uint64_t offset,
+                                     size_t len, uint8_t *dst);
+
+// Returned by zyphrax_get_content_size for invalid frames
+#define ZYPHRAX_CONTENT_SIZE_ERROR ((uint64_t)-1)
+
+// Exact decompressed size of a frame (the first, if src holds several)
+// Reads the header field when the frame was written with
+// ZYPHRAX_FLAG_CONTENT_SIZE, otherwise sums the seek table or walks the block
+// headers (no payload is decoded).
+// Returns the size, or ZYPHRAX_CONTENT_SIZE_ERROR
+uint64_t zyphrax_get_content_size(const uint8_t *src, size_t src_size);
+
+// In-place decompression
+// The compressed frame occupies the last src_size bytes of buf and is decoded
+// toward the front, so no second buffer is needed. buf_size must be at least
+// content size + zyphrax_inplace_margin(). Blocks whose output would overrun
+// their own unread input are rejected rather than decoded.
+// Returns decompressed size (output starts at buf), or 0 on error
+size_t zyphrax_decompress_inplace(uint8_t *buf, size_t buf_size,
+                                  size_t src_size);
+
+// Extra headroom (beyond content_size) that in-place decompression needs for
+// a frame written with params: frame header + one block + per-block header
+// slack (+ seek table). Worst case derived from the block format.
+size_t zyphrax_inplace_margin(uint64_t content_size,
+                              const zyphrax_params_t *params);
+
+// -------------------------------------------------------------------------
+// Streaming
+// -------------------------------------------------------------------------
+// Buffers are advanced in place: pos is moved past consumed input / produced
+// output. Compression functions return the number of bytes still waiting to
+// be written (0 = fully drained). All of them return ZYPHRAX_STREAM_ERROR on
+// failure.
+
+#define ZYPHRAX_STREAM_ERROR ((size_t)-1)
+
+typedef struct {
+    const uint8_t *src;
+    size_t size;
+    size_t pos;
+} zyphrax_in_buffer_t;
+
+typedef struct {
+    uint8_t *dst;
+    size_t size;
+    size_t pos;
+} zyphrax_out_buffer_t;
+
+typedef struct zyphrax_cstream_s zyphrax_cstream_t;
+
+// Streaming compression
+// Memory is bounded by one input block, one encoded block and the match
+// finder state, whatever the stream length. The total size is unknown up
+// front, so ZYPHRAX_FLAG_CONTENT_SIZE is ignored unless the size is pledged
+// (the seek table, if requested, keeps 16 bytes per block until
+// zyphrax_cstream_end).
+// Returns NULL on allocation failure
+zyphrax_cstream_t *zyphrax_cstream_init(const zyphrax_params_t *params);
+
+// Pipelined streaming compression
+// Full blocks are handed to nb_workers background threads while the caller
+// keeps reading input and writing earlier blocks, which come out in order
+// (same bytes as zyphrax_cstream_init). At most max_in_flight blocks are
+// queued or being compressed (0 = 2 * nb_workers); memory is about
+// 2 * (max_in_flight + 1) blocks plus one match finder per worker.
+// update blocks only when every slot is in flight and output has room.
+zyphrax_cstream_t *zyphrax_cstream_init_mt(const zyphrax_params_t *params,
+                                           unsigned nb_workers,
+                                           unsigned max_in_flight);
+
+// Promises the total input size so the header can carry it
+// (ZYPHRAX_FLAG_CONTENT_SIZE). Call before the first output; end fails if
+// the stream then differs. Returns 0 or ZYPHRAX_STREAM_ERROR
+size_t zyphrax_cstream_pledge_size(zyphrax_cstream_t *cs,
+                                   uint64_t content_size);
+
+// Adaptive level
+// Instead of a fixed params.level, the stream picks the level of every block
+// from what it measures: the time each block took at each level and, when
+// pipelined, how far the workers fall behind the input. It climbs while
+// workers sit idle and steps down when the input has to wait for them, but
+// never to a level whose measured speed misses the budget:
+//   target_speed    input bytes/s the stream must sustain (all workers
+//                   together), 0 = none
+//   max_block_usec  time one block may take to compress, 0 = none
+// With neither, the stream only follows the backlog. Levels stay within
+// [min_level, max_level] (0 = ZYPHRAX_LEVEL_MAX); min_level 0 also lets the
+// stream store blocks uncompressed when even level 1 is too slow. The
+// controller's levels are tiers of their own: 1 writes LZ blocks and 9
+// searches like any fixed level above 1, while 2-8 walk 2 to 128 chain links
+// and stride through literal runs, which a fixed params.level never does.
+typedef struct {
+    uint64_t target_speed;
+    uint32_t max_block_usec;
+    uint32_t min_level;
+    uint32_t max_level;
+} zyphrax_adaptive_t;
+
+// Enables the adaptive level from the next block on (NULL returns to
+// params.level). Output stays an ordinary frame: levels only change how
+// hard the encoder searches. Returns 0 or ZYPHRAX_STREAM_ERROR
+size_t zyphrax_cstream_set_adaptive(zyphrax_cstream_t *cs,
+                                    const zyphrax_adaptive_t *adapt);
+
+// Level the next block will use (0 = stored), to watch the controller
+unsigned zyphrax_cstream_level(const zyphrax_cstream_t *cs);
+
+// Consumes input, emitting a block each time block_size bytes are buffered.
+// Input may be left unconsumed while output is pending; call again with
+// more output space.
+size_t zyphrax_cstream_update(zyphrax_cstream_t *cs, zyphrax_out_buffer_t *out,
+                              zyphrax_in_buffer_t *in);
+
+// Closes the current partial block so everything passed so far is
+// decodable. Call until it returns 0.
+size_t zyphrax_cstream_flush(zyphrax_cstream_t *cs, zyphrax_out_buffer_t *out);
+
+// Flushes and finishes the frame (seek table). Call until it returns 0; no
+// further input is accepted afterwards.
+size_t zyphrax_cstream_end(zyphrax_cstream_t *cs, zyphrax_out_buffer_t *out);
+
+void zyphrax_cstream_free(zyphrax_cstream_t *cs);
+
+typedef struct zyphrax_dstream_s zyphrax_dstream_t;
+
+// Streaming decompression
+// Accepts the frame in arbitrary chunks and hands out each block as soon as
+// it is decoded. Raw and skippable blocks pass straight through; only one
+// compressed block is buffered. Concatenated frames decode back to back and
+// skippable frames are dropped. Returns NULL on allocation failure
+zyphrax_dstream_t *zyphrax_dstream_init(void);
+
+// Consumes input and produces output until either buffer runs out; call
+// again while the output buffer comes back full.
+// Returns 0 when all output has been delivered at a block boundary (the
+// frame may end here). Otherwise returns a hint of the input bytes still
+// needed to complete the current block or header (1 while decoded output
+// is waiting for space).
+size_t zyphrax_dstream_update(zyphrax_dstream_t *ds, zyphrax_out_buffer_t *out,
+                              zyphrax_in_buffer_t *in);
+
+void zyphrax_dstream_free(zyphrax_dstream_t *ds);
+
+// Scatter-gather segment; same layout as struct iovec
+typedef struct {
+    void *iov_base;
+    size_t iov_len;
+} zyphrax_iovec_t;
+
+// Compresses the concatenation of the src segments into the dst segments,
+// filling each in order. Produces the same frame as zyphrax_compress on the
+// coalesced input. Blocks are coded where they lie, with no copy into a
+// contiguous buffer: the match finder reaches back across src segments, and
+// compressed output is written across dst segment boundaries. Returns the
+// total bytes written, or 0 on error (including running out of dst segments)
+size_t zyphrax_compressv(const zyphrax_iovec_t *src, size_t src_cnt,
+                         const zyphrax_iovec_t *dst, size_t dst_cnt,
+                         const zyphrax_params_t *params);
+
+// Decompresses a frame split over the src segments into the dst segments. As
+// with zyphrax_compressv, blocks are decoded in place: bits are read across
+// src segments, and literals and matches are written, and matches read back,
+// across dst segments. Returns the total bytes written, or 0 on error
+size_t zyphrax_decompressv(const zyphrax_iovec_t *src, size_t src_cnt,
+                           const zyphrax_iovec_t *dst, size_t dst_cnt);
@@ -1,52 +1,77 @@
 #include "zyphrax_block.h"
+#include "zyphrax_hash.h"
 #include "zyphrax_huff.h"
 #include "zyphrax_lz77.h"
+#include "zyphrax_mem.h"
 #include "zyphrax_seq.h"
+#include "zyphrax_simd.h"
+#include "zyphrax_stats.h"
+#include "zyphrax_trace.h"
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
 // Helper to store raw block
-static size_t zyphrax_store_raw(const uint8_t *src, size_t src_size,
-                                uint8_t *dst, size_t dst_cap) {
-  if (dst_cap < src_size + 4)
-    return 0; // Need space for raw header?
-  // Actually, block header is separate?
-  // "Phase 1: Header (12 bytes) ... Process blocks... Header read/write"
-  // Phase 6 doc: "Main Compression Loop ... zyphrax_compress_block"
-  // But how do we distinguish compressed vs raw block in the output stream?
-  // The main Frame Header has `raw_block:1`. That's for the WHOLE FRAME maybe?
-  // Or do blocks have headers?
-  // "Block Format: [Hdr][LitTree]..."
-  // "Hdr" likely contains block type (Compressed/Raw) + Size.
-  // Let's assume a 1-byte or 3-byte block header.
-  // Spec in Phase 5: "[Hdr][LitTree]..."
-  // Let's define Block Header:
-  // [BlockSize:16? or 24?][Type:1?]
-  // If raw, we just dump bytes?
-  // But the caller iterates blocks.
-  // If returning size, the caller usually frames it?
-  // The prompt trace in Phase 7 says:
-  // "Process blocks... out += block_enc;"
-  // It doesn't write a block header explicitly in Phase 7 trace...
-  // Wait, Phase 5 said: "Block Format: [Hdr][LitTree]..."
-  // So `zyphrax_compress_block` MUST write the header.
-
-  // Let's define simple block header:
-  // Byte 0: Type (0=Raw, 1=Compressed)
-  // Byte 1-3: Compressed Size (if needed? or implied?)
-  // If we return size, the containing format might need lengths.
-  // Let's assume format is:
-  // [Type][Data...]
-
-  // Raw: [Type=0][RawBytes...]
-
-  if (dst_cap < src_size + 1)
+// Raw: [Type=2][Size:4][RawBytes...]
+// The explicit size keeps every block self-delimiting, so a frame can be
+// indexed without decoding it (see zyphrax_index_blocks).
+// sum, if set, hashes src a chunk at a time as it is copied.
+//
+// The block coders work on windows (zyphrax_segs.h), so that scattered
+// buffers (zyphrax_compressv) are coded in place; the pointer entry points
+// pass one-segment windows, and the hot loops run on plain pointers whenever
+// their windows lie in one segment.
+static size_t store_raw_sum(const zyphrax_segs_t *src,
+                            const zyphrax_segs_t *dst,
+                            zyphrax_hash_run_t *sum) {
+  size_t src_size = src->size;
+  if (dst->size < src_size + ZYPHRAX_BLOCK_HDR_RAW)
     return 0;
-  dst[0] = 0; // Raw
-  memcpy(dst + 1, src, src_size);
-  return src_size + 1;
+  uint8_t hdr[ZYPHRAX_BLOCK_HDR_RAW] = {
+      ZYPHRAX_BLOCK_RAW, (uint8_t)(src_size & 0xFF),
+      (uint8_t)((src_size >> 8) & 0xFF), (uint8_t)((src_size >> 16) & 0xFF),
+      (uint8_t)((src_size >> 24) & 0xFF)};
+  zyphrax_segs_write(dst, 0, hdr, sizeof(hdr));
+  if (!sum) {
+    zyphrax_segs_copy(dst, ZYPHRAX_BLOCK_HDR_RAW, src, 0, src_size);
+    return src_size + ZYPHRAX_BLOCK_HDR_RAW;
+  }
+  for (size_t off = 0; off < src_size; off += ZYPHRAX_HASH_CHUNK) {
+    size_t n = min(src_size - off, (size_t)ZYPHRAX_HASH_CHUNK);
+    zyphrax_segs_copy(dst, ZYPHRAX_BLOCK_HDR_RAW + off, src, off, n);
+    zyphrax_hash_run_to(sum, off + n);
+  }
+  return src_size + ZYPHRAX_BLOCK_HDR_RAW;
+}
+
+size_t zyphrax_store_raw(const uint8_t *src, size_t src_size, uint8_t *dst,
+                         size_t dst_cap) {
+  zyphrax_seg_t in_seg, out_seg;
+  zyphrax_segs_t in, out;
+  zyphrax_segs_plain(&in, &in_seg, src, src_size);
+  zyphrax_segs_plain(&out, &out_seg, dst, dst_cap);
+  return store_raw_sum(&in, &out, NULL);
 }
 
+// Header of a compressed or LZ block: [Type:1][OrigSize:4][CompSize:4]
+static void block_header(const zyphrax_segs_t *dst, uint8_t type,
+                         size_t src_size, size_t written) {
+  uint8_t hdr[ZYPHRAX_BLOCK_HDR_COMPRESSED];
+  hdr[0] = type;
+  for (int i = 0; i < 4; i++) {
+    hdr[1 + i] = (uint8_t)(src_size >> (8 * i));
+    hdr[5 + i] = (uint8_t)(written >> (8 * i));
+  }
+  zyphrax_segs_write(dst, 0, hdr, sizeof(hdr));
+}
+
+// Nibble-packed code lengths (Token, Lit, Off) at the start of every
+// compressed payload
+#define BLOCK_TABLES_SIZE 384
+
 #define MAX_SEQS                                                               \
   (64 * 1024 / 4) // Worst case: 4 byte matches? Or just literals?
 // If all literals, experimental: 1 sequence per block?
@@ -58,41 +83,143 @@ static size_t zyphrax_store_raw(const uint8_t *src, size_t src_size,
 // Let's allocate on stack or static? 21K * sizeof(seq) = 21K * 24 bytes =
 // 500KB. Too big for stack. Use malloc.
 
+static size_t block_ws_max_seqs(size_t block_size) {
+  size_t max_seqs = (block_size / 4) + 256;
+  // Wait, MIN_MATCH=4.
+  if (max_seqs < 1024)
+    max_seqs = 1024;
+  return max_seqs;
+}
+
+size_t zyphrax_block_ws_size(size_t block_size) {
+  return zyphrax_arena_round(sizeof(zyphrax_lz77_t)) +
+         zyphrax_arena_round(block_ws_max_seqs(block_size) *
+                             sizeof(zyphrax_sequence_t));
+}
+
+int zyphrax_block_ws_init(zyphrax_block_ws_t *ws, size_t block_size,
+                          const zyphrax_allocator_t *alloc) {
+  // Sequence buffer
+  size_t max_seqs = block_ws_max_seqs(block_size);
+
+  // LZ77 state is a large struct (256K+128K). Allocate on heap.
+  ws->lz = zyphrax_malloc(alloc, sizeof(zyphrax_lz77_t));
+  ws->seqs = zyphrax_malloc(alloc, max_seqs * sizeof(zyphrax_sequence_t));
+  ws->max_seqs = max_seqs;
+  ws->stats = NULL;
+  if (!ws->lz || !ws->seqs) {
+    zyphrax_block_ws_free(ws, alloc);
+    return -1;
+  }
+  // Initialized once; each block resets what it used
+  zyphrax_lz77_init(ws->lz);
+  return 0;
+}
+
+void zyphrax_block_ws_free(zyphrax_block_ws_t *ws,
+                           const zyphrax_allocator_t *alloc) {
+  zyphrax_free(alloc, ws->lz);
+  zyphrax_free(alloc, ws->seqs);
+  ws->lz = NULL;
+  ws->seqs = NULL;
+  ws->max_seqs = 0;
+}
+
 size_t zyphrax_compress_block(const uint8_t *src, size_t src_size, uint8_t *dst,
-                              size_t dst_cap,
-                              const zyphrax_params_t *params // Unused for now
-) {
+                              size_t dst_cap, const zyphrax_params_t *params) {
   if (src_size == 0)
     return 0;
 
-  // 1. LZ77
-  // Need state. Large struct (256K+128K).
-  // Allocate on heap.
-  zyphrax_lz77_t *lz = malloc(sizeof(zyphrax_lz77_t));
-  if (!lz)
+  zyphrax_block_ws_t ws;
+  if (zyphrax_block_ws_init(&ws, src_size, NULL) != 0)
     return 0;
 
-  zyphrax_lz77_init(lz);
+  size_t res = zyphrax_compress_block_ws(&ws, src, src_size, dst, dst_cap,
+                                         params);
+  zyphrax_block_ws_free(&ws, NULL);
+  return res;
+}
 
-  // Sequence buffer
-  size_t max_seqs = (src_size / 4) + 256;
-  // Wait, MIN_MATCH=4.
-  if (max_seqs < 1024)
-    max_seqs = 1024;
+// -------------------------------------------------------------------------
+// Levels
+// -------------------------------------------------------------------------
+// A level sets how hard the match finder looks: the chain links it walks per
+// position and how quickly it strides through literal runs (after 2^skip
+// misses in a row each step grows by one byte, so incompressible stretches
+// go by at a fraction of the cost). Level 1 drops the entropy stage
+// altogether and writes LZ blocks (see block_lz); above it the format is the
+// same at every level and only the encoder's effort changes.
+//
+// A fixed params.level above 1 searches like the original encoder: 256 links
+// at every position. The shorter searches in between are tiers of the
+// adaptive level controller only (zyphrax_compress_block_tier), so callers
+// that pick a level keep the ratio they always had.
 
-  zyphrax_sequence_t *seqs = malloc(max_seqs * sizeof(zyphrax_sequence_t));
-  if (!seqs) {
-    free(lz);
-    return 0;
-  }
+typedef struct {
+  uint16_t chain;
+  uint8_t skip; // 0: test every position
+  uint8_t lz;   // LZ blocks: one hash probe per position, no Huffman
+} block_level_t;
+
+static const block_level_t block_levels[ZYPHRAX_LEVEL_MAX + 1] = {
+    {0, 0, 0}, // Unused: level 0 is ZYPHRAX_LEVEL_DEFAULT
+    {1, 6, 1},   {256, 0, 0}, {256, 0, 0},  {256, 0, 0}, {256, 0, 0},
+    {256, 0, 0}, {256, 0, 0}, {256, 0, 0},  {256, 0, 0},
+};
+
+static const block_level_t block_tiers[ZYPHRAX_LEVEL_MAX + 1] = {
+    {0, 0, 0}, // Unused: tier 0 stores blocks (zyphrax_store_block)
+    {1, 6, 1},   {2, 5, 0},   {4, 6, 0},    {8, 0, 0},   {16, 0, 0},
+    {32, 0, 0},  {64, 0, 0},  {128, 0, 0},  {256, 0, 0},
+};
+
+static const block_level_t *block_level(const zyphrax_params_t *params) {
+  uint32_t level = params ? params->level : 0;
+  if (level == 0 || level > ZYPHRAX_LEVEL_MAX)
+    level = ZYPHRAX_LEVEL_DEFAULT;
+  return &block_levels[level];
+}
+
+// Resets the match finder after src, flat if it lies in one segment
+static void parse_reset(zyphrax_lz77_t *lz, const uint8_t *flat,
+                        const zyphrax_segs_t *src) {
+  if (flat)
+    zyphrax_lz77_reset(lz, flat, src->size);
+  else
+    zyphrax_lz77_reset_segs(lz, src, src->size);
+}
+
+// Runs the match finder over src into ws->seqs and leaves it reset for the
+// next block; sum, if set, hashes src behind it. Returns the sequence count,
+// or -1 if the buffer overflowed. The sequences of a src spread over several
+// segments have no literal pointers (NULL): the coders read the literals
+// from src.
+static long block_parse(zyphrax_block_ws_t *ws, const zyphrax_segs_t *src,
+                        const block_level_t *lv, zyphrax_hash_run_t *sum) {
+  const uint8_t *flat = zyphrax_segs_flat(src);
+  size_t src_size = src->size;
+
+  // 1. LZ77
+  zyphrax_lz77_t *lz = ws->lz;
+  lz->max_chain = lv->chain;
+  size_t misses = 0;
+  size_t searches = 0;
+  uint64_t steps = lz->chain_steps;
+
+  zyphrax_sequence_t *seqs = ws->seqs;
+  size_t max_seqs = ws->max_seqs;
 
   size_t seq_count = 0;
   size_t pos = 0;
   size_t lit_start = 0;
 
   while (pos < src_size) {
+    zyphrax_hash_run_to(sum, pos);
     // Find match
-    zyphrax_match_t m = zyphrax_find_best_match(lz, src, pos, src_size);
+    zyphrax_match_t m =
+        flat ? zyphrax_find_best_match(lz, flat, pos, src_size)
+             : zyphrax_find_best_match_segs(lz, src, pos, src_size);
+    searches++;
 
     if (m.length >= MIN_MATCH) {
       // Found match
@@ -102,74 +229,639 @@ size_t zyphrax_compress_block(const uint8_t *src, size_t src_size, uint8_t *dst,
         // Just break and encode what we have? Or raw?
         // Should be rare if sized correctly.
         // Treat as raw fallback.
-        free(lz);
-        free(seqs);
-        return zyphrax_store_raw(src, src_size, dst, dst_cap);
+        parse_reset(lz, flat, src);
+        return -1;
       }
 
       zyphrax_sequence_t *s = &seqs[seq_count++];
-      s->literals = src + lit_start;
+      s->literals = flat ? flat + lit_start : NULL;
       s->lit_len = pos - lit_start;
       s->match = m;
 
       pos += m.length;
       lit_start = pos;
+      misses = 0;
+    } else if (lv->skip) {
+      pos += 1 + (misses++ >> lv->skip);
     } else {
       pos++;
     }
   }
 
-  // Final sequence (literals only)
+  // Literals left after the last match: a final literals-only sequence
   if (lit_start < src_size) {
     if (seq_count < max_seqs) {
       zyphrax_sequence_t *s = &seqs[seq_count++];
-      s->literals = src + lit_start;
+      s->literals = flat ? flat + lit_start : NULL;
       s->lit_len = src_size - lit_start;
       s->match.length = 0;
       s->match.offset = 0;
     }
   }
 
-  free(lz); // Done with LZ77
+  parse_reset(lz, flat, src); // Ready for the next block
+  if (ws->stats) {
+    ws->stats->searches += searches;
+    ws->stats->chain_steps += lz->chain_steps - steps;
+  }
+  return (long)seq_count;
+}
+
+// Entropy codes the sequences of src as one block (raw if that is smaller).
+// st, if set, gets the stage times.
+static size_t block_encode(const zyphrax_sequence_t *seqs, size_t seq_count,
+                           const zyphrax_segs_t *src,
+                           const zyphrax_segs_t *dst, zyphrax_stats_t *st) {
+  uint64_t t0 = st ? zyphrax_stats_now() : 0;
+  size_t src_size = src->size;
+  // Literals come from src when the sequences do not point at them
+  const zyphrax_segs_t *lits = zyphrax_segs_flat(src) ? NULL : src;
 
   // 2. Freq Analysis
   zyphrax_huffman_t lit_hf, off_hf, token_hf;
-  zyphrax_analyze_sequences(seqs, seq_count, &lit_hf, &off_hf, &token_hf);
+  zyphrax_analyze_sequences_segs(seqs, seq_count, lits, &lit_hf, &off_hf,
+                                 &token_hf);
 
   // 3. Build Trees
   zyphrax_build_huffman(&lit_hf);
   zyphrax_build_huffman(&off_hf);
   zyphrax_build_huffman(&token_hf);
+  uint64_t t1 = st ? zyphrax_stats_now() : 0;
+  ZYPHRAX_PROBE2(block_tables, src_size, seq_count);
 
   // 4. Encode
-  // Header: [Type:1][OrigSize:4][CompSize:4][Data...]
-  if (dst_cap < 9) {
-    free(seqs);
+  // Header: [Type:1][OrigSize:4][CompSize:4][Data...], written once the
+  // payload is
+  if (dst->size < 9)
     return 0;
+  zyphrax_segs_t payload = zyphrax_segs_sub(dst, 9, dst->size - 9);
+  size_t written = zyphrax_huffman_encode_segs(
+      seqs, seq_count, lits, &payload, &lit_hf, &off_hf, &token_hf);
+  if (st) {
+    st->tables_ns += t1 - t0;
+    st->coding_ns += zyphrax_stats_now() - t1;
   }
-  dst[0] = 1; // Compressed
-  // Write original size (little-endian u32)
-  dst[1] = (uint8_t)(src_size & 0xFF);
-  dst[2] = (uint8_t)((src_size >> 8) & 0xFF);
-  dst[3] = (uint8_t)((src_size >> 16) & 0xFF);
-  dst[4] = (uint8_t)((src_size >> 24) & 0xFF);
-  // CompSize will be written after encoding
-
-  size_t written = zyphrax_huffman_encode(seqs, seq_count, dst + 9, dst_cap - 9,
-                                          &lit_hf, &off_hf, &token_hf);
-
-  free(seqs);
 
   if (written == 0 || written + 9 >= src_size) {
     // Fallback to raw
+    ZYPHRAX_PROBE2(block_raw, src_size, written ? written + 9 : 0);
+    return store_raw_sum(src, dst, NULL);
+  }
+
+  block_header(dst, ZYPHRAX_BLOCK_COMPRESSED, src_size, written);
+  return written + 9;
+}
+
+// -------------------------------------------------------------------------
+// LZ Blocks (level 1)
+// -------------------------------------------------------------------------
+// One pass over src: each position probes a single slot of a small hash
+// table (no chains, so no match finder state survives the block) and every
+// match found goes straight out through zyphrax_encode_sequence, byte
+// aligned. Matches are extended backwards over pending literals. The output
+// is capped below src_size so incompressible blocks give up early and are
+// stored.
+
+#define LZ_HASH_LOG 12 // 16 KB of positions: stays in L1
+
+static inline uint32_t lz_read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v) {
+  return (v * 2654435761u) >> (32 - LZ_HASH_LOG);
+}
+
+// Codes the sequences of src into dst (payload only), sum hashing src behind
+// the parse. Returns the payload size, or 0 if it would not fit in dst_cap.
+// The sequence counts go to st.
+static size_t lz_encode(const uint8_t *src, size_t src_size, uint8_t *dst,
+                        size_t dst_cap, unsigned skip, zyphrax_stats_t *st,
+                        zyphrax_hash_run_t *sum) {
+  uint32_t table[1 << LZ_HASH_LOG];
+  memset(table, 0, sizeof(table));
+
+  size_t pos = 1, anchor = 0, out = 0, misses = 0;
+  while (pos + MIN_MATCH <= src_size) {
+    zyphrax_hash_run_to(sum, pos);
+    uint32_t v = lz_read32(src + pos);
+    uint32_t h = lz_hash(v);
+    size_t cand = table[h];
+    table[h] = (uint32_t)pos;
+    if (pos - cand > MAX_DIST || lz_read32(src + cand) != v) {
+      pos += 1 + (misses++ >> skip);
+      continue;
+    }
+
+    size_t max_len = min(src_size - pos, (size_t)UINT16_MAX);
+    size_t len = MIN_MATCH + zyphrax_match_len_simd(src + pos + MIN_MATCH,
+                                                    src + cand + MIN_MATCH,
+                                                    max_len - MIN_MATCH);
+    while (pos > anchor && cand > 0 && len < UINT16_MAX &&
+           src[pos - 1] == src[cand - 1]) {
+      pos--;
+      cand--;
+      len++;
+    }
+
+    zyphrax_sequence_t seq = {src + anchor, pos - anchor,
+                              {(uint16_t)(pos - cand), (uint16_t)len}};
+    size_t n = zyphrax_encode_sequence(&seq, dst + out, dst_cap - out);
+    if (n == 0)
+      return 0;
+    out += n;
+    st->matches++;
+    st->match_bytes += len;
+    pos += len;
+    anchor = pos;
+    misses = 0;
+    // Seed the table just before the match end: runs continue from there
+    if (pos + MIN_MATCH <= src_size + 2)
+      table[lz_hash(lz_read32(src + pos - 2))] = (uint32_t)(pos - 2);
+  }
+
+  if (anchor < src_size) {
+    zyphrax_sequence_t last = {src + anchor, src_size - anchor, {0, 0}};
+    size_t n = zyphrax_encode_sequence(&last, dst + out, dst_cap - out);
+    if (n == 0)
+      return 0;
+    out += n;
+    st->sequences++;
+  }
+  st->sequences += st->matches;
+  st->literal_bytes = src_size - st->match_bytes;
+  return out;
+}
+
+// The same pass when src or dst spans segments
+
+static inline uint32_t lz_read32_segs(const zyphrax_segs_t *w,
+                                      zyphrax_segs_run_t *c, size_t pos) {
+  const uint8_t *p = zyphrax_segs_get(w, c, pos, 4);
+  if (p)
+    return lz_read32(p);
+  uint32_t v;
+  zyphrax_segs_read(w, pos, &v, 4);
+  return v;
+}
+
+static inline uint8_t lz_byte_segs(const zyphrax_segs_t *w, size_t pos) {
+  size_t run;
+  return *zyphrax_segs_at(w, pos, &run);
+}
+
+// Extra length bytes (write_len in zyphrax_seq.c) at pos of dst. Returns
+// their count.
+static size_t lz_put_len_segs(const zyphrax_segs_t *dst, size_t pos,
+                              size_t val) {
+  uint8_t buf[64];
+  size_t n = 0, k = 0;
+  for (;;) {
+    int last = val < 255;
+    buf[k++] = last ? (uint8_t)val : 255;
+    val -= last ? 0 : 255;
+    if (last || k == sizeof(buf)) {
+      zyphrax_segs_write(dst, pos + n, buf, k);
+      n += k;
+      k = 0;
+      if (last)
+        return n;
+    }
+  }
+}
+
+// zyphrax_encode_sequence at out of dst, the ll literals taken from lit of
+// src. Returns the bytes written, or 0 if they would not fit.
+static size_t lz_put_segs(const zyphrax_segs_t *src, size_t lit, size_t ll,
+                          size_t offset, size_t ml, const zyphrax_segs_t *dst,
+                          size_t out) {
+  size_t size = 1 + ll;
+  if (ll >= 15)
+    size += (ll - 15) / 255 + 1;
+  if (ml >= 4)
+    size += 2 + (ml - 4 >= 15 ? (ml - 19) / 255 + 1 : 0);
+  if (size > dst->size - out)
+    return 0;
+
+  uint8_t token_ll = ll >= 15 ? 15 : (uint8_t)ll;
+  uint8_t token_ml = ml < 4 ? 0 : ml - 4 >= 15 ? 15 : (uint8_t)(ml - 4);
+  uint8_t token = (uint8_t)((token_ll << 4) | token_ml);
+  size_t op = out;
+  zyphrax_segs_write(dst, op++, &token, 1);
+  if (token_ll == 15)
+    op += lz_put_len_segs(dst, op, ll - 15);
+  zyphrax_segs_copy(dst, op, src, lit, ll);
+  op += ll;
+  if (ml >= 4) {
+    uint8_t off[2] = {(uint8_t)(offset & 0xFF), (uint8_t)(offset >> 8)};
+    zyphrax_segs_write(dst, op, off, 2);
+    op += 2;
+    if (token_ml == 15)
+      op += lz_put_len_segs(dst, op, ml - 4 - 15);
+  }
+  return op - out;
+}
+
+// lz_encode over windows: the same matches, read and written across
+// segments
+static size_t lz_encode_segs(const zyphrax_segs_t *src,
+                             const zyphrax_segs_t *dst, unsigned skip,
+                             zyphrax_stats_t *st, zyphrax_hash_run_t *sum) {
+  size_t src_size = src->size;
+  uint32_t table[1 << LZ_HASH_LOG];
+  memset(table, 0, sizeof(table));
+  // Last runs read at the current position and at a candidate
+  zyphrax_segs_run_t at = {NULL, 0, 0}, back = {NULL, 0, 0};
+
+  size_t pos = 1, anchor = 0, out = 0, misses = 0;
+  while (pos + MIN_MATCH <= src_size) {
+    zyphrax_hash_run_to(sum, pos);
+    uint32_t v = lz_read32_segs(src, &at, pos);
+    uint32_t h = lz_hash(v);
+    size_t cand = table[h];
+    table[h] = (uint32_t)pos;
+    if (pos - cand > MAX_DIST || lz_read32_segs(src, &back, cand) != v) {
+      pos += 1 + (misses++ >> skip);
+      continue;
+    }
+
+    size_t max_len = min(src_size - pos, (size_t)UINT16_MAX);
+    size_t len = MIN_MATCH + zyphrax_segs_match_len(src, pos + MIN_MATCH,
+                                                    cand + MIN_MATCH,
+                                                    max_len - MIN_MATCH);
+    while (pos > anchor && cand > 0 && len < UINT16_MAX &&
+           lz_byte_segs(src, pos - 1) == lz_byte_segs(src, cand - 1)) {
+      pos--;
+      cand--;
+      len++;
+    }
+
+    size_t n = lz_put_segs(src, anchor, pos - anchor, pos - cand, len, dst,
+                           out);
+    if (n == 0)
+      return 0;
+    out += n;
+    st->matches++;
+    st->match_bytes += len;
+    pos += len;
+    anchor = pos;
+    misses = 0;
+    if (pos + MIN_MATCH <= src_size + 2)
+      table[lz_hash(lz_read32_segs(src, &at, pos - 2))] = (uint32_t)(pos - 2);
+  }
+
+  if (anchor < src_size) {
+    size_t n = lz_put_segs(src, anchor, src_size - anchor, 0, 0, dst, out);
+    if (n == 0)
+      return 0;
+    out += n;
+    st->sequences++;
+  }
+  st->sequences += st->matches;
+  st->literal_bytes = src_size - st->match_bytes;
+  return out;
+}
+
+// Writes src as one LZ block, or stored when that is no smaller. st, if
+// set, gets the sequence counts of an LZ block.
+static size_t block_lz(const zyphrax_segs_t *src, const zyphrax_segs_t *dst,
+                       unsigned skip, zyphrax_stats_t *st,
+                       zyphrax_hash_run_t *sum) {
+  size_t src_size = src->size;
+  size_t hdr = ZYPHRAX_BLOCK_HDR_LZ;
+  size_t cap = dst->size > hdr ? min(dst->size - hdr, src_size) : 0;
+  zyphrax_stats_t counts = {0};
+  size_t written = 0;
+  if (cap) {
+    zyphrax_segs_t out = zyphrax_segs_sub(dst, hdr, cap);
+    const uint8_t *in = zyphrax_segs_flat(src);
+    uint8_t *op = zyphrax_segs_flat(&out);
+    written = in && op ? lz_encode(in, src_size, op, cap, skip, &counts, sum)
+                       : lz_encode_segs(src, &out, skip, &counts, sum);
+  }
+  if (written == 0 || written + hdr >= src_size) {
+    ZYPHRAX_PROBE2(block_raw, src_size, written ? written + hdr : 0);
+    return store_raw_sum(src, dst, sum);
+  }
+  if (st)
+    zyphrax_stats_add(st, &counts);
+
+  block_header(dst, ZYPHRAX_BLOCK_LZ, src_size, written);
+  return written + hdr;
+}
+
+// -------------------------------------------------------------------------
+// Block Splitting (ZYPHRAX_FLAG_SPLIT_BLOCKS)
+// -------------------------------------------------------------------------
+// One set of Huffman tables per block fits badly when the statistics shift
+// inside it (JSON followed by binary, say). Once the match finder has run,
+// the sequence stream is swept once: the left histograms grow sequence by
+// sequence and the right ones are the totals minus the left, so each
+// candidate cut costs one entropy estimate. The best cut is taken when it
+// saves clearly more than the extra block costs. Both parts are then parsed
+// again, since blocks are independent and matches may not cross the cut,
+// and may split once more. A window never exceeds block_size.
+
+#define SPLIT_MIN_PART 4096 // Smallest block a split may produce
+#define SPLIT_DEPTH 2       // Up to 4 blocks per window
+#define SPLIT_CANDIDATES 16 // Cut positions tried per window
+
+// Bits of an extra block (header + code length tables), in 1/256 bit
+#define SPLIT_BLOCK_COST                                                      \
+  ((uint64_t)(ZYPHRAX_BLOCK_HDR_COMPRESSED + BLOCK_TABLES_SIZE) * 8 * 256)
+
+// log2(x) in 1/256 bit, x >= 1
+static uint64_t split_log2(uint32_t x) {
+  int e = 31 - __builtin_clz(x);
+  uint32_t m = e >= 8 ? x >> (e - 8) : x << (8 - e); // [256, 512)
+  uint32_t f = m - 256;
+  // log2(1 + f) ~= f + 0.347 f (1 - f), within 0.01 bit
+  return ((uint64_t)e << 8) + f + ((f * (256 - f) * 89) >> 16);
+}
+
+// Entropy coded size of the three histograms, in 1/256 bit
+static uint64_t split_cost(const uint32_t *freq) {
+  uint64_t bits = 0;
+  for (int t = 0; t < 3; t++) {
+    const uint32_t *h = freq + t * 256;
+    uint64_t total = 0, sum = 0;
+    for (int i = 0; i < 256; i++) {
+      if (h[i]) {
+        total += h[i];
+        sum += h[i] * split_log2(h[i]);
+      }
+    }
+    if (total)
+      bits += total * split_log2((uint32_t)total) - sum;
+  }
+  return bits;
+}
+
+// Adds a sequence to the three histograms at freq, its literals at pos of
+// lits if set
+static inline void split_count(const zyphrax_sequence_t *s,
+                               const zyphrax_segs_t *lits, size_t pos,
+                               uint32_t *freq) {
+  if (lits)
+    zyphrax_count_sequence_segs(s, lits, pos, freq, freq + 256, freq + 512);
+  else
+    zyphrax_count_sequence(s, freq, freq + 256, freq + 512);
+}
+
+// Input offset of the best cut, or 0 to keep the block whole. lits, if set,
+// holds the literals (see block_parse).
+static size_t split_find(const zyphrax_sequence_t *seqs, size_t seq_count,
+                         const zyphrax_segs_t *lits, size_t src_size) {
+  uint32_t all[3 * 256], left[3 * 256], right[3 * 256];
+  memset(all, 0, sizeof(all));
+  memset(left, 0, sizeof(left));
+  for (size_t i = 0, at = 0; i < seq_count; i++) {
+    split_count(&seqs[i], lits, at, all);
+    at += seqs[i].lit_len + seqs[i].match.length;
+  }
+
+  uint64_t whole = split_cost(all);
+  uint64_t best = whole - whole / 256; // Margin for estimation noise
+  if (best < SPLIT_BLOCK_COST)
+    return 0;
+  best -= SPLIT_BLOCK_COST;
+
+  size_t step = src_size / SPLIT_CANDIDATES;
+  size_t next = step, pos = 0, cut = 0;
+  for (size_t i = 0; i + 1 < seq_count; i++) {
+    split_count(&seqs[i], lits, pos, left);
+    pos += seqs[i].lit_len + seqs[i].match.length;
+    if (pos < next)
+      continue;
+    next = pos + step;
+    if (pos < SPLIT_MIN_PART || src_size - pos < SPLIT_MIN_PART)
+      continue;
+
+    for (int k = 0; k < 3 * 256; k++)
+      right[k] = all[k] - left[k];
+    uint64_t cost = split_cost(left) + split_cost(right);
+    if (cost < best) {
+      best = cost;
+      cut = pos;
+    }
+  }
+  return cut;
+}
+
+// -------------------------------------------------------------------------
+// Checksums
+// -------------------------------------------------------------------------
+// A checksummed block is coded ZYPHRAX_BLOCK_SUM_SIZE bytes into dst; its
+// header then slides back over the gap and the checksum goes after it. The
+// payload is written once either way. The checksum of src is taken as the
+// block is coded (zyphrax_hash_run_t): behind the match finder, or behind
+// the copy of a stored block, so only the tail past the last whole chunk is
+// hashed when the block is sealed.
+
+static int block_sum_kind(const zyphrax_params_t *params) {
+  return params ? (int)params->checksum : ZYPHRAX_CHECKSUM_NONE;
+}
+
+// Seals the block coded at ZYPHRAX_BLOCK_SUM_SIZE into dst (n bytes) with
+// the checksum of its src_size input bytes, finishing sum
+static size_t block_seal(zyphrax_hash_run_t *sum, size_t src_size,
+                         const zyphrax_segs_t *dst, size_t n) {
+  uint8_t blk[ZYPHRAX_BLOCK_HDR_COMPRESSED + ZYPHRAX_BLOCK_SUM_SIZE];
+  zyphrax_segs_read(dst, ZYPHRAX_BLOCK_SUM_SIZE, blk, 1);
+  size_t hdr = blk[0] == ZYPHRAX_BLOCK_COMPRESSED ? ZYPHRAX_BLOCK_HDR_COMPRESSED
+                : blk[0] == ZYPHRAX_BLOCK_LZ       ? ZYPHRAX_BLOCK_HDR_LZ
+                                                   : ZYPHRAX_BLOCK_HDR_RAW;
+  zyphrax_segs_read(dst, ZYPHRAX_BLOCK_SUM_SIZE, blk, hdr);
+  blk[0] |= (uint8_t)(sum->hash.kind << ZYPHRAX_BLOCK_SUM_SHIFT);
+  uint32_t sum_value = zyphrax_hash_run_end(sum, src_size);
+  blk[hdr] = (uint8_t)(sum_value & 0xFF);
+  blk[hdr + 1] = (uint8_t)((sum_value >> 8) & 0xFF);
+  blk[hdr + 2] = (uint8_t)((sum_value >> 16) & 0xFF);
+  blk[hdr + 3] = (uint8_t)((sum_value >> 24) & 0xFF);
+  zyphrax_segs_write(dst, 0, blk, hdr + ZYPHRAX_BLOCK_SUM_SIZE);
+  return n + ZYPHRAX_BLOCK_SUM_SIZE;
+}
+
+size_t zyphrax_store_block(const uint8_t *src, size_t src_size, uint8_t *dst,
+                           size_t dst_cap, const zyphrax_params_t *params) {
+  int kind = block_sum_kind(params);
+  if (kind == ZYPHRAX_CHECKSUM_NONE)
     return zyphrax_store_raw(src, src_size, dst, dst_cap);
+  if (dst_cap < ZYPHRAX_BLOCK_SUM_SIZE)
+    return 0;
+  zyphrax_seg_t in_seg, out_seg;
+  zyphrax_segs_t in, out;
+  zyphrax_segs_plain(&in, &in_seg, src, src_size);
+  zyphrax_segs_plain(&out, &out_seg, dst, dst_cap);
+  zyphrax_segs_t blk = zyphrax_segs_sub(&out, ZYPHRAX_BLOCK_SUM_SIZE,
+                                        dst_cap - ZYPHRAX_BLOCK_SUM_SIZE);
+  zyphrax_hash_run_t sum;
+  zyphrax_hash_run_init(&sum, kind, src, 0);
+  size_t n = store_raw_sum(&in, &blk, &sum);
+  return n ? block_seal(&sum, src_size, &out, n) : 0;
+}
+
+// Adds a block of the given type (size bytes, sealed) to st. The sequence
+// counts of a compressed block come from its seq_count sequences.
+static void block_stats(zyphrax_stats_t *st, int type, size_t size,
+                        size_t src_size, const zyphrax_sequence_t *seqs,
+                        long seq_count) {
+  st->blocks++;
+  st->src_bytes += src_size;
+  st->dst_bytes += size;
+  if (type == ZYPHRAX_BLOCK_RAW) {
+    st->raw_blocks++;
+    return;
   }
+  if (type != ZYPHRAX_BLOCK_COMPRESSED)
+    return;
+  st->table_bytes += BLOCK_TABLES_SIZE;
+  st->sequences += (uint64_t)seq_count;
+  for (long i = 0; i < seq_count; i++) {
+    st->literal_bytes += seqs[i].lit_len;
+    st->match_bytes += seqs[i].match.length;
+    st->matches += seqs[i].match.length != 0;
+  }
+}
 
-  // Write compressed size at offset 5
-  dst[5] = (uint8_t)(written & 0xFF);
-  dst[6] = (uint8_t)((written >> 8) & 0xFF);
-  dst[7] = (uint8_t)((written >> 16) & 0xFF);
-  dst[8] = (uint8_t)((written >> 24) & 0xFF);
+// Writes src as one block: an LZ block when lv asks for one, coded from its
+// seq_count sequences in ws->seqs, or stored when seq_count < 0. sum, if
+// set, holds the checksum of src taken so far and is finished here.
+static size_t block_write(zyphrax_block_ws_t *ws, long seq_count,
+                          const zyphrax_segs_t *src, const zyphrax_segs_t *dst,
+                          const block_level_t *lv, zyphrax_hash_run_t *sum) {
+  zyphrax_stats_t *st = ws->stats;
+  size_t src_size = src->size;
+  size_t gap = sum ? ZYPHRAX_BLOCK_SUM_SIZE : 0;
+  if (dst->size < gap)
+    return 0;
+  zyphrax_segs_t out = zyphrax_segs_sub(dst, gap, dst->size - gap);
+  // Hashing done inside a stage is the checksum's, not the stage's
+  uint64_t hashed = sum ? sum->ns : 0;
+  uint64_t t = st ? zyphrax_stats_now() : 0;
+  size_t n;
+  if (seq_count < 0) {
+    n = store_raw_sum(src, &out, sum);
+    if (st)
+      st->coding_ns += zyphrax_stats_now() - t - (sum ? sum->ns - hashed : 0);
+  } else if (lv->lz) {
+    n = block_lz(src, &out, lv->skip, st, sum);
+    if (st)
+      st->parse_ns += zyphrax_stats_now() - t - (sum ? sum->ns - hashed : 0);
+  } else {
+    n = block_encode(ws->seqs, (size_t)seq_count, src, &out, st);
+  }
+  if (n && sum) {
+    n = block_seal(sum, src_size, dst, n);
+    if (st)
+      st->checksum_ns += sum->ns;
+  }
+  if (n && st) {
+    uint8_t type;
+    zyphrax_segs_read(dst, 0, &type, 1);
+    block_stats(st, type & ZYPHRAX_BLOCK_TYPE_MASK, n, src_size, ws->seqs,
+                seq_count);
+  }
+  return n;
+}
 
-  return written + 9;
+static size_t compress_range(zyphrax_block_ws_t *ws,
+                             const zyphrax_segs_t *src,
+                             const zyphrax_segs_t *dst,
+                             const block_level_t *lv, int kind, int depth) {
+  size_t src_size = src->size;
+  zyphrax_hash_run_t run, *sum = NULL;
+  if (kind != ZYPHRAX_CHECKSUM_NONE) {
+    zyphrax_hash_run_init_segs(&run, kind, src, ws->stats != NULL);
+    sum = &run;
+  }
+
+  // No tables to fit, so nothing to split either
+  if (lv->lz)
+    return block_write(ws, 0, src, dst, lv, sum);
+
+  // The 384 bytes of code lengths alone make a compressed block lose
+  if (src_size <= BLOCK_TABLES_SIZE + ZYPHRAX_BLOCK_HDR_COMPRESSED) {
+    ZYPHRAX_PROBE2(block_raw, src_size, 0);
+    return block_write(ws, -1, src, dst, lv, sum);
+  }
+
+  // A window that may be cut is hashed again per part, so not while parsing
+  int may_split = depth > 0 && src_size >= 2 * SPLIT_MIN_PART;
+  uint64_t t = ws->stats ? zyphrax_stats_now() : 0;
+  long seq_count = block_parse(ws, src, lv, may_split ? NULL : sum);
+  if (ws->stats)
+    ws->stats->parse_ns += zyphrax_stats_now() - t - (sum ? sum->ns : 0);
+  if (seq_count < 0) {
+    ZYPHRAX_PROBE2(block_raw, src_size, 0);
+    return block_write(ws, -1, src, dst, lv, sum);
+  }
+
+  if (may_split) {
+    const zyphrax_segs_t *lits = zyphrax_segs_flat(src) ? NULL : src;
+    size_t cut = split_find(ws->seqs, (size_t)seq_count, lits, src_size);
+    if (cut) {
+      zyphrax_segs_t src_a = zyphrax_segs_sub(src, 0, cut);
+      size_t a = compress_range(ws, &src_a, dst, lv, kind, depth - 1);
+      if (a == 0)
+        return 0;
+      zyphrax_segs_t src_b = zyphrax_segs_sub(src, cut, src_size - cut);
+      zyphrax_segs_t dst_b = zyphrax_segs_sub(dst, a, dst->size - a);
+      size_t b = compress_range(ws, &src_b, &dst_b, lv, kind, depth - 1);
+      return b ? a + b : 0;
+    }
+  }
+  return block_write(ws, seq_count, src, dst, lv, sum);
+}
+
+static size_t compress_block_lv(zyphrax_block_ws_t *ws,
+                                const zyphrax_segs_t *src,
+                                const zyphrax_segs_t *dst,
+                                const zyphrax_params_t *params,
+                                const block_level_t *lv, uint32_t level) {
+  size_t src_size = src->size;
+  if (src_size == 0)
+    return 0;
+  int depth = (params && (params->flags & ZYPHRAX_FLAG_SPLIT_BLOCKS))
+                  ? SPLIT_DEPTH
+                  : 0;
+  ZYPHRAX_PROBE2(block_compress_start, src_size, level);
+  size_t n =
+      compress_range(ws, src, dst, lv, block_sum_kind(params), depth);
+  ZYPHRAX_PROBE2(block_compress_end, src_size, n);
+  return n;
+}
+
+size_t zyphrax_compress_block_ws(zyphrax_block_ws_t *ws, const uint8_t *src,
+                                 size_t src_size, uint8_t *dst, size_t dst_cap,
+                                 const zyphrax_params_t *params) {
+  zyphrax_seg_t in_seg, out_seg;
+  zyphrax_segs_t in, out;
+  zyphrax_segs_plain(&in, &in_seg, src, src_size);
+  zyphrax_segs_plain(&out, &out_seg, dst, dst_cap);
+  return zyphrax_compress_block_segs(ws, &in, &out, params);
+}
+
+size_t zyphrax_compress_block_segs(zyphrax_block_ws_t *ws,
+                                   const zyphrax_segs_t *src,
+                                   const zyphrax_segs_t *dst,
+                                   const zyphrax_params_t *params) {
+  return compress_block_lv(ws, src, dst, params, block_level(params),
+                           params ? params->level : 0);
+}
+
+size_t zyphrax_compress_block_tier(zyphrax_block_ws_t *ws, const uint8_t *src,
+                                   size_t src_size, uint8_t *dst,
+                                   size_t dst_cap,
+                                   const zyphrax_params_t *params,
+                                   uint32_t tier) {
+  if (tier == 0 || tier > ZYPHRAX_LEVEL_MAX)
+    return 0;
+  zyphrax_seg_t in_seg, out_seg;
+  zyphrax_segs_t in, out;
+  zyphrax_segs_plain(&in, &in_seg, src, src_size);
+  zyphrax_segs_plain(&out, &out_seg, dst, dst_cap);
+  return compress_block_lv(ws, &in, &out, params, &block_tiers[tier], tier);
 }
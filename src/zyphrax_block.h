@@ -1,8 +1,40 @@
 #pragma once
 #include "zyphrax.h"
+#include "zyphrax_lz77.h"
+#include "zyphrax_seq.h"
 #include <stddef.h>
 #include <stdint.h>
 
+// Block types (first byte of every block in a frame)
+// RAW_IMPLICIT: [0][bytes...]                  (legacy, length = block_size)
+// COMPRESSED:   [1][OrigSize:4][CompSize:4][payload...]
+// RAW:          [2][Size:4][bytes...]
+// SKIPPABLE:    [3][Size:4][metadata...]       (decodes to nothing)
+// LZ:           [4][OrigSize:4][CompSize:4][sequences...]
+// LZ blocks (level 1) hold the byte-aligned sequences of zyphrax_seq.h with
+// no entropy stage. A block ends on a match reaching its last byte, or, when
+// literals are left after the last match, on a sequence of literals only.
+#define ZYPHRAX_BLOCK_RAW_IMPLICIT 0
+#define ZYPHRAX_BLOCK_COMPRESSED 1
+#define ZYPHRAX_BLOCK_RAW 2
+#define ZYPHRAX_BLOCK_SKIPPABLE 3
+#define ZYPHRAX_BLOCK_LZ 4
+
+#define ZYPHRAX_BLOCK_HDR_COMPRESSED 9
+#define ZYPHRAX_BLOCK_HDR_RAW 5
+#define ZYPHRAX_BLOCK_HDR_SKIPPABLE 5
+#define ZYPHRAX_BLOCK_HDR_LZ 9
+
+// In a checksummed frame (zyphrax_params_t.checksum) the top two bits of the
+// type byte of COMPRESSED, RAW and LZ blocks hold the checksum kind, and the
+// header ends with the checksum of the decoded bytes:
+// COMPRESSED:   [1|Kind<<6][OrigSize:4][CompSize:4][Checksum:4][payload...]
+// RAW:          [2|Kind<<6][Size:4][Checksum:4][bytes...]
+// LZ:           [4|Kind<<6][OrigSize:4][CompSize:4][Checksum:4][payload...]
+#define ZYPHRAX_BLOCK_TYPE_MASK 0x3F
+#define ZYPHRAX_BLOCK_SUM_SHIFT 6
+#define ZYPHRAX_BLOCK_SUM_SIZE 4
+
 // Compresses a single block (up to 64KB or whatever params say)
 // Returns compressed size.
 // If compressed size >= src_size (expansion), returns 0 or flag?
@@ -10,3 +42,58 @@
 // We'll return size.
 size_t zyphrax_compress_block(const uint8_t *src, size_t src_size, uint8_t *dst,
                               size_t dst_cap, const zyphrax_params_t *params);
+
+// Stores src as one RAW block. Returns its size, or 0 if dst_cap is short.
+size_t zyphrax_store_raw(const uint8_t *src, size_t src_size, uint8_t *dst,
+                         size_t dst_cap);
+
+// Same, checksummed when params asks for it
+size_t zyphrax_store_block(const uint8_t *src, size_t src_size, uint8_t *dst,
+                           size_t dst_cap, const zyphrax_params_t *params);
+
+// Reusable block workspace (match finder + sequence buffer)
+// Lets callers compressing many blocks pay for the allocations once.
+// When stats is set, every block written adds its counters to it.
+typedef struct {
+  zyphrax_lz77_t *lz;
+  zyphrax_sequence_t *seqs;
+  size_t max_seqs;
+  zyphrax_stats_t *stats; // NULL (the default) collects nothing
+} zyphrax_block_ws_t;
+
+// Sizes the workspace for blocks up to block_size, allocating through alloc
+// (NULL = malloc). Returns 0 or -1 (OOM).
+int zyphrax_block_ws_init(zyphrax_block_ws_t *ws, size_t block_size,
+                          const zyphrax_allocator_t *alloc);
+void zyphrax_block_ws_free(zyphrax_block_ws_t *ws,
+                           const zyphrax_allocator_t *alloc);
+
+// Arena bytes zyphrax_block_ws_init takes for block_size (see zyphrax_mem.h)
+size_t zyphrax_block_ws_size(size_t block_size);
+
+// Same as zyphrax_compress_block, using a caller-owned workspace.
+// src_size must not exceed the block_size the workspace was sized for.
+// With ZYPHRAX_FLAG_SPLIT_BLOCKS the output may be up to 4 consecutive
+// blocks, each no larger than its input plus ZYPHRAX_BLOCK_HDR_RAW (and
+// ZYPHRAX_BLOCK_SUM_SIZE when checksummed).
+size_t zyphrax_compress_block_ws(zyphrax_block_ws_t *ws, const uint8_t *src,
+                                 size_t src_size, uint8_t *dst, size_t dst_cap,
+                                 const zyphrax_params_t *params);
+
+// Same, from and to windows over scattered buffers (zyphrax_compressv):
+// matches reach across the input's segments and the block is written across
+// the output's. dst->size bounds the output.
+size_t zyphrax_compress_block_segs(zyphrax_block_ws_t *ws,
+                                   const zyphrax_segs_t *src,
+                                   const zyphrax_segs_t *dst,
+                                   const zyphrax_params_t *params);
+
+// Same, at tier 1-ZYPHRAX_LEVEL_MAX of the adaptive level controller instead
+// of params->level: tier 1 writes LZ blocks like level 1, tier 9 searches like
+// the fixed levels, and the tiers between walk fewer chain links. Returns 0
+// for an invalid tier.
+size_t zyphrax_compress_block_tier(zyphrax_block_ws_t *ws, const uint8_t *src,
+                                   size_t src_size, uint8_t *dst,
+                                   size_t dst_cap,
+                                   const zyphrax_params_t *params,
+                                   uint32_t tier);
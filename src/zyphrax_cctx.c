@@ -0,0 +1,579 @@
+#include "zyphrax.h"
+#include "zyphrax_block.h"
+#include "zyphrax_frame.h"
+#include "zyphrax_hash.h"
+#include "zyphrax_mem.h"
+#include "zyphrax_pool.h"
+#include "zyphrax_seek.h"
+#include "zyphrax_stats.h"
+#include "zyphrax_trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+// Blocks compressed per pool run, per worker. More than one evens out blocks
+// that compress at different speeds.
+#define CCTX_BLOCKS_PER_WORKER 4
+
+// Encoded block slot: block_size + raw fallback header, with room to spare
+#define CCTX_SLOT_SLACK 64
+
+static void write_u64_le(uint8_t *p, uint64_t x) {
+  for (int i = 0; i < 8; i++)
+    p[i] = (uint8_t)(x >> (8 * i));
+}
+
+// -------------------------------------------------------------------------
+// Compression Context
+// -------------------------------------------------------------------------
+// Holds everything that is worth keeping between calls: the worker pool,
+// one block workspace per worker and (multithreaded) the slots blocks are
+// compressed into before being placed in the frame. Resources are sized
+// lazily for the largest block_size seen.
+//
+// Static mode: the context and its single workspace are carved from the
+// caller's buffer by an arena allocator, sized up front for one block_size.
+
+struct zyphrax_cctx_s {
+  unsigned nb_workers;
+  zyphrax_pool_t *pool; // NULL when single-threaded
+  zyphrax_allocator_t alloc;
+  zyphrax_arena_t arena; // Static mode only
+  int is_static;
+
+  zyphrax_block_ws_t *ws; // One per worker
+  size_t ws_block_size;   // Block size the workspaces are sized for
+
+  uint8_t *slots;
+  size_t slot_size;
+  size_t nb_slots;
+  size_t *slot_len;
+  size_t *slot_off;
+  zyphrax_stats_t *slot_stats; // Record of each slot's block
+
+  zyphrax_stats_sink_t stats;
+};
+
+zyphrax_cctx_t *zyphrax_cctx_create(unsigned nb_workers) {
+  return zyphrax_cctx_create_advanced(nb_workers, NULL);
+}
+
+zyphrax_cctx_t *zyphrax_cctx_create_advanced(unsigned nb_workers,
+                                             const zyphrax_allocator_t *alloc) {
+  if (nb_workers == 0)
+    nb_workers = 1;
+
+  zyphrax_cctx_t *cctx = zyphrax_calloc(alloc, 1, sizeof(*cctx));
+  if (!cctx)
+    return NULL;
+  cctx->nb_workers = nb_workers;
+  if (alloc)
+    cctx->alloc = *alloc;
+
+  cctx->ws = zyphrax_calloc(alloc, nb_workers, sizeof(*cctx->ws));
+  if (!cctx->ws) {
+    zyphrax_free(alloc, cctx);
+    return NULL;
+  }
+
+  if (nb_workers > 1) {
+    cctx->pool = zyphrax_pool_create(nb_workers, alloc);
+    cctx->nb_slots = (size_t)nb_workers * CCTX_BLOCKS_PER_WORKER;
+    cctx->slot_len = zyphrax_malloc(alloc, cctx->nb_slots * sizeof(size_t));
+    cctx->slot_off = zyphrax_malloc(alloc, cctx->nb_slots * sizeof(size_t));
+    cctx->slot_stats =
+        zyphrax_malloc(alloc, cctx->nb_slots * sizeof(zyphrax_stats_t));
+    if (!cctx->pool || !cctx->slot_len || !cctx->slot_off ||
+        !cctx->slot_stats) {
+      zyphrax_cctx_free(cctx);
+      return NULL;
+    }
+  }
+  return cctx;
+}
+
+void zyphrax_cctx_free(zyphrax_cctx_t *cctx) {
+  if (!cctx || cctx->is_static)
+    return; // Static: nothing is owned
+  zyphrax_allocator_t alloc = cctx->alloc;
+  zyphrax_pool_free(cctx->pool);
+  for (unsigned i = 0; i < cctx->nb_workers; i++)
+    zyphrax_block_ws_free(&cctx->ws[i], &alloc);
+  zyphrax_free(&alloc, cctx->ws);
+  zyphrax_free(&alloc, cctx->slots);
+  zyphrax_free(&alloc, cctx->slot_len);
+  zyphrax_free(&alloc, cctx->slot_off);
+  zyphrax_free(&alloc, cctx->slot_stats);
+  zyphrax_free(&alloc, cctx);
+}
+
+// Makes sure workspaces (and slots) fit blocks of block_size
+static int cctx_reserve(zyphrax_cctx_t *cctx, size_t block_size) {
+  if (cctx->ws[0].lz && block_size <= cctx->ws_block_size)
+    return 0;
+  if (cctx->is_static)
+    return -1; // The workspace cannot grow
+
+  for (unsigned i = 0; i < cctx->nb_workers; i++) {
+    zyphrax_block_ws_free(&cctx->ws[i], &cctx->alloc);
+    if (zyphrax_block_ws_init(&cctx->ws[i], block_size, &cctx->alloc) != 0)
+      return -1;
+  }
+  cctx->ws_block_size = block_size;
+
+  if (cctx->pool) {
+    zyphrax_free(&cctx->alloc, cctx->slots);
+    cctx->slot_size = block_size + CCTX_SLOT_SLACK;
+    cctx->slots =
+        zyphrax_malloc(&cctx->alloc, cctx->nb_slots * cctx->slot_size);
+    if (!cctx->slots) {
+      cctx->ws_block_size = 0;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Bytes the context holds: its workspaces and slots (statistics mem_peak;
+// they only grow, so this is also the most it has held)
+static uint64_t cctx_footprint(const zyphrax_cctx_t *cctx) {
+  if (cctx->is_static)
+    return cctx->arena.used;
+  uint64_t mem = sizeof(*cctx) + cctx->nb_workers * sizeof(*cctx->ws);
+  if (cctx->ws_block_size)
+    mem += (uint64_t)cctx->nb_workers *
+           zyphrax_block_ws_size(cctx->ws_block_size);
+  if (cctx->pool)
+    mem += cctx->nb_slots * (cctx->slot_size + 2 * sizeof(size_t) +
+                             sizeof(zyphrax_stats_t));
+  return mem;
+}
+
+void zyphrax_cctx_set_stats(zyphrax_cctx_t *cctx, int enable,
+                            zyphrax_stats_fn fn, void *opaque) {
+  zyphrax_stats_set(&cctx->stats, enable, fn, opaque);
+}
+
+void zyphrax_cctx_get_stats(const zyphrax_cctx_t *cctx,
+                            zyphrax_stats_t *stats) {
+  *stats = cctx->stats.total;
+}
+
+static zyphrax_params_t cctx_params(const zyphrax_params_t *params) {
+  zyphrax_params_t p = *params;
+  if (p.block_size == 0)
+    p.block_size = ZYPHRAX_BLOCK_SIZE;
+  return p;
+}
+
+size_t zyphrax_cctx_workspace_size(const zyphrax_params_t *params) {
+  zyphrax_params_t p = cctx_params(params);
+  return ZYPHRAX_ARENA_SLACK + zyphrax_arena_round(sizeof(zyphrax_cctx_t)) +
+         zyphrax_arena_round(sizeof(zyphrax_block_ws_t)) +
+         zyphrax_block_ws_size(p.block_size);
+}
+
+zyphrax_cctx_t *zyphrax_cctx_init_static(void *workspace, size_t size,
+                                         const zyphrax_params_t *params) {
+  zyphrax_arena_t arena;
+  zyphrax_arena_init(&arena, workspace, size);
+  zyphrax_allocator_t alloc = zyphrax_arena_allocator(&arena);
+
+  zyphrax_cctx_t *cctx = zyphrax_calloc(&alloc, 1, sizeof(*cctx));
+  if (!cctx)
+    return NULL;
+  // From here on the arena state lives in the context itself
+  cctx->arena = arena;
+  cctx->alloc = zyphrax_arena_allocator(&cctx->arena);
+  cctx->is_static = 1;
+  cctx->nb_workers = 1;
+
+  cctx->ws = zyphrax_calloc(&cctx->alloc, 1, sizeof(*cctx->ws));
+  if (!cctx->ws)
+    return NULL;
+
+  zyphrax_params_t p = cctx_params(params);
+  if (zyphrax_block_ws_init(&cctx->ws[0], p.block_size, &cctx->alloc) != 0)
+    return NULL;
+  cctx->ws_block_size = p.block_size;
+  return cctx;
+}
+
+typedef struct {
+  zyphrax_cctx_t *cctx;
+  const uint8_t *src;
+  size_t src_size;
+  size_t block_size;
+  size_t first; // Index of the first block of this round
+  uint8_t *dst;
+  const zyphrax_params_t *params;
+} cctx_round_t;
+
+static void compress_slot_job(void *ctx, size_t job, unsigned worker) {
+  cctx_round_t *r = (cctx_round_t *)ctx;
+  zyphrax_cctx_t *cctx = r->cctx;
+  size_t pos = (r->first + job) * r->block_size;
+  size_t len = min(r->block_size, r->src_size - pos);
+
+  zyphrax_block_ws_t *ws = &cctx->ws[worker];
+  ws->stats = NULL;
+  if (cctx->stats.on) {
+    ws->stats = &cctx->slot_stats[job];
+    memset(ws->stats, 0, sizeof(*ws->stats));
+  }
+  cctx->slot_len[job] = zyphrax_compress_block_ws(
+      ws, r->src + pos, len, cctx->slots + job * cctx->slot_size,
+      cctx->slot_size, r->params);
+}
+
+static void place_slot_job(void *ctx, size_t job, unsigned worker) {
+  cctx_round_t *r = (cctx_round_t *)ctx;
+  zyphrax_cctx_t *cctx = r->cctx;
+  (void)worker;
+  memcpy(r->dst + cctx->slot_off[job], cctx->slots + job * cctx->slot_size,
+         cctx->slot_len[job]);
+}
+
+// Frame header (+ content size). Returns its size.
+static size_t cctx_write_header(uint8_t *dst, const zyphrax_params_t *p,
+                                size_t src_size) {
+  zyphrax_write_header_internal(dst, p);
+  size_t out = ZYPHRAX_HEADER_SIZE;
+  if (p->flags & ZYPHRAX_FLAG_CONTENT_SIZE) {
+    write_u64_le(dst + out, (uint64_t)src_size);
+    out += ZYPHRAX_CONTENT_SIZE_FIELD;
+  }
+  return out;
+}
+
+// Appends the checksum block and the seek table (as requested) to the
+// blocks at dst[first, out), both rebuilt from the block headers. Returns
+// the frame size, or 0.
+static size_t cctx_write_trailer(uint8_t *dst, size_t first, size_t out,
+                                 size_t dst_cap, const zyphrax_params_t *p) {
+  size_t end = out;
+  if (p->checksum != ZYPHRAX_CHECKSUM_NONE) {
+    zyphrax_frame_sum_t sum;
+    zyphrax_frame_sum_init(&sum, (int)p->checksum);
+    zyphrax_block_info_t info;
+    for (size_t pos = first; pos < out; pos += info.hdr_size + info.comp_size) {
+      if (zyphrax_read_block_info(dst + pos, out - pos, p->block_size,
+                                  &info) != 0 ||
+          zyphrax_frame_sum_block(&sum, dst + pos, &info) != 0)
+        return 0;
+    }
+    size_t n = zyphrax_write_frame_sum(&sum, dst + end, dst_cap - end);
+    if (n == 0)
+      return 0;
+    end += n;
+  }
+
+  if (!(p->flags & ZYPHRAX_FLAG_SEEK_TABLE))
+    return end;
+  // The table indexes the data blocks only
+  size_t table = zyphrax_write_seek_table_scan(dst, first, out, p->block_size,
+                                               dst + end, dst_cap - end);
+  return table ? end + table : 0;
+}
+
+// Blocks of src written at dst + out on the calling thread with one
+// workspace. p has its defaults applied and ws fits min(block_size,
+// src_size). With a sink, ws->stats is pointed at its block record and
+// every block is passed on. Returns the new end of dst, or 0.
+static size_t cctx_blocks_ws(zyphrax_block_ws_t *ws, const uint8_t *src,
+                             size_t src_size, uint8_t *dst, size_t out,
+                             size_t dst_cap, const zyphrax_params_t *p,
+                             zyphrax_stats_sink_t *sink) {
+  size_t block_size = p->block_size;
+  size_t nb_blocks = (src_size + block_size - 1) / block_size;
+  if (sink)
+    ws->stats = &sink->block;
+  for (size_t blk = 0; blk < nb_blocks; blk++) {
+    size_t pos = blk * block_size;
+    size_t len = min(block_size, src_size - pos);
+    size_t enc = zyphrax_compress_block_ws(ws, src + pos, len, dst + out,
+                                           dst_cap - out, p);
+    if (enc == 0)
+      return 0; // Error / overflow
+    out += enc;
+    if (sink) {
+      zyphrax_stats_done(sink, &sink->block);
+      memset(&sink->block, 0, sizeof(sink->block));
+    }
+  }
+  return out;
+}
+
+// Same, on the context's workers: rounds of blocks are compressed into
+// slots in parallel, laid out in order, then copied into dst in parallel
+static size_t cctx_blocks(zyphrax_cctx_t *cctx, const uint8_t *src,
+                          size_t src_size, uint8_t *dst, size_t out,
+                          size_t dst_cap, const zyphrax_params_t *p) {
+  zyphrax_stats_sink_t *sink = cctx->stats.on ? &cctx->stats : NULL;
+  if (!cctx->pool) {
+    cctx->ws[0].stats = NULL;
+    return cctx_blocks_ws(&cctx->ws[0], src, src_size, dst, out, dst_cap, p,
+                          sink);
+  }
+
+  size_t block_size = p->block_size;
+  size_t nb_blocks = (src_size + block_size - 1) / block_size;
+  for (size_t blk = 0; blk < nb_blocks;) {
+    size_t count = min(cctx->nb_slots, nb_blocks - blk);
+    cctx_round_t r = {cctx, src, src_size, block_size, blk, dst, p};
+    zyphrax_pool_run(cctx->pool, compress_slot_job, &r, count);
+
+    for (size_t i = 0; i < count; i++) {
+      size_t len = cctx->slot_len[i];
+      if (len == 0 || len > dst_cap - out)
+        return 0;
+      cctx->slot_off[i] = out;
+      out += len;
+      if (sink)
+        zyphrax_stats_done(sink, &cctx->slot_stats[i]);
+    }
+    zyphrax_pool_run(cctx->pool, place_slot_job, &r, count);
+    blk += count;
+  }
+  return out;
+}
+
+// Whole frame on the calling thread with one workspace (see cctx_blocks_ws)
+static size_t compress_frame_ws(zyphrax_block_ws_t *ws, const uint8_t *src,
+                                size_t src_size, uint8_t *dst, size_t dst_cap,
+                                const zyphrax_params_t *p) {
+  if (dst_cap < zyphrax_frame_header_size(p))
+    return 0;
+
+  ZYPHRAX_PROBE2(frame_compress_start, src_size, p->level);
+  size_t first = cctx_write_header(dst, p, src_size);
+  size_t out = cctx_blocks_ws(ws, src, src_size, dst, first, dst_cap, p, NULL);
+  size_t end = out ? cctx_write_trailer(dst, first, out, dst_cap, p) : 0;
+  ZYPHRAX_PROBE2(frame_compress_end, src_size, end);
+  return end;
+}
+
+size_t zyphrax_compress_cctx(zyphrax_cctx_t *cctx, const uint8_t *src,
+                             size_t src_size, uint8_t *dst, size_t dst_cap,
+                             const zyphrax_params_t *params) {
+  if (dst_cap < zyphrax_frame_header_size(params) ||
+      params->checksum > ZYPHRAX_CHECKSUM_XXH32)
+    return 0;
+
+  zyphrax_params_t p = cctx_params(params);
+  if (cctx_reserve(cctx, min(p.block_size, src_size)) != 0)
+    return 0;
+  if (cctx->stats.on)
+    zyphrax_stats_begin(&cctx->stats, cctx_footprint(cctx));
+
+  ZYPHRAX_PROBE2(frame_compress_start, src_size, p.level);
+  size_t first = cctx_write_header(dst, &p, src_size);
+  size_t out = cctx_blocks(cctx, src, src_size, dst, first, dst_cap, &p);
+  size_t end = out ? cctx_write_trailer(dst, first, out, dst_cap, &p) : 0;
+  ZYPHRAX_PROBE2(frame_compress_end, src_size, end);
+  return end;
+}
+
+// -------------------------------------------------------------------------
+// Append
+// -------------------------------------------------------------------------
+// The new blocks are compressed past the end of dst first, so nothing the
+// caller has is overwritten until they are known to fit; they then move
+// down over the old trailer and a new one is written after them. The old
+// blocks are only read back for their headers (trailer scan).
+
+// Data region of the frame at f: the end of its last data block, where the
+// checksum block or seek table starts. Checks the old frame checksum on the
+// way. Returns 0 on error (or if the frame cannot take more blocks).
+static size_t append_data_end(const uint8_t *f, size_t f_size,
+                              const zyphrax_frame_t *frame) {
+  const zyphrax_params_t *p = &frame->params;
+  zyphrax_frame_sum_t sum;
+  zyphrax_frame_sum_init(&sum, (int)p->checksum);
+
+  size_t data_end = frame->header_size;
+  int last_type = -1;
+  zyphrax_block_info_t info;
+  for (size_t pos = data_end; pos < f_size;) {
+    if (zyphrax_read_block_info(f + pos, f_size - pos, p->block_size,
+                                &info) != 0 ||
+        zyphrax_frame_sum_block(&sum, f + pos, &info) != 0)
+      return 0;
+    if (sum.sealed)
+      break; // Checksum block: the trailer starts here
+    pos += info.hdr_size + info.comp_size;
+    if (info.type == ZYPHRAX_BLOCK_SKIPPABLE &&
+        (p->flags & ZYPHRAX_FLAG_SEEK_TABLE) && pos == f_size)
+      break; // Seek table
+    data_end = pos;
+    last_type = info.type;
+  }
+  // A legacy implicit raw block runs to the end of the frame
+  if (zyphrax_frame_sum_end(&sum) != 0 ||
+      last_type == ZYPHRAX_BLOCK_RAW_IMPLICIT)
+    return 0;
+  return data_end;
+}
+
+static size_t count_blocks(const uint8_t *dst, size_t begin, size_t end,
+                           size_t block_size) {
+  zyphrax_block_info_t info;
+  size_t count = 0;
+  for (size_t pos = begin; pos < end; pos += info.hdr_size + info.comp_size) {
+    zyphrax_read_block_info(dst + pos, end - pos, block_size, &info);
+    count++;
+  }
+  return count;
+}
+
+size_t zyphrax_append_cctx(zyphrax_cctx_t *cctx, uint8_t *dst, size_t dst_size,
+                           size_t dst_cap, const uint8_t *src,
+                           size_t src_size, const zyphrax_params_t *params) {
+  // Last frame in dst
+  size_t start = 0;
+  for (size_t pos = 0, len; pos < dst_size; pos += len) {
+    len = zyphrax_find_frame_size(dst + pos, dst_size - pos);
+    if (len == 0)
+      return 0;
+    start = pos;
+  }
+  zyphrax_frame_t frame;
+  if (dst_size == 0 || dst_cap < dst_size ||
+      zyphrax_frame_word(dst + start) != ZYPHRAX_MAGIC ||
+      zyphrax_read_frame_internal(dst + start, dst_size - start, &frame) != 0)
+    return 0;
+
+  uint8_t *f = dst + start;
+  size_t f_size = dst_size - start;
+  size_t f_cap = dst_cap - start;
+  size_t data_end = append_data_end(f, f_size, &frame);
+  if (data_end == 0)
+    return 0;
+
+  zyphrax_params_t p = cctx_params(&frame.params);
+  if (params)
+    p.level = params->level;
+  if (cctx_reserve(cctx, min(p.block_size, src_size)) != 0)
+    return 0;
+  if (cctx->stats.on)
+    zyphrax_stats_begin(&cctx->stats, cctx_footprint(cctx));
+
+  // New blocks past the old trailer, then a check that the new trailer
+  // fits before anything moves
+  size_t end = cctx_blocks(cctx, src, src_size, f, f_size, f_cap, &p);
+  if (end == 0)
+    return 0;
+  size_t added = end - f_size;
+  size_t trailer = 0;
+  if (p.checksum != ZYPHRAX_CHECKSUM_NONE)
+    trailer += ZYPHRAX_SUM_BLOCK_SIZE;
+  if (p.flags & ZYPHRAX_FLAG_SEEK_TABLE)
+    trailer += zyphrax_seek_table_size(
+        count_blocks(f, frame.header_size, data_end, p.block_size) +
+        count_blocks(f, f_size, end, p.block_size));
+  if (trailer > f_cap - data_end - added)
+    return 0;
+
+  memmove(f + data_end, f + f_size, added);
+  if (frame.content_size != ZYPHRAX_CONTENT_SIZE_ERROR)
+    write_u64_le(f + ZYPHRAX_HEADER_SIZE, frame.content_size + src_size);
+  size_t f_end =
+      cctx_write_trailer(f, frame.header_size, data_end + added, f_cap, &p);
+  return f_end ? start + f_end : 0;
+}
+
+size_t zyphrax_append(uint8_t *dst, size_t dst_size, size_t dst_cap,
+                      const uint8_t *src, size_t src_size,
+                      const zyphrax_params_t *params) {
+  zyphrax_cctx_t *cctx = zyphrax_cctx_create(1);
+  if (!cctx)
+    return 0;
+  size_t res = zyphrax_append_cctx(cctx, dst, dst_size, dst_cap, src, src_size,
+                                   params);
+  zyphrax_cctx_free(cctx);
+  return res;
+}
+
+// -------------------------------------------------------------------------
+// Batch
+// -------------------------------------------------------------------------
+// Every item is a complete frame compressed by one worker with that
+// worker's workspace, so per-message cost is the match itself: no
+// allocation, no thread start and no full match finder reset.
+
+typedef struct {
+  zyphrax_cctx_t *cctx;
+  zyphrax_batch_item_t *items;
+  const zyphrax_params_t *params;
+} cctx_batch_t;
+
+static void compress_item_job(void *ctx, size_t job, unsigned worker) {
+  cctx_batch_t *b = (cctx_batch_t *)ctx;
+  zyphrax_batch_item_t *item = &b->items[job];
+  item->result = compress_frame_ws(&b->cctx->ws[worker], item->src,
+                                   item->src_size, item->dst, item->dst_cap,
+                                   b->params);
+}
+
+size_t zyphrax_compress_batch(zyphrax_cctx_t *cctx, zyphrax_batch_item_t *items,
+                              size_t count, const zyphrax_params_t *params) {
+  zyphrax_params_t p = cctx_params(params);
+
+  // Workspaces sized for the largest block in the batch
+  size_t largest = 0;
+  for (size_t i = 0; i < count; i++) {
+    size_t block = min(p.block_size, items[i].src_size);
+    if (block > largest)
+      largest = block;
+    items[i].result = 0;
+  }
+  if (p.checksum > ZYPHRAX_CHECKSUM_XXH32 || cctx_reserve(cctx, largest) != 0)
+    return 0;
+
+  // Statistics: one record per worker, added up afterwards
+  zyphrax_stats_t *rec = NULL;
+  if (cctx->stats.on) {
+    zyphrax_stats_begin(&cctx->stats, cctx_footprint(cctx));
+    rec = cctx->pool ? cctx->slot_stats : &cctx->stats.block;
+    memset(rec, 0, cctx->nb_workers * sizeof(*rec));
+  }
+  for (unsigned i = 0; i < cctx->nb_workers; i++)
+    cctx->ws[i].stats = rec ? &rec[i] : NULL;
+
+  cctx_batch_t b = {cctx, items, &p};
+  if (cctx->pool && count > 1) {
+    zyphrax_pool_run(cctx->pool, compress_item_job, &b, count);
+  } else {
+    for (size_t i = 0; i < count; i++)
+      compress_item_job(&b, i, 0);
+  }
+
+  for (unsigned i = 0; rec && i < cctx->nb_workers; i++)
+    zyphrax_stats_add(&cctx->stats.total, &rec[i]);
+
+  size_t ok = 0;
+  for (size_t i = 0; i < count; i++)
+    ok += items[i].result != 0;
+  return ok;
+}
+
+size_t zyphrax_compress_mt(const uint8_t *src, size_t src_size, uint8_t *dst,
+                           size_t dst_cap, const zyphrax_params_t *params,
+                           unsigned nb_threads) {
+  // No point in more workers than blocks
+  size_t block_size = params->block_size ? params->block_size
+                                         : ZYPHRAX_BLOCK_SIZE;
+  size_t nb_blocks = (src_size + block_size - 1) / block_size;
+  if (nb_threads > nb_blocks)
+    nb_threads = (unsigned)nb_blocks;
+
+  zyphrax_cctx_t *cctx = zyphrax_cctx_create(nb_threads);
+  if (!cctx)
+    return 0;
+  size_t res = zyphrax_compress_cctx(cctx, src, src_size, dst, dst_cap, params);
+  zyphrax_cctx_free(cctx);
+  return res;
+}
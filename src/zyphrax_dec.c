@@ -1,4 +1,9 @@
 #include "zyphrax_dec.h"
+#include "zyphrax_frame.h"
+#include "zyphrax_hash.h"
+#include "zyphrax_mem.h"
+#include "zyphrax_stats.h"
+#include "zyphrax_trace.h"
 #include <string.h>
 
 void zyphrax_build_dec_table(zyphrax_huff_decoder *dec,
@@ -22,8 +27,14 @@ void zyphrax_build_dec_table(zyphrax_huff_decoder *dec,
   }
 
   // 3. Fill Table
-  // Init table with 0 (invalid)
-  memset(dec->table, 0, sizeof(dec->table));
+  // Indexed by the next max-code-length bits; init with 0 (invalid)
+  dec->bits = 0;
+  for (int bits = 1; bits <= 15; bits++) {
+    if (bl_count[bits])
+      dec->bits = bits;
+  }
+  size_t table_size = (size_t)1 << dec->bits;
+  memset(dec->table, 0, table_size * sizeof(dec->table[0]));
 
   for (int i = 0; i < 256; i++) {
     int len = code_lens[i];
@@ -76,8 +87,726 @@ void zyphrax_build_dec_table(zyphrax_huff_decoder *dec,
 
     uint16_t entry = (i << 8) | len; // [sym:8][len:8]
 
-    for (int j = r; j < FAST_TABLE_SIZE; j += stride) {
+    for (size_t j = r; j < table_size; j += stride) {
       dec->table[j] = entry;
     }
   }
 }
+
+// -------------------------------------------------------------------------
+// Block Decoder
+// -------------------------------------------------------------------------
+
+static inline uint32_t read_u32_le(const uint8_t *p) {
+  return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+int zyphrax_read_block_info(const uint8_t *src, size_t src_size,
+                            size_t block_size, zyphrax_block_info_t *info) {
+  if (src_size < 1)
+    return -1;
+
+  info->type = src[0] & ZYPHRAX_BLOCK_TYPE_MASK;
+  info->sum_kind = src[0] >> ZYPHRAX_BLOCK_SUM_SHIFT;
+  info->checksum = 0;
+  switch (info->type) {
+  case ZYPHRAX_BLOCK_RAW_IMPLICIT:
+    // Legacy raw block: no length, spans block_size or the rest of the frame
+    info->hdr_size = 1;
+    info->comp_size = src_size - 1;
+    if (block_size > 0 && info->comp_size > block_size)
+      info->comp_size = block_size;
+    info->orig_size = info->comp_size;
+    break;
+  case ZYPHRAX_BLOCK_RAW:
+    if (src_size < ZYPHRAX_BLOCK_HDR_RAW)
+      return -1;
+    info->hdr_size = ZYPHRAX_BLOCK_HDR_RAW;
+    info->comp_size = read_u32_le(src + 1);
+    info->orig_size = info->comp_size;
+    break;
+  case ZYPHRAX_BLOCK_SKIPPABLE:
+    if (src_size < ZYPHRAX_BLOCK_HDR_SKIPPABLE)
+      return -1;
+    info->hdr_size = ZYPHRAX_BLOCK_HDR_SKIPPABLE;
+    info->comp_size = read_u32_le(src + 1);
+    info->orig_size = 0;
+    break;
+  case ZYPHRAX_BLOCK_COMPRESSED:
+  case ZYPHRAX_BLOCK_LZ:
+    if (src_size < ZYPHRAX_BLOCK_HDR_COMPRESSED)
+      return -1;
+    info->hdr_size = ZYPHRAX_BLOCK_HDR_COMPRESSED;
+    info->orig_size = read_u32_le(src + 1);
+    info->comp_size = read_u32_le(src + 5);
+    break;
+  default:
+    return -1;
+  }
+
+  if (info->sum_kind != ZYPHRAX_CHECKSUM_NONE) {
+    if (info->sum_kind > ZYPHRAX_CHECKSUM_XXH32 ||
+        (info->type != ZYPHRAX_BLOCK_COMPRESSED &&
+         info->type != ZYPHRAX_BLOCK_RAW && info->type != ZYPHRAX_BLOCK_LZ) ||
+        src_size < info->hdr_size + ZYPHRAX_BLOCK_SUM_SIZE)
+      return -1;
+    info->checksum = read_u32_le(src + info->hdr_size);
+    info->hdr_size += ZYPHRAX_BLOCK_SUM_SIZE;
+  }
+
+  if (info->comp_size > src_size - info->hdr_size)
+    return -1; // Truncated payload
+  return 0;
+}
+
+int zyphrax_index_blocks(const uint8_t *src, size_t src_size,
+                         size_t block_size, zyphrax_block_ref_t **refs,
+                         size_t *count, size_t *total,
+                         const zyphrax_allocator_t *alloc) {
+  size_t cap = 64;
+  size_t n = 0;
+  size_t in = 0;
+  size_t out = 0;
+
+  zyphrax_block_ref_t *arr = zyphrax_malloc(alloc, cap * sizeof(*arr));
+  if (!arr)
+    return -1;
+
+  while (in < src_size && !zyphrax_is_frame_start(src + in, src_size - in)) {
+    if (n == cap) {
+      // The hooks have no realloc
+      zyphrax_block_ref_t *grown =
+          zyphrax_malloc(alloc, 2 * cap * sizeof(*arr));
+      if (!grown) {
+        zyphrax_free(alloc, arr);
+        return -1;
+      }
+      memcpy(grown, arr, n * sizeof(*arr));
+      zyphrax_free(alloc, arr);
+      arr = grown;
+      cap *= 2;
+    }
+
+    zyphrax_block_ref_t *ref = &arr[n];
+    if (zyphrax_read_block_info(src + in, src_size - in, block_size,
+                                &ref->info) != 0) {
+      zyphrax_free(alloc, arr);
+      return -1;
+    }
+    ref->src_off = in;
+    ref->dst_off = out;
+    in += ref->info.hdr_size + ref->info.comp_size;
+    out += ref->info.orig_size;
+    n++;
+  }
+
+  *refs = arr;
+  *count = n;
+  *total = out;
+  return 0;
+}
+
+// Decompression Helper: Read Bits
+typedef struct {
+  const uint8_t *ptr;
+  const uint8_t *end;
+  uint64_t bit_buf;
+  int bit_count;
+} z_bit_reader;
+
+static inline void refill_bits(z_bit_reader *br) {
+  while (br->bit_count <= 56 && br->ptr < br->end) {
+    br->bit_buf |= ((uint64_t)(*br->ptr++)) << br->bit_count;
+    br->bit_count += 8;
+  }
+}
+
+static inline uint16_t peek_bits(z_bit_reader *br, int n) {
+  return (uint16_t)(br->bit_buf & ((1 << n) - 1));
+}
+
+static inline void consume_bits(z_bit_reader *br, int n) {
+  br->bit_buf >>= n;
+  br->bit_count -= n;
+}
+
+static inline uint16_t read_bits(z_bit_reader *br, int n) {
+  uint16_t val = peek_bits(br, n);
+  consume_bits(br, n);
+  return val;
+}
+
+// Decode symbol using table
+// Returns -1 on an invalid code or when the code runs past the payload.
+static inline int decode_sym(z_bit_reader *br,
+                             const zyphrax_huff_decoder *dec) {
+  refill_bits(br);
+  // Peek as many bits as the longest code
+  uint16_t look = peek_bits(br, dec->bits);
+  uint16_t entry = dec->table[look];
+  // Entry: [sym:8][bits:8]
+  uint8_t bits = entry & 0xFF;
+  if (bits == 0 || bits > br->bit_count)
+    return -1;
+  consume_bits(br, bits);
+  return entry >> 8;
+}
+
+// Extra length: run of 255 bytes plus a terminator. Literal runs in
+// incompressible data span whole blocks, so the run is only bounded by input.
+static size_t read_start_extra(z_bit_reader *br) {
+  size_t val = 0;
+  for (;;) {
+    refill_bits(br);
+    if (br->bit_count < 8)
+      break; // No more data
+    uint8_t b = read_bits(br, 8);
+    val += b;
+    if (b < 255)
+      break;
+  }
+  return val;
+}
+
+static void read_code_lens(const uint8_t *in, uint8_t *lens) {
+  for (int i = 0; i < 256; i += 2) {
+    uint8_t b = *in++;
+    lens[i] = (b >> 4);
+    lens[i + 1] = (b & 0xF);
+  }
+}
+
+size_t zyphrax_decompress_block(const uint8_t *src,
+                                const zyphrax_block_info_t *info, uint8_t *dst,
+                                size_t dst_cap) {
+  zyphrax_dec_ws_t ws;
+  ws.stats = NULL;
+  return zyphrax_decompress_block_ws(&ws, src, info, dst, dst_cap);
+}
+
+// -------------------------------------------------------------------------
+// LZ Block Decoder
+// -------------------------------------------------------------------------
+// Byte-aligned sequences (zyphrax_seq.h). While there is room, literals and
+// matches move in 16-byte steps that may write up to 15 bytes past the
+// copy; those bytes are still inside the block and are overwritten by what
+// follows. Near either end of the block copies are exact, so nothing is
+// read past the payload or written past dst + orig_size (in-place decoding
+// relies on the latter).
+
+#define LZ_WILD 16
+
+// Extra length bytes: a run of 255s and a terminator. Returns -1 if the
+// payload ends first.
+static inline int lz_read_len(const uint8_t **ip, const uint8_t *ip_end,
+                              size_t *len) {
+  uint8_t b;
+  do {
+    if (*ip >= ip_end)
+      return -1;
+    b = *(*ip)++;
+    *len += b;
+  } while (b == 255);
+  return 0;
+}
+
+static inline void lz_wild_copy(uint8_t *op, const uint8_t *ip, size_t n) {
+  size_t k = 0;
+  do {
+    memcpy(op + k, ip + k, LZ_WILD);
+    k += LZ_WILD;
+  } while (k < n);
+}
+
+// Match at op from offset bytes back; op + len + LZ_WILD stays in the block
+static inline void lz_copy_match(uint8_t *op, size_t offset, size_t len) {
+  const uint8_t *m = op - offset;
+  if (offset >= LZ_WILD) {
+    lz_wild_copy(op, m, len);
+  } else if (offset == 1) {
+    memset(op, m[0], len);
+  } else if (offset >= 8) {
+    for (size_t k = 0; k < len; k += 8)
+      memcpy(op + k, m + k, 8);
+  } else {
+    for (size_t k = 0; k < len; k++)
+      op[k] = m[k];
+  }
+}
+
+// Bytes before op are final, so sum hashes up to it as it goes
+static size_t decode_lz(const uint8_t *in, size_t in_size, uint8_t *dst,
+                        size_t orig_size, zyphrax_hash_run_t *sum) {
+  const uint8_t *ip = in;
+  const uint8_t *const ip_end = in + in_size;
+  uint8_t *op = dst;
+  uint8_t *const op_end = dst + orig_size;
+
+  while (op < op_end) {
+    zyphrax_hash_run_to(sum, (size_t)(op - dst));
+    if (ip >= ip_end)
+      return 0;
+    unsigned token = *ip++;
+
+    // Literals. Short runs far from both ends take one fixed-size copy.
+    size_t ll = token >> 4;
+    if (ll != 15 && (size_t)(op_end - op) >= LZ_WILD &&
+        (size_t)(ip_end - ip) >= LZ_WILD) {
+      memcpy(op, ip, LZ_WILD);
+    } else {
+      if (ll == 15 && lz_read_len(&ip, ip_end, &ll) != 0)
+        return 0;
+      if (ll > (size_t)(op_end - op) || ll > (size_t)(ip_end - ip))
+        return 0;
+      if ((size_t)(op_end - op) >= ll + LZ_WILD &&
+          (size_t)(ip_end - ip) >= ll + LZ_WILD)
+        lz_wild_copy(op, ip, ll);
+      else
+        memcpy(op, ip, ll);
+    }
+    op += ll;
+    ip += ll;
+    if (op == op_end)
+      break; // Block ends on literals: no match follows
+
+    // Match
+    if (ip_end - ip < 2)
+      return 0;
+    size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    size_t ml = (token & 0xF) + MIN_MATCH;
+    if (offset == 0 || offset > (size_t)(op - dst))
+      return 0;
+    if (ml < 15 + MIN_MATCH && offset >= LZ_WILD &&
+        (size_t)(op_end - op) >= 2 * LZ_WILD) {
+      // Up to 18 bytes, two fixed-size copies
+      memcpy(op, op - offset, LZ_WILD);
+      memcpy(op + LZ_WILD, op - offset + LZ_WILD, 2);
+      op += ml;
+      continue;
+    }
+    if (ml == 15 + MIN_MATCH && lz_read_len(&ip, ip_end, &ml) != 0)
+      return 0;
+    if (ml > (size_t)(op_end - op))
+      return 0;
+    if ((size_t)(op_end - op) >= ml + LZ_WILD) {
+      lz_copy_match(op, offset, ml);
+    } else {
+      const uint8_t *m = op - offset;
+      for (size_t k = 0; k < ml; k++)
+        op[k] = m[k];
+    }
+    op += ml;
+  }
+  return orig_size;
+}
+
+// Raw payload moved to dst a chunk at a time, each hashed by sum as it
+// lands. memmove: in-place decompression slides raw payloads toward the
+// front, which a forward pass over chunks also gets right.
+static void decode_raw(const uint8_t *in, uint8_t *dst, size_t size,
+                       zyphrax_hash_run_t *sum) {
+  if (!sum || dst > in) {
+    memmove(dst, in, size);
+    return;
+  }
+  for (size_t off = 0; off < size; off += ZYPHRAX_HASH_CHUNK) {
+    size_t n = size - off < ZYPHRAX_HASH_CHUNK ? size - off
+                                                : ZYPHRAX_HASH_CHUNK;
+    memmove(dst + off, in + off, n);
+    zyphrax_hash_run_to(sum, off + n);
+  }
+}
+
+static size_t decode_sequences(const zyphrax_dec_ws_t *ws, const uint8_t *src,
+                               size_t src_size, uint8_t *dst, size_t size,
+                               zyphrax_hash_run_t *sum);
+
+// Builds the decoders from the code lengths at in (384 bytes); *tables_ns
+// receives the time it took (statistics)
+static void decode_tables(zyphrax_dec_ws_t *ws, const uint8_t *in,
+                          const zyphrax_block_info_t *info,
+                          uint64_t *tables_ns) {
+  uint64_t t = ws->stats ? zyphrax_stats_now() : 0;
+  uint8_t token_lens[256];
+  uint8_t lit_lens[256];
+  uint8_t off_lens[256];
+  read_code_lens(in, token_lens);
+  read_code_lens(in + 128, lit_lens);
+  read_code_lens(in + 256, off_lens);
+
+  // Build Decoders
+  zyphrax_build_dec_table(&ws->token, token_lens);
+  zyphrax_build_dec_table(&ws->lit, lit_lens);
+  zyphrax_build_dec_table(&ws->off, off_lens);
+  ZYPHRAX_PROBE2(block_dec_tables, info->orig_size, info->comp_size);
+
+  if (ws->stats)
+    *tables_ns = zyphrax_stats_now() - t;
+}
+
+// Decodes the payload at in. *tables_ns receives the time spent building
+// decoder tables (statistics). sum, if set, hashes the output as it is
+// decoded.
+static size_t decode_block(zyphrax_dec_ws_t *ws, const uint8_t *in,
+                           const zyphrax_block_info_t *info, uint8_t *dst,
+                           size_t dst_cap, uint64_t *tables_ns,
+                           zyphrax_hash_run_t *sum) {
+  size_t orig_size = info->orig_size;
+
+  if (orig_size > dst_cap)
+    return 0; // Overflow
+
+  if (info->type == ZYPHRAX_BLOCK_SKIPPABLE)
+    return 0; // Metadata only
+
+  if (info->type == ZYPHRAX_BLOCK_LZ)
+    return decode_lz(in, info->comp_size, dst, orig_size, sum);
+
+  if (info->type != ZYPHRAX_BLOCK_COMPRESSED) {
+    decode_raw(in, dst, orig_size, sum);
+    return orig_size;
+  }
+
+  // Tables: [Token:128][Lit:128][Off:128] = 384 bytes
+  if (info->comp_size < 384)
+    return 0;
+
+  decode_tables(ws, in, info, tables_ns);
+  return decode_sequences(ws, in + 384, info->comp_size - 384, dst, orig_size,
+                          sum);
+}
+
+size_t zyphrax_decode_sequences(const zyphrax_dec_ws_t *ws, const uint8_t *src,
+                                size_t src_size, uint8_t *dst, size_t size) {
+  return decode_sequences(ws, src, src_size, dst, size, NULL);
+}
+
+static size_t decode_sequences(const zyphrax_dec_ws_t *ws, const uint8_t *src,
+                               size_t src_size, uint8_t *dst, size_t size,
+                               zyphrax_hash_run_t *sum) {
+  const zyphrax_huff_decoder *token_dec = &ws->token;
+  const zyphrax_huff_decoder *lit_dec = &ws->lit;
+  const zyphrax_huff_decoder *off_dec = &ws->off;
+
+  // Init Reader, bounded to this block's payload
+  z_bit_reader br = {.ptr = src,
+                     .end = src + src_size,
+                     .bit_buf = 0,
+                     .bit_count = 0};
+
+  uint8_t *out = dst;
+  uint8_t *out_end = dst + size;
+
+  // Decode Loop - use size for termination
+  while (out < out_end) {
+    zyphrax_hash_run_to(sum, (size_t)(out - dst));
+    // Decode Token
+    int token = decode_sym(&br, token_dec);
+    if (token < 0)
+      return 0;
+    size_t t_ll = token >> 4;
+    size_t t_ml = token & 0xF;
+
+    // Lit Len
+    size_t ll = t_ll;
+    if (ll == 15)
+      ll += read_start_extra(&br);
+
+    // Copy Literals
+    if (ll > (size_t)(out_end - out))
+      return 0;
+    for (size_t i = 0; i < ll; i++) {
+      int lit = decode_sym(&br, lit_dec);
+      if (lit < 0)
+        return 0;
+      *out++ = (uint8_t)lit;
+    }
+
+    if (out >= out_end)
+      break;
+
+    // Match - ml = t_ml + 3, plus extra if t_ml==15
+    // Order: Offset FIRST, then Extra Match Len
+    if (t_ml > 0) {
+      // Offset first
+      int off_hi = decode_sym(&br, off_dec);
+      refill_bits(&br);
+      if (off_hi < 0 || br.bit_count < 8)
+        return 0;
+      uint8_t off_lo = (uint8_t)read_bits(&br, 8);
+      size_t offset = ((size_t)off_hi << 8) | off_lo;
+
+      // Match length
+      size_t ml = t_ml + 3;
+      if (t_ml == 15)
+        ml += read_start_extra(&br);
+
+      // Execute Match
+      if (offset == 0 || offset > (size_t)(out - dst))
+        return 0; // Underflow
+      if (ml > (size_t)(out_end - out))
+        return 0;
+      const uint8_t *match_src = out - offset;
+      for (size_t k = 0; k < ml; k++) {
+        out[k] = match_src[k];
+      }
+      out += ml;
+    }
+  }
+
+  return size;
+}
+
+// -------------------------------------------------------------------------
+// Scattered Blocks (zyphrax_decompressv)
+// -------------------------------------------------------------------------
+// The same decoders over windows (zyphrax_segs.h): the payload is read a
+// segment at a time and the output goes straight into the caller's
+// segments, matches reaching back across them. Blocks that lie in one
+// segment on both sides take the pointer decoders above.
+
+// The bit reader on the current run of a window, moved on to the next run
+// when it runs dry
+typedef struct {
+  z_bit_reader br;
+  const zyphrax_segs_t *w;
+  size_t next; // Window position after the current run
+} z_bit_reader_segs;
+
+static inline void refill_bits_segs(z_bit_reader_segs *r) {
+  refill_bits(&r->br);
+  while (r->br.bit_count <= 56 && r->next < r->w->size) {
+    size_t run;
+    r->br.ptr = zyphrax_segs_at(r->w, r->next, &run);
+    r->br.end = r->br.ptr + run;
+    r->next += run;
+    refill_bits(&r->br);
+  }
+}
+
+static inline int decode_sym_segs(z_bit_reader_segs *r,
+                                  const zyphrax_huff_decoder *dec) {
+  refill_bits_segs(r);
+  return decode_sym(&r->br, dec);
+}
+
+static size_t read_start_extra_segs(z_bit_reader_segs *r) {
+  size_t val = 0;
+  for (;;) {
+    refill_bits_segs(r);
+    if (r->br.bit_count < 8)
+      break; // No more data
+    uint8_t b = read_bits(&r->br, 8);
+    val += b;
+    if (b < 255)
+      break;
+  }
+  return val;
+}
+
+static size_t decode_sequences_segs(const zyphrax_dec_ws_t *ws,
+                                    const zyphrax_segs_t *src,
+                                    const zyphrax_segs_t *dst, size_t size,
+                                    zyphrax_hash_run_t *sum) {
+  z_bit_reader_segs r = {{NULL, NULL, 0, 0}, src, 0};
+  size_t out = 0;
+
+  while (out < size) {
+    zyphrax_hash_run_to(sum, out);
+    int token = decode_sym_segs(&r, &ws->token);
+    if (token < 0)
+      return 0;
+    size_t t_ml = token & 0xF;
+
+    size_t ll = token >> 4;
+    if (ll == 15)
+      ll += read_start_extra_segs(&r);
+    if (ll > size - out)
+      return 0;
+    // Literals, a run of dst at a time
+    for (size_t i = 0, run; i < ll; i += run) {
+      uint8_t *op = zyphrax_segs_at(dst, out + i, &run);
+      if (run > ll - i)
+        run = ll - i;
+      for (size_t k = 0; k < run; k++) {
+        int lit = decode_sym_segs(&r, &ws->lit);
+        if (lit < 0)
+          return 0;
+        op[k] = (uint8_t)lit;
+      }
+    }
+    out += ll;
+
+    if (out >= size)
+      break;
+
+    if (t_ml > 0) {
+      int off_hi = decode_sym_segs(&r, &ws->off);
+      refill_bits_segs(&r);
+      if (off_hi < 0 || r.br.bit_count < 8)
+        return 0;
+      uint8_t off_lo = (uint8_t)read_bits(&r.br, 8);
+      size_t offset = ((size_t)off_hi << 8) | off_lo;
+
+      size_t ml = t_ml + 3;
+      if (t_ml == 15)
+        ml += read_start_extra_segs(&r);
+
+      if (offset == 0 || offset > out)
+        return 0; // Underflow
+      if (ml > size - out)
+        return 0;
+      zyphrax_segs_repeat(dst, out, offset, ml);
+      out += ml;
+    }
+  }
+
+  return size;
+}
+
+static inline int lz_read_len_segs(const zyphrax_segs_t *w,
+                                   zyphrax_segs_run_t *c, size_t *ip,
+                                   size_t *len) {
+  uint8_t b;
+  do {
+    if (*ip >= w->size)
+      return -1;
+    b = *zyphrax_segs_get(w, c, (*ip)++, 1);
+    *len += b;
+  } while (b == 255);
+  return 0;
+}
+
+static size_t decode_lz_segs(const zyphrax_segs_t *src,
+                             const zyphrax_segs_t *dst, size_t orig_size,
+                             zyphrax_hash_run_t *sum) {
+  zyphrax_segs_run_t c = {NULL, 0, 0};
+  size_t in_size = src->size;
+  size_t ip = 0, op = 0;
+
+  while (op < orig_size) {
+    zyphrax_hash_run_to(sum, op);
+    if (ip >= in_size)
+      return 0;
+    unsigned token = *zyphrax_segs_get(src, &c, ip++, 1);
+
+    size_t ll = token >> 4;
+    if (ll == 15 && lz_read_len_segs(src, &c, &ip, &ll) != 0)
+      return 0;
+    if (ll > orig_size - op || ll > in_size - ip)
+      return 0;
+    zyphrax_segs_copy(dst, op, src, ip, ll);
+    op += ll;
+    ip += ll;
+    if (op == orig_size)
+      break; // Block ends on literals: no match follows
+
+    if (in_size - ip < 2)
+      return 0;
+    uint8_t off[2];
+    zyphrax_segs_read(src, ip, off, 2);
+    ip += 2;
+    size_t offset = (size_t)off[0] | ((size_t)off[1] << 8);
+    size_t ml = (token & 0xF) + MIN_MATCH;
+    if (offset == 0 || offset > op)
+      return 0;
+    if (ml == 15 + MIN_MATCH && lz_read_len_segs(src, &c, &ip, &ml) != 0)
+      return 0;
+    if (ml > orig_size - op)
+      return 0;
+    zyphrax_segs_repeat(dst, op, offset, ml);
+    op += ml;
+  }
+  return orig_size;
+}
+
+// decode_block over windows
+static size_t decode_block_segs(zyphrax_dec_ws_t *ws,
+                                const zyphrax_segs_t *src,
+                                const zyphrax_block_info_t *info,
+                                const zyphrax_segs_t *dst,
+                                uint64_t *tables_ns,
+                                zyphrax_hash_run_t *sum) {
+  size_t orig_size = info->orig_size;
+  if (orig_size > dst->size)
+    return 0; // Overflow
+  if (info->type == ZYPHRAX_BLOCK_SKIPPABLE)
+    return 0; // Metadata only
+  if (info->type == ZYPHRAX_BLOCK_LZ)
+    return decode_lz_segs(src, dst, orig_size, sum);
+
+  if (info->type != ZYPHRAX_BLOCK_COMPRESSED) {
+    for (size_t off = 0; off < orig_size; off += ZYPHRAX_HASH_CHUNK) {
+      size_t n = orig_size - off < ZYPHRAX_HASH_CHUNK ? orig_size - off
+                                                      : ZYPHRAX_HASH_CHUNK;
+      zyphrax_segs_copy(dst, off, src, off, n);
+      zyphrax_hash_run_to(sum, off + n);
+    }
+    return orig_size;
+  }
+
+  if (info->comp_size < 384)
+    return 0;
+  uint8_t lens[384]; // May span segments
+  zyphrax_segs_read(src, 0, lens, sizeof(lens));
+  decode_tables(ws, lens, info, tables_ns);
+  zyphrax_segs_t seqs = zyphrax_segs_sub(src, 384, info->comp_size - 384);
+  return decode_sequences_segs(ws, &seqs, dst, orig_size, sum);
+}
+
+// Counts the block decoded from src (statistics): t0 is when decoding
+// started and t1 when it was done and checked; tables of that went to the
+// decoder tables and sum to its checksum
+static void block_stats(zyphrax_stats_t *st, const zyphrax_block_info_t *info,
+                        uint64_t t0, uint64_t t1, uint64_t tables,
+                        uint64_t sum) {
+  st->tables_ns += tables;
+  st->coding_ns += t1 - t0 - tables - sum;
+  st->checksum_ns += sum;
+  st->blocks++;
+  st->src_bytes += info->orig_size;
+  st->dst_bytes += info->hdr_size + info->comp_size;
+  if (info->type == ZYPHRAX_BLOCK_RAW ||
+      info->type == ZYPHRAX_BLOCK_RAW_IMPLICIT)
+    st->raw_blocks++;
+  else if (info->type == ZYPHRAX_BLOCK_COMPRESSED)
+    st->table_bytes += 384;
+}
+
+size_t zyphrax_decompress_block_segs(zyphrax_dec_ws_t *ws,
+                                     const zyphrax_segs_t *src,
+                                     const zyphrax_block_info_t *info,
+                                     const zyphrax_segs_t *dst) {
+  ZYPHRAX_PROBE2(block_decompress_start, info->type, info->comp_size);
+  uint64_t t0 = ws->stats ? zyphrax_stats_now() : 0;
+  uint64_t tables = 0;
+  zyphrax_hash_run_t run, *sum = NULL;
+  if (info->sum_kind != ZYPHRAX_CHECKSUM_NONE) {
+    zyphrax_hash_run_init_segs(&run, info->sum_kind, dst, ws->stats != NULL);
+    sum = &run;
+  }
+  const uint8_t *in = zyphrax_segs_flat(src);
+  uint8_t *out = zyphrax_segs_flat(dst);
+  size_t n = in && out
+                 ? decode_block(ws, in, info, out, dst->size, &tables, sum)
+                 : decode_block_segs(ws, src, info, dst, &tables, sum);
+  if (n && sum && zyphrax_hash_run_end(sum, n) != info->checksum)
+    n = 0;
+  uint64_t t1 = ws->stats ? zyphrax_stats_now() : 0;
+  if (n && ws->stats)
+    block_stats(ws->stats, info, t0, t1, tables, sum ? sum->ns : 0);
+  ZYPHRAX_PROBE2(block_decompress_end, info->orig_size, n);
+  return n;
+}
+
+size_t zyphrax_decompress_block_ws(zyphrax_dec_ws_t *ws, const uint8_t *src,
+                                   const zyphrax_block_info_t *info,
+                                   uint8_t *dst, size_t dst_cap) {
+  zyphrax_seg_t in_seg, out_seg;
+  zyphrax_segs_t in, out;
+  zyphrax_segs_plain(&in, &in_seg, src + info->hdr_size, info->comp_size);
+  zyphrax_segs_plain(&out, &out_seg, dst, dst_cap);
+  return zyphrax_decompress_block_segs(ws, &in, info, &out);
+}
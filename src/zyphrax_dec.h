@@ -1,4 +1,7 @@
 #pragma once
+#include "zyphrax_block.h"
+#include "zyphrax_pool.h"
+#include "zyphrax_stats.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -41,6 +44,9 @@ typedef struct {
 #define FAST_TABLE_SIZE (1 << FAST_TABLE_BITS)
 
 typedef struct {
+  // Only the first 1 << bits entries are filled, bits being the longest code:
+  // small blocks with short codes skip most of the table setup.
+  int bits;
   uint16_t table[FAST_TABLE_SIZE];
   // Entry format: [bits: 4][symbol: 12] (since bits <= 15)
   // Or [symbol:8][bits:8].
@@ -48,3 +54,98 @@ typedef struct {
 
 void zyphrax_build_dec_table(zyphrax_huff_decoder *dec,
                              const uint8_t *code_lens);
+
+// Parsed block header
+typedef struct {
+  uint8_t type;      // ZYPHRAX_BLOCK_*
+  size_t hdr_size;   // Bytes before the payload
+  size_t comp_size;  // Payload bytes
+  size_t orig_size;  // Decoded bytes
+  int sum_kind;      // ZYPHRAX_CHECKSUM_* of the block
+  uint32_t checksum; // Of the decoded bytes, when sum_kind is set
+} zyphrax_block_info_t;
+
+// Parses the block header at src. block_size is the frame block size, needed
+// only for legacy implicit-length raw blocks.
+// Returns 0 on success, -1 if the header or payload is truncated.
+int zyphrax_read_block_info(const uint8_t *src, size_t src_size,
+                            size_t block_size, zyphrax_block_info_t *info);
+
+// Decoding tables for one compressed block (~200 KB)
+// When stats is set, every block decoded adds its counters to it.
+typedef struct {
+  zyphrax_huff_decoder token;
+  zyphrax_huff_decoder lit;
+  zyphrax_huff_decoder off;
+  zyphrax_stats_t *stats; // NULL unless collecting
+} zyphrax_dec_ws_t;
+
+// Decodes one block (src points at its header) into dst.
+// Blocks are independent: matches never reach before dst.
+// A checksummed block is checked against its checksum once decoded.
+// Returns decoded size (== info->orig_size), or 0 on error.
+size_t zyphrax_decompress_block(const uint8_t *src,
+                                const zyphrax_block_info_t *info, uint8_t *dst,
+                                size_t dst_cap);
+
+// Same, building the tables in ws instead of on the stack
+size_t zyphrax_decompress_block_ws(zyphrax_dec_ws_t *ws, const uint8_t *src,
+                                   const zyphrax_block_info_t *info,
+                                   uint8_t *dst, size_t dst_cap);
+
+// Same, from and to windows over scattered buffers (zyphrax_decompressv):
+// src holds the block's info->comp_size payload bytes (its header already
+// parsed into info), and the decoded bytes go across dst's segments.
+size_t zyphrax_decompress_block_segs(zyphrax_dec_ws_t *ws,
+                                     const zyphrax_segs_t *src,
+                                     const zyphrax_block_info_t *info,
+                                     const zyphrax_segs_t *dst);
+
+// Decode loop of a compressed block, with its tables already built in ws:
+// src is the bitstream after the code length tables. Decodes exactly size
+// bytes. Returns size, or 0 on error
+size_t zyphrax_decode_sequences(const zyphrax_dec_ws_t *ws, const uint8_t *src,
+                                size_t src_size, uint8_t *dst, size_t size);
+
+// Location of one block within a frame and within the decoded output
+typedef struct {
+  size_t src_off; // Offset of the block header from the frame body start
+  size_t dst_off; // Offset of the decoded bytes in the output
+  zyphrax_block_info_t info;
+} zyphrax_block_ref_t;
+
+// Walks the block headers of a frame body (src points just past the frame
+// header, which ends with src_size or at the next frame) without decoding any
+// payload. On success *refs is an array of *count entries from alloc (caller
+// frees) and *total is the decoded size.
+// Returns 0 on success, -1 on a malformed frame or allocation failure.
+int zyphrax_index_blocks(const uint8_t *src, size_t src_size,
+                         size_t block_size, zyphrax_block_ref_t **refs,
+                         size_t *count, size_t *total,
+                         const zyphrax_allocator_t *alloc);
+
+// Multithreaded decompression workers (zyphrax_mt.c): a pool and one decoder
+// workspace per worker, which is too big for a worker's stack. Kept together
+// so a context can reuse both. pool is NULL until started.
+typedef struct {
+  zyphrax_pool_t *pool;
+  zyphrax_dec_ws_t *ws; // Indexed by the pool's worker number
+} zyphrax_dec_workers_t;
+
+// Starts nb_threads workers through alloc (NULL = malloc). Returns 0 or -1.
+int zyphrax_dec_workers_init(zyphrax_dec_workers_t *w, unsigned nb_threads,
+                             const zyphrax_allocator_t *alloc);
+void zyphrax_dec_workers_free(zyphrax_dec_workers_t *w,
+                              const zyphrax_allocator_t *alloc);
+
+// Frames and skippable frames at src decoded on w. Workers not yet started
+// are started on first use through alloc, capped at the block count of a
+// lone frame unless keep says they will serve later calls too. With a sink,
+// every block decoded is passed on to it, in frame order.
+// Returns decompressed size, or 0 on error
+size_t zyphrax_decompress_frames_mt(const uint8_t *src, size_t src_size,
+                                    uint8_t *dst, size_t dst_cap,
+                                    unsigned nb_threads,
+                                    zyphrax_dec_workers_t *w,
+                                    const zyphrax_allocator_t *alloc,
+                                    int keep, zyphrax_stats_sink_t *sink);
@@ -0,0 +1,55 @@
+#pragma once
+#include "zyphrax.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Frame Header: [Magic:4][BlockSize:24|Flags:8][Checksum:4]
+// (Checksum covers the first 8 bytes in checksummed frames, else 0)
+// followed by [ContentSize:8] when ZYPHRAX_FLAG_CONTENT_SIZE is set
+#define ZYPHRAX_HEADER_SIZE 12
+#define ZYPHRAX_CONTENT_SIZE_FIELD 8
+
+// Parsed frame header
+typedef struct {
+  zyphrax_params_t params;
+  size_t header_size;    // Offset of the first block
+  uint64_t content_size; // ZYPHRAX_CONTENT_SIZE_ERROR if not stored
+} zyphrax_frame_t;
+
+// Internal frame header helpers (zyphrax.c)
+void zyphrax_write_header_internal(uint8_t *dst,
+                                   const zyphrax_params_t *params);
+int zyphrax_read_header_internal(const uint8_t *src, zyphrax_params_t *params);
+
+// Header size implied by params->flags
+size_t zyphrax_frame_header_size(const zyphrax_params_t *params);
+
+// Parses the full frame header (including optional fields)
+// Returns 0 on success, -1 on bad magic or truncation
+int zyphrax_read_frame_internal(const uint8_t *src, size_t src_size,
+                                zyphrax_frame_t *frame);
+
+// Frames may be concatenated, with skippable frames around them. Both magics
+// start with a byte whose type bits no block uses, so a block walker that
+// meets one knows the frame has ended.
+static inline uint32_t zyphrax_frame_word(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static inline int zyphrax_is_frame_start(const uint8_t *src, size_t size) {
+  return size >= 4 && (zyphrax_frame_word(src) == ZYPHRAX_MAGIC ||
+                       zyphrax_frame_word(src) == ZYPHRAX_SKIPPABLE_MAGIC);
+}
+
+// Size of the skippable frame at src, 0 if src does not start a whole one
+static inline size_t zyphrax_skippable_frame_size(const uint8_t *src,
+                                                  size_t size) {
+  if (size < ZYPHRAX_SKIPPABLE_HEADER_SIZE ||
+      zyphrax_frame_word(src) != ZYPHRAX_SKIPPABLE_MAGIC)
+    return 0;
+  size_t len = zyphrax_frame_word(src + 4);
+  if (len > size - ZYPHRAX_SKIPPABLE_HEADER_SIZE)
+    return 0;
+  return ZYPHRAX_SKIPPABLE_HEADER_SIZE + len;
+}
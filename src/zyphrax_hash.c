@@ -0,0 +1,366 @@
+#include "zyphrax_hash.h"
+#include "zyphrax.h"
+#include "zyphrax_stats.h"
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#elif defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#define CRC32C_DISPATCH
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+static uint32_t read_u32_le(const uint8_t *p) {
+  return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static void write_u32_le(uint8_t *p, uint32_t x) {
+  p[0] = x & 0xFF;
+  p[1] = (x >> 8) & 0xFF;
+  p[2] = (x >> 16) & 0xFF;
+  p[3] = (x >> 24) & 0xFF;
+}
+
+// -------------------------------------------------------------------------
+// CRC32C (Castagnoli)
+// -------------------------------------------------------------------------
+// crc is the running register (pre-inverted); callers invert at both ends.
+
+#if defined(__SSE4_2__)
+
+static uint32_t crc32c_update(uint32_t crc, const uint8_t *p, size_t n) {
+  uint64_t c = crc;
+  for (; n >= 8; p += 8, n -= 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    c = _mm_crc32_u64(c, v);
+  }
+  crc = (uint32_t)c;
+  while (n--)
+    crc = _mm_crc32_u8(crc, *p++);
+  return crc;
+}
+
+#elif defined(__ARM_FEATURE_CRC32)
+
+static uint32_t crc32c_update(uint32_t crc, const uint8_t *p, size_t n) {
+  for (; n >= 8; p += 8, n -= 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    crc = __crc32cd(crc, v);
+  }
+  while (n--)
+    crc = __crc32cb(crc, *p++);
+  return crc;
+}
+
+#else
+
+// Slicing-by-8: table[k][b] is the CRC of byte b followed by k zero bytes
+static uint32_t crc32c_table[8][256];
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_init_table(void) {
+  for (uint32_t b = 0; b < 256; b++) {
+    uint32_t c = b;
+    for (int i = 0; i < 8; i++)
+      c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1)));
+    crc32c_table[0][b] = c;
+  }
+  for (uint32_t b = 0; b < 256; b++)
+    for (int k = 1; k < 8; k++)
+      crc32c_table[k][b] = (crc32c_table[k - 1][b] >> 8) ^
+                           crc32c_table[0][crc32c_table[k - 1][b] & 0xFF];
+}
+
+static uint32_t crc32c_table_update(uint32_t crc, const uint8_t *p,
+                                    size_t n) {
+  pthread_once(&crc32c_once, crc32c_init_table);
+  for (; n >= 8; p += 8, n -= 8) {
+    uint32_t lo = read_u32_le(p) ^ crc;
+    uint32_t hi = read_u32_le(p + 4);
+    crc = crc32c_table[7][lo & 0xFF] ^ crc32c_table[6][(lo >> 8) & 0xFF] ^
+          crc32c_table[5][(lo >> 16) & 0xFF] ^ crc32c_table[4][lo >> 24] ^
+          crc32c_table[3][hi & 0xFF] ^ crc32c_table[2][(hi >> 8) & 0xFF] ^
+          crc32c_table[1][(hi >> 16) & 0xFF] ^ crc32c_table[0][hi >> 24];
+  }
+  while (n--)
+    crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xFF];
+  return crc;
+}
+
+#if defined(CRC32C_DISPATCH)
+
+// Distribution builds target plain ARMv8-A, whose CRC instructions are
+// optional: this one is built for the extension and only called when the
+// kernel reports it
+#if defined(__clang__)
+__attribute__((target("crc")))
+#else
+__attribute__((target("+crc")))
+#endif
+static uint32_t crc32c_hw_update(uint32_t crc, const uint8_t *p, size_t n) {
+  for (; n >= 8; p += 8, n -= 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    __asm__("crc32cx %w0, %w0, %x1" : "+r"(crc) : "r"(v));
+  }
+  for (; n > 0; p++, n--) {
+    uint32_t b = *p;
+    __asm__("crc32cb %w0, %w0, %w1" : "+r"(crc) : "r"(b));
+  }
+  return crc;
+}
+
+static uint32_t (*crc32c_impl)(uint32_t, const uint8_t *, size_t);
+static pthread_once_t crc32c_pick_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_pick(void) {
+  crc32c_impl = (getauxval(AT_HWCAP) & HWCAP_CRC32) ? crc32c_hw_update
+                                                    : crc32c_table_update;
+}
+
+static uint32_t crc32c_update(uint32_t crc, const uint8_t *p, size_t n) {
+  pthread_once(&crc32c_pick_once, crc32c_pick);
+  return crc32c_impl(crc, p, n);
+}
+
+#else
+
+static uint32_t crc32c_update(uint32_t crc, const uint8_t *p, size_t n) {
+  return crc32c_table_update(crc, p, n);
+}
+
+#endif
+#endif
+
+// -------------------------------------------------------------------------
+// XXH32
+// -------------------------------------------------------------------------
+
+#define XXH_P1 2654435761u
+#define XXH_P2 2246822519u
+#define XXH_P3 3266489917u
+#define XXH_P4 668265263u
+#define XXH_P5 374761393u
+
+static inline uint32_t xxh_rotl(uint32_t x, int r) {
+  return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t xxh_round(uint32_t acc, uint32_t lane) {
+  return xxh_rotl(acc + lane * XXH_P2, 13) * XXH_P1;
+}
+
+// Whole 16-byte stripes of p; returns the bytes consumed. The four lanes fit
+// one 128-bit vector, but each stripe then waits on two vector multiplies
+// in a row: an SSE4.1 version measured no faster than this, so the lanes
+// stay scalar and independent.
+static size_t xxh_stripes(uint32_t *v, const uint8_t *p, size_t n) {
+  uint32_t v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+  size_t done = 0;
+  for (; n - done >= 16; done += 16) {
+    v0 = xxh_round(v0, read_u32_le(p + done));
+    v1 = xxh_round(v1, read_u32_le(p + done + 4));
+    v2 = xxh_round(v2, read_u32_le(p + done + 8));
+    v3 = xxh_round(v3, read_u32_le(p + done + 12));
+  }
+  v[0] = v0;
+  v[1] = v1;
+  v[2] = v2;
+  v[3] = v3;
+  return done;
+}
+
+static uint32_t xxh_final(const zyphrax_hash_t *h) {
+  uint32_t acc;
+  if (h->total >= 16)
+    acc = xxh_rotl(h->v[0], 1) + xxh_rotl(h->v[1], 7) +
+          xxh_rotl(h->v[2], 12) + xxh_rotl(h->v[3], 18);
+  else
+    acc = h->v[2] + XXH_P5; // v[2] still holds the seed
+  acc += (uint32_t)h->total;
+
+  const uint8_t *p = h->buf;
+  size_t n = h->buf_len;
+  for (; n >= 4; p += 4, n -= 4)
+    acc = xxh_rotl(acc + read_u32_le(p) * XXH_P3, 17) * XXH_P4;
+  for (; n > 0; p++, n--)
+    acc = xxh_rotl(acc + *p * XXH_P5, 11) * XXH_P1;
+
+  acc ^= acc >> 15;
+  acc *= XXH_P2;
+  acc ^= acc >> 13;
+  acc *= XXH_P3;
+  acc ^= acc >> 16;
+  return acc;
+}
+
+// -------------------------------------------------------------------------
+// Hash State
+// -------------------------------------------------------------------------
+
+void zyphrax_hash_init(zyphrax_hash_t *h, int kind) {
+  memset(h, 0, sizeof(*h));
+  h->kind = kind;
+  h->crc = 0xFFFFFFFFu;
+  h->v[0] = XXH_P1 + XXH_P2;
+  h->v[1] = XXH_P2;
+  h->v[2] = 0;
+  h->v[3] = 0u - XXH_P1;
+}
+
+void zyphrax_hash_update(zyphrax_hash_t *h, const void *data, size_t size) {
+  const uint8_t *p = (const uint8_t *)data;
+  if (h->kind == ZYPHRAX_CHECKSUM_CRC32C) {
+    h->crc = crc32c_update(h->crc, p, size);
+    return;
+  }
+
+  h->total += size;
+  if (h->buf_len + size < 16) {
+    memcpy(h->buf + h->buf_len, p, size);
+    h->buf_len += size;
+    return;
+  }
+  if (h->buf_len) {
+    size_t fill = 16 - h->buf_len;
+    memcpy(h->buf + h->buf_len, p, fill);
+    xxh_stripes(h->v, h->buf, 16);
+    p += fill;
+    size -= fill;
+  }
+  size_t done = xxh_stripes(h->v, p, size);
+  h->buf_len = size - done;
+  memcpy(h->buf, p + done, h->buf_len);
+}
+
+uint32_t zyphrax_hash_final(const zyphrax_hash_t *h) {
+  if (h->kind == ZYPHRAX_CHECKSUM_CRC32C)
+    return h->crc ^ 0xFFFFFFFFu;
+  return xxh_final(h);
+}
+
+uint32_t zyphrax_hash(int kind, const void *data, size_t size) {
+  if (kind == ZYPHRAX_CHECKSUM_CRC32C)
+    return crc32c_update(0xFFFFFFFFu, (const uint8_t *)data, size) ^
+           0xFFFFFFFFu;
+  zyphrax_hash_t h;
+  zyphrax_hash_init(&h, kind);
+  zyphrax_hash_update(&h, data, size);
+  return zyphrax_hash_final(&h);
+}
+
+// -------------------------------------------------------------------------
+// Running Block Checksum
+// -------------------------------------------------------------------------
+
+void zyphrax_hash_run_init(zyphrax_hash_run_t *r, int kind,
+                           const uint8_t *base, int timed) {
+  zyphrax_hash_init(&r->hash, kind);
+  r->base = base;
+  r->segs = NULL;
+  r->done = 0;
+  r->timed = timed;
+  r->ns = 0;
+}
+
+void zyphrax_hash_run_init_segs(zyphrax_hash_run_t *r, int kind,
+                                const zyphrax_segs_t *w, int timed) {
+  const uint8_t *flat = zyphrax_segs_flat(w);
+  zyphrax_hash_run_init(r, kind, flat, timed);
+  if (!flat)
+    r->segs = w;
+}
+
+// Hashes base[done, end)
+static void hash_run_span(zyphrax_hash_run_t *r, size_t end) {
+  uint64_t t = r->timed ? zyphrax_stats_now() : 0;
+  if (!r->segs) {
+    zyphrax_hash_update(&r->hash, r->base + r->done, end - r->done);
+  } else {
+    for (size_t pos = r->done, run; pos < end; pos += run) {
+      const uint8_t *p = zyphrax_segs_at(r->segs, pos, &run);
+      if (run > end - pos)
+        run = end - pos;
+      zyphrax_hash_update(&r->hash, p, run);
+    }
+  }
+  r->done = end;
+  if (r->timed)
+    r->ns += zyphrax_stats_now() - t;
+}
+
+void zyphrax_hash_run_chunks(zyphrax_hash_run_t *r, size_t pos) {
+  size_t n = (pos - r->done) & ~(size_t)(ZYPHRAX_HASH_CHUNK - 1);
+  hash_run_span(r, r->done + n);
+}
+
+uint32_t zyphrax_hash_run_end(zyphrax_hash_run_t *r, size_t size) {
+  if (size > r->done)
+    hash_run_span(r, size);
+  return zyphrax_hash_final(&r->hash);
+}
+
+// -------------------------------------------------------------------------
+// Frame Checksum
+// -------------------------------------------------------------------------
+
+void zyphrax_frame_sum_init(zyphrax_frame_sum_t *fs, int kind) {
+  fs->kind = kind;
+  fs->sealed = 0;
+  zyphrax_hash_init(&fs->hash, kind);
+}
+
+int zyphrax_is_frame_sum_block(const uint8_t *src,
+                               const zyphrax_block_info_t *info) {
+  return info->type == ZYPHRAX_BLOCK_SKIPPABLE && info->comp_size == 8 &&
+         read_u32_le(src + info->hdr_size) == ZYPHRAX_SUM_MAGIC;
+}
+
+int zyphrax_frame_sum_block(zyphrax_frame_sum_t *fs, const uint8_t *src,
+                            const zyphrax_block_info_t *info) {
+  if (fs->kind == ZYPHRAX_CHECKSUM_NONE)
+    return 0;
+
+  if (info->type == ZYPHRAX_BLOCK_SKIPPABLE) {
+    if (!zyphrax_is_frame_sum_block(src, info))
+      return 0; // Seek table, user metadata
+    if (fs->sealed ||
+        read_u32_le(src + info->hdr_size + 4) !=
+            zyphrax_hash_final(&fs->hash))
+      return -1;
+    fs->sealed = 1;
+    return 0;
+  }
+
+  if (fs->sealed || info->sum_kind != fs->kind)
+    return -1;
+  uint8_t le[4];
+  write_u32_le(le, info->checksum);
+  zyphrax_hash_update(&fs->hash, le, 4);
+  return 0;
+}
+
+int zyphrax_frame_sum_end(const zyphrax_frame_sum_t *fs) {
+  return fs->kind == ZYPHRAX_CHECKSUM_NONE || fs->sealed ? 0 : -1;
+}
+
+size_t zyphrax_write_frame_sum(zyphrax_frame_sum_t *fs, uint8_t *dst,
+                               size_t dst_cap) {
+  if (dst_cap < ZYPHRAX_SUM_BLOCK_SIZE)
+    return 0;
+  dst[0] = ZYPHRAX_BLOCK_SKIPPABLE;
+  write_u32_le(dst + 1, 8);
+  write_u32_le(dst + 5, ZYPHRAX_SUM_MAGIC);
+  write_u32_le(dst + 9, zyphrax_hash_final(&fs->hash));
+  fs->sealed = 1;
+  return ZYPHRAX_SUM_BLOCK_SIZE;
+}
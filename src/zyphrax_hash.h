@@ -0,0 +1,101 @@
+#pragma once
+#include "zyphrax_dec.h"
+#include "zyphrax_segs.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Checksums (zyphrax_params_t.checksum)
+// CRC32C runs on the SSE4.2 / ARMv8 CRC instructions and on a slicing-by-8
+// table otherwise; on AArch64 Linux builds that do not target the CRC
+// extension, the CPU is asked at first use. XXH32 is the standard 32-bit
+// xxHash (seed 0): four independent lanes over 16-byte stripes.
+//
+// Every block of a checksummed frame carries the checksum of its decoded
+// bytes at the end of its header (see zyphrax_block.h). Coders hash a block
+// as they go (zyphrax_hash_run_t), a chunk at a time behind their position
+// in it, rather than in a pass over the block once it is done. The frame
+// checksum runs the same hash over the block checksums in frame order (4 LE
+// bytes each) and ends the frame's data in a skippable block:
+//   [Type=3][Size=8][Magic:4][Checksum:4]
+// which catches blocks that were dropped, repeated or reordered.
+
+#define ZYPHRAX_SUM_MAGIC 0x4D55535Au // "ZSUM" little-endian
+#define ZYPHRAX_SUM_BLOCK_SIZE (ZYPHRAX_BLOCK_HDR_SKIPPABLE + 8)
+
+typedef struct {
+  int kind;
+  uint32_t crc;
+  uint32_t v[4];
+  uint8_t buf[16];
+  size_t buf_len;
+  uint64_t total;
+} zyphrax_hash_t;
+
+void zyphrax_hash_init(zyphrax_hash_t *h, int kind);
+void zyphrax_hash_update(zyphrax_hash_t *h, const void *data, size_t size);
+uint32_t zyphrax_hash_final(const zyphrax_hash_t *h);
+
+// One-shot; kind is a ZYPHRAX_CHECKSUM_* other than NONE
+uint32_t zyphrax_hash(int kind, const void *data, size_t size);
+
+// Block checksum taken while the block is coded. The coder calls
+// zyphrax_hash_run_to with its position in the block (bytes of base that are
+// final) as it advances, and each whole chunk behind it is hashed while still
+// in L1. A NULL run (no checksum) costs one test per call. With timed set, ns
+// adds up the time spent hashing (statistics).
+#define ZYPHRAX_HASH_CHUNK 4096
+
+typedef struct {
+  zyphrax_hash_t hash;
+  const uint8_t *base;
+  const zyphrax_segs_t *segs; // Instead of base, for scattered blocks
+  size_t done;                // Bytes of base hashed
+  int timed;
+  uint64_t ns;
+} zyphrax_hash_run_t;
+
+void zyphrax_hash_run_init(zyphrax_hash_run_t *r, int kind,
+                           const uint8_t *base, int timed);
+
+// Same, over the window w (which must outlive the run)
+void zyphrax_hash_run_init_segs(zyphrax_hash_run_t *r, int kind,
+                                const zyphrax_segs_t *w, int timed);
+
+// Hashes the whole chunks of base up to pos
+void zyphrax_hash_run_chunks(zyphrax_hash_run_t *r, size_t pos);
+
+static inline void zyphrax_hash_run_to(zyphrax_hash_run_t *r, size_t pos) {
+  if (r && pos >= r->done + ZYPHRAX_HASH_CHUNK)
+    zyphrax_hash_run_chunks(r, pos);
+}
+
+// Hashes the rest of the size bytes of base. Returns the checksum
+uint32_t zyphrax_hash_run_end(zyphrax_hash_run_t *r, size_t size);
+
+// Frame checksum, fed block by block on either side
+typedef struct {
+  int kind; // Frame checksum kind, ZYPHRAX_CHECKSUM_NONE if the frame has none
+  zyphrax_hash_t hash;
+  int sealed; // Checksum block seen (decoding) or written (encoding)
+} zyphrax_frame_sum_t;
+
+void zyphrax_frame_sum_init(zyphrax_frame_sum_t *fs, int kind);
+
+// True if the block at src is a frame checksum block
+int zyphrax_is_frame_sum_block(const uint8_t *src,
+                               const zyphrax_block_info_t *info);
+
+// Adds the block at src. Returns 0, or -1 if it breaks the frame's checksum:
+// a data block without the frame's kind of checksum or after the checksum
+// block, or a checksum block that does not match.
+int zyphrax_frame_sum_block(zyphrax_frame_sum_t *fs, const uint8_t *src,
+                            const zyphrax_block_info_t *info);
+
+// 0 once every block is accounted for: the frame has no checksum or its
+// checksum block matched
+int zyphrax_frame_sum_end(const zyphrax_frame_sum_t *fs);
+
+// Writes the checksum block of a checksummed frame.
+// Returns ZYPHRAX_SUM_BLOCK_SIZE, or 0 if dst_cap is too small
+size_t zyphrax_write_frame_sum(zyphrax_frame_sum_t *fs, uint8_t *dst,
+                               size_t dst_cap);
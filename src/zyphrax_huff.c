@@ -13,6 +13,29 @@ void zyphrax_bw_init(zyphrax_bit_writer_t *bw, uint8_t *buf, size_t cap) {
   bw->out = buf;
   bw->start = buf;
   bw->end = buf + cap;
+  bw->overflow = 0;
+  bw->segs = NULL;
+  bw->done = 0;
+}
+
+void zyphrax_bw_init_segs(zyphrax_bit_writer_t *bw, const zyphrax_segs_t *w) {
+  size_t run = 0;
+  uint8_t *p = w->size ? zyphrax_segs_at(w, 0, &run) : NULL;
+  zyphrax_bw_init(bw, p, run);
+  bw->segs = w;
+}
+
+// Buffer full: moves on to the window's next run. Returns 0, or -1 at the
+// end of the output.
+static int bw_next(zyphrax_bit_writer_t *bw) {
+  size_t done = bw->done + (size_t)(bw->out - bw->start);
+  if (!bw->segs || done >= bw->segs->size)
+    return -1;
+  size_t run;
+  bw->out = bw->start = zyphrax_segs_at(bw->segs, done, &run);
+  bw->end = bw->out + run;
+  bw->done = done;
+  return 0;
 }
 
 // Helper: Bit-reverse a code of given length
@@ -34,8 +57,10 @@ void zyphrax_bw_put(zyphrax_bit_writer_t *bw, uint32_t value, int bits) {
   bw->count += bits;
 
   while (bw->count >= 8) {
-    if (bw->out < bw->end) {
+    if (bw->out < bw->end || bw_next(bw) == 0) {
       *bw->out++ = (uint8_t)(bw->bits & 0xFF);
+    } else {
+      bw->overflow = 1;
     }
     bw->bits >>= 8;
     bw->count -= 8;
@@ -50,8 +75,10 @@ void zyphrax_bw_put_huff(zyphrax_bit_writer_t *bw, uint32_t code, int len) {
 
 void zyphrax_bw_flush(zyphrax_bit_writer_t *bw) {
   if (bw->count > 0) {
-    if (bw->out < bw->end) {
+    if (bw->out < bw->end || bw_next(bw) == 0) {
       *bw->out++ = (uint8_t)(bw->bits & 0xFF);
+    } else {
+      bw->overflow = 1;
     }
     bw->bits = 0;
     bw->count = 0;
@@ -59,7 +86,7 @@ void zyphrax_bw_flush(zyphrax_bit_writer_t *bw) {
 }
 
 size_t zyphrax_bw_written(const zyphrax_bit_writer_t *bw) {
-  return bw->out - bw->start;
+  return bw->done + (size_t)(bw->out - bw->start);
 }
 
 // ---------------------------------------------------------------------
@@ -251,53 +278,92 @@ static void write_extra_len(zyphrax_bit_writer_t *bw, size_t val) {
   zyphrax_bw_put(bw, (uint8_t)val, 8);
 }
 
-void zyphrax_analyze_sequences(const zyphrax_sequence_t *seqs, size_t count,
-                               zyphrax_huffman_t *lit_hf,
-                               zyphrax_huffman_t *off_hf,
-                               zyphrax_huffman_t *token_hf) {
-  memset(lit_hf, 0, sizeof(*lit_hf));
-  memset(off_hf, 0, sizeof(*off_hf));
-  memset(token_hf, 0, sizeof(*token_hf));
-
-  for (size_t i = 0; i < count; i++) {
-    const zyphrax_sequence_t *s = &seqs[i];
+// Token and offset symbols of a sequence
+static inline void count_codes(const zyphrax_sequence_t *s, uint32_t *off_freq,
+                               uint32_t *token_freq) {
+  // Token - t_ml=0 means no match, t_ml>=1 means ml = t_ml + 3
+  size_t ll = s->lit_len;
+  size_t ml = s->match.length;
+
+  uint8_t t_ll = (ll >= 15) ? 15 : (uint8_t)ll;
+  uint8_t t_ml = 0;
+  if (ml >= 4) {
+    size_t ml_code = ml - 3; // ml=4 -> t_ml=1, ml=18 -> t_ml=15
+    t_ml = (ml_code >= 15) ? 15 : (uint8_t)ml_code;
+
+    // Offset Freq
+    uint8_t off_hi = (s->match.offset >> 8) & 0xFF;
+    off_freq[off_hi]++;
+  }
 
-    // Literals
-    for (size_t j = 0; j < s->lit_len; j++) {
-      lit_hf->freq[s->literals[j]]++;
-    }
+  uint8_t token = (t_ll << 4) | t_ml;
+  token_freq[token]++;
+}
 
-    // Token - t_ml=0 means no match, t_ml>=1 means ml = t_ml + 3
-    size_t ll = s->lit_len;
-    size_t ml = s->match.length;
+void zyphrax_count_sequence(const zyphrax_sequence_t *s, uint32_t *lit_freq,
+                            uint32_t *off_freq, uint32_t *token_freq) {
+  // Literals
+  for (size_t j = 0; j < s->lit_len; j++) {
+    lit_freq[s->literals[j]]++;
+  }
+  count_codes(s, off_freq, token_freq);
+}
 
-    uint8_t t_ll = (ll >= 15) ? 15 : (uint8_t)ll;
-    uint8_t t_ml = 0;
-    if (ml >= 4) {
-      size_t ml_code = ml - 3; // ml=4 -> t_ml=1, ml=18 -> t_ml=15
-      t_ml = (ml_code >= 15) ? 15 : (uint8_t)ml_code;
+void zyphrax_count_sequence_segs(const zyphrax_sequence_t *s,
+                                 const zyphrax_segs_t *src, size_t pos,
+                                 uint32_t *lit_freq, uint32_t *off_freq,
+                                 uint32_t *token_freq) {
+  // Literals, a segment at a time
+  for (size_t j = 0, run; j < s->lit_len; j += run) {
+    const uint8_t *lit = zyphrax_segs_at(src, pos + j, &run);
+    if (run > s->lit_len - j)
+      run = s->lit_len - j;
+    for (size_t k = 0; k < run; k++)
+      lit_freq[lit[k]]++;
+  }
+  count_codes(s, off_freq, token_freq);
+}
 
-      // Offset Freq
-      uint8_t off_hi = (s->match.offset >> 8) & 0xFF;
-      off_hf->freq[off_hi]++;
-    }
+void zyphrax_analyze_sequences_segs(const zyphrax_sequence_t *seqs,
+                                    size_t count, const zyphrax_segs_t *src,
+                                    zyphrax_huffman_t *lit_hf,
+                                    zyphrax_huffman_t *off_hf,
+                                    zyphrax_huffman_t *token_hf) {
+  memset(lit_hf, 0, sizeof(*lit_hf));
+  memset(off_hf, 0, sizeof(*off_hf));
+  memset(token_hf, 0, sizeof(*token_hf));
 
-    uint8_t token = (t_ll << 4) | t_ml;
-    token_hf->freq[token]++;
+  size_t pos = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (src)
+      zyphrax_count_sequence_segs(&seqs[i], src, pos, lit_hf->freq,
+                                  off_hf->freq, token_hf->freq);
+    else
+      zyphrax_count_sequence(&seqs[i], lit_hf->freq, off_hf->freq,
+                             token_hf->freq);
+    pos += seqs[i].lit_len + seqs[i].match.length;
   }
 }
 
+void zyphrax_analyze_sequences(const zyphrax_sequence_t *seqs, size_t count,
+                               zyphrax_huffman_t *lit_hf,
+                               zyphrax_huffman_t *off_hf,
+                               zyphrax_huffman_t *token_hf) {
+  zyphrax_analyze_sequences_segs(seqs, count, NULL, lit_hf, off_hf, token_hf);
+}
+
 // ---------------------------------------------------------------------
 // Encoder (Interleaved)
 // ---------------------------------------------------------------------
 
-size_t zyphrax_huffman_encode(const zyphrax_sequence_t *seqs, size_t count,
-                              uint8_t *dst, size_t dst_cap,
-                              const zyphrax_huffman_t *lit_hf,
-                              const zyphrax_huffman_t *off_hf,
-                              const zyphrax_huffman_t *token_hf) {
+size_t zyphrax_huffman_encode_segs(const zyphrax_sequence_t *seqs,
+                                   size_t count, const zyphrax_segs_t *src,
+                                   const zyphrax_segs_t *dst,
+                                   const zyphrax_huffman_t *lit_hf,
+                                   const zyphrax_huffman_t *off_hf,
+                                   const zyphrax_huffman_t *token_hf) {
   zyphrax_bit_writer_t bw;
-  zyphrax_bw_init(&bw, dst, dst_cap);
+  zyphrax_bw_init_segs(&bw, dst);
 
   // 1. Write Tables (Fixed 384 bytes order: Token, Lit, Off)
   // Token Table (256 codes)
@@ -320,6 +386,7 @@ size_t zyphrax_huffman_encode(const zyphrax_sequence_t *seqs, size_t count,
   }
 
   // 2. Interleaved Encode
+  size_t pos = 0; // Of the sequence in src
   for (size_t i = 0; i < count; i++) {
     const zyphrax_sequence_t *s = &seqs[i];
     size_t ll = s->lit_len;
@@ -340,11 +407,17 @@ size_t zyphrax_huffman_encode(const zyphrax_sequence_t *seqs, size_t count,
       write_extra_len(&bw, ll - 15);
     }
 
-    // Literals
-    for (size_t k = 0; k < ll; k++) {
-      uint8_t lit = s->literals[k];
-      zyphrax_bw_put_huff(&bw, lit_hf->code[lit], lit_hf->code_len[lit]);
+    // Literals, a segment at a time from src
+    for (size_t k = 0, run = ll; k < ll; k += run) {
+      const uint8_t *lit =
+          src ? zyphrax_segs_at(src, pos + k, &run) : s->literals;
+      if (run > ll - k)
+        run = ll - k;
+      for (size_t j = 0; j < run; j++)
+        zyphrax_bw_put_huff(&bw, lit_hf->code[lit[j]],
+                            lit_hf->code_len[lit[j]]);
     }
+    pos += ll + ml;
 
     // Match
     if (ml >= 4) {
@@ -362,5 +435,19 @@ size_t zyphrax_huffman_encode(const zyphrax_sequence_t *seqs, size_t count,
   }
 
   zyphrax_bw_flush(&bw);
+  if (bw.overflow)
+    return 0; // dst_cap too small: caller falls back to raw
   return zyphrax_bw_written(&bw);
 }
+
+size_t zyphrax_huffman_encode(const zyphrax_sequence_t *seqs, size_t count,
+                              uint8_t *dst, size_t dst_cap,
+                              const zyphrax_huffman_t *lit_hf,
+                              const zyphrax_huffman_t *off_hf,
+                              const zyphrax_huffman_t *token_hf) {
+  zyphrax_seg_t seg;
+  zyphrax_segs_t w;
+  zyphrax_segs_plain(&w, &seg, dst, dst_cap);
+  return zyphrax_huffman_encode_segs(seqs, count, NULL, &w, lit_hf, off_hf,
+                                     token_hf);
+}
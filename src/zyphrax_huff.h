@@ -1,4 +1,5 @@
 #pragma once
+#include "zyphrax_segs.h"
 #include "zyphrax_seq.h" // For sequences analysis
 #include <stddef.h>
 #include <stdint.h>
@@ -23,26 +24,57 @@ typedef struct {
   uint8_t *out;   // Current output pointer
   uint8_t *start; // Start of buffer (for offset calc)
   uint8_t *end;   // End of buffer
+  int overflow;   // Set once a byte did not fit
+  // Output window the buffer is a run of, or NULL
+  const zyphrax_segs_t *segs;
+  size_t done; // Bytes written to the window's earlier runs
 } zyphrax_bit_writer_t;
 
 void zyphrax_bw_init(zyphrax_bit_writer_t *bw, uint8_t *buf, size_t cap);
+// Writes across the window w, a run at a time
+void zyphrax_bw_init_segs(zyphrax_bit_writer_t *bw, const zyphrax_segs_t *w);
 void zyphrax_bw_put(zyphrax_bit_writer_t *bw, uint32_t value, int bits);
 void zyphrax_bw_flush(zyphrax_bit_writer_t *bw);
 size_t zyphrax_bw_written(const zyphrax_bit_writer_t *bw);
 
 // Huffman Analysis & Build
+// Adds one sequence's symbols to the three 256-entry histograms
+void zyphrax_count_sequence(const zyphrax_sequence_t *s, uint32_t *lit_freq,
+                            uint32_t *off_freq, uint32_t *token_freq);
+// Same, with the sequence's literals at pos of src rather than at
+// s->literals
+void zyphrax_count_sequence_segs(const zyphrax_sequence_t *s,
+                                 const zyphrax_segs_t *src, size_t pos,
+                                 uint32_t *lit_freq, uint32_t *off_freq,
+                                 uint32_t *token_freq);
+
 // Analyze sequences to populate frequency counts for the 3 trees
 void zyphrax_analyze_sequences(const zyphrax_sequence_t *seqs, size_t count,
                                zyphrax_huffman_t *lit_hf,
                                zyphrax_huffman_t *off_hf,
                                zyphrax_huffman_t *token_hf);
+// Same, with the literals taken from the block's window src, if set
+void zyphrax_analyze_sequences_segs(const zyphrax_sequence_t *seqs,
+                                    size_t count, const zyphrax_segs_t *src,
+                                    zyphrax_huffman_t *lit_hf,
+                                    zyphrax_huffman_t *off_hf,
+                                    zyphrax_huffman_t *token_hf);
 
 // Build tree from frequencies (generates code_len and code)
 void zyphrax_build_huffman(zyphrax_huffman_t *hf);
 
 // Encode sequences using the built trees
+// Returns bytes written, or 0 if the output does not fit in dst_cap
 size_t zyphrax_huffman_encode(const zyphrax_sequence_t *seqs, size_t count,
                               uint8_t *dst, size_t dst_cap,
                               const zyphrax_huffman_t *lit_hf,
                               const zyphrax_huffman_t *off_hf,
                               const zyphrax_huffman_t *token_hf);
+// Same, into the window dst, with the literals taken from the block's
+// window src, if set
+size_t zyphrax_huffman_encode_segs(const zyphrax_sequence_t *seqs,
+                                   size_t count, const zyphrax_segs_t *src,
+                                   const zyphrax_segs_t *dst,
+                                   const zyphrax_huffman_t *lit_hf,
+                                   const zyphrax_huffman_t *off_hf,
+                                   const zyphrax_huffman_t *token_hf);
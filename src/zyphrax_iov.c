@@ -0,0 +1,359 @@
+#include "zyphrax.h"
+#include "zyphrax_block.h"
+#include "zyphrax_dec.h"
+#include "zyphrax_frame.h"
+#include "zyphrax_hash.h"
+#include "zyphrax_seek.h"
+#include "zyphrax_segs.h"
+#include <stdlib.h>
+
+// -------------------------------------------------------------------------
+// Scatter-Gather
+// -------------------------------------------------------------------------
+// Blocks are coded where they lie. Each one is handed to the block coders as
+// a window over the segments it spans (zyphrax_segs.h), so the match finder
+// reaches back across segment boundaries, encoded blocks are written across
+// the output segments and decoded bytes land straight in the caller's
+// buffers, whatever the segment sizes. Only headers and the trailer go
+// through small local buffers, which a frame needs anyway: the block
+// headers are read back for the frame checksum and seek table, as
+// zyphrax_compress does.
+
+// Room past its input a block's output window gets: enough for every
+// header the coders may add (as CSTREAM_OUT_SLACK), so a block fits if and
+// only if it would in zyphrax_compress
+#define IOV_OUT_SLACK 64
+
+// Largest granule of a window table (log2): 64 KB, so tables stay small for
+// large segments
+#define IOV_SHIFT_MAX 16
+
+// A caller's segment list, empty segments dropped, and the granule table of
+// the window last opened on it
+typedef struct {
+  zyphrax_seg_t *seg;
+  size_t count;
+  uint64_t size;  // Bytes in all segments
+  unsigned shift; // Granule: no larger than any segment
+  uint32_t *table;
+  size_t table_cap;
+} iov_buf_t;
+
+static int iov_buf_init(iov_buf_t *b, const zyphrax_iovec_t *iov,
+                        size_t cnt) {
+  b->seg = malloc((cnt ? cnt : 1) * sizeof(*b->seg));
+  b->count = 0;
+  b->size = 0;
+  b->shift = IOV_SHIFT_MAX;
+  b->table = NULL;
+  b->table_cap = 0;
+  if (!b->seg)
+    return -1;
+  for (size_t i = 0; i < cnt; i++) {
+    if (iov[i].iov_len == 0)
+      continue;
+    zyphrax_seg_t *s = &b->seg[b->count++];
+    s->ptr = (uint8_t *)iov[i].iov_base;
+    s->len = iov[i].iov_len;
+    s->off = b->size;
+    b->size += s->len;
+    while (((size_t)1 << b->shift) > s->len)
+      b->shift--;
+  }
+  return 0;
+}
+
+static void iov_buf_free(iov_buf_t *b) {
+  free(b->seg);
+  free(b->table);
+}
+
+// Opens [pos, pos + size) of b as w, replacing the window opened before.
+// The range must lie within b. Returns 0, or -1 (out of memory).
+static int iov_window(iov_buf_t *b, uint64_t pos, size_t size,
+                      zyphrax_segs_t *w) {
+  static const zyphrax_seg_t empty = {NULL, 0, 0};
+  w->seg = &empty;
+  w->table = NULL;
+  w->origin = 0;
+  w->base = 0;
+  w->size = size;
+  w->shift = b->shift;
+  if (size == 0)
+    return 0;
+
+  // Last segment starting at or before pos
+  size_t lo = 0, hi = b->count - 1;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo + 1) / 2;
+    if (b->seg[mid].off <= pos)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  w->seg = &b->seg[lo];
+  w->origin = pos;
+  w->base = pos;
+  if (pos - b->seg[lo].off + size <= b->seg[lo].len)
+    return 0; // Inside one segment
+
+  size_t n = ((size - 1) >> b->shift) + 1;
+  if (n > b->table_cap) {
+    uint32_t *t = realloc(b->table, n * sizeof(*t));
+    if (!t)
+      return -1;
+    b->table = t;
+    b->table_cap = n;
+  }
+  for (size_t g = 0, k = lo; g < n; g++) {
+    uint64_t at = pos + ((uint64_t)g << b->shift);
+    while (at - b->seg[k].off >= b->seg[k].len)
+      k++;
+    b->table[g] = (uint32_t)(k - lo);
+  }
+  w->table = b->table;
+  return 0;
+}
+
+// Copies n bytes between a local buffer and pos of b (which holds them)
+static int iov_read(iov_buf_t *b, uint64_t pos, void *dst, size_t n) {
+  zyphrax_segs_t w;
+  if (iov_window(b, pos, n, &w) != 0)
+    return -1;
+  zyphrax_segs_read(&w, 0, dst, n);
+  return 0;
+}
+
+static int iov_write(iov_buf_t *b, uint64_t pos, const void *src, size_t n) {
+  zyphrax_segs_t w;
+  if (iov_window(b, pos, n, &w) != 0)
+    return -1;
+  zyphrax_segs_write(&w, 0, src, n);
+  return 0;
+}
+
+// Frame being written: block records for the trailer
+typedef struct {
+  zyphrax_frame_sum_t sum;
+  zyphrax_seek_entry_t *seek; // With ZYPHRAX_FLAG_SEEK_TABLE
+  size_t seek_count;
+  size_t seek_cap;
+} iov_frame_t;
+
+// Adds the blocks just written at frame offset pos of out (n bytes) to f.
+// Returns 0, or -1.
+static int iov_record(iov_frame_t *f, iov_buf_t *out, uint64_t pos, size_t n,
+                      const zyphrax_params_t *p) {
+  zyphrax_block_info_t info;
+  for (size_t at = 0; at < n; at += info.hdr_size + info.comp_size) {
+    // Header only: the payload is never read through it
+    uint8_t hdr[ZYPHRAX_SUM_BLOCK_SIZE];
+    size_t len = n - at < sizeof(hdr) ? n - at : sizeof(hdr);
+    if (iov_read(out, pos + at, hdr, len) != 0 ||
+        zyphrax_read_block_info(hdr, n - at, p->block_size, &info) != 0 ||
+        zyphrax_frame_sum_block(&f->sum, hdr, &info) != 0)
+      return -1;
+    if (!(p->flags & ZYPHRAX_FLAG_SEEK_TABLE))
+      continue;
+    if (f->seek_count == f->seek_cap) {
+      size_t cap = f->seek_cap ? 2 * f->seek_cap : 64;
+      zyphrax_seek_entry_t *e = realloc(f->seek, cap * sizeof(*e));
+      if (!e)
+        return -1;
+      f->seek = e;
+      f->seek_cap = cap;
+    }
+    zyphrax_seek_entry_t *e = &f->seek[f->seek_count++];
+    e->comp_off = pos + at;
+    e->comp_size = (uint32_t)(info.hdr_size + info.comp_size);
+    e->orig_size = (uint32_t)info.orig_size;
+  }
+  return 0;
+}
+
+// Checksum block and seek table (as requested) at frame offset pos of out.
+// Returns the new frame size, or 0.
+static uint64_t iov_trailer(iov_frame_t *f, iov_buf_t *out, uint64_t pos,
+                            const zyphrax_params_t *p) {
+  int sum = p->checksum != ZYPHRAX_CHECKSUM_NONE;
+  int table = (p->flags & ZYPHRAX_FLAG_SEEK_TABLE) != 0;
+  size_t size = (sum ? ZYPHRAX_SUM_BLOCK_SIZE : 0) +
+                (table ? zyphrax_seek_table_size(f->seek_count) : 0);
+  if (size == 0)
+    return pos;
+  if (size > out->size - pos)
+    return 0;
+  uint8_t *t = malloc(size);
+  if (!t)
+    return 0;
+  size_t n = sum ? zyphrax_write_frame_sum(&f->sum, t, size) : 0;
+  int err = (sum && n == 0) ||
+            (table && zyphrax_write_seek_table(f->seek, f->seek_count, t + n,
+                                               size - n) == 0) ||
+            iov_write(out, pos, t, size) != 0;
+  free(t);
+  return err ? 0 : pos + size;
+}
+
+size_t zyphrax_compressv(const zyphrax_iovec_t *src, size_t src_cnt,
+                         const zyphrax_iovec_t *dst, size_t dst_cnt,
+                         const zyphrax_params_t *params) {
+  if (params->checksum > ZYPHRAX_CHECKSUM_XXH32)
+    return 0;
+  zyphrax_params_t p = *params;
+  if (p.block_size == 0)
+    p.block_size = ZYPHRAX_BLOCK_SIZE;
+
+  iov_buf_t in, out;
+  int in_ok = iov_buf_init(&in, src, src_cnt) == 0;
+  int out_ok = iov_buf_init(&out, dst, dst_cnt) == 0;
+  iov_frame_t f = {{0}, NULL, 0, 0};
+  zyphrax_frame_sum_init(&f.sum, (int)p.checksum);
+  zyphrax_block_ws_t ws = {NULL, NULL, 0, NULL};
+  uint64_t frame = 0; // Bytes written
+  if (!in_ok || !out_ok ||
+      zyphrax_block_ws_init(&ws, in.size < p.block_size ? (size_t)in.size
+                                                         : p.block_size,
+                            NULL) != 0)
+    goto done;
+
+  // Header (+ content size)
+  uint8_t hdr[ZYPHRAX_HEADER_SIZE + ZYPHRAX_CONTENT_SIZE_FIELD];
+  size_t hdr_size = zyphrax_frame_header_size(&p);
+  zyphrax_write_header_internal(hdr, &p);
+  if (p.flags & ZYPHRAX_FLAG_CONTENT_SIZE) {
+    for (int i = 0; i < 8; i++)
+      hdr[ZYPHRAX_HEADER_SIZE + i] = (uint8_t)(in.size >> (8 * i));
+  }
+  if (out.size < hdr_size || iov_write(&out, 0, hdr, hdr_size) != 0)
+    goto done;
+  frame = hdr_size;
+
+  for (uint64_t pos = 0; pos < in.size;) {
+    size_t len = in.size - pos < p.block_size ? (size_t)(in.size - pos)
+                                              : p.block_size;
+    size_t cap = len + IOV_OUT_SLACK;
+    if (cap > out.size - frame)
+      cap = (size_t)(out.size - frame);
+    zyphrax_segs_t iw, ow;
+    if (iov_window(&in, pos, len, &iw) != 0 ||
+        iov_window(&out, frame, cap, &ow) != 0)
+      goto fail;
+    size_t n = zyphrax_compress_block_segs(&ws, &iw, &ow, &p);
+    if (n == 0 || iov_record(&f, &out, frame, n, &p) != 0)
+      goto fail;
+    frame += n;
+    pos += len;
+  }
+
+  frame = iov_trailer(&f, &out, frame, &p);
+  goto done;
+
+fail:
+  frame = 0;
+done:
+  zyphrax_block_ws_free(&ws, NULL);
+  free(f.seek);
+  if (in_ok)
+    iov_buf_free(&in);
+  if (out_ok)
+    iov_buf_free(&out);
+  return (size_t)frame;
+}
+
+// Decodes the frame at offset *pos of in into out from offset *produced,
+// moving both past it. Returns 0, or -1 on error.
+static int iov_decode_frame(zyphrax_dec_ws_t *ws, iov_buf_t *in,
+                            uint64_t *pos, iov_buf_t *out,
+                            uint64_t *produced) {
+  uint8_t hdr[ZYPHRAX_HEADER_SIZE + ZYPHRAX_CONTENT_SIZE_FIELD];
+  size_t avail = in->size - *pos < sizeof(hdr) ? (size_t)(in->size - *pos)
+                                                : sizeof(hdr);
+  zyphrax_frame_t frame;
+  if (iov_read(in, *pos, hdr, avail) != 0 ||
+      zyphrax_read_frame_internal(hdr, avail, &frame) != 0)
+    return -1;
+  if (frame.content_size != ZYPHRAX_CONTENT_SIZE_ERROR &&
+      frame.content_size > out->size - *produced)
+    return -1;
+
+  uint64_t ip = *pos + frame.header_size;
+  uint64_t op = *produced;
+  zyphrax_frame_sum_t sum;
+  zyphrax_frame_sum_init(&sum, (int)frame.params.checksum);
+
+  while (ip < in->size) {
+    // The block header, or the start of the next frame
+    uint8_t blk[ZYPHRAX_SUM_BLOCK_SIZE];
+    size_t left = (size_t)(in->size - ip);
+    size_t n = left < sizeof(blk) ? left : sizeof(blk);
+    if (iov_read(in, ip, blk, n) != 0)
+      return -1;
+    if (zyphrax_is_frame_start(blk, n))
+      break;
+    zyphrax_block_info_t info;
+    if (zyphrax_read_block_info(blk, left, frame.params.block_size,
+                                &info) != 0 ||
+        zyphrax_frame_sum_block(&sum, blk, &info) != 0 ||
+        info.orig_size > out->size - op)
+      return -1;
+
+    if (info.type != ZYPHRAX_BLOCK_SKIPPABLE) {
+      zyphrax_segs_t iw, ow;
+      if (iov_window(in, ip + info.hdr_size, info.comp_size, &iw) != 0 ||
+          iov_window(out, op, info.orig_size, &ow) != 0 ||
+          zyphrax_decompress_block_segs(ws, &iw, &info, &ow) !=
+              info.orig_size)
+        return -1;
+      op += info.orig_size;
+    }
+    ip += info.hdr_size + info.comp_size;
+  }
+
+  if (zyphrax_frame_sum_end(&sum) != 0)
+    return -1; // Checksum block missing
+  if (frame.content_size != ZYPHRAX_CONTENT_SIZE_ERROR &&
+      frame.content_size != op - *produced)
+    return -1; // Frame disagrees with its own header
+  *pos = ip;
+  *produced = op;
+  return 0;
+}
+
+size_t zyphrax_decompressv(const zyphrax_iovec_t *src, size_t src_cnt,
+                           const zyphrax_iovec_t *dst, size_t dst_cnt) {
+  iov_buf_t in, out;
+  int in_ok = iov_buf_init(&in, src, src_cnt) == 0;
+  int out_ok = iov_buf_init(&out, dst, dst_cnt) == 0;
+  zyphrax_dec_ws_t ws;
+  ws.stats = NULL;
+  uint64_t pos = 0, produced = 0;
+  if (!in_ok || !out_ok)
+    goto fail;
+
+  // Every frame, skipping skippable frames
+  while (pos < in.size) {
+    uint8_t word[ZYPHRAX_SKIPPABLE_HEADER_SIZE];
+    size_t left = (size_t)(in.size - pos);
+    size_t n = left < sizeof(word) ? left : sizeof(word);
+    if (iov_read(&in, pos, word, n) != 0)
+      goto fail;
+    size_t skip = zyphrax_skippable_frame_size(word, left);
+    if (skip) {
+      pos += skip;
+      continue;
+    }
+    if (iov_decode_frame(&ws, &in, &pos, &out, &produced) != 0)
+      goto fail;
+  }
+  goto done;
+
+fail:
+  produced = 0;
+done:
+  if (in_ok)
+    iov_buf_free(&in);
+  if (out_ok)
+    iov_buf_free(&out);
+  return (size_t)produced;
+}
@@ -9,11 +9,39 @@ static inline uint16_t zyphrax_hash4(const uint8_t *p) {
   return (v * 2654435761u) >> (32 - HASH_LOG);
 }
 
-void zyphrax_lz77_init(zyphrax_lz77_t *lz) {
+static void lz77_clear(zyphrax_lz77_t *lz) {
   memset(lz->hash_table, 0, sizeof(lz->hash_table));
   memset(lz->chain, 0, sizeof(lz->chain));
 }
 
+void zyphrax_lz77_init(zyphrax_lz77_t *lz) {
+  lz77_clear(lz);
+  lz->max_chain = ZYPHRAX_LZ77_DEFAULT_CHAIN;
+  lz->chain_steps = 0;
+}
+
+// Below this size, clearing the touched hash heads one by one beats a memset
+// of the whole table.
+#define LZ77_SPARSE_RESET 4096
+
+void zyphrax_lz77_reset(zyphrax_lz77_t *lz, const uint8_t *data, size_t size) {
+  // Past 64K the 16-bit positions alias and the chain walk can reach entries
+  // this block never wrote: start from scratch.
+  if (size > MAX_DIST + 1) {
+    lz77_clear(lz);
+    return;
+  }
+
+  // Chain entries are always written before they are read, so only the hash
+  // heads need clearing.
+  if (size < LZ77_SPARSE_RESET) {
+    for (size_t i = 0; i + MIN_MATCH <= size; i++)
+      lz->hash_table[zyphrax_hash4(data + i)] = 0;
+    return;
+  }
+  memset(lz->hash_table, 0, sizeof(lz->hash_table));
+}
+
 // Find best match
 // Note: pos is absolute position in 'data'. 'limit' is the end of valid data.
 zyphrax_match_t zyphrax_find_best_match(zyphrax_lz77_t *lz, const uint8_t *data,
@@ -43,7 +71,7 @@ zyphrax_match_t zyphrax_find_best_match(zyphrax_lz77_t *lz, const uint8_t *data,
   lz->hash_table[h] = (uint16_t)(pos + 1);
 
   // Scan chain
-  uint32_t max_chain_len = 256; // Limit search for speed
+  uint32_t max_chain_len = lz->max_chain; // Limit search for speed
 
   uint16_t best_len = MIN_MATCH - 1;
   // Limit max match check
@@ -62,10 +90,10 @@ zyphrax_match_t zyphrax_find_best_match(zyphrax_lz77_t *lz, const uint8_t *data,
     // distance
     uint16_t delta = scan_val - cur_val;
 
-    // Wrap-around distance check
-    if (delta == 0 || delta > MAX_DIST) {
-      // Invalid distance
-    }
+    // Wrap-around: an entry exactly 64K back aliases the current position
+    // and would be emitted as offset 0 (blocks over 64K only)
+    if (delta == 0)
+      break;
 
     // Safety: verify absolute position
     if (delta > pos) {
@@ -95,6 +123,114 @@ zyphrax_match_t zyphrax_find_best_match(zyphrax_lz77_t *lz, const uint8_t *data,
     // Next in chain
     cur_val = lz->chain[match_full_pos & chain_mask];
   }
+  // depth overshoots by one when the walk ran out of effort
+  lz->chain_steps += depth < max_chain_len ? depth : max_chain_len;
+
+  return best_match;
+}
+
+// -------------------------------------------------------------------------
+// Scattered Input
+// -------------------------------------------------------------------------
+
+static inline uint8_t segs_byte(const zyphrax_segs_t *w, size_t pos) {
+  size_t run;
+  return *zyphrax_segs_at(w, pos, &run);
+}
+
+// Hash of the 4 bytes at pos of w, gathered when they span segments
+static inline uint16_t segs_hash4(const zyphrax_segs_t *w,
+                                  zyphrax_segs_run_t *c, size_t pos) {
+  const uint8_t *p = zyphrax_segs_get(w, c, pos, 4);
+  if (p)
+    return zyphrax_hash4(p);
+  uint8_t b[4];
+  zyphrax_segs_read(w, pos, b, 4);
+  return zyphrax_hash4(b);
+}
+
+size_t zyphrax_segs_match_len(const zyphrax_segs_t *w, size_t a, size_t b,
+                              size_t max) {
+  size_t len = 0;
+  while (len < max) {
+    size_t ra, rb;
+    const uint8_t *pa = zyphrax_segs_at(w, a + len, &ra);
+    const uint8_t *pb = zyphrax_segs_at(w, b + len, &rb);
+    size_t n = max - len;
+    if (ra < n)
+      n = ra;
+    if (rb < n)
+      n = rb;
+    size_t m = zyphrax_match_len_simd(pa, pb, n);
+    len += m;
+    if (m < n)
+      break;
+  }
+  return len;
+}
+
+void zyphrax_lz77_reset_segs(zyphrax_lz77_t *lz, const zyphrax_segs_t *w,
+                             size_t size) {
+  if (size <= MAX_DIST + 1 && size < LZ77_SPARSE_RESET) {
+    zyphrax_segs_run_t c = {NULL, 0, 0};
+    for (size_t i = 0; i + MIN_MATCH <= size; i++)
+      lz->hash_table[segs_hash4(w, &c, i)] = 0;
+    return;
+  }
+  zyphrax_lz77_reset(lz, NULL, size); // Data is only read below that size
+}
+
+// zyphrax_find_best_match, reading through w
+zyphrax_match_t zyphrax_find_best_match_segs(zyphrax_lz77_t *lz,
+                                             const zyphrax_segs_t *w,
+                                             size_t pos, size_t limit) {
+  zyphrax_match_t best_match = {0, 0};
+  if (pos + MIN_MATCH > limit)
+    return best_match;
+
+  zyphrax_segs_run_t c = {NULL, 0, 0};
+  uint16_t h = segs_hash4(w, &c, pos);
+  uint16_t cur_val = lz->hash_table[h];
+
+  size_t chain_mask = (1 << 18) - 1;
+  lz->chain[pos & chain_mask] = cur_val;
+  lz->hash_table[h] = (uint16_t)(pos + 1);
+
+  uint32_t max_chain_len = lz->max_chain;
+  uint16_t best_len = MIN_MATCH - 1;
+  size_t max_possible_match = MAX_MATCH;
+  if (pos + max_possible_match > limit)
+    max_possible_match = limit - pos;
+
+  size_t depth = 0;
+  uint16_t scan_val = (uint16_t)(pos + 1);
+  // The current position's bytes the candidates are first tested on
+  uint8_t first = segs_byte(w, pos);
+  uint8_t at_best = segs_byte(w, pos + best_len);
+
+  while (cur_val != 0 && depth++ < max_chain_len) {
+    uint16_t delta = scan_val - cur_val;
+    if (delta == 0 || delta > pos)
+      break;
+
+    size_t match_full_pos = pos - delta;
+    if (at_best == segs_byte(w, match_full_pos + best_len) &&
+        first == segs_byte(w, match_full_pos)) {
+      size_t len = zyphrax_segs_match_len(w, pos, match_full_pos,
+                                          max_possible_match);
+      if (len > best_len) {
+        best_len = len;
+        best_match.offset = delta;
+        best_match.length = len;
+        if (len >= max_possible_match)
+          break;
+        at_best = segs_byte(w, pos + best_len);
+      }
+    }
+
+    cur_val = lz->chain[match_full_pos & chain_mask];
+  }
+  lz->chain_steps += depth < max_chain_len ? depth : max_chain_len;
 
   return best_match;
 }
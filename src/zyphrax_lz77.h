@@ -1,4 +1,5 @@
 #pragma once
+#include "zyphrax_segs.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -8,9 +9,14 @@
 #define MIN_MATCH 4
 #define MAX_MATCH 258
 
+// Chain links walked per position unless the caller sets max_chain
+#define ZYPHRAX_LZ77_DEFAULT_CHAIN 256
+
 typedef struct {
   uint16_t hash_table[HASH_SIZE]; // Heads of chains
   uint16_t chain[1 << 18];        // 256K chain buffer (offsets)
+  uint32_t max_chain;             // Search effort, at least 1
+  uint64_t chain_steps;           // Links walked so far (statistics)
 } zyphrax_lz77_t;
 
 typedef struct {
@@ -18,10 +24,28 @@ typedef struct {
   uint16_t length;
 } zyphrax_match_t;
 
-// Initialize the LZ77 state (clears hash table)
+// Initialize the LZ77 state (clears hash table, default search effort)
 void zyphrax_lz77_init(zyphrax_lz77_t *lz);
 
+// Returns the state to its initialized form after matching data[0, size),
+// touching only what that block could have dirtied. Cheaper than a full init
+// when one state serves many (small) blocks.
+void zyphrax_lz77_reset(zyphrax_lz77_t *lz, const uint8_t *data, size_t size);
+
 // Find best match for data at pos, looking back up to MAX_DIST
 // Updates hash chain with new position
 zyphrax_match_t zyphrax_find_best_match(zyphrax_lz77_t *lz, const uint8_t *data,
                                         size_t pos, size_t limit);
+
+// Same over the window w of scattered input (zyphrax_compressv): chains and
+// matches run across segments, and the choices are those the pointer calls
+// make on the same bytes.
+void zyphrax_lz77_reset_segs(zyphrax_lz77_t *lz, const zyphrax_segs_t *w,
+                             size_t size);
+zyphrax_match_t zyphrax_find_best_match_segs(zyphrax_lz77_t *lz,
+                                             const zyphrax_segs_t *w,
+                                             size_t pos, size_t limit);
+
+// Length of the match of w at a against w at b, up to max
+size_t zyphrax_segs_match_len(const zyphrax_segs_t *w, size_t a, size_t b,
+                              size_t max);
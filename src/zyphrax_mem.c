@@ -0,0 +1,63 @@
+#include "zyphrax_mem.h"
+#include <stdlib.h>
+#include <string.h>
+
+void *zyphrax_malloc(const zyphrax_allocator_t *a, size_t size) {
+  if (a && a->alloc)
+    return a->alloc(a->opaque, size);
+  return malloc(size);
+}
+
+void *zyphrax_calloc(const zyphrax_allocator_t *a, size_t count, size_t size) {
+  if (!(a && a->alloc))
+    return calloc(count, size);
+  if (size && count > SIZE_MAX / size)
+    return NULL;
+  void *p = a->alloc(a->opaque, count * size);
+  if (p)
+    memset(p, 0, count * size);
+  return p;
+}
+
+void zyphrax_free(const zyphrax_allocator_t *a, void *ptr) {
+  if (!ptr)
+    return;
+  if (a && a->alloc) {
+    if (a->free)
+      a->free(a->opaque, ptr);
+    return;
+  }
+  free(ptr);
+}
+
+// -------------------------------------------------------------------------
+// Arena
+// -------------------------------------------------------------------------
+
+void zyphrax_arena_init(zyphrax_arena_t *arena, void *mem, size_t size) {
+  arena->base = (uint8_t *)mem;
+  arena->size = size;
+  arena->used = 0;
+}
+
+static void *arena_alloc(void *opaque, size_t size) {
+  zyphrax_arena_t *arena = (zyphrax_arena_t *)opaque;
+  uintptr_t base = (uintptr_t)arena->base;
+  uintptr_t p = (base + arena->used + ZYPHRAX_ARENA_ALIGN - 1) &
+                ~(uintptr_t)(ZYPHRAX_ARENA_ALIGN - 1);
+  size_t off = (size_t)(p - base);
+  if (off > arena->size || size > arena->size - off)
+    return NULL; // Workspace exhausted
+  arena->used = off + size;
+  return (void *)p;
+}
+
+static void arena_free(void *opaque, void *ptr) {
+  (void)opaque;
+  (void)ptr;
+}
+
+zyphrax_allocator_t zyphrax_arena_allocator(zyphrax_arena_t *arena) {
+  zyphrax_allocator_t a = {arena_alloc, arena_free, arena};
+  return a;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "zyphrax.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Allocation through the caller's hooks
+// A NULL allocator (or NULL alloc hook) means malloc/free.
+
+void *zyphrax_malloc(const zyphrax_allocator_t *a, size_t size);
+void *zyphrax_calloc(const zyphrax_allocator_t *a, size_t count, size_t size);
+void zyphrax_free(const zyphrax_allocator_t *a, void *ptr);
+
+// Bump allocator over a caller-provided workspace (static mode)
+// Allocations are 64-byte aligned and never given back: free is a no-op, so
+// everything is carved once when the context is set up. Budget
+// ZYPHRAX_ARENA_SLACK plus zyphrax_arena_round() of each allocation.
+
+#define ZYPHRAX_ARENA_ALIGN 64
+#define ZYPHRAX_ARENA_SLACK (ZYPHRAX_ARENA_ALIGN - 1)
+
+typedef struct {
+  uint8_t *base;
+  size_t size;
+  size_t used;
+} zyphrax_arena_t;
+
+static inline size_t zyphrax_arena_round(size_t size) {
+  return (size + ZYPHRAX_ARENA_ALIGN - 1) & ~(size_t)(ZYPHRAX_ARENA_ALIGN - 1);
+}
+
+void zyphrax_arena_init(zyphrax_arena_t *arena, void *mem, size_t size);
+
+// Allocator whose hooks draw from arena (which must outlive it)
+zyphrax_allocator_t zyphrax_arena_allocator(zyphrax_arena_t *arena);
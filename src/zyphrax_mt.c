@@ -0,0 +1,192 @@
+#include "zyphrax.h"
+#include "zyphrax_dec.h"
+#include "zyphrax_frame.h"
+#include "zyphrax_hash.h"
+#include "zyphrax_mem.h"
+#include "zyphrax_pool.h"
+#include "zyphrax_stats.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+// -------------------------------------------------------------------------
+// Multithreaded Decompression
+// -------------------------------------------------------------------------
+
+int zyphrax_dec_workers_init(zyphrax_dec_workers_t *w, unsigned nb_threads,
+                             const zyphrax_allocator_t *alloc) {
+  w->ws = zyphrax_malloc(alloc, nb_threads * sizeof(*w->ws));
+  w->pool = w->ws ? zyphrax_pool_create(nb_threads, alloc) : NULL;
+  if (!w->pool) {
+    zyphrax_free(alloc, w->ws);
+    w->ws = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+void zyphrax_dec_workers_free(zyphrax_dec_workers_t *w,
+                              const zyphrax_allocator_t *alloc) {
+  zyphrax_pool_free(w->pool);
+  zyphrax_free(alloc, w->ws);
+  w->pool = NULL;
+  w->ws = NULL;
+}
+
+typedef struct {
+  const uint8_t *body; // Frame body (just past the header)
+  uint8_t *dst;
+  const zyphrax_block_ref_t *refs;
+  zyphrax_dec_ws_t *ws;  // One per worker, NULL when decoding inline
+  zyphrax_stats_t *recs; // Statistics: one record per block, else NULL
+  atomic_int failed;     // Any block failed: the rest are skipped
+} dec_job_t;
+
+static void dec_block_job(void *ctx, size_t job, unsigned worker) {
+  dec_job_t *dj = (dec_job_t *)ctx;
+  const zyphrax_block_ref_t *ref = &dj->refs[job];
+
+  if (atomic_load_explicit(&dj->failed, memory_order_relaxed))
+    return;
+
+  const uint8_t *src = dj->body + ref->src_off;
+  uint8_t *dst = dj->dst + ref->dst_off;
+  size_t dec;
+  if (dj->ws) {
+    zyphrax_dec_ws_t *ws = &dj->ws[worker];
+    ws->stats = dj->recs ? &dj->recs[job] : NULL;
+    dec = zyphrax_decompress_block_ws(ws, src, &ref->info, dst,
+                                      ref->info.orig_size);
+  } else {
+    dec = zyphrax_decompress_block(src, &ref->info, dst, ref->info.orig_size);
+  }
+  if (dec != ref->info.orig_size)
+    atomic_store_explicit(&dj->failed, 1, memory_order_relaxed);
+}
+
+// Decodes the frame at src (up to the next frame, if any) on w, whose
+// workers are started on first use (no more than blocks, for a lone frame,
+// unless keep says they outlive the call). With a sink, each block's record
+// is passed on to it in frame order once all of them decoded. On success
+// *in_size and *out_size are the frame's compressed and decoded sizes.
+// Returns 0, or -1 on error.
+static int decompress_frame_mt(const uint8_t *src, size_t src_size,
+                               uint8_t *dst, size_t dst_cap,
+                               unsigned nb_threads, zyphrax_dec_workers_t *w,
+                               const zyphrax_allocator_t *alloc, int keep,
+                               zyphrax_stats_sink_t *sink, size_t *in_size,
+                               size_t *out_size) {
+  zyphrax_frame_t frame;
+  if (zyphrax_read_frame_internal(src, src_size, &frame) != 0)
+    return -1;
+
+  const uint8_t *body = src + frame.header_size;
+  zyphrax_block_ref_t *refs;
+  size_t count, total;
+  if (zyphrax_index_blocks(body, src_size - frame.header_size,
+                           frame.params.block_size, &refs, &count, &total,
+                           alloc) != 0)
+    return -1;
+
+  if (total > dst_cap || (frame.content_size != ZYPHRAX_CONTENT_SIZE_ERROR &&
+                          frame.content_size != total)) {
+    zyphrax_free(alloc, refs);
+    return -1;
+  }
+
+  // The frame checksum only needs the block headers: check it up front
+  zyphrax_frame_sum_t sum;
+  zyphrax_frame_sum_init(&sum, (int)frame.params.checksum);
+  for (size_t i = 0; i < count; i++) {
+    if (zyphrax_frame_sum_block(&sum, body + refs[i].src_off,
+                                &refs[i].info) != 0) {
+      zyphrax_free(alloc, refs);
+      return -1;
+    }
+  }
+  if (zyphrax_frame_sum_end(&sum) != 0) {
+    zyphrax_free(alloc, refs);
+    return -1;
+  }
+
+  size_t body_size = 0;
+  if (count) {
+    const zyphrax_block_ref_t *last = &refs[count - 1];
+    body_size = last->src_off + last->info.hdr_size + last->info.comp_size;
+  }
+  *in_size = frame.header_size + body_size;
+  *out_size = total;
+
+  // No point in more workers than blocks, unless more frames follow
+  if (!w->pool && nb_threads > 1) {
+    if (!keep && *in_size == src_size && nb_threads > count)
+      nb_threads = (unsigned)count;
+    if (nb_threads > 1)
+      zyphrax_dec_workers_init(w, nb_threads, alloc);
+  }
+
+  dec_job_t dj = {.body = body, .dst = dst, .refs = refs, .ws = w->ws};
+  if (sink && w->ws && count) {
+    dj.recs = zyphrax_calloc(alloc, count, sizeof(*dj.recs));
+    if (!dj.recs) {
+      zyphrax_free(alloc, refs);
+      return -1;
+    }
+  }
+  atomic_init(&dj.failed, 0);
+  if (w->pool) {
+    zyphrax_pool_run(w->pool, dec_block_job, &dj, count);
+  } else {
+    for (size_t i = 0; i < count; i++)
+      dec_block_job(&dj, i, 0);
+  }
+
+  int failed = atomic_load(&dj.failed);
+  if (dj.recs && !failed) {
+    for (size_t i = 0; i < count; i++)
+      zyphrax_stats_done(sink, &dj.recs[i]);
+  }
+  zyphrax_free(alloc, dj.recs);
+  zyphrax_free(alloc, refs);
+  return failed ? -1 : 0;
+}
+
+size_t zyphrax_decompress_frames_mt(const uint8_t *src, size_t src_size,
+                                    uint8_t *dst, size_t dst_cap,
+                                    unsigned nb_threads,
+                                    zyphrax_dec_workers_t *w,
+                                    const zyphrax_allocator_t *alloc,
+                                    int keep, zyphrax_stats_sink_t *sink) {
+  size_t in = 0;
+  size_t out = 0;
+  int failed = 0;
+  while (in < src_size && !failed) {
+    size_t skip = zyphrax_skippable_frame_size(src + in, src_size - in);
+    if (skip) {
+      in += skip;
+      continue;
+    }
+    size_t in_size, out_size;
+    failed = decompress_frame_mt(src + in, src_size - in, dst + out,
+                                 dst_cap - out, nb_threads, w, alloc, keep,
+                                 sink, &in_size, &out_size) != 0;
+    if (!failed) {
+      in += in_size;
+      out += out_size;
+    }
+  }
+  return failed ? 0 : out;
+}
+
+size_t zyphrax_decompress_mt(const uint8_t *src, size_t src_size,
+                             uint8_t *dst, size_t dst_cap,
+                             unsigned nb_threads) {
+  if (nb_threads <= 1)
+    return zyphrax_decompress(src, src_size, dst, dst_cap);
+
+  // Workers for this call only, sized to the work
+  zyphrax_dec_workers_t w = {NULL, NULL};
+  size_t out = zyphrax_decompress_frames_mt(src, src_size, dst, dst_cap,
+                                            nb_threads, &w, NULL, 0, NULL);
+  zyphrax_dec_workers_free(&w, NULL);
+  return out;
+}
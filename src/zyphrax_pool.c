@@ -0,0 +1,139 @@
+#include "zyphrax_pool.h"
+#include "zyphrax_mem.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef struct {
+  zyphrax_pool_t *pool;
+  unsigned id;
+} worker_arg_t;
+
+struct zyphrax_pool {
+  pthread_t *threads;
+  worker_arg_t *args;
+  unsigned nb_threads;
+  zyphrax_allocator_t alloc;
+
+  pthread_mutex_t lock;
+  pthread_cond_t work_cv; // Signalled when jobs are published or on shutdown
+  pthread_cond_t done_cv; // Signalled when the last job of a run finishes
+
+  zyphrax_pool_fn fn;
+  void *ctx;
+  size_t job_count;
+  size_t next_job;
+  size_t jobs_done;
+  int shutdown;
+};
+
+static void *worker_main(void *arg) {
+  worker_arg_t *wa = (worker_arg_t *)arg;
+  zyphrax_pool_t *pool = wa->pool;
+  unsigned id = wa->id;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->shutdown && pool->next_job >= pool->job_count)
+      pthread_cond_wait(&pool->work_cv, &pool->lock);
+    if (pool->shutdown)
+      break;
+
+    size_t job = pool->next_job++;
+    zyphrax_pool_fn fn = pool->fn;
+    void *ctx = pool->ctx;
+    pthread_mutex_unlock(&pool->lock);
+
+    fn(ctx, job, id);
+
+    pthread_mutex_lock(&pool->lock);
+    if (++pool->jobs_done == pool->job_count)
+      pthread_cond_signal(&pool->done_cv);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+zyphrax_pool_t *zyphrax_pool_create(unsigned nb_threads,
+                                    const zyphrax_allocator_t *alloc) {
+  if (nb_threads == 0)
+    nb_threads = 1;
+
+  zyphrax_pool_t *pool = zyphrax_calloc(alloc, 1, sizeof(*pool));
+  if (!pool)
+    return NULL;
+  if (alloc)
+    pool->alloc = *alloc;
+
+  pool->threads = zyphrax_calloc(alloc, nb_threads, sizeof(pthread_t));
+  pool->args = zyphrax_calloc(alloc, nb_threads, sizeof(worker_arg_t));
+  if (!pool->threads || !pool->args) {
+    zyphrax_free(alloc, pool->threads);
+    zyphrax_free(alloc, pool->args);
+    zyphrax_free(alloc, pool);
+    return NULL;
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work_cv, NULL);
+  pthread_cond_init(&pool->done_cv, NULL);
+
+  for (unsigned i = 0; i < nb_threads; i++) {
+    worker_arg_t *wa = &pool->args[i];
+    wa->pool = pool;
+    wa->id = i;
+    if (pthread_create(&pool->threads[i], NULL, worker_main, wa) != 0) {
+      zyphrax_pool_free(pool);
+      return NULL;
+    }
+    pool->nb_threads = i + 1;
+  }
+
+  return pool;
+}
+
+void zyphrax_pool_free(zyphrax_pool_t *pool) {
+  if (!pool)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = 1;
+  pthread_cond_broadcast(&pool->work_cv);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (unsigned i = 0; i < pool->nb_threads; i++)
+    pthread_join(pool->threads[i], NULL);
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->work_cv);
+  pthread_cond_destroy(&pool->done_cv);
+  zyphrax_allocator_t alloc = pool->alloc;
+  zyphrax_free(&alloc, pool->threads);
+  zyphrax_free(&alloc, pool->args);
+  zyphrax_free(&alloc, pool);
+}
+
+unsigned zyphrax_pool_size(const zyphrax_pool_t *pool) {
+  return pool->nb_threads;
+}
+
+void zyphrax_pool_run(zyphrax_pool_t *pool, zyphrax_pool_fn fn, void *ctx,
+                      size_t count) {
+  if (count == 0)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->fn = fn;
+  pool->ctx = ctx;
+  pool->next_job = 0;
+  pool->jobs_done = 0;
+  pool->job_count = count;
+  pthread_cond_broadcast(&pool->work_cv);
+
+  while (pool->jobs_done < pool->job_count)
+    pthread_cond_wait(&pool->done_cv, &pool->lock);
+
+  // Park the workers until the next run
+  pool->job_count = 0;
+  pool->next_job = 0;
+  pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "zyphrax.h"
+#include <stddef.h>
+
+// Persistent worker pool
+// Threads are created once and reused for every zyphrax_pool_run call, so
+// per-call cost is a wake-up rather than a thread spawn.
+
+typedef struct zyphrax_pool zyphrax_pool_t;
+
+// Job callback: job is in [0, count), worker is in [0, nb_threads)
+typedef void (*zyphrax_pool_fn)(void *ctx, size_t job, unsigned worker);
+
+// Bookkeeping goes through alloc (NULL = malloc). Returns NULL on failure
+zyphrax_pool_t *zyphrax_pool_create(unsigned nb_threads,
+                                    const zyphrax_allocator_t *alloc);
+void zyphrax_pool_free(zyphrax_pool_t *pool);
+
+unsigned zyphrax_pool_size(const zyphrax_pool_t *pool);
+
+// Runs fn for every job in [0, count) across the workers and blocks until all
+// jobs have finished. Jobs are handed out in increasing order.
+// Not reentrant: one run per pool at a time.
+void zyphrax_pool_run(zyphrax_pool_t *pool, zyphrax_pool_fn fn, void *ctx,
+                      size_t count);
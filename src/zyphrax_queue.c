@@ -0,0 +1,70 @@
+#include "zyphrax_queue.h"
+#include <stdlib.h>
+
+int zyphrax_queue_init(zyphrax_queue_t *q, size_t capacity) {
+  size_t size = 2;
+  while (size < capacity)
+    size <<= 1;
+
+  q->cells = malloc(size * sizeof(*q->cells));
+  if (!q->cells)
+    return -1;
+  for (size_t i = 0; i < size; i++)
+    atomic_init(&q->cells[i].seq, i);
+  q->mask = size - 1;
+  atomic_init(&q->head, 0);
+  atomic_init(&q->tail, 0);
+  return 0;
+}
+
+void zyphrax_queue_free(zyphrax_queue_t *q) {
+  free(q->cells);
+  q->cells = NULL;
+}
+
+int zyphrax_queue_push(zyphrax_queue_t *q, size_t value) {
+  size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+  for (;;) {
+    zyphrax_queue_cell_t *cell = &q->cells[pos & q->mask];
+    size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+    ptrdiff_t diff = (ptrdiff_t)(seq - pos);
+    if (diff == 0) {
+      // Cell free for this lap: claim it
+      if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        cell->value = value;
+        atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+        return 1;
+      }
+    } else if (diff < 0) {
+      return 0; // Still holds last lap's value
+    } else {
+      pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    }
+  }
+}
+
+int zyphrax_queue_pop(zyphrax_queue_t *q, size_t *value) {
+  size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+  for (;;) {
+    zyphrax_queue_cell_t *cell = &q->cells[pos & q->mask];
+    size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+    ptrdiff_t diff = (ptrdiff_t)(seq - (pos + 1));
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        *value = cell->value;
+        // Hand the cell to the producer of the next lap
+        atomic_store_explicit(&cell->seq, pos + q->mask + 1,
+                              memory_order_release);
+        return 1;
+      }
+    } else if (diff < 0) {
+      return 0; // Empty
+    } else {
+      pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    }
+  }
+}
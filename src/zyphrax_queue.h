@@ -0,0 +1,28 @@
+#pragma once
+#include <stdatomic.h>
+#include <stddef.h>
+
+// Bounded lock-free MPMC queue of size_t values
+// Each cell carries a sequence number telling producers and consumers whose
+// turn it is, so push/pop are a CAS on the shared index plus one store.
+// Capacity is rounded up to a power of two.
+
+typedef struct {
+  atomic_size_t seq;
+  size_t value;
+} zyphrax_queue_cell_t;
+
+typedef struct {
+  zyphrax_queue_cell_t *cells;
+  size_t mask;
+  atomic_size_t head; // Next cell to push
+  atomic_size_t tail; // Next cell to pop
+} zyphrax_queue_t;
+
+// Returns 0 or -1 (OOM)
+int zyphrax_queue_init(zyphrax_queue_t *q, size_t capacity);
+void zyphrax_queue_free(zyphrax_queue_t *q);
+
+// Return 1 on success, 0 if the queue is full / empty
+int zyphrax_queue_push(zyphrax_queue_t *q, size_t value);
+int zyphrax_queue_pop(zyphrax_queue_t *q, size_t *value);
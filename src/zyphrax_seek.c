@@ -0,0 +1,295 @@
+#include "zyphrax_seek.h"
+#include "zyphrax.h"
+#include "zyphrax_frame.h"
+#include "zyphrax_hash.h"
+#include "zyphrax_mem.h"
+#include <string.h>
+
+static void write_u32_le(uint8_t *p, uint32_t x) {
+  p[0] = x & 0xFF;
+  p[1] = (x >> 8) & 0xFF;
+  p[2] = (x >> 16) & 0xFF;
+  p[3] = (x >> 24) & 0xFF;
+}
+
+static uint32_t read_u32_le(const uint8_t *p) {
+  return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static void write_u64_le(uint8_t *p, uint64_t x) {
+  write_u32_le(p, (uint32_t)x);
+  write_u32_le(p + 4, (uint32_t)(x >> 32));
+}
+
+static uint64_t read_u64_le(const uint8_t *p) {
+  return (uint64_t)read_u32_le(p) | ((uint64_t)read_u32_le(p + 4) << 32);
+}
+
+// -------------------------------------------------------------------------
+// Seek Table
+// -------------------------------------------------------------------------
+
+size_t zyphrax_seek_table_size(size_t count) {
+  return ZYPHRAX_BLOCK_HDR_SKIPPABLE + 4 + count * ZYPHRAX_SEEK_ENTRY_SIZE +
+         ZYPHRAX_SEEK_TRAILER_SIZE;
+}
+
+// Block header and count; returns where the entries go
+static uint8_t *seek_table_open(uint8_t *dst, size_t count, size_t total) {
+  uint8_t *p = dst;
+  *p++ = ZYPHRAX_BLOCK_SKIPPABLE;
+  write_u32_le(p, (uint32_t)(total - ZYPHRAX_BLOCK_HDR_SKIPPABLE));
+  p += 4;
+  write_u32_le(p, (uint32_t)count);
+  return p + 4;
+}
+
+static uint8_t *seek_table_entry(uint8_t *p, uint64_t comp_off,
+                                 uint32_t comp_size, uint32_t orig_size) {
+  write_u64_le(p, comp_off);
+  write_u32_le(p + 8, comp_size);
+  write_u32_le(p + 12, orig_size);
+  return p + ZYPHRAX_SEEK_ENTRY_SIZE;
+}
+
+static void seek_table_close(uint8_t *p, size_t total) {
+  write_u32_le(p, (uint32_t)total);
+  write_u32_le(p + 4, ZYPHRAX_SEEK_MAGIC);
+}
+
+size_t zyphrax_write_seek_table(const zyphrax_seek_entry_t *entries,
+                                size_t count, uint8_t *dst, size_t dst_cap) {
+  size_t total = zyphrax_seek_table_size(count);
+  if (dst_cap < total || total > 0xFFFFFFFFu)
+    return 0;
+
+  uint8_t *p = seek_table_open(dst, count, total);
+  for (size_t i = 0; i < count; i++)
+    p = seek_table_entry(p, entries[i].comp_off, entries[i].comp_size,
+                         entries[i].orig_size);
+  seek_table_close(p, total);
+  return total;
+}
+
+size_t zyphrax_write_seek_table_scan(const uint8_t *frame, size_t begin,
+                                     size_t end, size_t block_size,
+                                     uint8_t *dst, size_t dst_cap) {
+  zyphrax_block_info_t info;
+  size_t count = 0;
+  for (size_t pos = begin; pos < end; pos += info.hdr_size + info.comp_size) {
+    if (zyphrax_read_block_info(frame + pos, end - pos, block_size, &info) != 0)
+      return 0;
+    count++;
+  }
+
+  size_t total = zyphrax_seek_table_size(count);
+  if (dst_cap < total || total > 0xFFFFFFFFu)
+    return 0;
+
+  uint8_t *p = seek_table_open(dst, count, total);
+  for (size_t pos = begin; pos < end; pos += info.hdr_size + info.comp_size) {
+    zyphrax_read_block_info(frame + pos, end - pos, block_size, &info);
+    p = seek_table_entry(p, pos, (uint32_t)(info.hdr_size + info.comp_size),
+                         (uint32_t)info.orig_size);
+  }
+  seek_table_close(p, total);
+  return total;
+}
+
+int zyphrax_read_seek_table(const uint8_t *src, size_t src_size,
+                            zyphrax_seek_entry_t **entries, size_t *count,
+                            const zyphrax_allocator_t *alloc) {
+  if (src_size < ZYPHRAX_HEADER_SIZE + zyphrax_seek_table_size(0))
+    return -1;
+
+  const uint8_t *end = src + src_size;
+  if (read_u32_le(end - 4) != ZYPHRAX_SEEK_MAGIC)
+    return -1;
+
+  size_t total = read_u32_le(end - 8);
+  if (total < zyphrax_seek_table_size(0) ||
+      total > src_size - ZYPHRAX_HEADER_SIZE)
+    return -1;
+
+  const uint8_t *p = end - total;
+  if (p[0] != ZYPHRAX_BLOCK_SKIPPABLE ||
+      read_u32_le(p + 1) != total - ZYPHRAX_BLOCK_HDR_SKIPPABLE)
+    return -1;
+
+  size_t n = read_u32_le(p + 5);
+  if (zyphrax_seek_table_size(n) != total)
+    return -1;
+
+  // The table must close the frame at src rather than a later frame of a
+  // concatenation: the blocks it lists and the checksum block end where it
+  // starts
+  zyphrax_frame_t frame;
+  if (zyphrax_read_frame_internal(src, src_size, &frame) != 0)
+    return -1;
+  const uint8_t *last = p + ZYPHRAX_BLOCK_HDR_SKIPPABLE + 4 +
+                        (n ? n - 1 : 0) * ZYPHRAX_SEEK_ENTRY_SIZE;
+  uint64_t data_end = n ? read_u64_le(last) + read_u32_le(last + 8)
+                        : frame.header_size;
+  if (frame.params.checksum != ZYPHRAX_CHECKSUM_NONE)
+    data_end += ZYPHRAX_SUM_BLOCK_SIZE;
+  if (data_end != src_size - total)
+    return -1;
+
+  zyphrax_seek_entry_t *arr = zyphrax_malloc(alloc, (n ? n : 1) * sizeof(*arr));
+  if (!arr)
+    return -1;
+
+  p += ZYPHRAX_BLOCK_HDR_SKIPPABLE + 4;
+  for (size_t i = 0; i < n; i++) {
+    arr[i].comp_off = read_u64_le(p);
+    arr[i].comp_size = read_u32_le(p + 8);
+    arr[i].orig_size = read_u32_le(p + 12);
+    p += ZYPHRAX_SEEK_ENTRY_SIZE;
+  }
+
+  *entries = arr;
+  *count = n;
+  return 0;
+}
+
+// Builds seek entries by walking block headers (frames without a table)
+static int index_frame(const uint8_t *src, size_t src_size,
+                       const zyphrax_frame_t *frame,
+                       zyphrax_seek_entry_t **entries, size_t *count,
+                       const zyphrax_allocator_t *alloc) {
+  zyphrax_block_ref_t *refs;
+  size_t n, total;
+  if (zyphrax_index_blocks(src + frame->header_size,
+                           src_size - frame->header_size,
+                           frame->params.block_size, &refs, &n, &total,
+                           alloc) != 0)
+    return -1;
+
+  zyphrax_seek_entry_t *arr = zyphrax_malloc(alloc, (n ? n : 1) * sizeof(*arr));
+  if (!arr) {
+    zyphrax_free(alloc, refs);
+    return -1;
+  }
+  for (size_t i = 0; i < n; i++) {
+    arr[i].comp_off = frame->header_size + refs[i].src_off;
+    arr[i].comp_size = (uint32_t)(refs[i].info.hdr_size + refs[i].info.comp_size);
+    arr[i].orig_size = (uint32_t)refs[i].info.orig_size;
+  }
+  zyphrax_free(alloc, refs);
+
+  *entries = arr;
+  *count = n;
+  return 0;
+}
+
+int zyphrax_frame_entries(const uint8_t *src, size_t src_size,
+                          const zyphrax_frame_t *frame,
+                          zyphrax_seek_entry_t **entries, size_t *count,
+                          const zyphrax_allocator_t *alloc) {
+  if (frame->params.flags & ZYPHRAX_FLAG_SEEK_TABLE) {
+    if (zyphrax_read_seek_table(src, src_size, entries, count, alloc) == 0)
+      return 0;
+    // A broken table fails, one that closes a later frame does not
+    if (zyphrax_find_frame_size(src, src_size) == src_size)
+      return -1;
+  }
+  return index_frame(src, src_size, frame, entries, count, alloc);
+}
+
+// -------------------------------------------------------------------------
+// Range Decompression
+// -------------------------------------------------------------------------
+
+size_t zyphrax_decompress_range_ws(zyphrax_dec_ws_t *ws,
+                                   const uint8_t *src, size_t src_size,
+                                   uint64_t offset, size_t len, uint8_t *dst,
+                                   const zyphrax_allocator_t *alloc) {
+  if (len == 0)
+    return 0;
+
+  zyphrax_frame_t frame;
+  if (zyphrax_read_frame_internal(src, src_size, &frame) != 0)
+    return 0;
+  const zyphrax_params_t params = frame.params;
+
+  zyphrax_seek_entry_t *entries;
+  size_t count;
+  if (zyphrax_frame_entries(src, src_size, &frame, &entries, &count,
+                            alloc) != 0)
+    return 0;
+
+  ws->stats = NULL;
+  uint64_t range_end = offset + len;
+  uint64_t pos = 0;
+  size_t written = 0;
+  uint8_t *scratch = NULL;
+  size_t scratch_cap = 0;
+
+  for (size_t i = 0; i < count && pos < range_end; i++) {
+    const zyphrax_seek_entry_t *e = &entries[i];
+    uint64_t blk_start = pos;
+    uint64_t blk_end = pos + e->orig_size;
+    pos = blk_end;
+
+    if (blk_end <= offset || e->orig_size == 0)
+      continue; // Before the range (or metadata)
+
+    if (e->comp_off > src_size || e->comp_size > src_size - e->comp_off)
+      goto fail;
+
+    zyphrax_block_info_t info;
+    if (zyphrax_read_block_info(src + e->comp_off, e->comp_size,
+                                params.block_size, &info) != 0 ||
+        info.orig_size != e->orig_size ||
+        info.hdr_size + info.comp_size != e->comp_size)
+      goto fail;
+
+    size_t lo = (size_t)((offset > blk_start ? offset : blk_start) - blk_start);
+    size_t hi = (size_t)((range_end < blk_end ? range_end : blk_end) - blk_start);
+
+    if (lo == 0 && hi == info.orig_size) {
+      // Whole block inside the range: decode in place
+      if (zyphrax_decompress_block_ws(ws, src + e->comp_off, &info,
+                                      dst + written, hi) != hi)
+        goto fail;
+    } else if (info.type == ZYPHRAX_BLOCK_RAW ||
+               info.type == ZYPHRAX_BLOCK_RAW_IMPLICIT) {
+      const uint8_t *raw = src + e->comp_off + info.hdr_size;
+      if (info.sum_kind != ZYPHRAX_CHECKSUM_NONE &&
+          zyphrax_hash(info.sum_kind, raw, info.orig_size) != info.checksum)
+        goto fail;
+      memcpy(dst + written, raw + lo, hi - lo);
+    } else {
+      // Partial block: decode to scratch, copy the slice
+      if (scratch_cap < info.orig_size) {
+        zyphrax_free(alloc, scratch);
+        scratch = zyphrax_malloc(alloc, info.orig_size);
+        scratch_cap = scratch ? info.orig_size : 0;
+        if (!scratch)
+          goto fail;
+      }
+      if (zyphrax_decompress_block_ws(ws, src + e->comp_off, &info, scratch,
+                                      scratch_cap) != info.orig_size)
+        goto fail;
+      memcpy(dst + written, scratch + lo, hi - lo);
+    }
+    written += hi - lo;
+  }
+
+  zyphrax_free(alloc, scratch);
+  zyphrax_free(alloc, entries);
+  return written;
+
+fail:
+  zyphrax_free(alloc, scratch);
+  zyphrax_free(alloc, entries);
+  return 0;
+}
+
+size_t zyphrax_decompress_range(const uint8_t *src, size_t src_size,
+                                uint64_t offset, size_t len, uint8_t *dst) {
+  zyphrax_dec_ws_t ws;
+  return zyphrax_decompress_range_ws(&ws, src, src_size, offset, len, dst,
+                                     NULL);
+}
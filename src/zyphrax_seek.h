@@ -0,0 +1,61 @@
+#pragma once
+#include "zyphrax_dec.h"
+#include "zyphrax_frame.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Seek Table (ZYPHRAX_FLAG_SEEK_TABLE)
+// Stored as the last block of the frame, a skippable block:
+//   [Type=3][Size:4][Count:4][Entry * Count][BlockBytes:4][Magic:4]
+//   Entry: [CompOffset:8][CompSize:4][OrigSize:4]
+// CompOffset is measured from the frame start and CompSize covers the whole
+// block (header + payload). The trailer lets readers find the table from the
+// end of the frame; BlockBytes is the size of the entire seek table block.
+
+#define ZYPHRAX_SEEK_MAGIC 0x4B45455Au // "ZEEK" little-endian
+#define ZYPHRAX_SEEK_ENTRY_SIZE 16
+#define ZYPHRAX_SEEK_TRAILER_SIZE 8
+
+typedef struct {
+  uint64_t comp_off;
+  uint32_t comp_size;
+  uint32_t orig_size;
+} zyphrax_seek_entry_t;
+
+// Size of the seek table block for count entries
+size_t zyphrax_seek_table_size(size_t count);
+
+// Writes the seek table block. Returns bytes written, or 0 if dst_cap is
+// too small.
+size_t zyphrax_write_seek_table(const zyphrax_seek_entry_t *entries,
+                                size_t count, uint8_t *dst, size_t dst_cap);
+
+// Same, with the entries read back from the block headers already written
+// at frame[begin, end) rather than from an array (frame offsets are
+// relative to frame). Returns bytes written, or 0 on error.
+size_t zyphrax_write_seek_table_scan(const uint8_t *frame, size_t begin,
+                                     size_t end, size_t block_size,
+                                     uint8_t *dst, size_t dst_cap);
+
+// Locates the seek table of the frame at src, which must end src. On success
+// *entries points to an array of *count entries from alloc (caller frees).
+// Returns 0 on success, -1 if the frame has no valid seek table (or more
+// frames follow it).
+int zyphrax_read_seek_table(const uint8_t *src, size_t src_size,
+                            zyphrax_seek_entry_t **entries, size_t *count,
+                            const zyphrax_allocator_t *alloc);
+
+// Seek entries of the frame at src (parsed into frame): from its seek table,
+// or by walking its block headers when it has none or more frames follow it.
+// Same ownership as zyphrax_read_seek_table. Returns 0, or -1 on error.
+int zyphrax_frame_entries(const uint8_t *src, size_t src_size,
+                          const zyphrax_frame_t *frame,
+                          zyphrax_seek_entry_t **entries, size_t *count,
+                          const zyphrax_allocator_t *alloc);
+
+// zyphrax_decompress_range on ws, with the block index and the scratch block
+// from alloc
+size_t zyphrax_decompress_range_ws(zyphrax_dec_ws_t *ws,
+                                   const uint8_t *src, size_t src_size,
+                                   uint64_t offset, size_t len, uint8_t *dst,
+                                   const zyphrax_allocator_t *alloc);
@@ -0,0 +1,178 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// -------------------------------------------------------------------------
+// Segment Windows
+// -------------------------------------------------------------------------
+// Scattered input and output (zyphrax_compressv, zyphrax_decompressv) are
+// coded where they lie. A window is a range of a buffer split over the
+// caller's segments, addressed by position as if it were contiguous, so the
+// match finder reaches back across segments and the decoders write across
+// them. A table gives, per granule of 2^shift bytes, the first segment
+// holding one of them. Granules are no larger than the smallest segment, so
+// finding the segment of a position costs a load and at most one step.
+// Sequential access goes a segment-sized run at a time. A window that lies
+// in one segment has no table; plain buffers are such windows, and the
+// coders take their pointer paths on them.
+
+typedef struct {
+  uint8_t *ptr;
+  size_t len;
+  uint64_t off; // Of ptr[0] in the buffer
+} zyphrax_seg_t;
+
+typedef struct {
+  const zyphrax_seg_t *seg; // Table entries count from here; holds the
+                            // whole window when there is no table
+  const uint32_t *table;    // NULL for a window inside one segment
+  uint64_t origin;          // Buffer offset of the first granule
+  uint64_t base;            // Buffer offset of position 0
+  size_t size;
+  unsigned shift; // Granule size (log2)
+} zyphrax_segs_t;
+
+// Window over the plain buffer p, described by seg (which must outlive it)
+static inline void zyphrax_segs_plain(zyphrax_segs_t *w, zyphrax_seg_t *seg,
+                                      const uint8_t *p, size_t size) {
+  seg->ptr = (uint8_t *)p;
+  seg->len = size;
+  seg->off = 0;
+  w->seg = seg;
+  w->table = NULL;
+  w->origin = 0;
+  w->base = 0;
+  w->size = size;
+  w->shift = 0;
+}
+
+// [pos, pos + size) of w, as a window of its own
+static inline zyphrax_segs_t zyphrax_segs_sub(const zyphrax_segs_t *w,
+                                              size_t pos, size_t size) {
+  zyphrax_segs_t sub = *w;
+  sub.base += pos;
+  sub.size = size;
+  return sub;
+}
+
+// Position pos (< size) of w; *run gets the bytes from there to the end of
+// its segment or of the window, whichever comes first
+static inline uint8_t *zyphrax_segs_at(const zyphrax_segs_t *w, size_t pos,
+                                       size_t *run) {
+  uint64_t at = w->base + pos;
+  const zyphrax_seg_t *s = w->seg;
+  if (w->table) {
+    s += w->table[(at - w->origin) >> w->shift];
+    if (at - s->off >= s->len)
+      s++;
+  }
+  size_t in = (size_t)(at - s->off);
+  size_t left = w->size - pos;
+  *run = s->len - in < left ? s->len - in : left;
+  return s->ptr + in;
+}
+
+// The window as a plain pointer when it lies in one segment, else NULL
+static inline uint8_t *zyphrax_segs_flat(const zyphrax_segs_t *w) {
+  if (!w->table)
+    return w->seg->ptr ? w->seg->ptr + (size_t)(w->base - w->seg->off)
+                       : NULL;
+  size_t run;
+  uint8_t *p = zyphrax_segs_at(w, 0, &run);
+  return run == w->size ? p : NULL;
+}
+
+// The last run looked up, for accesses that mostly stay close together
+typedef struct {
+  uint8_t *p;
+  size_t lo, hi; // Window positions p covers
+} zyphrax_segs_run_t;
+
+// n contiguous bytes at pos through c, or NULL if they span segments (or
+// pass the end of the window)
+static inline uint8_t *zyphrax_segs_get(const zyphrax_segs_t *w,
+                                        zyphrax_segs_run_t *c, size_t pos,
+                                        size_t n) {
+  if (pos < c->lo || pos >= c->hi) {
+    if (pos >= w->size)
+      return NULL;
+    size_t run;
+    c->p = zyphrax_segs_at(w, pos, &run);
+    c->lo = pos;
+    c->hi = pos + run;
+  }
+  return n <= c->hi - pos ? c->p + (pos - c->lo) : NULL;
+}
+
+// Copies n bytes at pos of w out to dst
+static inline void zyphrax_segs_read(const zyphrax_segs_t *w, size_t pos,
+                                     void *dst, size_t n) {
+  uint8_t *d = (uint8_t *)dst;
+  while (n) {
+    size_t run;
+    const uint8_t *p = zyphrax_segs_at(w, pos, &run);
+    size_t k = run < n ? run : n;
+    memcpy(d, p, k);
+    d += k;
+    pos += k;
+    n -= k;
+  }
+}
+
+// Copies n bytes from src to pos of w
+static inline void zyphrax_segs_write(const zyphrax_segs_t *w, size_t pos,
+                                      const void *src, size_t n) {
+  const uint8_t *s = (const uint8_t *)src;
+  while (n) {
+    size_t run;
+    uint8_t *p = zyphrax_segs_at(w, pos, &run);
+    size_t k = run < n ? run : n;
+    memcpy(p, s, k);
+    s += k;
+    pos += k;
+    n -= k;
+  }
+}
+
+// Copies n bytes from src_pos of src to dst_pos of dst (different buffers)
+static inline void zyphrax_segs_copy(const zyphrax_segs_t *dst,
+                                     size_t dst_pos,
+                                     const zyphrax_segs_t *src,
+                                     size_t src_pos, size_t n) {
+  while (n) {
+    size_t rd, rs;
+    uint8_t *d = zyphrax_segs_at(dst, dst_pos, &rd);
+    const uint8_t *s = zyphrax_segs_at(src, src_pos, &rs);
+    size_t k = n < rd ? n : rd;
+    if (rs < k)
+      k = rs;
+    memcpy(d, s, k);
+    dst_pos += k;
+    src_pos += k;
+    n -= k;
+  }
+}
+
+// LZ match: len bytes copied to pos from offset bytes back, front to back,
+// so a match may overlap what it writes
+static inline void zyphrax_segs_repeat(const zyphrax_segs_t *w, size_t pos,
+                                       size_t offset, size_t len) {
+  while (len) {
+    size_t rd, rs;
+    uint8_t *d = zyphrax_segs_at(w, pos, &rd);
+    const uint8_t *s = zyphrax_segs_at(w, pos - offset, &rs);
+    size_t k = len < rd ? len : rd;
+    if (rs < k)
+      k = rs;
+    if (k <= offset) {
+      memcpy(d, s, k);
+    } else {
+      // Overlapping, so within one segment
+      for (size_t i = 0; i < k; i++)
+        d[i] = s[i];
+    }
+    pos += k;
+    len -= k;
+  }
+}
@@ -15,11 +15,9 @@ typedef struct {
   zyphrax_match_t match; // offset, length
 } zyphrax_sequence_t;
 
-// Encodes a sequence into destination buffer.
-// Returns bytes written.
-// Note: This does NOT check output bounds thoroughly for performance, caller
-// must ensure dst_cap is sufficient. (In a robust implementation, we check.
-// Here we should check.)
+// Encodes a sequence into destination buffer (LZ blocks, level 1). A
+// sequence without a match (length < 4) must be the last of its block.
+// Returns bytes written, or 0 if out_cap is too small.
 size_t zyphrax_encode_sequence(const zyphrax_sequence_t *seq, uint8_t *out,
                                size_t out_cap);
 
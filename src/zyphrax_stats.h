@@ -0,0 +1,71 @@
+#pragma once
+#include "zyphrax.h"
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+// Statistics plumbing (see zyphrax_stats_t)
+// The block coders add what they do to a block record (their workspace's
+// stats pointer, NULL when off); whoever drives them passes each finished
+// record on to the context's sink.
+
+typedef struct {
+  int on;
+  zyphrax_stats_fn fn;
+  void *opaque;
+  zyphrax_stats_t block; // Record of the block in progress
+  zyphrax_stats_t total; // Since the start of the current call
+} zyphrax_stats_sink_t;
+
+static inline uint64_t zyphrax_stats_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Adds the counters of b to a (mem_peak: the larger of the two)
+static inline void zyphrax_stats_add(zyphrax_stats_t *a,
+                                     const zyphrax_stats_t *b) {
+  a->blocks += b->blocks;
+  a->raw_blocks += b->raw_blocks;
+  a->src_bytes += b->src_bytes;
+  a->dst_bytes += b->dst_bytes;
+  a->table_bytes += b->table_bytes;
+  a->sequences += b->sequences;
+  a->matches += b->matches;
+  a->literal_bytes += b->literal_bytes;
+  a->match_bytes += b->match_bytes;
+  a->searches += b->searches;
+  a->chain_steps += b->chain_steps;
+  a->parse_ns += b->parse_ns;
+  a->tables_ns += b->tables_ns;
+  a->coding_ns += b->coding_ns;
+  a->checksum_ns += b->checksum_ns;
+  if (b->mem_peak > a->mem_peak)
+    a->mem_peak = b->mem_peak;
+}
+
+static inline void zyphrax_stats_set(zyphrax_stats_sink_t *sink, int enable,
+                                     zyphrax_stats_fn fn, void *opaque) {
+  sink->on = enable != 0;
+  sink->fn = enable ? fn : NULL;
+  sink->opaque = opaque;
+  memset(&sink->block, 0, sizeof(sink->block));
+  memset(&sink->total, 0, sizeof(sink->total));
+}
+
+// Starts a call: totals from zero, the context's memory as the peak so far
+static inline void zyphrax_stats_begin(zyphrax_stats_sink_t *sink,
+                                       uint64_t mem) {
+  memset(&sink->block, 0, sizeof(sink->block));
+  memset(&sink->total, 0, sizeof(sink->total));
+  sink->total.mem_peak = mem;
+}
+
+// Hands one finished record to the callback and the totals
+static inline void zyphrax_stats_done(zyphrax_stats_sink_t *sink,
+                                      const zyphrax_stats_t *block) {
+  if (sink->fn)
+    sink->fn(block, sink->opaque);
+  zyphrax_stats_add(&sink->total, block);
+}
@@ -0,0 +1,1109 @@
+#include "zyphrax.h"
+#include "zyphrax_block.h"
+#include "zyphrax_frame.h"
+#include "zyphrax_hash.h"
+#include "zyphrax_queue.h"
+#include "zyphrax_seek.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+// Slack on top of block_size for the encoded block: raw fallback costs
+// ZYPHRAX_BLOCK_HDR_RAW (+ ZYPHRAX_BLOCK_SUM_SIZE), per block of a split.
+#define CSTREAM_OUT_SLACK 64
+
+// -------------------------------------------------------------------------
+// Streaming Compression
+// -------------------------------------------------------------------------
+// Input is cut into blocks held in a ring of slots. Slots [tail, head) are
+// submitted blocks in frame order; slot head is the one being filled. A slot
+// is compressed in place (single-threaded) or queued to the workers
+// (pipelined), and the writer side hands encoded slots out in order from
+// tail. Memory: nb_slots * 2 blocks + one match finder per worker.
+//
+// Pipelining: the caller thread reads input into slots and writes finished
+// blocks out, workers pull slot indices from a lock-free queue. The mutex and
+// condition variables are only touched to sleep and wake.
+
+enum { SLOT_FREE, SLOT_BUSY, SLOT_DONE, SLOT_ERROR };
+
+typedef struct {
+  uint8_t *in;
+  size_t in_len;
+  uint8_t *out;
+  size_t out_len;
+  int level;     // Adaptive: level used (0 = stored), -1 = params.level
+  uint64_t nsec; // Adaptive: time the worker took
+  atomic_int state;
+} cstream_slot_t;
+
+typedef struct {
+  zyphrax_cstream_t *cs;
+  unsigned id;
+} cstream_worker_t;
+
+// Adaptive level state, only touched by the caller thread
+typedef struct {
+  int on;
+  unsigned level; // For the next block
+  unsigned min_level, max_level;
+  uint64_t budget;                      // ns per KiB of input, 0 = none
+  uint64_t cost[ZYPHRAX_LEVEL_MAX + 1]; // Measured ns per KiB, 0 = unknown
+  int64_t credit;                       // ns ahead of the budget
+  int stalled;                          // Input waited for a free slot
+  uint64_t idle_ns;                     // Worker idle time at the last pick
+  uint64_t time;                        // Time of the last pick
+} cstream_adapt_t;
+
+struct zyphrax_cstream_s {
+  zyphrax_params_t params;
+  size_t out_cap; // Per-slot encoded buffer
+
+  cstream_slot_t *slots;
+  size_t nb_slots;
+  uint64_t head;  // Slot being filled
+  uint64_t tail;  // Next slot to write out
+  size_t out_pos; // Bytes of slot tail already written
+  int recorded;   // Slot tail entered in the seek table
+
+  // Header / trailer (checksum block, seek table) bytes waiting to be written
+  uint8_t hdr[ZYPHRAX_HEADER_SIZE + ZYPHRAX_CONTENT_SIZE_FIELD];
+  uint8_t *extra;
+  size_t extra_len;
+  size_t extra_pos;
+  uint8_t *table;
+
+  zyphrax_frame_sum_t sum; // Over the blocks written out so far
+
+  uint64_t frame_pos; // Frame bytes produced so far (next block offset)
+  uint64_t consumed;  // Input bytes taken so far
+  uint64_t pledged;   // Promised total, ZYPHRAX_CONTENT_SIZE_ERROR if none
+
+  zyphrax_seek_entry_t *seek;
+  size_t seek_count;
+  size_t seek_cap;
+
+  int ended;
+
+  cstream_adapt_t adapt;
+
+  // Workers: ws[0] doubles as the caller's workspace when single-threaded
+  unsigned nb_workers;
+  zyphrax_block_ws_t *ws;
+  pthread_t *threads;
+  cstream_worker_t *worker_args;
+  unsigned nb_threads;
+  zyphrax_queue_t queue;
+  pthread_mutex_t lock;
+  pthread_cond_t work_cv; // Blocks queued or shutdown
+  pthread_cond_t done_cv; // A block finished
+  int shutdown;
+  atomic_uint_fast64_t idle_ns; // Time workers spent waiting for blocks
+};
+
+static uint64_t cstream_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Codes src into dst (slot->out, or the caller's output when written
+// directly); slot->out_len gets the encoded size
+static void cstream_compress_slot(zyphrax_cstream_t *cs, cstream_slot_t *slot,
+                                  const uint8_t *src, size_t size,
+                                  uint8_t *dst, size_t dst_cap,
+                                  zyphrax_block_ws_t *ws) {
+  if (slot->level < 0) {
+    slot->out_len = zyphrax_compress_block_ws(ws, src, size, dst, dst_cap,
+                                              &cs->params);
+  } else {
+    // Adaptive: the tier picked at submit, timed for the controller
+    uint64_t start = cstream_now();
+    if (slot->level == 0)
+      slot->out_len = zyphrax_store_block(src, size, dst, dst_cap,
+                                          &cs->params);
+    else
+      slot->out_len = zyphrax_compress_block_tier(
+          ws, src, size, dst, dst_cap, &cs->params, (uint32_t)slot->level);
+    slot->nsec = cstream_now() - start;
+  }
+  atomic_store_explicit(&slot->state,
+                        slot->out_len ? SLOT_DONE : SLOT_ERROR,
+                        memory_order_release);
+}
+
+static void *cstream_worker_main(void *arg) {
+  cstream_worker_t *w = (cstream_worker_t *)arg;
+  zyphrax_cstream_t *cs = w->cs;
+
+  for (;;) {
+    size_t idx;
+    if (!zyphrax_queue_pop(&cs->queue, &idx)) {
+      uint64_t start = cstream_now();
+      pthread_mutex_lock(&cs->lock);
+      int got;
+      while (!(got = zyphrax_queue_pop(&cs->queue, &idx)) && !cs->shutdown)
+        pthread_cond_wait(&cs->work_cv, &cs->lock);
+      pthread_mutex_unlock(&cs->lock);
+      atomic_fetch_add_explicit(&cs->idle_ns, cstream_now() - start,
+                                memory_order_relaxed);
+      if (!got)
+        return NULL; // Shutdown with nothing left
+    }
+
+    cstream_slot_t *slot = &cs->slots[idx];
+    cstream_compress_slot(cs, slot, slot->in, slot->in_len, slot->out,
+                          cs->out_cap, &cs->ws[w->id]);
+
+    pthread_mutex_lock(&cs->lock);
+    pthread_cond_broadcast(&cs->done_cv);
+    pthread_mutex_unlock(&cs->lock);
+  }
+}
+
+zyphrax_cstream_t *zyphrax_cstream_init(const zyphrax_params_t *params) {
+  return zyphrax_cstream_init_mt(params, 1, 1);
+}
+
+zyphrax_cstream_t *zyphrax_cstream_init_mt(const zyphrax_params_t *params,
+                                           unsigned nb_workers,
+                                           unsigned max_in_flight) {
+  if (params->checksum > ZYPHRAX_CHECKSUM_XXH32)
+    return NULL;
+  zyphrax_cstream_t *cs = calloc(1, sizeof(*cs));
+  if (!cs)
+    return NULL;
+
+  cs->params = *params;
+  if (cs->params.block_size == 0)
+    cs->params.block_size = ZYPHRAX_BLOCK_SIZE;
+  if (cs->params.block_size > 0xFFFFFF)
+    cs->params.block_size = 0xFFFFFF; // Header field is 24-bit
+  cs->params.flags &= ~ZYPHRAX_FLAG_CONTENT_SIZE;
+
+  if (nb_workers == 0)
+    nb_workers = 1;
+  if (max_in_flight == 0)
+    max_in_flight = 2 * nb_workers;
+  cs->nb_workers = nb_workers;
+  // Slot head is filled while max_in_flight blocks are in the pipeline
+  cs->nb_slots = nb_workers > 1 ? (size_t)max_in_flight + 1 : 1;
+
+  size_t block_size = cs->params.block_size;
+  cs->out_cap = block_size + CSTREAM_OUT_SLACK;
+  cs->slots = calloc(cs->nb_slots, sizeof(*cs->slots));
+  cs->ws = calloc(nb_workers, sizeof(*cs->ws));
+  pthread_mutex_init(&cs->lock, NULL);
+  pthread_cond_init(&cs->work_cv, NULL);
+  pthread_cond_init(&cs->done_cv, NULL);
+  atomic_init(&cs->idle_ns, 0);
+  if (!cs->slots || !cs->ws)
+    goto fail;
+
+  for (size_t i = 0; i < cs->nb_slots; i++) {
+    cs->slots[i].in = malloc(block_size);
+    cs->slots[i].out = malloc(cs->out_cap);
+    atomic_init(&cs->slots[i].state, SLOT_FREE);
+    if (!cs->slots[i].in || !cs->slots[i].out)
+      goto fail;
+  }
+  for (unsigned i = 0; i < nb_workers; i++) {
+    if (zyphrax_block_ws_init(&cs->ws[i], block_size, NULL) != 0)
+      goto fail;
+  }
+
+  if (nb_workers > 1) {
+    cs->threads = calloc(nb_workers, sizeof(*cs->threads));
+    cs->worker_args = calloc(nb_workers, sizeof(*cs->worker_args));
+    if (!cs->threads || !cs->worker_args ||
+        zyphrax_queue_init(&cs->queue, cs->nb_slots) != 0)
+      goto fail;
+    for (unsigned i = 0; i < nb_workers; i++) {
+      cs->worker_args[i].cs = cs;
+      cs->worker_args[i].id = i;
+      if (pthread_create(&cs->threads[i], NULL, cstream_worker_main,
+                         &cs->worker_args[i]) != 0)
+        goto fail;
+      cs->nb_threads = i + 1;
+    }
+  }
+
+  // The header goes out with the first drain
+  zyphrax_write_header_internal(cs->hdr, &cs->params);
+  cs->extra = cs->hdr;
+  cs->extra_len = ZYPHRAX_HEADER_SIZE;
+  cs->frame_pos = ZYPHRAX_HEADER_SIZE;
+  cs->pledged = ZYPHRAX_CONTENT_SIZE_ERROR;
+  zyphrax_frame_sum_init(&cs->sum, (int)cs->params.checksum);
+  return cs;
+
+fail:
+  zyphrax_cstream_free(cs);
+  return NULL;
+}
+
+void zyphrax_cstream_free(zyphrax_cstream_t *cs) {
+  if (!cs)
+    return;
+
+  if (cs->nb_threads) {
+    pthread_mutex_lock(&cs->lock);
+    cs->shutdown = 1;
+    pthread_cond_broadcast(&cs->work_cv);
+    pthread_mutex_unlock(&cs->lock);
+    for (unsigned i = 0; i < cs->nb_threads; i++)
+      pthread_join(cs->threads[i], NULL);
+  }
+  zyphrax_queue_free(&cs->queue);
+  pthread_mutex_destroy(&cs->lock);
+  pthread_cond_destroy(&cs->work_cv);
+  pthread_cond_destroy(&cs->done_cv);
+
+  if (cs->ws) {
+    for (unsigned i = 0; i < cs->nb_workers; i++)
+      zyphrax_block_ws_free(&cs->ws[i], NULL);
+  }
+  if (cs->slots) {
+    for (size_t i = 0; i < cs->nb_slots; i++) {
+      free(cs->slots[i].in);
+      free(cs->slots[i].out);
+    }
+  }
+  free(cs->ws);
+  free(cs->slots);
+  free(cs->threads);
+  free(cs->worker_args);
+  free(cs->table);
+  free(cs->seek);
+  free(cs);
+}
+
+static cstream_slot_t *cstream_slot(zyphrax_cstream_t *cs, uint64_t n) {
+  return &cs->slots[n % cs->nb_slots];
+}
+
+// Blocks until slot tail is no longer being compressed
+static void cstream_wait_tail(zyphrax_cstream_t *cs) {
+  cstream_slot_t *slot = cstream_slot(cs, cs->tail);
+  if (atomic_load_explicit(&slot->state, memory_order_acquire) != SLOT_BUSY)
+    return;
+  pthread_mutex_lock(&cs->lock);
+  while (atomic_load_explicit(&slot->state, memory_order_acquire) == SLOT_BUSY)
+    pthread_cond_wait(&cs->done_cv, &cs->lock);
+  pthread_mutex_unlock(&cs->lock);
+}
+
+// The len bytes at out hold one block, or several when
+// ZYPHRAX_FLAG_SPLIT_BLOCKS cut the slot's input
+static int cstream_record(zyphrax_cstream_t *cs, const uint8_t *out,
+                          size_t len) {
+  if ((cs->params.flags & ZYPHRAX_FLAG_SEEK_TABLE) ||
+      cs->params.checksum != ZYPHRAX_CHECKSUM_NONE) {
+    zyphrax_block_info_t info;
+    for (size_t pos = 0; pos < len; pos += info.hdr_size + info.comp_size) {
+      if (zyphrax_read_block_info(out + pos, len - pos,
+                                  cs->params.block_size, &info) != 0 ||
+          zyphrax_frame_sum_block(&cs->sum, out + pos, &info) != 0)
+        return -1;
+      if (!(cs->params.flags & ZYPHRAX_FLAG_SEEK_TABLE))
+        continue;
+      if (cs->seek_count == cs->seek_cap) {
+        size_t cap = cs->seek_cap ? cs->seek_cap * 2 : 64;
+        zyphrax_seek_entry_t *seek = realloc(cs->seek, cap * sizeof(*seek));
+        if (!seek)
+          return -1;
+        cs->seek = seek;
+        cs->seek_cap = cap;
+      }
+      cs->seek[cs->seek_count].comp_off = cs->frame_pos + pos;
+      cs->seek[cs->seek_count].comp_size =
+          (uint32_t)(info.hdr_size + info.comp_size);
+      cs->seek[cs->seek_count].orig_size = (uint32_t)info.orig_size;
+      cs->seek_count++;
+    }
+  }
+  cs->frame_pos += len;
+  return 0;
+}
+
+// -------------------------------------------------------------------------
+// Adaptive Level
+// -------------------------------------------------------------------------
+// Each finished block updates a running cost (ns per KiB) for the level it
+// used, and each submitted block moves the level by at most one step.
+//
+// With a budget, finished blocks also settle an account: credit for the time
+// the budget allowed, debit for the time taken, capped at one block per
+// worker so quiet periods cannot be banked. The level steps down while the
+// account is overdrawn and up while it is in credit and the current level
+// costs no more than the budget. It settles on the highest level that keeps
+// the promised speed, alternating with the level above when that one is
+// only a little too slow, so the average lands on the budget.
+//
+// When pipelined, workers waiting for input mean the input is slower than
+// the budget assumed: the level climbs past it and the debt is forgiven,
+// until the workers are busy again. Without a budget only this backlog
+// counts: up while workers wait, down while the input waits for a slot.
+
+// Workers idle for more than 1/CSTREAM_ADAPT_IDLE of the time since the last
+// block was submitted have capacity to spare
+#define CSTREAM_ADAPT_IDLE 8
+
+static void cstream_adapt_record(zyphrax_cstream_t *cs,
+                                 const cstream_slot_t *slot) {
+  cstream_adapt_t *a = &cs->adapt;
+  if (slot->level < 0 || slot->in_len == 0)
+    return;
+  uint64_t *cost = &a->cost[slot->level];
+  uint64_t c = slot->nsec * 1024 / slot->in_len + 1;
+  *cost = *cost ? (3 * *cost + c) / 4 : c;
+
+  if (a->budget) {
+    int64_t cap = (int64_t)(a->budget * cs->params.block_size / 1024) *
+                  cs->nb_workers;
+    a->credit += (int64_t)(a->budget * slot->in_len / 1024) -
+                 (int64_t)slot->nsec;
+    if (a->credit > cap)
+      a->credit = cap;
+  }
+}
+
+// Level for the block about to be submitted, -1 if not adaptive
+static int cstream_adapt_pick(zyphrax_cstream_t *cs) {
+  cstream_adapt_t *a = &cs->adapt;
+  if (!a->on)
+    return -1;
+
+  int idle = 0;
+  if (cs->nb_threads) {
+    uint64_t now = cstream_now();
+    uint64_t idle_ns = atomic_load_explicit(&cs->idle_ns,
+                                            memory_order_relaxed);
+    idle = (idle_ns - a->idle_ns) * CSTREAM_ADAPT_IDLE > now - a->time;
+    a->idle_ns = idle_ns;
+    a->time = now;
+  }
+
+  unsigned level = a->level;
+  int up, down;
+  if (idle) {
+    up = 1;
+    down = 0;
+    if (a->credit < 0)
+      a->credit = 0;
+  } else if (a->budget) {
+    down = a->credit < 0;
+    up = a->credit > 0 && a->cost[level] && a->cost[level] <= a->budget;
+  } else {
+    down = a->stalled;
+    up = !cs->nb_threads; // Caller's own thread: nothing to keep up with
+  }
+
+  if (down && level > a->min_level)
+    level--;
+  else if (up && !down && level < a->max_level)
+    level++;
+  a->level = level;
+  a->stalled = 0;
+  return (int)level;
+}
+
+size_t zyphrax_cstream_set_adaptive(zyphrax_cstream_t *cs,
+                                    const zyphrax_adaptive_t *adapt) {
+  cstream_adapt_t *a = &cs->adapt;
+  if (!adapt) {
+    a->on = 0;
+    return 0;
+  }
+
+  unsigned max_level = adapt->max_level ? adapt->max_level : ZYPHRAX_LEVEL_MAX;
+  if (max_level > ZYPHRAX_LEVEL_MAX || adapt->min_level > max_level)
+    return ZYPHRAX_STREAM_ERROR;
+
+  // Both limits as a cost per KiB for one worker; the tighter one wins
+  uint64_t budget = 0;
+  if (adapt->target_speed)
+    budget = max(1024 * 1000000000ull * cs->nb_workers / adapt->target_speed,
+                 1);
+  if (adapt->max_block_usec) {
+    uint64_t b = max((uint64_t)adapt->max_block_usec * 1000 * 1024 /
+                         cs->params.block_size,
+                     1);
+    if (budget == 0 || b < budget)
+      budget = b;
+  }
+
+  memset(a, 0, sizeof(*a));
+  a->on = 1;
+  a->min_level = adapt->min_level;
+  a->max_level = max_level;
+  a->budget = budget;
+  a->level = min(max(ZYPHRAX_LEVEL_DEFAULT, a->min_level), a->max_level);
+  a->idle_ns = atomic_load_explicit(&cs->idle_ns, memory_order_relaxed);
+  a->time = cstream_now();
+  return 0;
+}
+
+unsigned zyphrax_cstream_level(const zyphrax_cstream_t *cs) {
+  if (cs->adapt.on)
+    return cs->adapt.level;
+  return cs->params.level ? cs->params.level : ZYPHRAX_LEVEL_DEFAULT;
+}
+
+// Writes out whatever is ready, in frame order, without waiting.
+// Returns 0, or -1 if a block failed.
+static int cstream_drain(zyphrax_cstream_t *cs, zyphrax_out_buffer_t *out) {
+  size_t n = min(cs->extra_len - cs->extra_pos, out->size - out->pos);
+  memcpy(out->dst + out->pos, cs->extra + cs->extra_pos, n);
+  out->pos += n;
+  cs->extra_pos += n;
+  if (cs->extra_pos < cs->extra_len)
+    return 0;
+
+  while (cs->tail < cs->head) {
+    cstream_slot_t *slot = cstream_slot(cs, cs->tail);
+    int state = atomic_load_explicit(&slot->state, memory_order_acquire);
+    if (state == SLOT_ERROR)
+      return -1;
+    if (state != SLOT_DONE)
+      return 0; // Still compressing
+    if (!cs->recorded) {
+      if (cstream_record(cs, slot->out, slot->out_len) != 0)
+        return -1;
+      cstream_adapt_record(cs, slot);
+      cs->recorded = 1;
+    }
+
+    n = min(slot->out_len - cs->out_pos, out->size - out->pos);
+    memcpy(out->dst + out->pos, slot->out + cs->out_pos, n);
+    out->pos += n;
+    cs->out_pos += n;
+    if (cs->out_pos < slot->out_len)
+      return 0; // Output full
+
+    slot->in_len = 0;
+    atomic_store_explicit(&slot->state, SLOT_FREE, memory_order_relaxed);
+    cs->out_pos = 0;
+    cs->recorded = 0;
+    cs->tail++;
+  }
+  return 0;
+}
+
+// Bytes still to be written; blocks being compressed count as 1
+static size_t cstream_pending(zyphrax_cstream_t *cs) {
+  size_t pending = cs->extra_len - cs->extra_pos;
+  for (uint64_t i = cs->tail; i < cs->head; i++) {
+    cstream_slot_t *slot = cstream_slot(cs, i);
+    if (atomic_load_explicit(&slot->state, memory_order_acquire) == SLOT_DONE)
+      pending += slot->out_len - (i == cs->tail ? cs->out_pos : 0);
+    else
+      pending += 1;
+  }
+  return pending;
+}
+
+// Single-threaded: codes size bytes of src as the next block straight into
+// the caller's output, when nothing waits to go out before it and there is
+// room for whatever the block encodes to. slot is head, which stays free.
+// Returns 1 if written, 0 if the block has to go through slot, -1 on error.
+static int cstream_direct(zyphrax_cstream_t *cs, cstream_slot_t *slot,
+                          const uint8_t *src, size_t size,
+                          zyphrax_out_buffer_t *out) {
+  size_t cap = size + CSTREAM_OUT_SLACK;
+  if (cs->nb_threads || cs->tail != cs->head ||
+      cs->extra_pos < cs->extra_len || out->size - out->pos < cap)
+    return 0;
+
+  uint8_t *dst = out->dst + out->pos;
+  slot->in_len = size;
+  slot->level = cstream_adapt_pick(cs);
+  cstream_compress_slot(cs, slot, src, size, dst, cap, &cs->ws[0]);
+  int ok = slot->out_len && cstream_record(cs, dst, slot->out_len) == 0;
+  if (ok) {
+    cstream_adapt_record(cs, slot);
+    out->pos += slot->out_len;
+  }
+  slot->in_len = 0;
+  atomic_store_explicit(&slot->state, SLOT_FREE, memory_order_relaxed);
+  return ok ? 1 : -1;
+}
+
+// Hands slot head to a worker (or compresses it now, into out if it can) and
+// opens the next one. Returns 0, or -1 if the block failed.
+static int cstream_submit(zyphrax_cstream_t *cs, zyphrax_out_buffer_t *out) {
+  cstream_slot_t *slot = cstream_slot(cs, cs->head);
+  if (cs->nb_threads == 0) {
+    int direct = cstream_direct(cs, slot, slot->in, slot->in_len, out);
+    if (direct)
+      return direct < 0 ? -1 : 0;
+    slot->level = cstream_adapt_pick(cs);
+    cs->head++;
+    cstream_compress_slot(cs, slot, slot->in, slot->in_len, slot->out,
+                          cs->out_cap, &cs->ws[0]);
+    return 0;
+  }
+
+  slot->level = cstream_adapt_pick(cs);
+  cs->head++;
+
+  atomic_store_explicit(&slot->state, SLOT_BUSY, memory_order_relaxed);
+  // Never full: the queue holds at least nb_slots entries
+  zyphrax_queue_push(&cs->queue, (size_t)(slot - cs->slots));
+  pthread_mutex_lock(&cs->lock);
+  pthread_cond_signal(&cs->work_cv);
+  pthread_mutex_unlock(&cs->lock);
+  return 0;
+}
+
+size_t zyphrax_cstream_pledge_size(zyphrax_cstream_t *cs,
+                                   uint64_t content_size) {
+  // Only while the header has not been handed out
+  if (cs->extra != cs->hdr || cs->extra_pos != 0)
+    return ZYPHRAX_STREAM_ERROR;
+
+  cs->params.flags |= ZYPHRAX_FLAG_CONTENT_SIZE;
+  zyphrax_write_header_internal(cs->hdr, &cs->params);
+  for (int i = 0; i < 8; i++)
+    cs->hdr[ZYPHRAX_HEADER_SIZE + i] = (uint8_t)(content_size >> (8 * i));
+  cs->extra_len = ZYPHRAX_HEADER_SIZE + ZYPHRAX_CONTENT_SIZE_FIELD;
+  cs->frame_pos = cs->extra_len;
+  cs->pledged = content_size;
+  return 0;
+}
+
+size_t zyphrax_cstream_update(zyphrax_cstream_t *cs, zyphrax_out_buffer_t *out,
+                              zyphrax_in_buffer_t *in) {
+  if (cs->ended)
+    return ZYPHRAX_STREAM_ERROR;
+  if (cs->pledged != ZYPHRAX_CONTENT_SIZE_ERROR &&
+      in->size - in->pos > cs->pledged - cs->consumed)
+    return ZYPHRAX_STREAM_ERROR; // More than promised
+
+  size_t block_size = cs->params.block_size;
+  size_t start = in->pos;
+  for (;;) {
+    if (cstream_drain(cs, out) != 0)
+      return ZYPHRAX_STREAM_ERROR;
+    if (in->pos == in->size)
+      break;
+
+    if (cs->head - cs->tail == cs->nb_slots) {
+      // Every slot in flight: wait for the oldest, unless it cannot be
+      // written out anyway
+      if (out->pos == out->size)
+        break;
+      cs->adapt.stalled = 1;
+      cstream_wait_tail(cs);
+      continue;
+    }
+
+    cstream_slot_t *slot = cstream_slot(cs, cs->head);
+    size_t avail = in->size - in->pos;
+    uint64_t left = cs->pledged - cs->consumed - (in->pos - start);
+
+    // Single-threaded and a whole block (or all the input still promised)
+    // in the caller's buffer: encode it where it is, into the caller's
+    // output if there is room
+    if (cs->nb_threads == 0 && slot->in_len == 0 &&
+        (avail >= block_size ||
+         (cs->pledged != ZYPHRAX_CONTENT_SIZE_ERROR && avail == left))) {
+      size_t size = min(avail, block_size);
+      int direct = cstream_direct(cs, slot, in->src + in->pos, size, out);
+      if (direct < 0)
+        return ZYPHRAX_STREAM_ERROR;
+      if (!direct) {
+        slot->in_len = size;
+        slot->level = cstream_adapt_pick(cs);
+        cs->head++;
+        cstream_compress_slot(cs, slot, in->src + in->pos, size, slot->out,
+                              cs->out_cap, &cs->ws[0]);
+      }
+      in->pos += size;
+      continue;
+    }
+
+    size_t take = min(block_size - slot->in_len, avail);
+    memcpy(slot->in + slot->in_len, in->src + in->pos, take);
+    slot->in_len += take;
+    in->pos += take;
+    if (slot->in_len == block_size && cstream_submit(cs, out) != 0)
+      return ZYPHRAX_STREAM_ERROR;
+  }
+  cs->consumed += in->pos - start;
+  return cstream_pending(cs);
+}
+
+size_t zyphrax_cstream_flush(zyphrax_cstream_t *cs, zyphrax_out_buffer_t *out) {
+  if (cs->head - cs->tail < cs->nb_slots &&
+      cstream_slot(cs, cs->head)->in_len > 0 && cstream_submit(cs, out) != 0)
+    return ZYPHRAX_STREAM_ERROR;
+
+  for (;;) {
+    if (cstream_drain(cs, out) != 0)
+      return ZYPHRAX_STREAM_ERROR;
+    if (cs->tail == cs->head || out->pos == out->size)
+      break;
+    cstream_wait_tail(cs);
+  }
+
+  // A partial block that found no free slot goes out on the next call
+  size_t pending = cstream_pending(cs);
+  if (pending == 0 && cstream_slot(cs, cs->head)->in_len > 0)
+    return zyphrax_cstream_flush(cs, out);
+  return pending;
+}
+
+size_t zyphrax_cstream_end(zyphrax_cstream_t *cs, zyphrax_out_buffer_t *out) {
+  if (cs->ended) {
+    if (cstream_drain(cs, out) != 0)
+      return ZYPHRAX_STREAM_ERROR;
+    return cstream_pending(cs);
+  }
+
+  if (cs->pledged != ZYPHRAX_CONTENT_SIZE_ERROR &&
+      cs->consumed != cs->pledged)
+    return ZYPHRAX_STREAM_ERROR; // Header would lie
+
+  size_t pending = zyphrax_cstream_flush(cs, out);
+  if (pending != 0)
+    return pending; // Still flushing (or error)
+
+  cs->ended = 1;
+  int sum = cs->params.checksum != ZYPHRAX_CHECKSUM_NONE;
+  int table = (cs->params.flags & ZYPHRAX_FLAG_SEEK_TABLE) != 0;
+  if (sum || table) {
+    size_t size = (sum ? ZYPHRAX_SUM_BLOCK_SIZE : 0) +
+                  (table ? zyphrax_seek_table_size(cs->seek_count) : 0);
+    cs->table = malloc(size);
+    if (!cs->table)
+      return ZYPHRAX_STREAM_ERROR;
+    size_t len = sum ? zyphrax_write_frame_sum(&cs->sum, cs->table, size) : 0;
+    if (table) {
+      size_t n = zyphrax_write_seek_table(cs->seek, cs->seek_count,
+                                          cs->table + len, size - len);
+      if (n == 0)
+        return ZYPHRAX_STREAM_ERROR;
+      len += n;
+    }
+    cs->extra = cs->table;
+    cs->extra_len = len;
+    cs->extra_pos = 0;
+  }
+  if (cstream_drain(cs, out) != 0)
+    return ZYPHRAX_STREAM_ERROR;
+  return cstream_pending(cs);
+}
+
+// -------------------------------------------------------------------------
+// Streaming Decompression
+// -------------------------------------------------------------------------
+// Stages: frame header -> (block header -> payload)*. Raw blocks are copied
+// and skippable blocks dropped as their bytes arrive (PASS); compressed
+// blocks are collected in in_buf, decoded into out_buf and drained. A whole
+// compressed block in the caller's input is decoded from there, and a block
+// whose output fits in the caller's buffer is decoded into it, each saving
+// one of the copies.
+// In checksummed frames raw blocks are hashed as they pass and the frame's
+// checksum block is collected like a compressed one.
+// A frame ends where a block would start with a frame magic; the stream goes
+// back to HEADER for the next frame, passing skippable frames like skippable
+// blocks.
+
+enum { DS_HEADER, DS_BLOCK, DS_PASS, DS_PAYLOAD, DS_ERROR };
+
+struct zyphrax_dstream_s {
+  int stage;
+  zyphrax_frame_t frame;
+  uint8_t hdr[ZYPHRAX_HEADER_SIZE + ZYPHRAX_CONTENT_SIZE_FIELD];
+  size_t hdr_len;
+
+  uint8_t *in_buf; // Block header + compressed payload
+  size_t in_cap;
+  size_t in_len;
+  size_t in_need;
+  zyphrax_block_info_t info;
+
+  uint8_t *out_buf; // Decoded block not yet handed out
+  size_t out_len;
+  size_t out_pos;
+
+  uint64_t pass_left; // Raw / skippable bytes left in the current block
+  int pass_copy;      // 0 = skippable (drop)
+  int pass_implicit;  // Legacy raw block: may end with the frame
+  int pass_frame;     // Skippable frame: HEADER follows
+  zyphrax_hash_t pass_hash; // Of the raw bytes, when the block has a checksum
+
+  zyphrax_frame_sum_t sum;
+  uint64_t produced; // By the current frame
+  int frames;        // Frames and skippable frames completed
+};
+
+static uint32_t read_u32_le(const uint8_t *p) {
+  return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+zyphrax_dstream_t *zyphrax_dstream_init(void) {
+  zyphrax_dstream_t *ds = calloc(1, sizeof(*ds));
+  if (!ds)
+    return NULL;
+  ds->stage = DS_HEADER;
+  return ds;
+}
+
+void zyphrax_dstream_free(zyphrax_dstream_t *ds) {
+  if (!ds)
+    return;
+  free(ds->in_buf);
+  free(ds->out_buf);
+  free(ds);
+}
+
+static size_t dstream_fail(zyphrax_dstream_t *ds) {
+  ds->stage = DS_ERROR;
+  return ZYPHRAX_STREAM_ERROR;
+}
+
+// Moves up to need - *len bytes of input into buf. Returns 1 once complete.
+static int dstream_gather(uint8_t *buf, size_t *len, size_t need,
+                          zyphrax_in_buffer_t *in) {
+  size_t take = min(need - *len, in->size - in->pos);
+  memcpy(buf + *len, in->src + in->pos, take);
+  *len += take;
+  in->pos += take;
+  return *len == need;
+}
+
+// Accounts decoded bytes against the stored content size
+static int dstream_produce(zyphrax_dstream_t *ds, size_t n) {
+  ds->produced += n;
+  return (ds->frame.content_size != ZYPHRAX_CONTENT_SIZE_ERROR &&
+          ds->produced > ds->frame.content_size)
+             ? -1
+             : 0;
+}
+
+// Header bytes needed so far: the magic tells a frame from a skippable
+// frame, a frame's fixed part whether optional fields follow. 0 if invalid.
+static size_t dstream_header_need(const zyphrax_dstream_t *ds) {
+  if (ds->hdr_len < 4)
+    return 4;
+  if (zyphrax_frame_word(ds->hdr) == ZYPHRAX_SKIPPABLE_MAGIC)
+    return ZYPHRAX_SKIPPABLE_HEADER_SIZE;
+  if (ds->hdr_len < ZYPHRAX_HEADER_SIZE)
+    return ZYPHRAX_HEADER_SIZE;
+  zyphrax_params_t params;
+  if (zyphrax_read_header_internal(ds->hdr, &params) != 0)
+    return 0;
+  return zyphrax_frame_header_size(&params);
+}
+
+static int dstream_header(zyphrax_dstream_t *ds) {
+  if (zyphrax_read_frame_internal(ds->hdr, ds->hdr_len, &ds->frame) != 0)
+    return -1;
+
+  // One compressed block never exceeds block_size (else it is stored raw)
+  size_t block_size = ds->frame.params.block_size;
+  free(ds->in_buf);
+  free(ds->out_buf);
+  ds->in_cap =
+      block_size + ZYPHRAX_BLOCK_HDR_COMPRESSED + ZYPHRAX_BLOCK_SUM_SIZE;
+  ds->in_buf = malloc(ds->in_cap);
+  ds->out_buf = malloc(block_size ? block_size : 1);
+  if (!ds->in_buf || !ds->out_buf)
+    return -1;
+  zyphrax_frame_sum_init(&ds->sum, (int)ds->frame.params.checksum);
+  ds->produced = 0;
+  return 0;
+}
+
+// 1 while the frame still owes data: content the header promised or the
+// checksum block
+static int dstream_frame_open(const zyphrax_dstream_t *ds) {
+  return (ds->frame.content_size != ZYPHRAX_CONTENT_SIZE_ERROR &&
+          ds->produced < ds->frame.content_size) ||
+         zyphrax_frame_sum_end(&ds->sum) != 0;
+}
+
+// Size of the block header starting with byte b, 0 if the type is unknown
+static size_t dstream_block_hdr_size(uint8_t b) {
+  int kind = b >> ZYPHRAX_BLOCK_SUM_SHIFT;
+  switch (b & ZYPHRAX_BLOCK_TYPE_MASK) {
+  case ZYPHRAX_BLOCK_RAW_IMPLICIT:
+    return kind ? 0 : 1;
+  case ZYPHRAX_BLOCK_COMPRESSED:
+  case ZYPHRAX_BLOCK_LZ:
+    if (kind > ZYPHRAX_CHECKSUM_XXH32)
+      return 0;
+    return ZYPHRAX_BLOCK_HDR_COMPRESSED + (kind ? ZYPHRAX_BLOCK_SUM_SIZE : 0);
+  case ZYPHRAX_BLOCK_RAW:
+    if (kind > ZYPHRAX_CHECKSUM_XXH32)
+      return 0;
+    return ZYPHRAX_BLOCK_HDR_RAW + (kind ? ZYPHRAX_BLOCK_SUM_SIZE : 0);
+  case ZYPHRAX_BLOCK_SKIPPABLE:
+    return kind ? 0 : ZYPHRAX_BLOCK_HDR_SKIPPABLE;
+  default:
+    return 0;
+  }
+}
+
+// End of a passed block: raw bytes must match the block's checksum
+static int dstream_pass_end(zyphrax_dstream_t *ds) {
+  if (ds->pass_frame) {
+    ds->pass_frame = 0;
+    ds->frames++;
+    ds->stage = DS_HEADER;
+    return 0;
+  }
+  ds->stage = DS_BLOCK;
+  if (ds->pass_copy && ds->info.sum_kind != ZYPHRAX_CHECKSUM_NONE &&
+      zyphrax_hash_final(&ds->pass_hash) != ds->info.checksum)
+    return -1;
+  return 0;
+}
+
+// Sets up the next stage from a complete block header in in_buf
+static int dstream_block(zyphrax_dstream_t *ds) {
+  const uint8_t *h = ds->in_buf;
+  uint64_t block_size = ds->frame.params.block_size;
+
+  ds->info.type = h[0] & ZYPHRAX_BLOCK_TYPE_MASK;
+  ds->info.hdr_size = ds->in_len;
+  ds->info.sum_kind = h[0] >> ZYPHRAX_BLOCK_SUM_SHIFT;
+  ds->info.checksum = 0;
+  if (ds->info.sum_kind != ZYPHRAX_CHECKSUM_NONE) {
+    ds->info.checksum = read_u32_le(h + ds->in_len - ZYPHRAX_BLOCK_SUM_SIZE);
+    zyphrax_hash_init(&ds->pass_hash, ds->info.sum_kind);
+  }
+  // A checksum block is collected whole, it is checked against its bytes
+  if (ds->info.type == ZYPHRAX_BLOCK_SKIPPABLE &&
+      ds->sum.kind != ZYPHRAX_CHECKSUM_NONE && read_u32_le(h + 1) == 8) {
+    ds->info.comp_size = 8;
+    ds->in_need = ds->info.hdr_size + 8;
+    ds->stage = DS_PAYLOAD;
+    return 0;
+  }
+  ds->info.comp_size = 0; // Payload not read yet (nor needed past here)
+  if (zyphrax_frame_sum_block(&ds->sum, h, &ds->info) != 0)
+    return -1;
+
+  switch (ds->info.type) {
+  case ZYPHRAX_BLOCK_RAW_IMPLICIT:
+    // Spans block_size or the rest of the frame
+    ds->pass_left = block_size ? block_size : UINT64_MAX;
+    if (ds->frame.content_size != ZYPHRAX_CONTENT_SIZE_ERROR &&
+        ds->frame.content_size - ds->produced < ds->pass_left)
+      ds->pass_left = ds->frame.content_size - ds->produced;
+    ds->pass_copy = 1;
+    ds->pass_implicit = 1;
+    ds->stage = DS_PASS;
+    break;
+  case ZYPHRAX_BLOCK_RAW:
+  case ZYPHRAX_BLOCK_SKIPPABLE:
+    ds->pass_left = read_u32_le(h + 1);
+    ds->pass_copy = ds->info.type == ZYPHRAX_BLOCK_RAW;
+    ds->pass_implicit = 0;
+    ds->stage = DS_PASS;
+    break;
+  case ZYPHRAX_BLOCK_COMPRESSED:
+  case ZYPHRAX_BLOCK_LZ:
+    ds->info.orig_size = read_u32_le(h + 1);
+    ds->info.comp_size = read_u32_le(h + 5);
+    if (ds->info.orig_size > block_size ||
+        ds->info.comp_size > ds->in_cap - ds->info.hdr_size)
+      return -1;
+    ds->in_need = ds->info.hdr_size + ds->info.comp_size;
+    ds->stage = DS_PAYLOAD;
+    break;
+  }
+  if (ds->stage == DS_PASS) {
+    ds->in_len = 0; // Payload is not buffered
+    if (ds->pass_left == 0)
+      return dstream_pass_end(ds);
+  }
+  return 0;
+}
+
+// Whole compressed block in the caller's input: decoded from there, into the
+// caller's output when it fits, else into out_buf to be drained
+static int dstream_direct(zyphrax_dstream_t *ds, zyphrax_out_buffer_t *out,
+                          zyphrax_in_buffer_t *in) {
+  const uint8_t *src = in->src + in->pos;
+  size_t avail = in->size - in->pos;
+  zyphrax_block_info_t info;
+  int type = src[0] & ZYPHRAX_BLOCK_TYPE_MASK;
+  if ((type != ZYPHRAX_BLOCK_COMPRESSED && type != ZYPHRAX_BLOCK_LZ) ||
+      zyphrax_read_block_info(src, avail, ds->frame.params.block_size,
+                              &info) != 0 ||
+      info.orig_size > ds->frame.params.block_size)
+    return 0;
+
+  if (zyphrax_frame_sum_block(&ds->sum, src, &info) != 0)
+    return -1;
+  int direct = out->size - out->pos >= info.orig_size;
+  uint8_t *dst = direct ? out->dst + out->pos : ds->out_buf;
+  size_t dec = zyphrax_decompress_block(src, &info, dst, info.orig_size);
+  if (dec != info.orig_size || dstream_produce(ds, dec) != 0)
+    return -1;
+  in->pos += info.hdr_size + info.comp_size;
+  if (direct) {
+    out->pos += dec;
+  } else {
+    ds->out_len = dec;
+    ds->out_pos = 0;
+  }
+  return 1;
+}
+
+size_t zyphrax_dstream_update(zyphrax_dstream_t *ds, zyphrax_out_buffer_t *out,
+                              zyphrax_in_buffer_t *in) {
+  for (;;) {
+    // Hand out the last decoded block first
+    if (ds->out_pos < ds->out_len) {
+      size_t n = min(ds->out_len - ds->out_pos, out->size - out->pos);
+      memcpy(out->dst + out->pos, ds->out_buf + ds->out_pos, n);
+      out->pos += n;
+      ds->out_pos += n;
+      if (ds->out_pos < ds->out_len)
+        return 1; // Output full
+    }
+
+    size_t avail = in->size - in->pos;
+    switch (ds->stage) {
+    case DS_ERROR:
+      return ZYPHRAX_STREAM_ERROR;
+
+    case DS_HEADER: {
+      if (ds->hdr_len == 0 && avail == 0 && ds->frames > 0)
+        return 0; // Between frames
+      size_t need = dstream_header_need(ds);
+      if (need == 0)
+        return dstream_fail(ds);
+      if (ds->hdr_len < need) {
+        if (!dstream_gather(ds->hdr, &ds->hdr_len, need, in))
+          return need - ds->hdr_len;
+        continue; // May need more now that it is known what follows
+      }
+      if (zyphrax_frame_word(ds->hdr) == ZYPHRAX_SKIPPABLE_MAGIC) {
+        ds->pass_left = read_u32_le(ds->hdr + 4);
+        ds->pass_copy = 0;
+        ds->pass_implicit = 0;
+        ds->pass_frame = 1;
+        ds->hdr_len = 0;
+        ds->stage = DS_PASS;
+        if (ds->pass_left == 0)
+          dstream_pass_end(ds);
+        continue;
+      }
+      if (dstream_header(ds) != 0)
+        return dstream_fail(ds);
+      ds->hdr_len = 0;
+      ds->stage = DS_BLOCK;
+      continue;
+    }
+
+    case DS_BLOCK: {
+      if (ds->in_len == 0) {
+        if (avail == 0) {
+          // Boundary: done unless the header promised more or the
+          // checksum block is still to come
+          return (size_t)dstream_frame_open(ds);
+        }
+        int direct = dstream_direct(ds, out, in);
+        if (direct < 0)
+          return dstream_fail(ds);
+        if (direct)
+          continue;
+      }
+      if (ds->in_len == 0) {
+        uint8_t b = in->src[in->pos++];
+        if (b == (ZYPHRAX_MAGIC & 0xFF)) {
+          // Next frame: this one must be complete
+          if (dstream_frame_open(ds))
+            return dstream_fail(ds);
+          ds->frames++;
+          ds->hdr[0] = b;
+          ds->hdr_len = 1;
+          ds->stage = DS_HEADER;
+          continue;
+        }
+        ds->in_buf[ds->in_len++] = b;
+        if (dstream_block_hdr_size(b) == 0)
+          return dstream_fail(ds);
+      }
+      size_t need = dstream_block_hdr_size(ds->in_buf[0]);
+      if (!dstream_gather(ds->in_buf, &ds->in_len, need, in))
+        return need - ds->in_len;
+      if (dstream_block(ds) != 0)
+        return dstream_fail(ds);
+      continue;
+    }
+
+    case DS_PASS: {
+      size_t n = (size_t)min((uint64_t)avail, ds->pass_left);
+      if (ds->pass_copy) {
+        n = min(n, out->size - out->pos);
+        memcpy(out->dst + out->pos, in->src + in->pos, n);
+        if (ds->info.sum_kind != ZYPHRAX_CHECKSUM_NONE)
+          zyphrax_hash_update(&ds->pass_hash, out->dst + out->pos, n);
+        out->pos += n;
+        if (dstream_produce(ds, n) != 0)
+          return dstream_fail(ds);
+      }
+      in->pos += n;
+      ds->pass_left -= n;
+      if (ds->pass_left == 0) {
+        if (dstream_pass_end(ds) != 0)
+          return dstream_fail(ds);
+        continue;
+      }
+      if (ds->pass_implicit && in->pos == in->size)
+        return 0; // The frame may legitimately end here
+      if (n == 0 || in->pos == in->size)
+        return (size_t)min(ds->pass_left, (uint64_t)SIZE_MAX - 1);
+      continue;
+    }
+
+    case DS_PAYLOAD: {
+      if (!dstream_gather(ds->in_buf, &ds->in_len, ds->in_need, in))
+        return ds->in_need - ds->in_len;
+
+      if (ds->info.type == ZYPHRAX_BLOCK_SKIPPABLE) {
+        if (zyphrax_frame_sum_block(&ds->sum, ds->in_buf, &ds->info) != 0)
+          return dstream_fail(ds);
+        ds->in_len = 0;
+        ds->stage = DS_BLOCK;
+        continue;
+      }
+
+      size_t orig = ds->info.orig_size;
+      uint8_t *dst = ds->out_buf;
+      int direct = out->size - out->pos >= orig;
+      if (direct)
+        dst = out->dst + out->pos;
+      size_t dec = zyphrax_decompress_block(ds->in_buf, &ds->info, dst, orig);
+      if (dec != orig || dstream_produce(ds, dec) != 0)
+        return dstream_fail(ds);
+      if (direct) {
+        out->pos += dec;
+      } else {
+        ds->out_len = dec;
+        ds->out_pos = 0;
+      }
+      ds->in_len = 0;
+      ds->stage = DS_BLOCK;
+      continue;
+    }
+    }
+  }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// Static Tracepoints
+// Built with -DZYPHRAX_TRACE (make TRACE=1), the hot paths carry USDT probes
+// of the "zyphrax" provider for bpftrace, perf and SystemTap, e.g.
+//   bpftrace -e 'usdt:./libzyphrax.so:zyphrax:block_raw { @[arg0] = count(); }'
+// Needs <sys/sdt.h> (systemtap-sdt-dev / systemtap-sdt-devel). An unattached
+// probe is a single nop. Without ZYPHRAX_TRACE the macros are empty and their
+// arguments are never evaluated.
+//
+// Probe                   Arguments
+// frame_compress_start    src_size, level
+// frame_compress_end      src_size, frame_size (0 on error)
+// block_compress_start    src_size, level
+// block_compress_end      src_size, written (0 on error)
+// block_tables            src_size, sequences (Huffman codes built)
+// block_raw               src_size, coded size that lost (0: none fit)
+// frame_decompress_start  input offset of the frame, input bytes left
+// frame_decompress_end    frame_size, decoded size (0, 0 on error)
+// block_decompress_start  type (ZYPHRAX_BLOCK_*), payload size
+// block_decompress_end    orig_size, decoded (0 on error)
+// block_dec_tables        orig_size, payload size (decoder tables built)
+
+#ifdef ZYPHRAX_TRACE
+#include <sys/sdt.h>
+#define ZYPHRAX_PROBE2(name, a, b) DTRACE_PROBE2(zyphrax, name, a, b)
+#else
+#define ZYPHRAX_PROBE2(name, a, b) ((void)0)
+#endif
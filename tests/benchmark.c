@@ -1,238 +1,609 @@
+// Benchmark suite (make bench)
+// Every case is timed run by run on the wall clock after a warm-up, and
+// reported as median / p90 / p99 throughput: the p90 figure is the speed
+// that 90% of runs reached or beat, so it moves with jitter the median
+// hides. Single-threaded cases run pinned to one CPU. Data comes from
+// seeded generators (the same bytes on every machine and run) plus any
+// files named on the command line. --json writes the results for
+// scripts/bench_compare.py to diff against a baseline.
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
 #include "zyphrax.h"
-#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
-#define DATA_SIZE (50 * 1024 * 1024) // 50 MB
-#define NUM_ITER 5
-#define SMALL_BLOCK_SIZE 4096
+#define MAX_LEVELS 9
+#define MAX_RUNS 1000
+#define MSG_SIZE 1024
 
+typedef struct {
+  size_t size;     // Bytes per generated dataset
+  int runs;        // Timed runs per case
+  int warmup;      // Untimed runs before them
+  uint32_t levels[MAX_LEVELS];
+  int nb_levels;
+  unsigned threads; // Multithreaded cases (0 or 1 = none)
+  int cpu;          // CPU for single-threaded cases, -1 = not pinned
+  const char *json;
+} bench_config_t;
+
+static bench_config_t cfg = {
+    .size = 16 << 20,
+    .runs = 20,
+    .warmup = 3,
+    .levels = {1, 3},
+    .nb_levels = 2,
+    .cpu = 0,
+};
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// -------------------------------------------------------------------------
 // Generators
-void gen_json(uint8_t *buf, size_t size) {
+// -------------------------------------------------------------------------
+
+static uint64_t rng_state;
+
+// xorshift64*: rand() differs between C libraries
+static uint32_t rng(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return (uint32_t)((rng_state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+static void gen_json(uint8_t *buf, size_t size) {
   const char *template =
-      "{\"id\":%d,\"name\":\"user_%d\",\"active\":true,\"roles\":[\"admin\","
+      "{\"id\":%d,\"name\":\"user_%d\",\"active\":%s,\"roles\":[\"admin\","
       "\"editor\"],\"meta\":{\"ip\":\"192.168.1.%d\",\"ts\":%ld}},";
+  char rec[256];
   size_t pos = 0;
-  int i = 0;
-  while (pos < size - 200) {
-    int w = sprintf((char *)buf + pos, template, i, i, i % 255, (long)i * 1000);
-    pos += w;
-    i++;
+  for (int i = 0; pos < size; i++) {
+    int w = snprintf(rec, sizeof(rec), template, i, (int)(rng() % 100000),
+                     rng() % 3 ? "true" : "false", (int)(rng() % 255),
+                     1600000000L + i * 7 + (long)(rng() % 5));
+    size_t n = size - pos < (size_t)w ? size - pos : (size_t)w;
+    memcpy(buf + pos, rec, n);
+    pos += n;
   }
-  while (pos < size)
-    buf[pos++] = ' ';
 }
 
-void gen_binary(uint8_t *buf, size_t size) {
+static void gen_binary(uint8_t *buf, size_t size) {
   struct {
     uint32_t id;
     uint64_t ts;
     uint32_t val;
     uint8_t pad[16];
   } rec;
+  memset(&rec, 0, sizeof(rec));
   size_t pos = 0;
-  uint32_t id = 0;
-  while (pos < size - sizeof(rec)) {
-    rec.id = id++;
-    rec.ts = 1600000000 + id;
-    rec.val = (id * 17) % 10000;
-    memset(rec.pad, 0, 16);
-    memcpy(buf + pos, &rec, sizeof(rec));
-    pos += sizeof(rec);
+  for (uint32_t id = 0; pos < size; id++) {
+    rec.id = id;
+    rec.ts = 1600000000 + id * 13 + rng() % 8;
+    rec.val = rng() % 10000;
+    size_t n = size - pos < sizeof(rec) ? size - pos : sizeof(rec);
+    memcpy(buf + pos, &rec, n);
+    pos += n;
   }
 }
 
-void gen_text(uint8_t *buf, size_t size) {
+static void gen_text(uint8_t *buf, size_t size) {
   const char *w[] = {"the",  "quick", "brown", "fox",    "jumps",
-                     "over", "lazy",  "dog",   "system", "compression"};
+                     "over", "lazy",  "dog",   "system", "compression",
+                     "a",    "of",    "block", "stream", "entropy"};
   size_t pos = 0;
-  int i = 0;
-  while (pos < size - 20) {
-    const char *wd = w[i % 10];
-    int l = strlen(wd);
-    memcpy(buf + pos, wd, l);
-    pos += l;
-    buf[pos++] = ' ';
-    i++;
+  while (pos < size) {
+    // Zipf-like: short, common words far more often
+    const char *wd = w[rng() % (1 + rng() % 15)];
+    for (size_t i = 0; wd[i] && pos < size; i++)
+      buf[pos++] = (uint8_t)wd[i];
+    if (pos < size)
+      buf[pos++] = rng() % 12 ? ' ' : '\n';
   }
-  while (pos < size)
-    buf[pos++] = '.';
 }
 
-void gen_random(uint8_t *buf, size_t size) {
+static void gen_random(uint8_t *buf, size_t size) {
   for (size_t i = 0; i < size; i++)
-    buf[i] = rand() % 256;
-}
-
-// Benchmark Function
-void bench_compress(const char *name, void (*gen)(uint8_t *, size_t),
-                    int small_blocks) {
-  uint8_t *src = malloc(DATA_SIZE);
-  gen(src, DATA_SIZE);
-
-  size_t bound = zyphrax_compress_bound(DATA_SIZE);
-  if (small_blocks)
-    bound = zyphrax_compress_bound(SMALL_BLOCK_SIZE) *
-            (DATA_SIZE / SMALL_BLOCK_SIZE + 1);
-
-  uint8_t *dst = malloc(bound);
-  zyphrax_params_t params = {
-      .level = 3, .block_size = small_blocks ? SMALL_BLOCK_SIZE : 65536};
-
-  // Warmup
-  if (!small_blocks)
-    zyphrax_compress(src, DATA_SIZE, dst, bound, &params);
-
-  clock_t start = clock();
-  size_t total_out = 0;
-
-  for (int i = 0; i < NUM_ITER; i++) {
-    if (small_blocks) {
-      size_t pos = 0;
-      size_t out_pos = 0;
-      while (pos < DATA_SIZE) {
-        size_t chunk = (DATA_SIZE - pos < SMALL_BLOCK_SIZE) ? DATA_SIZE - pos
-                                                            : SMALL_BLOCK_SIZE;
-        size_t w = zyphrax_compress(src + pos, chunk, dst + out_pos,
-                                    bound - out_pos, &params);
-        pos += chunk;
-        out_pos += w;
-      }
-      total_out = out_pos;
-    } else {
-      total_out = zyphrax_compress(src, DATA_SIZE, dst, bound, &params);
-    }
+    buf[i] = (uint8_t)rng();
+}
+
+// The four above in turns of 256 KB, so block decisions keep changing
+static void gen_mixed(uint8_t *buf, size_t size) {
+  void (*gens[])(uint8_t *, size_t) = {gen_json, gen_binary, gen_text,
+                                       gen_random};
+  size_t seg = 256 << 10;
+  for (size_t pos = 0, k = 0; pos < size; pos += seg, k++)
+    gens[k % 4](buf + pos, size - pos < seg ? size - pos : seg);
+}
+
+static const struct {
+  const char *name;
+  void (*gen)(uint8_t *, size_t);
+} generators[] = {
+    {"json", gen_json},     {"binary", gen_binary}, {"text", gen_text},
+    {"random", gen_random}, {"mixed", gen_mixed},
+};
+
+static uint8_t *load_file(const char *path, size_t *size) {
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return NULL;
+  size_t cap = 1 << 20, len = 0;
+  uint8_t *buf = malloc(cap);
+  while (buf) {
+    len += fread(buf + len, 1, cap - len, f);
+    if (len < cap)
+      break;
+    uint8_t *grown = realloc(buf, cap * 2);
+    if (!grown)
+      free(buf);
+    buf = grown;
+    cap *= 2;
+  }
+  fclose(f);
+  *size = len;
+  return buf;
+}
+
+// -------------------------------------------------------------------------
+// CPU Pinning
+// -------------------------------------------------------------------------
+// Single-threaded cases stay on one CPU so the scheduler cannot migrate
+// them mid-run. Threads inherit the mask of their creator, so the
+// multithreaded cases get the original mask back first.
+
+#ifdef __linux__
+static cpu_set_t initial_mask;
+
+static void pin_init(void) {
+  sched_getaffinity(0, sizeof(initial_mask), &initial_mask);
+  if (cfg.cpu >= 0 && !CPU_ISSET(cfg.cpu, &initial_mask)) {
+    for (cfg.cpu = 0; cfg.cpu < CPU_SETSIZE; cfg.cpu++)
+      if (CPU_ISSET(cfg.cpu, &initial_mask))
+        break;
   }
+}
+
+static void pin(int pinned) {
+  if (cfg.cpu < 0)
+    return;
+  cpu_set_t one;
+  CPU_ZERO(&one);
+  CPU_SET(cfg.cpu, &one);
+  sched_setaffinity(0, sizeof(cpu_set_t), pinned ? &one : &initial_mask);
+}
+#else
+static void pin_init(void) { cfg.cpu = -1; }
+static void pin(int pinned) { (void)pinned; }
+#endif
 
-  clock_t end = clock();
-  double secs = (double)(end - start) / CLOCKS_PER_SEC;
-  double speed = ((double)DATA_SIZE * NUM_ITER) / (1024 * 1024 * 1024.0) / secs;
-  double ratio = (double)DATA_SIZE / total_out;
+// -------------------------------------------------------------------------
+// Cases
+// -------------------------------------------------------------------------
 
-  printf("| %-18s | %5.2f GB/s | %5.2f : 1 |\n", name, speed, ratio);
+typedef struct {
+  const uint8_t *src;
+  size_t size;
+  uint8_t *comp;
+  size_t comp_cap;
+  size_t comp_size;
+  uint8_t *dec;
+  zyphrax_params_t params;
+  unsigned threads;
+  zyphrax_cctx_t *cctx;
+  zyphrax_dctx_t *dctx;
+  zyphrax_batch_item_t *items;
+  size_t nb_items;
+} bench_case_t;
+
+// Each returns the bytes produced, 0 on failure
+static size_t run_compress(bench_case_t *c) {
+  return zyphrax_compress_cctx(c->cctx, c->src, c->size, c->comp,
+                               c->comp_cap, &c->params);
+}
 
-  free(src);
-  free(dst);
+static size_t run_decompress(bench_case_t *c) {
+  if (c->threads > 1)
+    return zyphrax_decompress_dctx_mt(c->dctx, c->comp, c->comp_size, c->dec,
+                                      c->size, c->threads);
+  return zyphrax_decompress_dctx(c->dctx, c->comp, c->comp_size, c->dec,
+                                 c->size);
 }
 
-void bench_decompress() {
-  printf("Benchmarking Decompression (JSON)...\n");
-  // Generate JSON
-  uint8_t *src = malloc(DATA_SIZE);
-  gen_json(src, DATA_SIZE);
+static size_t run_messages(bench_case_t *c) {
+  size_t total = 0;
+  for (size_t i = 0; i < c->nb_items; i++) {
+    zyphrax_batch_item_t *it = &c->items[i];
+    it->result = zyphrax_compress(it->src, it->src_size, it->dst,
+                                  it->dst_cap, &c->params);
+    if (it->result == 0)
+      return 0;
+    total += it->result;
+  }
+  return total;
+}
 
-  size_t bound = zyphrax_compress_bound(DATA_SIZE);
-  uint8_t *comp = malloc(bound);
-  zyphrax_params_t params = {3, 65536, 0};
-  size_t csz = zyphrax_compress(src, DATA_SIZE, comp, bound, &params);
-  printf("Compressed Size: %zu\n", csz);
+static size_t run_batch(bench_case_t *c) {
+  if (zyphrax_compress_batch(c->cctx, c->items, c->nb_items, &c->params) !=
+      c->nb_items)
+    return 0;
+  size_t total = 0;
+  for (size_t i = 0; i < c->nb_items; i++)
+    total += c->items[i].result;
+  return total;
+}
 
-  uint8_t *dec = malloc(DATA_SIZE * 2);
+typedef struct {
+  char name[96];
+  const char *dataset;
+  const char *op;
+  uint32_t level;
+  uint32_t block_size;
+  unsigned threads;
+  size_t bytes;
+  double ratio;
+  double median, p90, p99, best, worst; // MB/s
+} bench_result_t;
+
+static bench_result_t *results;
+static size_t nb_results, results_cap;
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
 
-  // Integrity Check
-  size_t dsz_check = zyphrax_decompress(comp, csz, dec, DATA_SIZE * 2);
-  if (dsz_check != DATA_SIZE || memcmp(src, dec, DATA_SIZE) != 0) {
-    printf("Integrity Check FAILED! Decompressed size: %zu\n", dsz_check);
-    free(src);
-    free(comp);
-    free(dec);
-    return;
+// Time at nearest-rank percentile p of the sorted run times
+static double percentile(const double *sorted, int n, double p) {
+  int rank = (int)(p / 100.0 * n + 0.999999);
+  if (rank < 1)
+    rank = 1;
+  return sorted[(rank > n ? n : rank) - 1];
+}
+
+// Runs one case; every run must produce `expect` bytes (0 = any nonzero).
+// Returns -1 on a failed run
+static int measure(bench_result_t *r, size_t (*fn)(bench_case_t *),
+                   bench_case_t *c, size_t expect, size_t *out) {
+  static double times[MAX_RUNS];
+  for (int i = 0; i < cfg.warmup; i++)
+    fn(c);
+  for (int i = 0; i < cfg.runs; i++) {
+    double t0 = now_sec();
+    size_t n = fn(c);
+    times[i] = now_sec() - t0;
+    if (n == 0 || (expect && n != expect))
+      return -1;
+    *out = n;
+  }
+  qsort(times, (size_t)cfg.runs, sizeof(double), cmp_double);
+  double mb = (double)r->bytes / 1e6;
+  r->median = mb / percentile(times, cfg.runs, 50);
+  r->p90 = mb / percentile(times, cfg.runs, 90);
+  r->p99 = mb / percentile(times, cfg.runs, 99);
+  r->best = mb / times[0];
+  r->worst = mb / times[cfg.runs - 1];
+  return 0;
+}
+
+static bench_result_t *new_result(const char *dataset, const char *op,
+                                  uint32_t level, unsigned threads,
+                                  size_t bytes) {
+  if (nb_results == results_cap) {
+    results_cap = results_cap ? results_cap * 2 : 64;
+    results = realloc(results, results_cap * sizeof(*results));
+    if (!results) {
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+    }
   }
-  printf("Integrity Check Passed.\n");
+  bench_result_t *r = &results[nb_results++];
+  memset(r, 0, sizeof(*r));
+  r->dataset = dataset;
+  r->op = op;
+  r->level = level;
+  r->block_size = ZYPHRAX_BLOCK_SIZE;
+  r->threads = threads;
+  r->bytes = bytes;
+  if (threads > 1)
+    snprintf(r->name, sizeof(r->name), "%s/L%u/%s-mt%u", dataset, level, op,
+             threads);
+  else
+    snprintf(r->name, sizeof(r->name), "%s/L%u/%s", dataset, level, op);
+  return r;
+}
 
-  struct timespec start, end;
-  clock_gettime(CLOCK_MONOTONIC, &start);
+static void print_result(const bench_result_t *r) {
+  printf("%-32s %8.3f %10.1f %10.1f %10.1f\n", r->name, r->ratio, r->median,
+         r->p90, r->p99);
+  fflush(stdout);
+}
 
-  for (int i = 0; i < NUM_ITER; i++) {
-    zyphrax_decompress(comp, csz, dec, DATA_SIZE * 2);
+static int fail(const bench_result_t *r) {
+  fprintf(stderr, "%s: run FAILED\n", r->name);
+  return 1;
+}
+
+// Compression and decompression at one level, on `threads` threads
+static int bench_level(const char *dataset, const uint8_t *src, size_t size,
+                       uint32_t level, unsigned threads) {
+  bench_case_t c = {.src = src, .size = size, .threads = threads};
+  c.params = (zyphrax_params_t){.level = level,
+                                .block_size = ZYPHRAX_BLOCK_SIZE};
+  c.comp_cap = zyphrax_compress_bound(size);
+  c.comp = malloc(c.comp_cap);
+  c.dec = malloc(size ? size : 1);
+  c.cctx = zyphrax_cctx_create(threads);
+  c.dctx = zyphrax_dctx_create(NULL);
+  int ret = 1;
+  if (!c.comp || !c.dec || !c.cctx || !c.dctx) {
+    fprintf(stderr, "Out of memory\n");
+    goto done;
+  }
+
+  bench_result_t *r = new_result(dataset, "compress", level, threads, size);
+  if (measure(r, run_compress, &c, 0, &c.comp_size) != 0) {
+    ret = fail(r);
+    goto done;
   }
-  clock_gettime(CLOCK_MONOTONIC, &end);
+  r->ratio = (double)size / c.comp_size;
+  print_result(r);
+
+  double ratio = r->ratio;
+  r = new_result(dataset, "decompress", level, threads, size);
+  r->ratio = ratio;
+  size_t dec_size;
+  memset(c.dec, 0, size);
+  if (measure(r, run_decompress, &c, size, &dec_size) != 0 ||
+      memcmp(c.dec, src, size) != 0) {
+    ret = fail(r);
+    goto done;
+  }
+  print_result(r);
+  ret = 0;
+
+done:
+  zyphrax_cctx_free(c.cctx);
+  zyphrax_dctx_free(c.dctx);
+  free(c.comp);
+  free(c.dec);
+  return ret;
+}
 
-  double secs =
-      (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-  double speed = ((double)DATA_SIZE * NUM_ITER) / (1024 * 1024 * 1024.0) / secs;
+// 1 KB messages, one call each and one batch call (first 4 MB of src)
+static int bench_messages(const char *dataset, const uint8_t *src,
+                          size_t size) {
+  size_t nb = (size < (4u << 20) ? size : (4u << 20)) / MSG_SIZE;
+  if (nb == 0)
+    return 0;
+  size_t cap = zyphrax_compress_bound(MSG_SIZE);
+  bench_case_t c = {.params = {.level = 3}, .nb_items = nb};
+  c.comp = malloc(nb * cap);
+  c.items = malloc(nb * sizeof(*c.items));
+  c.cctx = zyphrax_cctx_create(1);
+  int ret = 1;
+  if (!c.comp || !c.items || !c.cctx) {
+    fprintf(stderr, "Out of memory\n");
+    goto done;
+  }
+  for (size_t i = 0; i < nb; i++) {
+    c.items[i].src = src + i * MSG_SIZE;
+    c.items[i].src_size = MSG_SIZE;
+    c.items[i].dst = c.comp + i * cap;
+    c.items[i].dst_cap = cap;
+  }
 
-  printf("| %-18s | %5.2f GB/s |     -       |\n", "Decompression (JSON)",
-         speed);
+  const char *ops[] = {"msg1k-single", "msg1k-batch"};
+  size_t (*fns[])(bench_case_t *) = {run_messages, run_batch};
+  for (int k = 0; k < 2; k++) {
+    bench_result_t *r = new_result(dataset, ops[k], 3, 1, nb * MSG_SIZE);
+    r->block_size = MSG_SIZE;
+    size_t total = 0;
+    if (measure(r, fns[k], &c, 0, &total) != 0) {
+      ret = fail(r);
+      goto done;
+    }
+    r->ratio = (double)(nb * MSG_SIZE) / total;
+    print_result(r);
+  }
+  ret = 0;
 
-  free(src);
-  free(comp);
-  free(dec);
+done:
+  zyphrax_cctx_free(c.cctx);
+  free(c.comp);
+  free(c.items);
+  return ret;
 }
 
-// Multithreaded Test
-typedef struct {
-  uint8_t *src;
-  uint8_t *dst;
-  size_t size;
-  size_t bound;
-  zyphrax_params_t p;
-} thread_arg_t;
-
-void *thread_func(void *arg) {
-  thread_arg_t *a = (thread_arg_t *)arg;
-  for (int i = 0; i < 5; i++) {
-    zyphrax_compress(a->src, a->size, a->dst, a->bound, &a->p);
-  }
-  return NULL;
-}
-
-void bench_threads() {
-  int nlines = 4;
-  pthread_t th[4];
-  thread_arg_t args[4];
-
-  uint8_t *src = malloc(DATA_SIZE);
-  gen_json(src, DATA_SIZE);
-
-  for (int i = 0; i < nlines; i++) {
-    args[i].src = src; // Read only
-    args[i].size = DATA_SIZE;
-    args[i].bound = zyphrax_compress_bound(DATA_SIZE);
-    args[i].dst = malloc(args[i].bound);
-    args[i].p.level = 3;
-    args[i].p.block_size = 65536;
-    args[i].p.checksum = 0;
-  }
-
-  clock_t start = clock(); // Note: clock() measures CPU time, wall time is
-                           // needed for threads scaling
-  // Use timespec
-  struct timespec ts_start, ts_end;
-  clock_gettime(CLOCK_MONOTONIC, &ts_start);
-
-  for (int i = 0; i < nlines; i++)
-    pthread_create(&th[i], NULL, thread_func, &args[i]);
-  for (int i = 0; i < nlines; i++)
-    pthread_join(th[i], NULL);
-
-  clock_gettime(CLOCK_MONOTONIC, &ts_end);
-  double secs = (ts_end.tv_sec - ts_start.tv_sec) +
-                (ts_end.tv_nsec - ts_start.tv_nsec) / 1e9;
-
-  // Total throughput = 4 threads * 5 iters * DATA_SIZE
-  double total_bytes = (double)nlines * 5 * DATA_SIZE;
-  double speed = total_bytes / (1024 * 1024 * 1024.0) / secs;
-
-  printf("| %-18s | %5.2f GB/s |     -       |\n", "Thread Scale (x4)", speed);
-
-  free(src);
-  for (int i = 0; i < nlines; i++)
-    free(args[i].dst);
-}
-
-int main() {
-  printf("| Benchmark Category   | Speed      | Ratio       |\n");
-  printf("|----------------------|------------|-------------|\n");
-  bench_compress("JSON (Large)", gen_json, 0);
-  bench_compress("Binary (Large)", gen_binary, 0);
-  bench_compress("Text (Large)", gen_text, 0);
-  bench_compress("Random (Adversarial)", gen_random, 0);
-  bench_compress("JSON (4KB Blocks)", gen_json, 1);
-  bench_decompress();
-  bench_threads();
-  return 0;
+static int bench_dataset(const char *name, const uint8_t *src, size_t size) {
+  int failed = 0;
+  pin(1);
+  for (int l = 0; l < cfg.nb_levels; l++)
+    failed |= bench_level(name, src, size, cfg.levels[l], 1);
+  failed |= bench_messages(name, src, size);
+  if (cfg.threads > 1) {
+    pin(0);
+    for (int l = 0; l < cfg.nb_levels; l++)
+      failed |= bench_level(name, src, size, cfg.levels[l], cfg.threads);
+  }
+  return failed;
+}
+
+// -------------------------------------------------------------------------
+// Output
+// -------------------------------------------------------------------------
+
+static void json_string(FILE *f, const char *s) {
+  fputc('"', f);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', f);
+    if ((unsigned char)*s >= 0x20)
+      fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+static int write_json(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  fprintf(f, "{\n  \"version\": 1,\n  \"config\": {\"size\": %zu, "
+             "\"runs\": %d, \"warmup\": %d, \"threads\": %u, \"cpu\": %d, "
+             "\"compiler\": ",
+          cfg.size, cfg.runs, cfg.warmup, cfg.threads, cfg.cpu);
+#ifdef __VERSION__
+  json_string(f, __VERSION__);
+#else
+  json_string(f, "unknown");
+#endif
+  fprintf(f, "},\n  \"results\": [\n");
+  for (size_t i = 0; i < nb_results; i++) {
+    const bench_result_t *r = &results[i];
+    fprintf(f, "    {\"name\": ");
+    json_string(f, r->name);
+    fprintf(f, ", \"dataset\": ");
+    json_string(f, r->dataset);
+    fprintf(f,
+            ", \"op\": \"%s\", \"level\": %u, \"block_size\": %u, "
+            "\"threads\": %u, \"bytes\": %zu, \"ratio\": %.4f, "
+            "\"median_mbps\": %.2f, \"p90_mbps\": %.2f, \"p99_mbps\": %.2f, "
+            "\"best_mbps\": %.2f, \"worst_mbps\": %.2f}%s\n",
+            r->op, r->level, r->block_size, r->threads, r->bytes, r->ratio,
+            r->median, r->p90, r->p99, r->best, r->worst,
+            i + 1 < nb_results ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+  return fclose(f) == 0 ? 0 : -1;
+}
+
+// -------------------------------------------------------------------------
+// Main
+// -------------------------------------------------------------------------
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [options] [file...]\n"
+          "  --size <MB>       generated dataset size (default 16)\n"
+          "  --runs <n>        timed runs per case (default 20)\n"
+          "  --warmup <n>      untimed runs first (default 3)\n"
+          "  --levels <a,b>    compression levels (default 1,3)\n"
+          "  --threads <n>     also run multithreaded cases (default: "
+          "all cores)\n"
+          "  --cpu <n>         CPU for single-threaded cases, -1 = no "
+          "pinning (default 0)\n"
+          "  --json <path>     write results as JSON\n"
+          "  --no-generated    only the files given\n",
+          prog);
+}
+
+static int parse_levels(const char *s) {
+  cfg.nb_levels = 0;
+  for (;;) {
+    char *end;
+    long l = strtol(s, &end, 10);
+    if (end == s || l < ZYPHRAX_LEVEL_MIN || l > ZYPHRAX_LEVEL_MAX ||
+        cfg.nb_levels == MAX_LEVELS || (*end && *end != ','))
+      return -1;
+    cfg.levels[cfg.nb_levels++] = (uint32_t)l;
+    if (!*end)
+      return 0;
+    s = end + 1;
+  }
+}
+
+int main(int argc, char **argv) {
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  cfg.threads = ncpu > 1 ? (unsigned)ncpu : 0;
+  int generated = 1;
+  const char **files = malloc(sizeof(char *) * (size_t)argc);
+  int nb_files = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+    if (a[0] != '-') {
+      files[nb_files++] = a;
+      continue;
+    }
+    if (strcmp(a, "--no-generated") == 0) {
+      generated = 0;
+      continue;
+    }
+    if (!v) {
+      usage(argv[0]);
+      return 1;
+    }
+    i++;
+    if (strcmp(a, "--size") == 0 && atol(v) > 0)
+      cfg.size = (size_t)atol(v) << 20;
+    else if (strcmp(a, "--runs") == 0 && atoi(v) > 0 && atoi(v) <= MAX_RUNS)
+      cfg.runs = atoi(v);
+    else if (strcmp(a, "--warmup") == 0 && atoi(v) >= 0)
+      cfg.warmup = atoi(v);
+    else if (strcmp(a, "--levels") == 0 && parse_levels(v) == 0)
+      continue;
+    else if (strcmp(a, "--threads") == 0)
+      cfg.threads = (unsigned)atoi(v);
+    else if (strcmp(a, "--cpu") == 0)
+      cfg.cpu = atoi(v);
+    else if (strcmp(a, "--json") == 0)
+      cfg.json = v;
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  pin_init();
+
+  printf("%zu MB datasets, %d runs after %d warm-up, %s\n", cfg.size >> 20,
+         cfg.runs, cfg.warmup, cfg.cpu >= 0 ? "pinned" : "not pinned");
+  printf("%-32s %8s %10s %10s %10s\n", "Case", "Ratio", "Median MB/s",
+         "p90", "p99");
+
+  int failed = 0;
+  if (generated) {
+    uint8_t *buf = malloc(cfg.size);
+    if (!buf) {
+      fprintf(stderr, "Out of memory\n");
+      return 1;
+    }
+    for (size_t g = 0; g < sizeof(generators) / sizeof(generators[0]); g++) {
+      rng_state = 0x9E3779B97F4A7C15ull + g;
+      generators[g].gen(buf, cfg.size);
+      failed |= bench_dataset(generators[g].name, buf, cfg.size);
+    }
+    free(buf);
+  }
+  for (int i = 0; i < nb_files; i++) {
+    size_t size;
+    uint8_t *buf = load_file(files[i], &size);
+    if (!buf) {
+      perror(files[i]);
+      failed = 1;
+      continue;
+    }
+    const char *name = strrchr(files[i], '/') ? strrchr(files[i], '/') + 1
+                                              : files[i];
+    failed |= bench_dataset(name, buf, size);
+    free(buf);
+  }
+
+  if (cfg.json && write_json(cfg.json) != 0)
+    failed = 1;
+  free(results);
+  free(files);
+  return failed;
 }
@@ -0,0 +1,435 @@
+// Small-message latency benchmark (make latency)
+// Per-call latency of compressing and decompressing payloads of 64 B to
+// 16 KB, the sizes where fixed costs (context setup, match finder reset,
+// frame header, code length tables) outweigh the bytes themselves. Every
+// call is timed on its own and reported as p50 / p99 / p999, for the
+// one-shot API (zyphrax_compress, zyphrax_decompress) and for warm
+// contexts reused across calls (zyphrax_compress_cctx,
+// zyphrax_decompress_dctx). Calls cycle through a pool of different
+// messages of the same size and shape, so no single input sits in cache.
+// --json writes the results for scripts/bench_compare.py (--metric p99_ns).
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+#include "zyphrax.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_SIZES 16
+#define MSG_POOL 256 // Distinct messages per size and shape
+
+typedef struct {
+  size_t sizes[MAX_SIZES];
+  int nb_sizes;
+  int calls;  // Timed calls per case
+  int warmup; // Untimed calls before them
+  uint32_t level;
+  int cpu; // -1 = not pinned
+  const char *json;
+} latency_config_t;
+
+static latency_config_t cfg = {
+    .sizes = {64, 256, 1024, 4096, 16384},
+    .nb_sizes = 5,
+    .calls = 10000,
+    .warmup = 200,
+    .level = 3,
+    .cpu = 0,
+};
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// -------------------------------------------------------------------------
+// Message Shapes
+// -------------------------------------------------------------------------
+// Seeded, so every machine and run sees the same bytes
+
+static uint64_t rng_state;
+
+static uint32_t rng(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return (uint32_t)((rng_state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+// An RPC-style JSON object, cut to size
+static void gen_json(uint8_t *buf, size_t size) {
+  char rec[256];
+  size_t pos = 0;
+  for (int i = 0; pos < size; i++) {
+    int w = snprintf(rec, sizeof(rec),
+                     "{\"id\":%u,\"method\":\"%s\",\"user\":\"u%u\","
+                     "\"ok\":%s,\"ts\":%u},",
+                     rng() % 1000000,
+                     rng() % 2 ? "get_profile" : "update_status",
+                     rng() % 5000, rng() % 4 ? "true" : "false",
+                     1700000000u + (uint32_t)i * 3);
+    size_t n = size - pos < (size_t)w ? size - pos : (size_t)w;
+    memcpy(buf + pos, rec, n);
+    pos += n;
+  }
+}
+
+// Packed structs: ids, timestamps and small counters
+static void gen_binary(uint8_t *buf, size_t size) {
+  uint32_t id = rng() % 100000;
+  for (size_t pos = 0; pos < size; pos += 16) {
+    uint32_t rec[4] = {id++, 1700000000u + (uint32_t)pos, rng() % 64,
+                       rng() % 3};
+    memcpy(buf + pos, rec, size - pos < 16 ? size - pos : 16);
+  }
+}
+
+static void gen_text(uint8_t *buf, size_t size) {
+  static const char *words[] = {"the",    "request", "failed", "user",
+                                "server", "timeout", "retry",  "of",
+                                "a",      "session", "cache",  "ok"};
+  size_t pos = 0;
+  while (pos < size) {
+    const char *w = words[rng() % 12];
+    for (size_t i = 0; w[i] && pos < size; i++)
+      buf[pos++] = (uint8_t)w[i];
+    if (pos < size)
+      buf[pos++] = rng() % 10 ? ' ' : '\n';
+  }
+}
+
+// Already compressed or encrypted payloads
+static void gen_random(uint8_t *buf, size_t size) {
+  for (size_t i = 0; i < size; i++)
+    buf[i] = (uint8_t)rng();
+}
+
+static const struct {
+  const char *name;
+  void (*gen)(uint8_t *, size_t);
+} shapes[] = {{"json", gen_json},
+              {"binary", gen_binary},
+              {"text", gen_text},
+              {"random", gen_random}};
+
+// -------------------------------------------------------------------------
+// Cases
+// -------------------------------------------------------------------------
+
+typedef struct {
+  size_t size;
+  uint8_t *src;   // MSG_POOL messages of size bytes
+  uint8_t *comp;  // Their frames, comp_cap apart
+  size_t comp_cap;
+  size_t comp_size[MSG_POOL];
+  uint8_t *dst;   // Output of the call being timed
+  zyphrax_params_t params;
+  zyphrax_cctx_t *cctx;
+  zyphrax_dctx_t *dctx;
+} latency_case_t;
+
+// Each handles message i and returns the bytes produced, 0 on failure
+static size_t run_compress(latency_case_t *c, size_t i) {
+  return zyphrax_compress(c->src + i * c->size, c->size, c->dst, c->comp_cap,
+                          &c->params);
+}
+
+static size_t run_compress_cctx(latency_case_t *c, size_t i) {
+  return zyphrax_compress_cctx(c->cctx, c->src + i * c->size, c->size, c->dst,
+                               c->comp_cap, &c->params);
+}
+
+static size_t run_decompress(latency_case_t *c, size_t i) {
+  return zyphrax_decompress(c->comp + i * c->comp_cap, c->comp_size[i],
+                            c->dst, c->size);
+}
+
+static size_t run_decompress_dctx(latency_case_t *c, size_t i) {
+  return zyphrax_decompress_dctx(c->dctx, c->comp + i * c->comp_cap,
+                                 c->comp_size[i], c->dst, c->size);
+}
+
+static const struct {
+  const char *op;
+  size_t (*fn)(latency_case_t *, size_t);
+  int decompress;
+} ops[] = {{"compress", run_compress, 0},
+           {"compress-cctx", run_compress_cctx, 0},
+           {"decompress", run_decompress, 1},
+           {"decompress-dctx", run_decompress_dctx, 1}};
+
+typedef struct {
+  char name[96];
+  const char *shape;
+  const char *op;
+  size_t size;
+  double ratio;
+  double p50, p99, p999, mean, worst; // ns per call
+} latency_result_t;
+
+static latency_result_t *results;
+static size_t nb_results, results_cap;
+static uint64_t *times;
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile p of n sorted times
+static double percentile(const uint64_t *sorted, int n, double p) {
+  int rank = (int)(p / 100.0 * n + 0.999999);
+  if (rank < 1)
+    rank = 1;
+  return (double)sorted[(rank > n ? n : rank) - 1];
+}
+
+static latency_result_t *new_result(void) {
+  if (nb_results == results_cap) {
+    results_cap = results_cap ? results_cap * 2 : 64;
+    results = realloc(results, results_cap * sizeof(*results));
+    if (!results) {
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+    }
+  }
+  latency_result_t *r = &results[nb_results++];
+  memset(r, 0, sizeof(*r));
+  return r;
+}
+
+// Times cfg.calls calls of op, cycling through the pool. Every call must
+// produce expect bytes (0 = any nonzero). Returns -1 on a failed call
+static int measure(latency_result_t *r, size_t (*fn)(latency_case_t *, size_t),
+                   latency_case_t *c, size_t expect) {
+  for (int i = 0; i < cfg.warmup; i++)
+    fn(c, (size_t)i % MSG_POOL);
+  uint64_t total = 0;
+  for (int i = 0; i < cfg.calls; i++) {
+    size_t m = (size_t)i % MSG_POOL;
+    uint64_t t0 = now_ns();
+    size_t n = fn(c, m);
+    times[i] = now_ns() - t0;
+    if (n == 0 || (expect && n != expect))
+      return -1;
+    total += times[i];
+  }
+  qsort(times, (size_t)cfg.calls, sizeof(*times), cmp_u64);
+  r->p50 = percentile(times, cfg.calls, 50);
+  r->p99 = percentile(times, cfg.calls, 99);
+  r->p999 = percentile(times, cfg.calls, 99.9);
+  r->mean = (double)total / cfg.calls;
+  r->worst = (double)times[cfg.calls - 1];
+  return 0;
+}
+
+static int bench_size(const char *shape, void (*gen)(uint8_t *, size_t),
+                      size_t size) {
+  latency_case_t c = {.size = size};
+  c.comp_cap = zyphrax_compress_bound(size);
+  c.src = malloc(MSG_POOL * size);
+  c.comp = malloc(MSG_POOL * c.comp_cap);
+  c.dst = malloc(c.comp_cap > size ? c.comp_cap : size);
+  c.params.level = cfg.level;
+  c.cctx = zyphrax_cctx_create(1);
+  c.dctx = zyphrax_dctx_create(NULL);
+  int failed = 1;
+  if (!c.src || !c.comp || !c.dst || !c.cctx || !c.dctx) {
+    fprintf(stderr, "Out of memory\n");
+    goto done;
+  }
+
+  // Each message generated on its own, as a separate request would be
+  size_t comp_total = 0;
+  for (size_t i = 0; i < MSG_POOL; i++) {
+    gen(c.src + i * size, size);
+    c.comp_size[i] = zyphrax_compress(c.src + i * size, size,
+                                      c.comp + i * c.comp_cap, c.comp_cap,
+                                      &c.params);
+    if (c.comp_size[i] == 0 ||
+        zyphrax_decompress(c.comp + i * c.comp_cap, c.comp_size[i], c.dst,
+                           size) != size ||
+        memcmp(c.dst, c.src + i * size, size) != 0) {
+      fprintf(stderr, "%s/%zu: message %zu does not round-trip\n", shape,
+              size, i);
+      goto done;
+    }
+    comp_total += c.comp_size[i];
+  }
+
+  for (size_t k = 0; k < sizeof(ops) / sizeof(ops[0]); k++) {
+    latency_result_t *r = new_result();
+    r->shape = shape;
+    r->op = ops[k].op;
+    r->size = size;
+    r->ratio = (double)(MSG_POOL * size) / (double)comp_total;
+    snprintf(r->name, sizeof(r->name), "%s/%zu/L%u/%s", shape, size,
+             cfg.level, r->op);
+    if (measure(r, ops[k].fn, &c, ops[k].decompress ? size : 0) != 0) {
+      fprintf(stderr, "%s: call FAILED\n", r->name);
+      goto done;
+    }
+    printf("%-36s %7.3f %9.0f %9.0f %9.0f %9.0f\n", r->name, r->ratio,
+           r->p50, r->p99, r->p999, r->mean);
+    fflush(stdout);
+  }
+  failed = 0;
+
+done:
+  zyphrax_cctx_free(c.cctx);
+  zyphrax_dctx_free(c.dctx);
+  free(c.src);
+  free(c.comp);
+  free(c.dst);
+  return failed;
+}
+
+// -------------------------------------------------------------------------
+// Output
+// -------------------------------------------------------------------------
+
+static int write_json(const char *path, double timer_ns) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  fprintf(f,
+          "{\n  \"version\": 1,\n  \"config\": {\"calls\": %d, "
+          "\"warmup\": %d, \"level\": %u, \"cpu\": %d, \"timer_ns\": %.0f, "
+          "\"compiler\": \"%s\"},\n  \"results\": [\n",
+          cfg.calls, cfg.warmup, cfg.level, cfg.cpu, timer_ns,
+#ifdef __VERSION__
+          __VERSION__
+#else
+          "unknown"
+#endif
+  );
+  for (size_t i = 0; i < nb_results; i++) {
+    const latency_result_t *r = &results[i];
+    fprintf(f,
+            "    {\"name\": \"%s\", \"dataset\": \"%s\", \"op\": \"%s\", "
+            "\"size\": %zu, \"level\": %u, \"ratio\": %.4f, "
+            "\"p50_ns\": %.0f, \"p99_ns\": %.0f, \"p999_ns\": %.0f, "
+            "\"mean_ns\": %.0f, \"worst_ns\": %.0f}%s\n",
+            r->name, r->shape, r->op, r->size, cfg.level, r->ratio, r->p50,
+            r->p99, r->p999, r->mean, r->worst,
+            i + 1 < nb_results ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+  return fclose(f) == 0 ? 0 : -1;
+}
+
+// -------------------------------------------------------------------------
+// Main
+// -------------------------------------------------------------------------
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  --sizes <a,b,..>  payload sizes in bytes (default "
+          "64,256,1024,4096,16384)\n"
+          "  --calls <n>       timed calls per case (default 10000)\n"
+          "  --warmup <n>      untimed calls first (default 200)\n"
+          "  --level <n>       compression level (default 3)\n"
+          "  --cpu <n>         CPU to run on, -1 = no pinning (default 0)\n"
+          "  --json <path>     write results as JSON\n",
+          prog);
+}
+
+static int parse_sizes(const char *s) {
+  cfg.nb_sizes = 0;
+  for (;;) {
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (end == s || v <= 0 || cfg.nb_sizes == MAX_SIZES ||
+        (*end && *end != ','))
+      return -1;
+    cfg.sizes[cfg.nb_sizes++] = (size_t)v;
+    if (!*end)
+      return 0;
+    s = end + 1;
+  }
+}
+
+// Cost of the two clock reads around every call (not subtracted)
+static double timer_overhead(void) {
+  uint64_t best = UINT64_MAX;
+  for (int i = 0; i < 1000; i++) {
+    uint64_t t0 = now_ns();
+    uint64_t t = now_ns() - t0;
+    if (t < best)
+      best = t;
+  }
+  return (double)best;
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = i + 1 < argc ? argv[++i] : NULL;
+    if (!v) {
+      usage(argv[0]);
+      return 1;
+    }
+    if (strcmp(a, "--sizes") == 0 && parse_sizes(v) == 0)
+      continue;
+    else if (strcmp(a, "--calls") == 0 && atoi(v) > 0)
+      cfg.calls = atoi(v);
+    else if (strcmp(a, "--warmup") == 0 && atoi(v) >= 0)
+      cfg.warmup = atoi(v);
+    else if (strcmp(a, "--level") == 0 && atoi(v) >= ZYPHRAX_LEVEL_MIN &&
+             atoi(v) <= ZYPHRAX_LEVEL_MAX)
+      cfg.level = (uint32_t)atoi(v);
+    else if (strcmp(a, "--cpu") == 0)
+      cfg.cpu = atoi(v);
+    else if (strcmp(a, "--json") == 0)
+      cfg.json = v;
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+#ifdef __linux__
+  if (cfg.cpu >= 0) {
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(cfg.cpu, &one);
+    if (sched_setaffinity(0, sizeof(one), &one) != 0)
+      cfg.cpu = -1;
+  }
+#else
+  cfg.cpu = -1;
+#endif
+
+  times = malloc((size_t)cfg.calls * sizeof(*times));
+  if (!times) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  double timer_ns = timer_overhead();
+  printf("%d calls after %d warm-up, level %u, %s, timer %.0f ns/call\n",
+         cfg.calls, cfg.warmup, cfg.level,
+         cfg.cpu >= 0 ? "pinned" : "not pinned", timer_ns);
+  printf("%-36s %7s %9s %9s %9s %9s\n", "Case", "Ratio", "p50 ns", "p99 ns",
+         "p999 ns", "Mean ns");
+
+  int failed = 0;
+  for (size_t k = 0; k < sizeof(shapes) / sizeof(shapes[0]); k++) {
+    rng_state = 0x9E3779B97F4A7C15ull + k;
+    for (int s = 0; s < cfg.nb_sizes; s++)
+      failed |= bench_size(shapes[k].name, shapes[k].gen, cfg.sizes[s]);
+  }
+
+  if (cfg.json && write_json(cfg.json, timer_ns) != 0)
+    failed = 1;
+  free(results);
+  free(times);
+  return failed;
+}
@@ -0,0 +1,373 @@
+// Stage microbenchmarks (make microbench)
+// Times each stage of the block pipeline on its own, over every 64 KB block
+// of a few representative inputs: the match finder parse, the histogram, the
+// Huffman build, the bit packer, the decoder tables and the decode loop,
+// plus zyphrax_match_len_simd on the matches the parse found. Every stage
+// gets its inputs precomputed by the stages before it, runs over all blocks
+// once per round, and keeps its fastest round.
+//
+// Cost is per input byte of the block (per compared byte for match_len),
+// with ns/call alongside. Cycles come from the TSC on x86, which ticks at
+// the nominal clock rather than the core's current one; elsewhere they are
+// ns times --ghz, when given.
+#include "zyphrax.h"
+#include "zyphrax_dec.h"
+#include "zyphrax_huff.h"
+#include "zyphrax_lz77.h"
+#include "zyphrax_seq.h"
+#include "zyphrax_simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#define BLOCK_SIZE (64 * 1024)
+#define MAX_SEQS (BLOCK_SIZE / MIN_MATCH + 256)
+
+static size_t data_size = 4 << 20;
+static int rounds = 10;
+static uint32_t chain = 32; // Adaptive tier 6
+static double ghz;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void) {
+#ifdef HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// -------------------------------------------------------------------------
+// Inputs
+// -------------------------------------------------------------------------
+
+static uint64_t rng_state;
+
+static uint32_t rng(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return (uint32_t)((rng_state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+static void gen_text(uint8_t *buf, size_t size) {
+  const char *w[] = {"the",  "quick", "brown", "fox",    "jumps",
+                     "over", "lazy",  "dog",   "system", "compression",
+                     "a",    "of",    "block", "stream", "entropy"};
+  size_t pos = 0;
+  while (pos < size) {
+    const char *wd = w[rng() % (1 + rng() % 15)];
+    for (size_t i = 0; wd[i] && pos < size; i++)
+      buf[pos++] = (uint8_t)wd[i];
+    if (pos < size)
+      buf[pos++] = rng() % 12 ? ' ' : '\n';
+  }
+}
+
+static void gen_json(uint8_t *buf, size_t size) {
+  char rec[256];
+  size_t pos = 0;
+  for (int i = 0; pos < size; i++) {
+    int w = snprintf(rec, sizeof(rec),
+                     "{\"id\":%d,\"name\":\"user_%d\",\"active\":%s,"
+                     "\"meta\":{\"ip\":\"10.0.%d.%d\",\"ts\":%ld}},",
+                     i, (int)(rng() % 100000), rng() % 3 ? "true" : "false",
+                     (int)(rng() % 255), (int)(rng() % 255),
+                     1600000000L + i * 7 + (long)(rng() % 5));
+    size_t n = size - pos < (size_t)w ? size - pos : (size_t)w;
+    memcpy(buf + pos, rec, n);
+    pos += n;
+  }
+}
+
+// Fixed-size records with slowly changing fields
+static void gen_binary(uint8_t *buf, size_t size) {
+  uint8_t rec[32] = {0};
+  size_t pos = 0;
+  for (uint32_t id = 0; pos < size; id++) {
+    uint32_t ts = 1600000000 + id * 13 + rng() % 8, val = rng() % 10000;
+    memcpy(rec, &id, 4);
+    memcpy(rec + 4, &ts, 4);
+    memcpy(rec + 8, &val, 4);
+    size_t n = size - pos < sizeof(rec) ? size - pos : sizeof(rec);
+    memcpy(buf + pos, rec, n);
+    pos += n;
+  }
+}
+
+static const struct {
+  const char *name;
+  void (*gen)(uint8_t *, size_t);
+} inputs[] = {{"text", gen_text}, {"json", gen_json}, {"binary", gen_binary}};
+
+// -------------------------------------------------------------------------
+// Pipeline State
+// -------------------------------------------------------------------------
+// Everything one block carries from stage to stage
+
+typedef struct {
+  const uint8_t *src;
+  size_t size;
+  zyphrax_sequence_t *seqs;
+  size_t seq_count;
+  zyphrax_huffman_t lit, off, token;
+  uint8_t *enc; // Huffman payload: code length tables, then the bitstream
+  size_t enc_size;
+  uint8_t *dec;
+} block_t;
+
+static zyphrax_lz77_t *lz;
+static zyphrax_dec_ws_t *dws;
+static uint8_t seq_sink[BLOCK_SIZE]; // Keeps the match lengths observable
+
+// Same loop as the encoder's parse, testing every position
+static size_t stage_parse(block_t *b) {
+  size_t pos = 0, lit_start = 0;
+  b->seq_count = 0;
+  while (pos < b->size) {
+    zyphrax_match_t m = zyphrax_find_best_match(lz, b->src, pos, b->size);
+    if (m.length >= MIN_MATCH) {
+      zyphrax_sequence_t *s = &b->seqs[b->seq_count++];
+      s->literals = b->src + lit_start;
+      s->lit_len = pos - lit_start;
+      s->match = m;
+      pos += m.length;
+      lit_start = pos;
+    } else {
+      pos++;
+    }
+  }
+  if (lit_start < b->size) {
+    zyphrax_sequence_t *s = &b->seqs[b->seq_count++];
+    s->literals = b->src + lit_start;
+    s->lit_len = b->size - lit_start;
+    s->match.length = 0;
+    s->match.offset = 0;
+  }
+  zyphrax_lz77_reset(lz, b->src, b->size);
+  return b->size;
+}
+
+static size_t stage_analyze(block_t *b) {
+  zyphrax_analyze_sequences(b->seqs, b->seq_count, &b->lit, &b->off,
+                            &b->token);
+  return b->size;
+}
+
+static size_t stage_build(block_t *b) {
+  zyphrax_build_huffman(&b->lit);
+  zyphrax_build_huffman(&b->off);
+  zyphrax_build_huffman(&b->token);
+  return b->size;
+}
+
+static size_t stage_encode(block_t *b) {
+  b->enc_size = zyphrax_huffman_encode(b->seqs, b->seq_count, b->enc,
+                                       2 * BLOCK_SIZE + 1024, &b->lit,
+                                       &b->off, &b->token);
+  return b->enc_size ? b->size : 0;
+}
+
+static size_t stage_dec_table(block_t *b) {
+  zyphrax_build_dec_table(&dws->token, b->token.code_len);
+  zyphrax_build_dec_table(&dws->lit, b->lit.code_len);
+  zyphrax_build_dec_table(&dws->off, b->off.code_len);
+  return b->size;
+}
+
+// Needs this block's tables in dws; time_stage rebuilds them untimed
+static size_t stage_decode(block_t *b) {
+  return zyphrax_decode_sequences(dws, b->enc + 384, b->enc_size - 384,
+                                  b->dec, b->size);
+}
+
+// Re-measures every match of the parse; returns the bytes compared
+static size_t stage_match_len(block_t *b) {
+  size_t bytes = 0;
+  const uint8_t *p = b->src;
+  for (size_t i = 0; i < b->seq_count; i++) {
+    const zyphrax_sequence_t *s = &b->seqs[i];
+    p += s->lit_len;
+    if (s->match.length == 0)
+      break;
+    size_t max = (size_t)(b->src + b->size - p);
+    if (max > MAX_MATCH)
+      max = MAX_MATCH;
+    size_t n = zyphrax_match_len_simd(p, p - s->match.offset, max);
+    seq_sink[i % BLOCK_SIZE] = (uint8_t)n;
+    bytes += n;
+    p += s->match.length;
+  }
+  return bytes;
+}
+
+// -------------------------------------------------------------------------
+// Timing
+// -------------------------------------------------------------------------
+
+typedef struct {
+  const char *name;
+  size_t (*fn)(block_t *);
+  int needs_tables; // Rebuild the decoder tables before each call
+  int per_match;    // Counts calls and bytes per match, not per block
+} stage_t;
+
+static const stage_t stages[] = {
+    {"find_best_match (parse)", stage_parse, 0, 0},
+    {"analyze_sequences", stage_analyze, 0, 0},
+    {"build_huffman (x3)", stage_build, 0, 0},
+    {"huffman_encode", stage_encode, 0, 0},
+    {"build_dec_table (x3)", stage_dec_table, 0, 0},
+    {"decode loop", stage_decode, 1, 0},
+    {"match_len_simd", stage_match_len, 0, 1},
+};
+
+// Runs the stage over every block, rounds times; reports the fastest round.
+// Returns -1 if the stage failed on a block
+static int time_stage(const stage_t *st, block_t *blocks, size_t nb) {
+  double best_ns = 1e300, best_cyc = 0;
+  size_t bytes = 0, calls = 0;
+  for (int r = 0; r <= rounds; r++) { // Round 0 warms up
+    double ns = 0, cyc = 0;
+    bytes = 0;
+    calls = 0;
+    for (size_t i = 0; i < nb; i++) {
+      if (st->needs_tables)
+        stage_dec_table(&blocks[i]);
+      double t0 = now_ns();
+      uint64_t c0 = now_cycles();
+      size_t n = st->fn(&blocks[i]);
+      cyc += (double)(now_cycles() - c0);
+      ns += now_ns() - t0;
+      if (n == 0 && !st->per_match)
+        return -1;
+      bytes += n;
+      calls += st->per_match ? blocks[i].seq_count : 1;
+    }
+    if (r > 0 && ns < best_ns) {
+      best_ns = ns;
+      best_cyc = cyc;
+    }
+  }
+  if (!bytes)
+    bytes = 1;
+
+  char cycles[32] = "-";
+#ifdef HAVE_TSC
+  snprintf(cycles, sizeof(cycles), "%.3f", best_cyc / bytes);
+#else
+  (void)best_cyc;
+  if (ghz > 0)
+    snprintf(cycles, sizeof(cycles), "%.3f", best_ns * ghz / bytes);
+#endif
+  printf("  %-26s %10.3f %12s %12.1f\n", st->name, best_ns / bytes, cycles,
+         best_ns / calls);
+  return 0;
+}
+
+static int bench_input(const char *name, const uint8_t *data, size_t size) {
+  size_t nb = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  block_t *blocks = calloc(nb, sizeof(*blocks));
+  int ret = -1;
+  if (!blocks)
+    return -1;
+  for (size_t i = 0; i < nb; i++) {
+    block_t *b = &blocks[i];
+    b->src = data + i * BLOCK_SIZE;
+    b->size = size - i * BLOCK_SIZE < BLOCK_SIZE ? size - i * BLOCK_SIZE
+                                                 : BLOCK_SIZE;
+    b->seqs = malloc(MAX_SEQS * sizeof(*b->seqs));
+    b->enc = malloc(2 * BLOCK_SIZE + 1024);
+    b->dec = malloc(BLOCK_SIZE);
+    if (!b->seqs || !b->enc || !b->dec)
+      goto done;
+  }
+
+  // One untimed pass through the pipeline: every stage gets real inputs
+  size_t enc_total = 0;
+  for (size_t i = 0; i < nb; i++) {
+    block_t *b = &blocks[i];
+    stage_parse(b);
+    stage_analyze(b);
+    stage_build(b);
+    if (!stage_encode(b))
+      goto done;
+    stage_dec_table(b);
+    if (stage_decode(b) != b->size || memcmp(b->dec, b->src, b->size) != 0) {
+      fprintf(stderr, "%s: block %zu does not round-trip\n", name, i);
+      goto done;
+    }
+    enc_total += b->enc_size;
+  }
+
+  printf("%s: %zu blocks of %d KB, chain %u, entropy-coded ratio %.2f\n",
+         name, nb, BLOCK_SIZE / 1024, chain, (double)size / enc_total);
+  printf("  %-26s %10s %12s %12s\n", "Stage", "ns/byte", "cycles/byte",
+         "ns/call");
+  for (size_t s = 0; s < sizeof(stages) / sizeof(stages[0]); s++)
+    if (time_stage(&stages[s], blocks, nb) != 0) {
+      fprintf(stderr, "%s: %s failed\n", name, stages[s].name);
+      goto done;
+    }
+  ret = 0;
+
+done:
+  for (size_t i = 0; i < nb; i++) {
+    free(blocks[i].seqs);
+    free(blocks[i].enc);
+    free(blocks[i].dec);
+  }
+  free(blocks);
+  return ret;
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--size") == 0 && atol(argv[i + 1]) > 0)
+      data_size = (size_t)atol(argv[i + 1]) << 20;
+    else if (strcmp(argv[i], "--rounds") == 0 && atoi(argv[i + 1]) > 0)
+      rounds = atoi(argv[i + 1]);
+    else if (strcmp(argv[i], "--chain") == 0 && atoi(argv[i + 1]) > 0)
+      chain = (uint32_t)atoi(argv[i + 1]);
+    else if (strcmp(argv[i], "--ghz") == 0)
+      ghz = atof(argv[i + 1]);
+    else {
+      fprintf(stderr,
+              "Usage: %s [--size MB] [--rounds n] [--chain n] [--ghz f]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  lz = malloc(sizeof(*lz));
+  dws = malloc(sizeof(*dws));
+  uint8_t *data = malloc(data_size);
+  if (!lz || !dws || !data) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  zyphrax_lz77_init(lz);
+  lz->max_chain = chain;
+
+  int failed = 0;
+  for (size_t k = 0; k < sizeof(inputs) / sizeof(inputs[0]); k++) {
+    rng_state = 0x9E3779B97F4A7C15ull + k;
+    inputs[k].gen(data, data_size);
+    failed |= bench_input(inputs[k].name, data, data_size) != 0;
+  }
+
+  free(lz);
+  free(dws);
+  free(data);
+  return failed;
+}
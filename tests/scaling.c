@@ -0,0 +1,729 @@
+// Thread scaling benchmark (make scaling)
+// Sweeps 1..N threads and reports aggregate and per-thread throughput of
+// compression and decompression, and the scaling efficiency: aggregate
+// throughput over N times the one-thread figure. Two ways of using cores:
+//   independent  N threads, each with its own context and its own copy of
+//                the input, as a worker pool serving separate requests
+//   shared       one call on one input with an N-worker context
+//                (zyphrax_compress_cctx, zyphrax_decompress_dctx_mt)
+// Threads are pinned one per CPU, filling a NUMA node before the next
+// (--order compact) or taking nodes in turns (--order spread). With --numa
+// each independent thread allocates and writes its own buffers after
+// pinning, so first touch places them on its node; without it the main
+// thread allocates everything, as a pool that is handed buffers would.
+// --json writes the results for scripts/bench_compare.py
+// (--metric aggregate_mbps).
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+#include "zyphrax.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_COUNTS 64
+#define MAX_RUNS 100
+#define MAX_CPUS 1024
+
+typedef struct {
+  size_t size; // Input bytes per independent thread, and of the shared input
+  int counts[MAX_COUNTS]; // Thread counts to run
+  int nb_counts;
+  int runs;       // Timed runs per case, the median is reported
+  double seconds; // Length of a run
+  uint32_t level;
+  int spread; // Pin across NUMA nodes in turns rather than node by node
+  int numa;   // Independent threads allocate their own buffers
+  int independent, shared;
+  const char *json;
+} scaling_config_t;
+
+static scaling_config_t cfg = {
+    .size = 8 << 20,
+    .runs = 3,
+    .seconds = 0.5,
+    .level = 3,
+    .independent = 1,
+    .shared = 1,
+};
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void sleep_sec(double s) {
+  struct timespec ts = {(time_t)s, (long)((s - (double)(time_t)s) * 1e9)};
+  nanosleep(&ts, NULL);
+}
+
+// -------------------------------------------------------------------------
+// Input
+// -------------------------------------------------------------------------
+// JSON, binary, text and random in turns of 256 KB; seeded, so every thread
+// of every run works on the same bytes
+
+static uint64_t rng_state;
+
+static uint32_t rng(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return (uint32_t)((rng_state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+static void gen_segment(uint8_t *buf, size_t size, int kind) {
+  static const char *words[] = {"the",   "quick",  "brown", "fox",
+                                "jumps", "over",   "lazy",  "dog",
+                                "block", "stream", "of",    "entropy"};
+  size_t pos = 0;
+  char rec[160];
+  for (uint32_t i = 0; pos < size; i++) {
+    size_t n;
+    switch (kind) {
+    case 0:
+      n = (size_t)snprintf(rec, sizeof(rec),
+                           "{\"id\":%u,\"name\":\"user_%u\",\"active\":%s,"
+                           "\"ts\":%u},",
+                           i, rng() % 100000, rng() % 3 ? "true" : "false",
+                           1600000000u + i * 7 + rng() % 5);
+      break;
+    case 1: {
+      uint32_t r[4] = {i, 1600000000u + i * 13 + rng() % 8, rng() % 10000,
+                       0};
+      memcpy(rec, r, sizeof(r));
+      n = sizeof(r);
+      break;
+    }
+    case 2:
+      n = (size_t)snprintf(rec, sizeof(rec), "%s%c", words[rng() % 12],
+                           rng() % 12 ? ' ' : '\n');
+      break;
+    default:
+      for (n = 0; n < 16; n++)
+        rec[n] = (char)rng();
+    }
+    if (n > size - pos)
+      n = size - pos;
+    memcpy(buf + pos, rec, n);
+    pos += n;
+  }
+}
+
+static void gen_mixed(uint8_t *buf, size_t size) {
+  size_t seg = 256 << 10;
+  rng_state = 0x9E3779B97F4A7C15ull;
+  for (size_t pos = 0, k = 0; pos < size; pos += seg, k++)
+    gen_segment(buf + pos, size - pos < seg ? size - pos : seg, (int)(k % 4));
+}
+
+// -------------------------------------------------------------------------
+// CPUs and NUMA Nodes
+// -------------------------------------------------------------------------
+// cpus[] lists the CPUs we may run on in pinning order; thread i runs on
+// cpus[i % nb_cpus]. Nodes come from sysfs, so no libnuma is needed.
+
+static int cpus[MAX_CPUS], cpu_node[MAX_CPUS];
+static int nb_cpus, nb_nodes = 1;
+
+#ifdef __linux__
+static cpu_set_t initial_mask;
+
+// Node of every CPU from /sys/devices/system/node/node<n>/cpulist
+static void read_nodes(void) {
+  for (int node = 0; node < 256; node++) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+             node);
+    FILE *f = fopen(path, "r");
+    if (!f)
+      continue;
+    int lo, hi;
+    char sep;
+    while (fscanf(f, "%d", &lo) == 1) {
+      hi = lo;
+      if (fscanf(f, "%c", &sep) == 1 && sep == '-') {
+        if (fscanf(f, "%d", &hi) != 1)
+          break;
+        if (fscanf(f, "%c", &sep) != 1)
+          sep = '\n';
+      }
+      for (int c = lo; c <= hi && c < MAX_CPUS; c++)
+        cpu_node[c] = node;
+      if (sep != ',')
+        break;
+    }
+    fclose(f);
+    if (node + 1 > nb_nodes)
+      nb_nodes = node + 1;
+  }
+}
+
+static void cpus_init(void) {
+  sched_getaffinity(0, sizeof(initial_mask), &initial_mask);
+  read_nodes();
+  // Compact: node by node, CPUs in order within each
+  for (int node = 0; node < nb_nodes; node++)
+    for (int c = 0; c < MAX_CPUS && c < CPU_SETSIZE; c++)
+      if (CPU_ISSET(c, &initial_mask) && cpu_node[c] == node)
+        cpus[nb_cpus++] = c;
+  if (nb_cpus == 0) { // Affinity unknown: run unpinned
+    cpus[0] = -1;
+    nb_cpus = 1;
+    return;
+  }
+  if (!cfg.spread || nb_nodes == 1)
+    return;
+  // Spread: the first CPU of every node, then the second, ...
+  int compact[MAX_CPUS], taken[256] = {0}, n = 0;
+  memcpy(compact, cpus, sizeof(int) * (size_t)nb_cpus);
+  while (n < nb_cpus) {
+    for (int node = 0; node < nb_nodes; node++) {
+      int seen = 0;
+      for (int i = 0; i < nb_cpus; i++) {
+        if (cpu_node[compact[i]] != node)
+          continue;
+        if (seen++ == taken[node]) {
+          cpus[n++] = compact[i];
+          taken[node]++;
+          break;
+        }
+      }
+    }
+  }
+}
+
+static void pin_self(int cpu) {
+  cpu_set_t one;
+  CPU_ZERO(&one);
+  CPU_SET(cpu, &one);
+  pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+}
+
+// Restricts the calling thread, and the threads it creates from now on, to
+// the first n CPUs of the order (n = 0: back to the initial mask)
+static void pin_first(int n) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int i = 0; i < n && i < nb_cpus; i++)
+    CPU_SET(cpus[i], &set);
+  sched_setaffinity(0, sizeof(set), n ? &set : &initial_mask);
+}
+#else
+static void cpus_init(void) {
+  cpus[0] = -1;
+  nb_cpus = 1;
+}
+static void pin_self(int cpu) { (void)cpu; }
+static void pin_first(int n) { (void)n; }
+#endif
+
+// Distinct nodes the first n threads run on
+static int nodes_used(int n) {
+  int used[256] = {0}, count = 0;
+  for (int i = 0; i < n && i < nb_cpus; i++) {
+    int node = cpus[i] >= 0 ? cpu_node[cpus[i]] : 0;
+    if (!used[node]++)
+      count++;
+  }
+  return count;
+}
+
+// -------------------------------------------------------------------------
+// Results
+// -------------------------------------------------------------------------
+
+typedef struct {
+  char name[64];
+  const char *mode;
+  const char *op;
+  int threads;
+  int nodes;
+  double ratio;
+  double aggregate;  // MB/s, median over runs
+  double per_thread; // aggregate / threads
+  double slowest;    // MB/s of the slowest thread (independent only)
+  double efficiency; // aggregate / (threads * one-thread aggregate)
+} scaling_result_t;
+
+static scaling_result_t *results;
+static size_t nb_results, results_cap;
+
+static scaling_result_t *new_result(const char *mode, const char *op,
+                                    int threads) {
+  if (nb_results == results_cap) {
+    results_cap = results_cap ? results_cap * 2 : 64;
+    results = realloc(results, results_cap * sizeof(*results));
+    if (!results) {
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+    }
+  }
+  scaling_result_t *r = &results[nb_results++];
+  memset(r, 0, sizeof(*r));
+  r->mode = mode;
+  r->op = op;
+  r->threads = threads;
+  r->nodes = nodes_used(threads);
+  snprintf(r->name, sizeof(r->name), "%s/L%u/%s-t%d", mode, cfg.level, op,
+           threads);
+  return r;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double median(double *v, int n) {
+  qsort(v, (size_t)n, sizeof(*v), cmp_double);
+  return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// Efficiency against the one-thread result of the same mode and op, if run
+static void finish_result(scaling_result_t *r) {
+  r->per_thread = r->aggregate / r->threads;
+  r->efficiency = 0;
+  for (size_t i = 0; i < nb_results; i++) {
+    const scaling_result_t *one = &results[i];
+    if (one->threads == 1 && one->mode == r->mode && one->op == r->op &&
+        one->aggregate > 0)
+      r->efficiency = r->aggregate / (r->threads * one->aggregate);
+  }
+  printf("%-28s %5d %6.3f %12.1f %12.1f", r->name, r->nodes, r->ratio,
+         r->aggregate, r->per_thread);
+  if (r->slowest > 0)
+    printf(" %10.1f", r->slowest);
+  else
+    printf(" %10s", "-");
+  if (r->efficiency > 0)
+    printf(" %8.1f%%\n", r->efficiency * 100);
+  else
+    printf(" %9s\n", "-");
+  fflush(stdout);
+}
+
+// -------------------------------------------------------------------------
+// Independent Threads
+// -------------------------------------------------------------------------
+
+// Counted barrier for the workers and the main thread; macOS has no
+// pthread_barrier_t
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int parties, waiting;
+  unsigned generation;
+} barrier_t;
+
+static void barrier_wait(barrier_t *b) {
+  pthread_mutex_lock(&b->lock);
+  unsigned gen = b->generation;
+  if (++b->waiting == b->parties) {
+    b->waiting = 0;
+    b->generation++;
+    pthread_cond_broadcast(&b->cond);
+  } else {
+    while (gen == b->generation)
+      pthread_cond_wait(&b->cond, &b->lock);
+  }
+  pthread_mutex_unlock(&b->lock);
+}
+
+typedef struct {
+  int cpu;
+  const uint8_t *input; // Generated by the main thread
+  uint8_t *src, *comp, *dec;
+  size_t comp_cap, comp_size;
+  int owned; // src/comp/dec allocated by this thread
+  zyphrax_params_t params;
+  zyphrax_cctx_t *cctx;
+  zyphrax_dctx_t *dctx;
+  double mbps; // Of the last run
+  int failed;
+  pthread_t thread;
+} worker_t;
+
+typedef struct {
+  barrier_t barrier;
+  atomic_int stop;
+  worker_t *workers;
+} pool_t;
+
+static pool_t pool;
+
+// Runs one op until told to stop; returns MB/s
+static double worker_run(worker_t *w, int decompress) {
+  uint64_t bytes = 0;
+  double t0 = now_sec();
+  while (!atomic_load_explicit(&pool.stop, memory_order_relaxed)) {
+    size_t n = decompress ? zyphrax_decompress_dctx(w->dctx, w->comp,
+                                                    w->comp_size, w->dec,
+                                                    cfg.size)
+                          : zyphrax_compress_cctx(w->cctx, w->src, cfg.size,
+                                                  w->comp, w->comp_cap,
+                                                  &w->params);
+    if (n != (decompress ? cfg.size : w->comp_size)) {
+      w->failed = 1;
+      break;
+    }
+    bytes += cfg.size;
+  }
+  return (double)bytes / (now_sec() - t0) / 1e6;
+}
+
+// Per worker: set up, then a start and an end barrier around every run
+// of compression and then of decompression
+static void *worker_main(void *arg) {
+  worker_t *w = (worker_t *)arg;
+  if (w->cpu >= 0)
+    pin_self(w->cpu);
+  if (cfg.numa) {
+    w->src = malloc(cfg.size);
+    w->comp = malloc(w->comp_cap);
+    w->dec = malloc(cfg.size);
+    w->owned = 1;
+    if (w->src && w->comp && w->dec) {
+      memcpy(w->src, w->input, cfg.size);
+      memset(w->comp, 0, w->comp_cap);
+      memset(w->dec, 0, cfg.size);
+    }
+  }
+  w->cctx = zyphrax_cctx_create(1);
+  w->dctx = zyphrax_dctx_create(NULL);
+  if (!w->src || !w->comp || !w->dec || !w->cctx || !w->dctx)
+    w->failed = 1;
+  else {
+    w->comp_size = zyphrax_compress_cctx(w->cctx, w->src, cfg.size, w->comp,
+                                         w->comp_cap, &w->params);
+    if (w->comp_size == 0 ||
+        zyphrax_decompress_dctx(w->dctx, w->comp, w->comp_size, w->dec,
+                                cfg.size) != cfg.size ||
+        memcmp(w->dec, w->src, cfg.size) != 0)
+      w->failed = 1;
+  }
+  barrier_wait(&pool.barrier);
+
+  for (int op = 0; op < 2; op++) {
+    for (int r = 0; r < cfg.runs; r++) {
+      barrier_wait(&pool.barrier);
+      w->mbps = w->failed ? 0 : worker_run(w, op);
+      barrier_wait(&pool.barrier);
+    }
+  }
+  return NULL;
+}
+
+// Every thread count runs compression, then decompression, cfg.runs times;
+// a run's aggregate is the sum of what each thread did over its own window
+static int bench_independent(int n, const uint8_t *input) {
+  worker_t *workers = calloc((size_t)n, sizeof(*workers));
+  if (!workers) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  size_t cap = zyphrax_compress_bound(cfg.size);
+  for (int i = 0; i < n; i++) {
+    worker_t *w = &workers[i];
+    w->cpu = cpus[i % nb_cpus];
+    w->input = input;
+    w->comp_cap = cap;
+    w->params.level = cfg.level;
+    if (!cfg.numa) {
+      w->src = malloc(cfg.size);
+      w->comp = malloc(cap);
+      w->dec = malloc(cfg.size);
+      if (w->src)
+        memcpy(w->src, input, cfg.size);
+    }
+  }
+  pthread_mutex_init(&pool.barrier.lock, NULL);
+  pthread_cond_init(&pool.barrier.cond, NULL);
+  pool.barrier.parties = n + 1;
+  pool.barrier.waiting = 0;
+  atomic_init(&pool.stop, 0);
+  pool.workers = workers;
+  for (int i = 0; i < n; i++) {
+    if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i])) {
+      // The barrier counts on every worker; nothing sensible is left to do
+      fprintf(stderr, "Cannot start thread %d\n", i);
+      exit(1);
+    }
+  }
+
+  barrier_wait(&pool.barrier);
+  int failed = 0;
+  for (int i = 0; i < n; i++)
+    failed |= workers[i].failed;
+  static const char *op_names[] = {"compress", "decompress"};
+  for (int op = 0; op < 2; op++) {
+    double agg[MAX_RUNS], slow[MAX_RUNS];
+    for (int r = 0; r < cfg.runs; r++) {
+      atomic_store(&pool.stop, 0);
+      barrier_wait(&pool.barrier);
+      if (!failed)
+        sleep_sec(cfg.seconds);
+      atomic_store(&pool.stop, 1);
+      barrier_wait(&pool.barrier);
+      agg[r] = 0;
+      slow[r] = workers[0].mbps;
+      for (int i = 0; i < n; i++) {
+        failed |= workers[i].failed;
+        agg[r] += workers[i].mbps;
+        if (workers[i].mbps < slow[r])
+          slow[r] = workers[i].mbps;
+      }
+    }
+    if (failed)
+      continue;
+    scaling_result_t *r = new_result("independent", op_names[op], n);
+    r->ratio = (double)cfg.size / (double)workers[0].comp_size;
+    r->aggregate = median(agg, cfg.runs);
+    r->slowest = median(slow, cfg.runs);
+    finish_result(r);
+  }
+
+  for (int i = 0; i < n; i++) {
+    worker_t *w = &workers[i];
+    pthread_join(w->thread, NULL);
+    zyphrax_cctx_free(w->cctx);
+    zyphrax_dctx_free(w->dctx);
+    free(w->src);
+    free(w->comp);
+    free(w->dec);
+  }
+  pthread_cond_destroy(&pool.barrier.cond);
+  pthread_mutex_destroy(&pool.barrier.lock);
+  free(workers);
+  if (failed)
+    fprintf(stderr, "independent/t%d: round trip FAILED\n", n);
+  return failed;
+}
+
+// -------------------------------------------------------------------------
+// One Shared Input
+// -------------------------------------------------------------------------
+
+// Calls op back to back for cfg.seconds; returns MB/s, 0 on a failed call
+static double shared_run(zyphrax_cctx_t *cctx, zyphrax_dctx_t *dctx,
+                         const zyphrax_params_t *params, const uint8_t *src,
+                         uint8_t *comp, size_t comp_cap, size_t comp_size,
+                         uint8_t *dec, int n, int op) {
+  uint64_t bytes = 0;
+  double t0 = now_sec(), t;
+  do {
+    size_t got = op ? zyphrax_decompress_dctx_mt(dctx, comp, comp_size, dec,
+                                                 cfg.size, (unsigned)n)
+                    : zyphrax_compress_cctx(cctx, src, cfg.size, comp,
+                                            comp_cap, params);
+    if (got != (op ? cfg.size : comp_size))
+      return 0;
+    bytes += cfg.size;
+    t = now_sec();
+  } while (t - t0 < cfg.seconds);
+  return (double)bytes / (t - t0) / 1e6;
+}
+
+// The library's own workers, created while the process is held to the
+// first n CPUs of the order
+static int bench_shared(int n, const uint8_t *input, uint8_t *comp,
+                        size_t comp_cap, uint8_t *dec) {
+  pin_first(n);
+  zyphrax_params_t params = {.level = cfg.level};
+  zyphrax_cctx_t *cctx = zyphrax_cctx_create((unsigned)n);
+  zyphrax_dctx_t *dctx = zyphrax_dctx_create(NULL);
+  size_t comp_size = cctx && dctx ? zyphrax_compress_cctx(cctx, input,
+                                                          cfg.size, comp,
+                                                          comp_cap, &params)
+                                   : 0;
+  int failed = comp_size == 0 ||
+               zyphrax_decompress_dctx_mt(dctx, comp, comp_size, dec, cfg.size,
+                                          (unsigned)n) != cfg.size ||
+               memcmp(dec, input, cfg.size) != 0;
+  static const char *op_names[] = {"compress", "decompress"};
+  for (int op = 0; op < 2 && !failed; op++) {
+    double agg[MAX_RUNS];
+    for (int r = 0; r < cfg.runs && !failed; r++) {
+      agg[r] = shared_run(cctx, dctx, &params, input, comp, comp_cap,
+                          comp_size, dec, n, op);
+      failed = agg[r] == 0;
+    }
+    if (failed)
+      break;
+    scaling_result_t *r = new_result("shared", op_names[op], n);
+    r->ratio = (double)cfg.size / (double)comp_size;
+    r->aggregate = median(agg, cfg.runs);
+    finish_result(r);
+  }
+  zyphrax_cctx_free(cctx);
+  zyphrax_dctx_free(dctx);
+  pin_first(0);
+  if (failed)
+    fprintf(stderr, "shared/t%d: round trip FAILED\n", n);
+  return failed;
+}
+
+// -------------------------------------------------------------------------
+// Output
+// -------------------------------------------------------------------------
+
+static int write_json(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  fprintf(f,
+          "{\n  \"version\": 1,\n  \"config\": {\"size\": %zu, \"runs\": %d, "
+          "\"seconds\": %.3f, \"level\": %u, \"order\": \"%s\", "
+          "\"numa\": %d, \"cpus\": %d, \"nodes\": %d, \"compiler\": \"%s\"},"
+          "\n  \"results\": [\n",
+          cfg.size, cfg.runs, cfg.seconds, cfg.level,
+          cfg.spread ? "spread" : "compact", cfg.numa, nb_cpus, nb_nodes,
+#ifdef __VERSION__
+          __VERSION__
+#else
+          "unknown"
+#endif
+  );
+  for (size_t i = 0; i < nb_results; i++) {
+    const scaling_result_t *r = &results[i];
+    fprintf(f,
+            "    {\"name\": \"%s\", \"dataset\": \"mixed\", \"mode\": \"%s\", "
+            "\"op\": \"%s\", \"threads\": %d, \"nodes\": %d, \"level\": %u, "
+            "\"ratio\": %.4f, \"aggregate_mbps\": %.2f, "
+            "\"per_thread_mbps\": %.2f, \"slowest_mbps\": %.2f, "
+            "\"efficiency\": %.4f}%s\n",
+            r->name, r->mode, r->op, r->threads, r->nodes, cfg.level,
+            r->ratio, r->aggregate, r->per_thread, r->slowest, r->efficiency,
+            i + 1 < nb_results ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+  return fclose(f) == 0 ? 0 : -1;
+}
+
+// -------------------------------------------------------------------------
+// Main
+// -------------------------------------------------------------------------
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  --threads <a,b,..>  thread counts (default 1,2,4,.. up to the "
+          "CPUs)\n"
+          "  --size <MB>         input per thread and of the shared input "
+          "(default 8)\n"
+          "  --runs <n>          timed runs per case, median reported "
+          "(default 3)\n"
+          "  --seconds <s>       length of a run (default 0.5)\n"
+          "  --level <n>         compression level (default 3)\n"
+          "  --order <o>         compact (node by node, default) or spread\n"
+          "  --mode <m>          independent, shared or both (default)\n"
+          "  --numa              independent threads allocate their own "
+          "buffers\n"
+          "  --json <path>       write results as JSON\n",
+          prog);
+}
+
+static int parse_counts(const char *s) {
+  cfg.nb_counts = 0;
+  for (;;) {
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (end == s || v <= 0 || v > MAX_CPUS || cfg.nb_counts == MAX_COUNTS ||
+        (*end && *end != ','))
+      return -1;
+    cfg.counts[cfg.nb_counts++] = (int)v;
+    if (!*end)
+      return 0;
+    s = end + 1;
+  }
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    if (strcmp(a, "--numa") == 0) {
+      cfg.numa = 1;
+      continue;
+    }
+    const char *v = i + 1 < argc ? argv[++i] : NULL;
+    if (!v) {
+      usage(argv[0]);
+      return 1;
+    }
+    if (strcmp(a, "--threads") == 0 && parse_counts(v) == 0)
+      continue;
+    else if (strcmp(a, "--size") == 0 && atoi(v) > 0)
+      cfg.size = (size_t)atoi(v) << 20;
+    else if (strcmp(a, "--runs") == 0 && atoi(v) > 0 && atoi(v) <= MAX_RUNS)
+      cfg.runs = atoi(v);
+    else if (strcmp(a, "--seconds") == 0 && atof(v) > 0)
+      cfg.seconds = atof(v);
+    else if (strcmp(a, "--level") == 0 && atoi(v) >= ZYPHRAX_LEVEL_MIN &&
+             atoi(v) <= ZYPHRAX_LEVEL_MAX)
+      cfg.level = (uint32_t)atoi(v);
+    else if (strcmp(a, "--order") == 0 &&
+             (strcmp(v, "compact") == 0 || strcmp(v, "spread") == 0))
+      cfg.spread = strcmp(v, "spread") == 0;
+    else if (strcmp(a, "--mode") == 0 && (strcmp(v, "independent") == 0 ||
+                                          strcmp(v, "shared") == 0 ||
+                                          strcmp(v, "both") == 0)) {
+      cfg.independent = strcmp(v, "shared") != 0;
+      cfg.shared = strcmp(v, "independent") != 0;
+    } else if (strcmp(a, "--json") == 0)
+      cfg.json = v;
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  cpus_init();
+  if (cfg.nb_counts == 0) {
+    for (int n = 1; n < nb_cpus; n *= 2)
+      cfg.counts[cfg.nb_counts++] = n;
+    cfg.counts[cfg.nb_counts++] = nb_cpus;
+  }
+
+  size_t cap = zyphrax_compress_bound(cfg.size);
+  uint8_t *input = malloc(cfg.size);
+  uint8_t *comp = malloc(cap);
+  uint8_t *dec = malloc(cfg.size);
+  if (!input || !comp || !dec) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  gen_mixed(input, cfg.size);
+
+  printf("%zu MB mixed input, level %u, median of %d runs of %.2f s\n",
+         cfg.size >> 20, cfg.level, cfg.runs, cfg.seconds);
+  printf("%d CPUs on %d NUMA node(s), %s order, %s\n", nb_cpus, nb_nodes,
+         cfg.spread ? "spread" : "compact",
+         cfg.numa ? "per-thread buffers (first touch)"
+                  : "buffers allocated by the main thread");
+  if (cfg.counts[cfg.nb_counts - 1] > nb_cpus)
+    printf("More threads than CPUs: some share a CPU\n");
+  printf("%-28s %5s %6s %12s %12s %10s %9s\n", "Case", "Nodes", "Ratio",
+         "Total MB/s", "Thread MB/s", "Slowest", "Eff.");
+
+  int failed = 0;
+  for (int k = 0; k < cfg.nb_counts && cfg.independent; k++)
+    failed |= bench_independent(cfg.counts[k], input);
+  for (int k = 0; k < cfg.nb_counts && cfg.shared; k++)
+    failed |= bench_shared(cfg.counts[k], input, comp, cap, dec);
+
+  if (cfg.json && write_json(cfg.json) != 0)
+    failed = 1;
+  free(results);
+  free(input);
+  free(comp);
+  free(dec);
+  return failed;
+}
@@ -0,0 +1,163 @@
+#include "zyphrax.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t *make_input(size_t size) {
+  uint8_t *buf = malloc(size);
+  srand(38);
+  for (size_t i = 0; i < size; i++)
+    buf[i] = (uint8_t)("adaptive level "[i % 15] + (rand() % 7 == 0));
+  return buf;
+}
+
+void test_levels() {
+  size_t size = 256 * 1024;
+  uint8_t *src = make_input(size);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  uint8_t *dec = malloc(size);
+
+  size_t sizes[ZYPHRAX_LEVEL_MAX + 1];
+  for (uint32_t level = 0; level <= ZYPHRAX_LEVEL_MAX; level++) {
+    zyphrax_params_t params = {.level = level};
+    sizes[level] = zyphrax_compress(src, size, comp, bound, &params);
+    assert(sizes[level] > 0);
+    assert(zyphrax_decompress(comp, sizes[level], dec, size) == size);
+    assert(memcmp(dec, src, size) == 0);
+  }
+  // Level 0 is the default; more effort never costs ratio here
+  assert(sizes[0] == sizes[ZYPHRAX_LEVEL_DEFAULT]);
+  assert(sizes[ZYPHRAX_LEVEL_MAX] <= sizes[ZYPHRAX_LEVEL_MIN]);
+  // Fixed levels above 1 all search in full, like the original encoder
+  for (uint32_t level = 2; level <= ZYPHRAX_LEVEL_MAX; level++)
+    assert(sizes[level] == sizes[ZYPHRAX_LEVEL_MAX]);
+
+  free(src);
+  free(comp);
+  free(dec);
+  printf("Levels test passed.\n");
+}
+
+// Streams src through cs in 10K pieces, returns the frame size
+static size_t stream_all(zyphrax_cstream_t *cs, const uint8_t *src,
+                         size_t size, uint8_t *dst, size_t cap) {
+  zyphrax_out_buffer_t out = {dst, cap, 0};
+  for (size_t pos = 0; pos < size; pos += 10000) {
+    size_t n = size - pos < 10000 ? size - pos : 10000;
+    zyphrax_in_buffer_t in = {src + pos, n, 0};
+    assert(zyphrax_cstream_update(cs, &out, &in) != ZYPHRAX_STREAM_ERROR);
+    assert(in.pos == in.size);
+  }
+  assert(zyphrax_cstream_end(cs, &out) == 0);
+  return out.pos;
+}
+
+static void check_frame(const uint8_t *comp, size_t comp_size,
+                        const uint8_t *src, size_t size) {
+  uint8_t *dec = malloc(size);
+  assert(zyphrax_decompress(comp, comp_size, dec, size) == size);
+  assert(memcmp(dec, src, size) == 0);
+  free(dec);
+}
+
+void test_adaptive_budget() {
+  size_t size = 2 * 1000 * 1000;
+  uint8_t *src = make_input(size);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  zyphrax_params_t params = {.level = 3, .block_size = 32 * 1024,
+                             .flags = ZYPHRAX_FLAG_SEEK_TABLE};
+
+  // Pipelined, idle workers may lift the level past the budget, so the
+  // exact level is only checked on the caller's thread
+  for (unsigned workers = 1; workers <= 3; workers += 2) {
+    int exact = workers == 1;
+
+    // A budget nothing meets: down to storing blocks
+    zyphrax_cstream_t *cs = zyphrax_cstream_init_mt(&params, workers, 0);
+    zyphrax_adaptive_t adapt = {.target_speed = 1000000000000000ull};
+    assert(zyphrax_cstream_set_adaptive(cs, &adapt) == 0);
+    assert(zyphrax_cstream_level(cs) == ZYPHRAX_LEVEL_DEFAULT);
+    size_t comp_size = stream_all(cs, src, size, comp, bound);
+    assert(!exact || zyphrax_cstream_level(cs) == 0);
+    check_frame(comp, comp_size, src, size);
+    zyphrax_cstream_free(cs);
+
+    // Same, but never below level 2
+    cs = zyphrax_cstream_init_mt(&params, workers, 0);
+    adapt.min_level = 2;
+    assert(zyphrax_cstream_set_adaptive(cs, &adapt) == 0);
+    size_t floor_size = stream_all(cs, src, size, comp, bound);
+    assert(zyphrax_cstream_level(cs) >= 2);
+    assert(!exact || zyphrax_cstream_level(cs) == 2);
+    assert(!exact || floor_size < comp_size);
+    check_frame(comp, floor_size, src, size);
+    zyphrax_cstream_free(cs);
+
+    // A budget everything meets: up to the top
+    cs = zyphrax_cstream_init_mt(&params, workers, 0);
+    adapt = (zyphrax_adaptive_t){.max_block_usec = 60 * 1000 * 1000};
+    assert(zyphrax_cstream_set_adaptive(cs, &adapt) == 0);
+    comp_size = stream_all(cs, src, size, comp, bound);
+    assert(!exact || zyphrax_cstream_level(cs) == ZYPHRAX_LEVEL_MAX);
+    check_frame(comp, comp_size, src, size);
+    zyphrax_cstream_free(cs);
+  }
+
+  free(src);
+  free(comp);
+  printf("Adaptive budget test passed.\n");
+}
+
+void test_adaptive_options() {
+  zyphrax_params_t params = {.level = 3};
+  zyphrax_cstream_t *cs = zyphrax_cstream_init(&params);
+  assert(zyphrax_cstream_level(cs) == 3);
+
+  zyphrax_adaptive_t bad = {.min_level = 5, .max_level = 4};
+  assert(zyphrax_cstream_set_adaptive(cs, &bad) == ZYPHRAX_STREAM_ERROR);
+  bad = (zyphrax_adaptive_t){.max_level = ZYPHRAX_LEVEL_MAX + 1};
+  assert(zyphrax_cstream_set_adaptive(cs, &bad) == ZYPHRAX_STREAM_ERROR);
+
+  // Starts from the default level, clamped into the range
+  zyphrax_adaptive_t adapt = {.min_level = 1, .max_level = 2};
+  assert(zyphrax_cstream_set_adaptive(cs, &adapt) == 0);
+  assert(zyphrax_cstream_level(cs) == 2);
+
+  // Switching back: the rest of the stream is plain params.level again
+  size_t size = 200 * 1024;
+  uint8_t *src = make_input(size);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *ref = malloc(bound);
+  uint8_t *comp = malloc(bound);
+  size_t ref_size = zyphrax_compress(src, size, ref, bound, &params);
+  assert(zyphrax_cstream_set_adaptive(cs, NULL) == 0);
+  assert(zyphrax_cstream_level(cs) == 3);
+  assert(stream_all(cs, src, size, comp, bound) == ref_size);
+  assert(memcmp(comp, ref, ref_size) == 0);
+  zyphrax_cstream_free(cs);
+
+  // Pinned to tier 2, the stream searches less than a fixed level 2 does
+  params.level = 2;
+  cs = zyphrax_cstream_init(&params);
+  adapt = (zyphrax_adaptive_t){.min_level = 2, .max_level = 2};
+  assert(zyphrax_cstream_set_adaptive(cs, &adapt) == 0);
+  size_t tier_size = stream_all(cs, src, size, comp, bound);
+  check_frame(comp, tier_size, src, size);
+  assert(tier_size > zyphrax_compress(src, size, ref, bound, &params));
+  zyphrax_cstream_free(cs);
+
+  free(src);
+  free(ref);
+  free(comp);
+  printf("Adaptive options test passed.\n");
+}
+
+int main() {
+  test_levels();
+  test_adaptive_budget();
+  test_adaptive_options();
+  return 0;
+}
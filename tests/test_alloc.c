@@ -0,0 +1,149 @@
+#include "zyphrax.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Counts what goes through the hooks
+typedef struct {
+  size_t allocs;
+  size_t frees;
+} counting_t;
+
+static void *count_alloc(void *opaque, size_t size) {
+  ((counting_t *)opaque)->allocs++;
+  return malloc(size);
+}
+
+static void count_free(void *opaque, void *ptr) {
+  ((counting_t *)opaque)->frees++;
+  free(ptr);
+}
+
+static uint8_t *make_input(size_t size) {
+  uint8_t *buf = malloc(size);
+  for (size_t i = 0; i < size; i++)
+    buf[i] = (uint8_t)("allocator hooks "[i % 16] ^ (i / 4093));
+  return buf;
+}
+
+void test_allocator_hooks() {
+  size_t size = 600 * 1024;
+  uint8_t *src = make_input(size);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *ref = malloc(bound);
+  uint8_t *comp = malloc(bound);
+  uint8_t *dec = malloc(size);
+
+  zyphrax_params_t params = {.level = 3, .flags = ZYPHRAX_FLAG_SEEK_TABLE};
+  size_t ref_size = zyphrax_compress(src, size, ref, bound, &params);
+  assert(ref_size > 0);
+
+  for (unsigned workers = 1; workers <= 4; workers += 3) {
+    counting_t counts = {0, 0};
+    zyphrax_allocator_t alloc = {count_alloc, count_free, &counts};
+    zyphrax_cctx_t *cctx = zyphrax_cctx_create_advanced(workers, &alloc);
+    assert(cctx);
+    assert(zyphrax_compress_cctx(cctx, src, size, comp, bound, &params) ==
+           ref_size);
+    assert(memcmp(comp, ref, ref_size) == 0);
+
+    // Warm context: no further allocations per call
+    size_t warm = counts.allocs;
+    assert(zyphrax_compress_cctx(cctx, src, size, comp, bound, &params) ==
+           ref_size);
+    assert(counts.allocs == warm);
+
+    zyphrax_cctx_free(cctx);
+    assert(counts.allocs > 0 && counts.allocs == counts.frees);
+  }
+
+  counting_t counts = {0, 0};
+  zyphrax_allocator_t alloc = {count_alloc, count_free, &counts};
+  zyphrax_dctx_t *dctx = zyphrax_dctx_create(&alloc);
+  assert(dctx);
+  assert(zyphrax_decompress_dctx(dctx, ref, ref_size, dec, size) == size);
+  assert(memcmp(dec, src, size) == 0);
+  assert(counts.allocs == 1);
+
+  // Range decoding takes its block index and scratch from the hooks too,
+  // and gives them back
+  memset(dec, 0, size);
+  assert(zyphrax_decompress_range_dctx(dctx, ref, ref_size, 1000, 200000,
+                                       dec) == 200000);
+  assert(memcmp(dec, src + 1000, 200000) == 0);
+  assert(counts.allocs > 1 && counts.allocs == counts.frees + 1);
+  zyphrax_dctx_free(dctx);
+  assert(counts.allocs == counts.frees);
+
+  free(src);
+  free(ref);
+  free(comp);
+  free(dec);
+  printf("Allocator hooks test passed.\n");
+}
+
+void test_static_workspace() {
+  size_t size = 300 * 1024 + 5;
+  uint8_t *src = make_input(size);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *ref = malloc(bound);
+  uint8_t *comp = malloc(bound);
+  uint8_t *dec = malloc(size);
+
+  zyphrax_params_t params = {.level = 3, .block_size = 32 * 1024,
+                             .flags = ZYPHRAX_FLAG_CONTENT_SIZE};
+  size_t ref_size = zyphrax_compress(src, size, ref, bound, &params);
+
+  size_t ws_size = zyphrax_cctx_workspace_size(&params);
+  uint8_t *ws = malloc(ws_size);
+  assert(zyphrax_cctx_init_static(ws, ws_size / 2, &params) == NULL);
+  zyphrax_cctx_t *cctx = zyphrax_cctx_init_static(ws, ws_size, &params);
+  assert(cctx);
+  for (int i = 0; i < 3; i++) {
+    assert(zyphrax_compress_cctx(cctx, src, size, comp, bound, &params) ==
+           ref_size);
+    assert(memcmp(comp, ref, ref_size) == 0);
+  }
+
+  // Blocks larger than the workspace was sized for fail, smaller ones work
+  zyphrax_params_t big = params;
+  big.block_size = 64 * 1024;
+  assert(zyphrax_compress_cctx(cctx, src, size, comp, bound, &big) == 0);
+  zyphrax_params_t small = params;
+  small.block_size = 4096;
+  size_t small_size = zyphrax_compress_cctx(cctx, src, size, comp, bound,
+                                            &small);
+  assert(small_size > 0);
+  zyphrax_cctx_free(cctx); // No-op
+
+  size_t dws_size = zyphrax_dctx_workspace_size();
+  uint8_t *dws = malloc(dws_size);
+  assert(zyphrax_dctx_init_static(dws, 64) == NULL);
+  zyphrax_dctx_t *dctx = zyphrax_dctx_init_static(dws, dws_size);
+  assert(dctx);
+  assert(zyphrax_decompress_dctx(dctx, comp, small_size, dec, size) == size);
+  assert(memcmp(dec, src, size) == 0);
+  assert(zyphrax_decompress_dctx(dctx, ref, ref_size, dec, size) == size);
+  assert(memcmp(dec, src, size) == 0);
+  // No threads or range index without allocating: one thread, or an error
+  memset(dec, 0, size);
+  assert(zyphrax_decompress_dctx_mt(dctx, ref, ref_size, dec, size, 4) ==
+         size);
+  assert(memcmp(dec, src, size) == 0);
+  assert(zyphrax_decompress_range_dctx(dctx, ref, ref_size, 0, 10, dec) == 0);
+
+  free(ws);
+  free(dws);
+  free(src);
+  free(ref);
+  free(comp);
+  free(dec);
+  printf("Static workspace test passed.\n");
+}
+
+int main() {
+  test_allocator_hooks();
+  test_static_workspace();
+  return 0;
+}
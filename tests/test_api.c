@@ -31,12 +31,12 @@ void test_full_roundtrip_compress() {
   assert(comp_size > 12);
   assert(comp_size < size); // Should be compressed
 
-  // Verify Header
-  zyphrax_params_t p_out;
-  // We can't access internal read func, but we check bytes manually
-  // or use zyphrax_decompress which parses header (and returns 0 for now).
-  size_t dec_res = zyphrax_decompress(dst, comp_size, src, size);
-  assert(dec_res == 0); // As expected for Phase 7
+  // Verify Roundtrip
+  uint8_t *dec = malloc(size);
+  size_t dec_res = zyphrax_decompress(dst, comp_size, dec, size);
+  assert(dec_res == size);
+  assert(memcmp(src, dec, size) == 0);
+  free(dec);
 
   // Check magic manual
   assert(dst[0] == 0x59); // Z
@@ -58,7 +58,80 @@ void test_full_roundtrip_compress() {
   printf("Full integration test passed.\n");
 }
 
+void test_content_size() {
+  size_t size = 300 * 1000 + 17;
+  uint8_t *src = malloc(size);
+  for (size_t i = 0; i < size; i++)
+    src[i] = (uint8_t)((i * 7) ^ (i >> 9));
+
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *dst = malloc(bound);
+  uint8_t *dec = malloc(size);
+
+  uint32_t flag_sets[] = {0, ZYPHRAX_FLAG_CONTENT_SIZE, ZYPHRAX_FLAG_SEEK_TABLE,
+                          ZYPHRAX_FLAG_CONTENT_SIZE | ZYPHRAX_FLAG_SEEK_TABLE};
+  for (size_t i = 0; i < 4; i++) {
+    zyphrax_params_t params = {
+        .level = 3, .block_size = 64 * 1024, .flags = flag_sets[i]};
+    size_t comp_size = zyphrax_compress(src, size, dst, bound, &params);
+    assert(comp_size > 0);
+
+    // Header field, seek table sum or block walk: all exact
+    assert(zyphrax_get_content_size(dst, comp_size) == size);
+
+    // Exact-size buffer is enough
+    assert(zyphrax_decompress(dst, comp_size, dec, size) == size);
+    assert(memcmp(src, dec, size) == 0);
+  }
+
+  // Field present: a short buffer fails up front
+  zyphrax_params_t params = {.level = 3,
+                             .block_size = 64 * 1024,
+                             .flags = ZYPHRAX_FLAG_CONTENT_SIZE};
+  size_t comp_size = zyphrax_compress(src, size, dst, bound, &params);
+  assert(zyphrax_decompress(dst, comp_size, dec, size - 1) == 0);
+
+  // Invalid frames
+  assert(zyphrax_get_content_size(dst, 8) == ZYPHRAX_CONTENT_SIZE_ERROR);
+  dst[0] ^= 0xFF;
+  assert(zyphrax_get_content_size(dst, comp_size) ==
+         ZYPHRAX_CONTENT_SIZE_ERROR);
+
+  free(src);
+  free(dst);
+  free(dec);
+  printf("Content size test passed.\n");
+}
+
+void test_large_blocks() {
+  // Blocks over 64K: data repeating exactly 64K apart used to alias the
+  // match finder's 16-bit positions into offset-0 matches
+  size_t size = 3 * 65536 + 100;
+  uint8_t *src = malloc(size);
+  srand(5);
+  for (size_t i = 0; i < 65536; i++)
+    src[i] = (uint8_t)(rand() % 7);
+  for (size_t i = 65536; i < size; i++)
+    src[i] = src[i - 65536];
+
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *dst = malloc(bound);
+  uint8_t *dec = malloc(size);
+  zyphrax_params_t params = {.level = 3, .block_size = 256 * 1024};
+  size_t comp_size = zyphrax_compress(src, size, dst, bound, &params);
+  assert(comp_size > 0);
+  assert(zyphrax_decompress(dst, comp_size, dec, size) == size);
+  assert(memcmp(src, dec, size) == 0);
+
+  free(src);
+  free(dst);
+  free(dec);
+  printf("Large blocks test passed.\n");
+}
+
 int main() {
   test_full_roundtrip_compress();
+  test_content_size();
+  test_large_blocks();
   return 0;
 }
@@ -0,0 +1,236 @@
+#include "zyphrax.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t *make_input(size_t size) {
+  uint8_t *buf = malloc(size);
+  srand(40);
+  for (size_t i = 0; i < size; i++) {
+    // Text with an incompressible stretch, so frames mix both block types
+    if (i / 40000 == 2)
+      buf[i] = (uint8_t)rand();
+    else
+      buf[i] = (uint8_t)("appended frame "[i % 15] + (rand() % 8 == 0));
+  }
+  return buf;
+}
+
+// Streams src through a dstream in 777-byte pieces
+static size_t dstream_all(const uint8_t *src, size_t size, uint8_t *dst,
+                          size_t cap) {
+  zyphrax_dstream_t *ds = zyphrax_dstream_init();
+  zyphrax_out_buffer_t out = {dst, cap, 0};
+  size_t ret = 1;
+  for (size_t pos = 0; pos < size; pos += 777) {
+    zyphrax_in_buffer_t in = {src + pos, size - pos < 777 ? size - pos : 777,
+                              0};
+    ret = zyphrax_dstream_update(ds, &out, &in);
+    if (ret == ZYPHRAX_STREAM_ERROR)
+      break;
+  }
+  zyphrax_dstream_free(ds);
+  return ret == 0 ? out.pos : 0;
+}
+
+// Every whole-input decoder turns comp back into src
+static void check_all(const uint8_t *comp, size_t csz, const uint8_t *src,
+                      size_t size) {
+  uint8_t *dec = malloc(size + 1);
+  assert(zyphrax_decompress(comp, csz, dec, size) == size);
+  assert(memcmp(dec, src, size) == 0);
+  memset(dec, 0, size);
+  assert(zyphrax_decompress_mt(comp, csz, dec, size, 3) == size);
+  assert(memcmp(dec, src, size) == 0);
+  memset(dec, 0, size);
+  assert(dstream_all(comp, csz, dec, size + 1) == size);
+  assert(memcmp(dec, src, size) == 0);
+
+  zyphrax_dctx_t *dctx = zyphrax_dctx_create(NULL);
+  memset(dec, 0, size);
+  assert(zyphrax_decompress_dctx(dctx, comp, csz, dec, size) == size);
+  assert(memcmp(dec, src, size) == 0);
+  zyphrax_dctx_free(dctx);
+  free(dec);
+}
+
+void test_concatenated() {
+  size_t size = 300 * 1000;
+  uint8_t *src = make_input(size);
+  size_t bound = 3 * zyphrax_compress_bound(size) + 100;
+  uint8_t *comp = malloc(bound);
+
+  // [skippable][frame A][skippable][empty frame][frame B][skippable]
+  zyphrax_params_t pa = {.level = 3, .block_size = 32 * 1024,
+                         .flags = ZYPHRAX_FLAG_SEEK_TABLE |
+                                  ZYPHRAX_FLAG_CONTENT_SIZE};
+  zyphrax_params_t pb = {.level = 5, .checksum = ZYPHRAX_CHECKSUM_XXH32};
+  size_t split = 123457;
+  size_t csz = 0, n;
+  n = zyphrax_write_skippable_frame((const uint8_t *)"meta", 4, comp, bound);
+  assert(n == ZYPHRAX_SKIPPABLE_HEADER_SIZE + 4);
+  csz += n;
+  size_t a_start = csz;
+  n = zyphrax_compress(src, split, comp + csz, bound - csz, &pa);
+  assert(n > 0);
+  csz += n;
+  size_t a_end = csz;
+  n = zyphrax_write_skippable_frame(NULL, 0, comp + csz, bound - csz);
+  assert(n == ZYPHRAX_SKIPPABLE_HEADER_SIZE);
+  csz += n;
+  n = zyphrax_compress(src, 0, comp + csz, bound - csz, &pb);
+  assert(n > 0);
+  csz += n;
+  n = zyphrax_compress(src + split, size - split, comp + csz, bound - csz, &pb);
+  assert(n > 0);
+  csz += n;
+  size_t b_end = csz;
+  n = zyphrax_write_skippable_frame(src, 1000, comp + csz, bound - csz);
+  csz += n;
+
+  check_all(comp, csz, src, size);
+
+  // Frames are found by walking their headers
+  assert(zyphrax_find_frame_size(comp, csz) == 12);
+  assert(zyphrax_find_frame_size(comp + a_start, csz - a_start) ==
+         a_end - a_start);
+  assert(zyphrax_find_frame_size(comp + a_end, 7) == 0);
+  assert(zyphrax_get_content_size(comp + a_start, csz - a_start) == split);
+
+  // The first frame's seek table still serves ranges with more following
+  uint8_t *dec = malloc(size);
+  assert(zyphrax_decompress_range(comp + a_start, csz - a_start, 100000, 20000,
+                                  dec) == 20000);
+  assert(memcmp(dec, src + 100000, 20000) == 0);
+
+  // A truncated last frame or stray bytes after the last one fail
+  assert(zyphrax_decompress(comp, csz - 1, dec, size) == 0);
+  comp[csz] = 0x42;
+  assert(zyphrax_decompress(comp, csz + 1, dec, size) == 0);
+  assert(dstream_all(comp, csz + 1, dec, size) == 0);
+  // As does a frame cut short by the next one (B without its checksum block)
+  size_t cut = b_end - 13;
+  uint8_t *bad = malloc(bound);
+  memcpy(bad, comp, cut);
+  memcpy(bad + cut, comp + b_end, csz - b_end);
+  assert(zyphrax_decompress(bad, csz - 13, dec, size) == 0);
+  assert(zyphrax_decompress_mt(bad, csz - 13, dec, size, 3) == 0);
+  assert(dstream_all(bad, csz - 13, dec, size) == 0);
+
+  free(src);
+  free(comp);
+  free(bad);
+  free(dec);
+  printf("Concatenated frames test passed.\n");
+}
+
+void test_append() {
+  size_t size = 400 * 1000;
+  uint8_t *src = make_input(size);
+  size_t pieces[] = {0, 70000, 1, 129999, 200000};
+  zyphrax_params_t cases[] = {
+      {.level = 3, .block_size = 32 * 1024},
+      {.level = 2, .block_size = 16 * 1024, .flags = ZYPHRAX_FLAG_SEEK_TABLE},
+      {.level = 4, .flags = ZYPHRAX_FLAG_CONTENT_SIZE},
+      {.level = 3, .block_size = 32 * 1024,
+       .checksum = ZYPHRAX_CHECKSUM_CRC32C,
+       .flags = ZYPHRAX_FLAG_SEEK_TABLE | ZYPHRAX_FLAG_CONTENT_SIZE |
+                ZYPHRAX_FLAG_SPLIT_BLOCKS},
+  };
+  size_t bound = 2 * zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  uint8_t *dec = malloc(size);
+
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    zyphrax_params_t *p = &cases[c];
+    // A skippable frame ahead of the frame that grows
+    size_t csz = zyphrax_write_skippable_frame((const uint8_t *)"hdr", 3, comp,
+                                               bound);
+    size_t lead = csz;
+    csz += zyphrax_compress(src, pieces[0], comp + csz, bound - csz, p);
+    zyphrax_cctx_t *cctx = zyphrax_cctx_create(c % 2 ? 3 : 1);
+
+    size_t done = pieces[0];
+    for (size_t i = 1; i < sizeof(pieces) / sizeof(pieces[0]); i++) {
+      zyphrax_params_t level = {.level = 1 + (uint32_t)i};
+      size_t cap = csz + zyphrax_compress_bound(pieces[i]);
+      size_t n = i % 2 ? zyphrax_append(comp, csz, cap, src + done, pieces[i],
+                                        i == 1 ? NULL : &level)
+                       : zyphrax_append_cctx(cctx, comp, csz, cap, src + done,
+                                             pieces[i], &level);
+      assert(n > csz || (n == csz && pieces[i] == 0));
+      csz = n;
+      done += pieces[i];
+
+      check_all(comp, csz, src, done);
+      assert(zyphrax_get_content_size(comp + lead, csz - lead) == done);
+      if (done > 1000) {
+        assert(zyphrax_decompress_range(comp + lead, csz - lead, done - 1000,
+                                        1000, dec) == 1000);
+        assert(memcmp(dec, src + done - 1000, 1000) == 0);
+      }
+    }
+    assert(done == size);
+    zyphrax_cctx_free(cctx);
+  }
+
+  free(src);
+  free(comp);
+  free(dec);
+  printf("Append test passed.\n");
+}
+
+void test_append_errors() {
+  size_t size = 100 * 1000;
+  uint8_t *src = make_input(size);
+  size_t bound = 2 * zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  uint8_t *copy = malloc(bound);
+  zyphrax_params_t params = {.level = 3, .block_size = 16 * 1024,
+                             .checksum = ZYPHRAX_CHECKSUM_XXH32,
+                             .flags = ZYPHRAX_FLAG_SEEK_TABLE};
+  size_t csz = zyphrax_compress(src, size / 2, comp, bound, &params);
+  memcpy(copy, comp, bound);
+
+  // Too little room, for the blocks or just the new trailer: dst is left
+  // as it was
+  size_t full = zyphrax_append(copy, csz, bound, src + size / 2, size / 2,
+                               NULL);
+  assert(full > csz);
+  memcpy(copy, comp, csz);
+  for (size_t cap = csz; cap < full; cap += cap + 60 < full ? 997 : 1) {
+    assert(zyphrax_append(comp, csz, cap, src + size / 2, size / 2, NULL) ==
+           0);
+    assert(memcmp(comp, copy, csz) == 0);
+  }
+
+  // Nothing to append to: empty, truncated, skippable last or corrupt frames
+  assert(zyphrax_append(comp, 0, bound, src, 10, NULL) == 0);
+  assert(zyphrax_append(comp, csz - 1, bound, src, 10, NULL) == 0);
+  size_t n = zyphrax_write_skippable_frame(NULL, 0, comp + csz, bound - csz);
+  assert(zyphrax_append(comp, csz + n, bound, src, 10, NULL) == 0);
+  comp[22] ^= 1; // First block's checksum: the frame checksum breaks
+  assert(zyphrax_append(comp, csz, bound, src, 10, NULL) == 0);
+  comp[22] ^= 1;
+
+  // Still appendable after the failures
+  n = zyphrax_append(comp, csz, bound, src + size / 2, size / 2, NULL);
+  assert(n > csz);
+  uint8_t *dec = malloc(size);
+  assert(zyphrax_decompress(comp, n, dec, size) == size);
+  assert(memcmp(dec, src, size) == 0);
+
+  free(src);
+  free(comp);
+  free(copy);
+  free(dec);
+  printf("Append errors test passed.\n");
+}
+
+int main() {
+  test_concatenated();
+  test_append();
+  test_append_errors();
+  return 0;
+}
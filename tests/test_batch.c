@@ -0,0 +1,111 @@
+#include "zyphrax.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NB_MSGS 2000
+
+// Message bus payloads: 200 B to 8 KB of JSON-ish records
+static size_t make_message(uint8_t *buf, size_t i) {
+  size_t size = 200 + (size_t)rand() % (8 * 1024 - 200);
+  size_t pos = 0;
+  while (pos < size) {
+    char rec[96];
+    int n = snprintf(rec, sizeof(rec),
+                     "{\"seq\":%zu,\"topic\":\"orders\",\"qty\":%d},", i + pos,
+                     rand() % 100);
+    size_t take = (size_t)n < size - pos ? (size_t)n : size - pos;
+    memcpy(buf + pos, rec, take);
+    pos += take;
+  }
+  return size;
+}
+
+static void batch_roundtrip(unsigned workers) {
+  srand(99);
+  size_t cap = zyphrax_compress_bound(8 * 1024);
+  uint8_t *srcs = malloc((size_t)NB_MSGS * 8 * 1024);
+  uint8_t *comps = malloc((size_t)NB_MSGS * cap);
+  uint8_t *decs = malloc((size_t)NB_MSGS * 8 * 1024);
+  zyphrax_batch_item_t *items = malloc(NB_MSGS * sizeof(*items));
+
+  for (size_t i = 0; i < NB_MSGS; i++) {
+    uint8_t *src = srcs + i * 8 * 1024;
+    items[i].src = src;
+    items[i].src_size = make_message(src, i);
+    items[i].dst = comps + i * cap;
+    items[i].dst_cap = cap;
+  }
+
+  zyphrax_params_t params = {.level = 3, .flags = ZYPHRAX_FLAG_CONTENT_SIZE};
+  zyphrax_cctx_t *cctx = zyphrax_cctx_create(workers);
+  assert(cctx);
+  assert(zyphrax_compress_batch(cctx, items, NB_MSGS, &params) == NB_MSGS);
+
+  // Same frames as one call per message
+  uint8_t *ref = malloc(cap);
+  for (size_t i = 0; i < NB_MSGS; i += 7) {
+    size_t ref_size =
+        zyphrax_compress(items[i].src, items[i].src_size, ref, cap, &params);
+    assert(items[i].result == ref_size);
+    assert(memcmp(items[i].dst, ref, ref_size) == 0);
+  }
+  free(ref);
+
+  // Decompress: compressed frames become the sources
+  zyphrax_batch_item_t *back = malloc(NB_MSGS * sizeof(*back));
+  for (size_t i = 0; i < NB_MSGS; i++) {
+    back[i].src = items[i].dst;
+    back[i].src_size = items[i].result;
+    back[i].dst = decs + i * 8 * 1024;
+    back[i].dst_cap = 8 * 1024;
+  }
+  assert(zyphrax_decompress_batch(back, NB_MSGS) == NB_MSGS);
+  for (size_t i = 0; i < NB_MSGS; i++) {
+    assert(back[i].result == items[i].src_size);
+    assert(memcmp(back[i].dst, items[i].src, items[i].src_size) == 0);
+  }
+
+  // On a context: a static one works, and statistics cover the whole batch
+  size_t dws_size = zyphrax_dctx_workspace_size();
+  void *dws = malloc(dws_size);
+  zyphrax_dctx_t *dctx = zyphrax_dctx_init_static(dws, dws_size);
+  zyphrax_dctx_set_stats(dctx, 1, NULL, NULL);
+  memset(decs, 0, (size_t)NB_MSGS * 8 * 1024);
+  assert(zyphrax_decompress_batch_dctx(dctx, back, NB_MSGS) == NB_MSGS);
+  size_t total = 0;
+  for (size_t i = 0; i < NB_MSGS; i++) {
+    assert(back[i].result == items[i].src_size);
+    assert(memcmp(back[i].dst, items[i].src, items[i].src_size) == 0);
+    total += items[i].src_size;
+  }
+  zyphrax_stats_t stats;
+  zyphrax_dctx_get_stats(dctx, &stats);
+  assert(stats.src_bytes == total && stats.blocks >= NB_MSGS);
+  free(dws);
+
+  // One item without room fails alone
+  items[5].dst_cap = 10;
+  assert(zyphrax_compress_batch(cctx, items, NB_MSGS, &params) ==
+         NB_MSGS - 1);
+  assert(items[5].result == 0 && items[6].result > 0);
+
+  zyphrax_cctx_free(cctx);
+  free(srcs);
+  free(comps);
+  free(decs);
+  free(items);
+  free(back);
+}
+
+void test_batch_roundtrip() {
+  batch_roundtrip(1);
+  batch_roundtrip(4);
+  printf("Batch roundtrip test passed.\n");
+}
+
+int main() {
+  test_batch_roundtrip();
+  return 0;
+}
@@ -0,0 +1,252 @@
+#include "zyphrax.h"
+#include "zyphrax_hash.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t *make_input(size_t size) {
+  uint8_t *buf = malloc(size);
+  srand(39);
+  for (size_t i = 0; i < size; i++) {
+    // Text with an incompressible stretch, so frames mix both block types
+    if (i / 50000 == 3)
+      buf[i] = (uint8_t)rand();
+    else
+      buf[i] = (uint8_t)("checksummed frame "[i % 18] + (rand() % 9 == 0));
+  }
+  return buf;
+}
+
+void test_hash_vectors() {
+  const char *s = "123456789";
+  assert(zyphrax_hash(ZYPHRAX_CHECKSUM_CRC32C, s, 9) == 0xE3069283u);
+  assert(zyphrax_hash(ZYPHRAX_CHECKSUM_XXH32, "", 0) == 0x02CC5D05u);
+  assert(zyphrax_hash(ZYPHRAX_CHECKSUM_XXH32, "abc", 3) == 0x32D153FFu);
+
+  // Streaming in odd pieces matches one shot
+  size_t size = 10007;
+  uint8_t *buf = make_input(size);
+  for (int kind = 1; kind <= 2; kind++) {
+    zyphrax_hash_t h;
+    zyphrax_hash_init(&h, kind);
+    for (size_t pos = 0, step = 1; pos < size; pos += step, step = step * 3 % 97 + 1)
+      zyphrax_hash_update(&h, buf + pos, pos + step < size ? step : size - pos);
+    assert(zyphrax_hash_final(&h) == zyphrax_hash(kind, buf, size));
+
+    // So does a block checksum run behind a coder, including one whose
+    // position falls back (a stored block after a failed LZ parse)
+    zyphrax_hash_run_t run;
+    zyphrax_hash_run_init(&run, kind, buf, 1);
+    for (size_t pos = 0; pos < size; pos += 777)
+      zyphrax_hash_run_to(&run, pos);
+    for (size_t pos = 0; pos < size; pos += 100)
+      zyphrax_hash_run_to(&run, pos);
+    assert(zyphrax_hash_run_end(&run, size) == zyphrax_hash(kind, buf, size));
+  }
+  free(buf);
+  printf("Hash vectors test passed.\n");
+}
+
+// Streams frame through a dstream in 1000-byte pieces
+static size_t dstream_all(const uint8_t *frame, size_t size, uint8_t *dst,
+                          size_t cap) {
+  zyphrax_dstream_t *ds = zyphrax_dstream_init();
+  zyphrax_out_buffer_t out = {dst, cap, 0};
+  size_t ret = 1;
+  for (size_t pos = 0; pos < size; pos += 1000) {
+    zyphrax_in_buffer_t in = {frame + pos, size - pos < 1000 ? size - pos : 1000,
+                              0};
+    ret = zyphrax_dstream_update(ds, &out, &in);
+    if (ret == ZYPHRAX_STREAM_ERROR)
+      break;
+  }
+  zyphrax_dstream_free(ds);
+  return ret == 0 ? out.pos : 0;
+}
+
+void test_checksum_roundtrip() {
+  size_t size = 600 * 1000 + 3;
+  uint8_t *src = make_input(size);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  uint8_t *comp2 = malloc(bound);
+  uint8_t *dec = malloc(size);
+
+  for (uint32_t kind = 1; kind <= 2; kind++) {
+    // Blocks are hashed as they are parsed unless they may be split
+    for (uint32_t level = 1; level <= 3; level += 2) {
+      zyphrax_params_t p = {.level = level, .checksum = kind};
+      size_t n = zyphrax_compress(src, size, comp, bound, &p);
+      assert(n > 0 && zyphrax_decompress(comp, n, dec, size) == size);
+      assert(memcmp(dec, src, size) == 0);
+    }
+
+    zyphrax_params_t params = {.level = 3, .block_size = 32 * 1024,
+                               .checksum = kind,
+                               .flags = ZYPHRAX_FLAG_SEEK_TABLE |
+                                        ZYPHRAX_FLAG_SPLIT_BLOCKS};
+    size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+    assert(csz > 0);
+
+    assert(zyphrax_decompress(comp, csz, dec, size) == size);
+    assert(memcmp(dec, src, size) == 0);
+    assert(zyphrax_decompress_mt(comp, csz, dec, size, 3) == size);
+    assert(memcmp(dec, src, size) == 0);
+    assert(dstream_all(comp, csz, dec, size) == size);
+    assert(memcmp(dec, src, size) == 0);
+    assert(zyphrax_get_content_size(comp, csz) == size);
+
+    // Ranges through both compressed and raw blocks
+    uint64_t offs[] = {1000, 150000, 170000};
+    for (int i = 0; i < 3; i++) {
+      assert(zyphrax_decompress_range(comp, csz, offs[i], 9000, dec) == 9000);
+      assert(memcmp(dec, src + offs[i], 9000) == 0);
+    }
+
+    // In place
+    size_t buf_size = size + zyphrax_inplace_margin(size, &params);
+    uint8_t *buf = malloc(buf_size);
+    memcpy(buf + buf_size - csz, comp, csz);
+    assert(zyphrax_decompress_inplace(buf, buf_size, csz) == size);
+    assert(memcmp(buf, src, size) == 0);
+    free(buf);
+
+    // The other compressors write the same frame
+    zyphrax_cctx_t *cctx = zyphrax_cctx_create(3);
+    assert(zyphrax_compress_cctx(cctx, src, size, comp2, bound, &params) ==
+           csz);
+    assert(memcmp(comp2, comp, csz) == 0);
+    zyphrax_cctx_free(cctx);
+
+    zyphrax_cstream_t *cs = zyphrax_cstream_init_mt(&params, 2, 0);
+    zyphrax_in_buffer_t in = {src, size, 0};
+    zyphrax_out_buffer_t out = {comp2, bound, 0};
+    assert(zyphrax_cstream_update(cs, &out, &in) != ZYPHRAX_STREAM_ERROR);
+    assert(zyphrax_cstream_end(cs, &out) == 0);
+    assert(out.pos == csz);
+    assert(memcmp(comp2, comp, csz) == 0);
+    zyphrax_cstream_free(cs);
+
+    // Adaptive streams store blocks at the bottom: still checksummed
+    cs = zyphrax_cstream_init(&params);
+    zyphrax_adaptive_t adapt = {.target_speed = 1000000000000000ull};
+    assert(zyphrax_cstream_set_adaptive(cs, &adapt) == 0);
+    in = (zyphrax_in_buffer_t){src, size, 0};
+    out = (zyphrax_out_buffer_t){comp2, bound, 0};
+    assert(zyphrax_cstream_update(cs, &out, &in) != ZYPHRAX_STREAM_ERROR);
+    assert(zyphrax_cstream_end(cs, &out) == 0);
+    assert(zyphrax_decompress(comp2, out.pos, dec, size) == size);
+    assert(memcmp(dec, src, size) == 0);
+    zyphrax_cstream_free(cs);
+  }
+
+  // Unknown checksum kinds are refused
+  zyphrax_params_t bad = {.checksum = 3};
+  assert(zyphrax_compress(src, size, comp, bound, &bad) == 0);
+  assert(zyphrax_cstream_init(&bad) == NULL);
+
+  free(src);
+  free(comp);
+  free(comp2);
+  free(dec);
+  printf("Checksum roundtrip test passed.\n");
+}
+
+// Every decoder refuses frame
+static void assert_rejected(const uint8_t *frame, size_t size, uint8_t *dec,
+                            size_t cap) {
+  assert(zyphrax_decompress(frame, size, dec, cap) == 0);
+  assert(zyphrax_decompress_mt(frame, size, dec, cap, 3) == 0);
+  assert(dstream_all(frame, size, dec, cap) == 0);
+}
+
+void test_checksum_corruption() {
+  size_t size = 300 * 1000;
+  uint8_t *src = make_input(size);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  uint8_t *bad = malloc(bound);
+  uint8_t *dec = malloc(size);
+
+  zyphrax_params_t params = {.level = 3, .block_size = 32 * 1024,
+                             .checksum = ZYPHRAX_CHECKSUM_CRC32C};
+  size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+  assert(csz > 0);
+
+  // A flipped bit in a compressed and in a raw payload
+  size_t raw_pos = csz / 2; // Inside the random stretch's raw blocks
+  size_t positions[] = {200, raw_pos};
+  for (int i = 0; i < 2; i++) {
+    memcpy(bad, comp, csz);
+    bad[positions[i]] ^= 0x10;
+    assert_rejected(bad, csz, dec, size);
+  }
+
+  // A block dropped, header and all: the frame checksum catches it
+  size_t first = 12;
+  size_t blk = 9 + 4 + (comp[first + 5] | (size_t)comp[first + 6] << 8 |
+                        (size_t)comp[first + 7] << 16);
+  assert((comp[first] & 0x3F) == 1);
+  memcpy(bad, comp, first);
+  memcpy(bad + first, comp + first + blk, csz - first - blk);
+  assert_rejected(bad, csz - blk, dec, size);
+
+  // The checksum block itself cut off
+  assert_rejected(comp, csz - ZYPHRAX_SUM_BLOCK_SIZE, dec, size);
+
+  // Untouched, every decoder still accepts it
+  assert(zyphrax_decompress(comp, csz, dec, size) == size);
+  assert(memcmp(dec, src, size) == 0);
+
+  free(src);
+  free(comp);
+  free(bad);
+  free(dec);
+  printf("Checksum corruption test passed.\n");
+}
+
+// Checksums add 4 bytes to every block and a checksum block to the frame:
+// small raw blocks still fit in exactly zyphrax_compress_bound_params
+void test_checksum_bound() {
+  size_t size = 65536;
+  uint8_t *src = malloc(size);
+  uint32_t x = 3;
+  for (size_t i = 0; i < size; i++) {
+    x = x * 1103515245u + 12345u;
+    src[i] = (uint8_t)(x >> 24);
+  }
+  uint8_t *dec = malloc(size);
+  uint32_t blocks[] = {16, 256, 1024, 4096};
+
+  for (uint32_t sum = ZYPHRAX_CHECKSUM_CRC32C; sum <= ZYPHRAX_CHECKSUM_XXH32;
+       sum++) {
+    for (size_t b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+      zyphrax_params_t params = {.level = 3, .block_size = blocks[b],
+                                 .checksum = sum,
+                                 .flags = ZYPHRAX_FLAG_SEEK_TABLE |
+                                          ZYPHRAX_FLAG_CONTENT_SIZE};
+      size_t bound = zyphrax_compress_bound_params(size, &params);
+      uint8_t *comp = malloc(bound);
+      size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+      assert(csz > 0 && csz <= bound);
+      assert(zyphrax_decompress(comp, csz, dec, size) == size);
+      assert(memcmp(dec, src, size) == 0);
+      if (blocks[b] >= 4096)
+        assert(bound <= zyphrax_compress_bound(size));
+      free(comp);
+    }
+  }
+
+  free(src);
+  free(dec);
+  printf("Checksum bound test passed.\n");
+}
+
+int main() {
+  test_hash_vectors();
+  test_checksum_roundtrip();
+  test_checksum_corruption();
+  test_checksum_bound();
+  return 0;
+}
@@ -0,0 +1,173 @@
+#include "zyphrax.h"
+#include "zyphrax_block.h"
+#include "zyphrax_dec.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Runs, short-period repeats (every offset below the 16-byte copy width),
+// text, literal runs past 15 + 255 bytes and a random stretch
+static uint8_t *make_input(size_t size) {
+  uint8_t *buf = malloc(size);
+  srand(41);
+  for (size_t i = 0; i < size; i++) {
+    size_t seg = i / 5000 % 24;
+    if (seg < 16)
+      buf[i] = (uint8_t)("0123456789abcdef"[i % (seg + 1)]);
+    else if (seg < 20)
+      buf[i] = (uint8_t)("level one, no entropy "[i % 22] + (rand() % 6 == 0));
+    else
+      buf[i] = (uint8_t)rand();
+  }
+  return buf;
+}
+
+static size_t dstream_all(const uint8_t *src, size_t size, uint8_t *dst,
+                          size_t cap) {
+  zyphrax_dstream_t *ds = zyphrax_dstream_init();
+  zyphrax_out_buffer_t out = {dst, cap, 0};
+  size_t ret = 1;
+  for (size_t pos = 0; pos < size; pos += 1000) {
+    zyphrax_in_buffer_t in = {src + pos, size - pos < 1000 ? size - pos : 1000,
+                              0};
+    ret = zyphrax_dstream_update(ds, &out, &in);
+    if (ret == ZYPHRAX_STREAM_ERROR)
+      break;
+  }
+  zyphrax_dstream_free(ds);
+  return ret == 0 ? out.pos : 0;
+}
+
+void test_lz_blocks() {
+  size_t size = 600 * 1000 + 7;
+  uint8_t *src = make_input(size);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  uint8_t *dec = malloc(size);
+
+  for (uint32_t kind = 0; kind <= 2; kind++) {
+    zyphrax_params_t params = {.level = 1, .block_size = 32 * 1024,
+                               .checksum = kind,
+                               .flags = ZYPHRAX_FLAG_SEEK_TABLE};
+    size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+    assert(csz > 0 && csz < size / 2);
+
+    // Level 1 writes LZ blocks; the random stretch is stored
+    zyphrax_block_ref_t *refs;
+    size_t count, total, lz = 0, raw = 0;
+    assert(zyphrax_index_blocks(comp + 12, csz - 12, params.block_size, &refs,
+                                &count, &total, NULL) == 0);
+    for (size_t i = 0; i < count; i++) {
+      lz += refs[i].info.type == ZYPHRAX_BLOCK_LZ;
+      raw += refs[i].info.type == ZYPHRAX_BLOCK_RAW;
+      assert(refs[i].info.type != ZYPHRAX_BLOCK_COMPRESSED);
+    }
+    free(refs);
+    assert(lz > 0 && raw > 0);
+
+    assert(zyphrax_decompress(comp, csz, dec, size) == size);
+    assert(memcmp(dec, src, size) == 0);
+    memset(dec, 0, size);
+    assert(zyphrax_decompress_mt(comp, csz, dec, size, 3) == size);
+    assert(memcmp(dec, src, size) == 0);
+    memset(dec, 0, size);
+    assert(dstream_all(comp, csz, dec, size) == size);
+    assert(memcmp(dec, src, size) == 0);
+    assert(zyphrax_decompress_range(comp, csz, 70001, 30000, dec) == 30000);
+    assert(memcmp(dec, src + 70001, 30000) == 0);
+
+    size_t buf_size = size + zyphrax_inplace_margin(size, &params);
+    uint8_t *buf = malloc(buf_size);
+    memcpy(buf + buf_size - csz, comp, csz);
+    assert(zyphrax_decompress_inplace(buf, buf_size, csz) == size);
+    assert(memcmp(buf, src, size) == 0);
+    free(buf);
+  }
+
+  // Small inputs: no tables to amortize, so even these compress
+  uint8_t small[300];
+  for (size_t i = 0; i < sizeof(small); i++)
+    small[i] = (uint8_t)("tiny message "[i % 13]);
+  zyphrax_params_t params = {.level = 1};
+  size_t csz = zyphrax_compress(small, sizeof(small), comp, bound, &params);
+  assert(comp[12] == ZYPHRAX_BLOCK_LZ);
+  assert(zyphrax_decompress(comp, csz, dec, sizeof(small)) == sizeof(small));
+  assert(memcmp(dec, small, sizeof(small)) == 0);
+  for (size_t n = 0; n < 40; n++) {
+    csz = zyphrax_compress(small, n, comp, bound, &params);
+    assert(csz > 0);
+    assert(zyphrax_decompress(comp, csz, dec, n) == n);
+    assert(memcmp(dec, small, n) == 0);
+  }
+
+  free(src);
+  free(comp);
+  free(dec);
+  printf("LZ blocks test passed.\n");
+}
+
+void test_lz_long_lengths() {
+  // A single run: matches far past the token's 15 and one extra byte
+  size_t size = 1 << 20;
+  uint8_t *src = malloc(size);
+  memset(src, 'z', size);
+  memcpy(src + 500000, "break", 5);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  uint8_t *dec = malloc(size);
+  zyphrax_params_t params = {.level = 1, .block_size = 1 << 20};
+  size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+  assert(csz > 0 && csz < 8192); // 64K matches, 257 length bytes each
+  assert(zyphrax_decompress(comp, csz, dec, size) == size);
+  assert(memcmp(dec, src, size) == 0);
+  free(src);
+  free(comp);
+  free(dec);
+  printf("LZ long lengths test passed.\n");
+}
+
+void test_lz_corrupt() {
+  size_t size = 64 * 1024;
+  uint8_t *src = make_input(size);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  uint8_t *bad = malloc(bound);
+  uint8_t *dec = malloc(size);
+  zyphrax_params_t params = {.level = 1};
+  size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+  assert(comp[12] == ZYPHRAX_BLOCK_LZ);
+
+  // Payload bytes flipped one at a time: a wrong result is possible
+  // (there is no checksum) but never a read or write out of bounds
+  size_t payload = 12 + ZYPHRAX_BLOCK_HDR_LZ;
+  for (size_t i = payload; i < csz; i += 7) {
+    memcpy(bad, comp, csz);
+    bad[i] ^= 0x5A;
+    zyphrax_decompress(bad, csz, dec, size);
+  }
+
+  // A match reaching before the block start
+  uint8_t blk[] = {ZYPHRAX_BLOCK_LZ, 20, 0, 0, 0, 4, 0, 0, 0,
+                   0x10, 'a', 9, 0}; // 1 literal, offset 9, length 4
+  zyphrax_block_info_t info;
+  assert(zyphrax_read_block_info(blk, sizeof(blk), 0, &info) == 0);
+  assert(zyphrax_decompress_block(blk, &info, dec, size) == 0);
+  // Truncated: output promised but the sequences stop
+  uint8_t cut[] = {ZYPHRAX_BLOCK_LZ, 8, 0, 0, 0, 3, 0, 0, 0, 0x20, 'a', 'b'};
+  assert(zyphrax_read_block_info(cut, sizeof(cut), 0, &info) == 0);
+  assert(zyphrax_decompress_block(cut, &info, dec, size) == 0);
+
+  free(src);
+  free(comp);
+  free(bad);
+  free(dec);
+  printf("LZ corrupt input test passed.\n");
+}
+
+int main() {
+  test_lz_blocks();
+  test_lz_long_lengths();
+  test_lz_corrupt();
+  return 0;
+}
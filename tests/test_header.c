@@ -20,11 +20,13 @@ void test_packing() {
 
   // Verify Flags/Size layout
   // We expect: Word1 = (block_size[24]) | (flags[8] << 24)
-  // Flags for level=5, checksum=1 => 5 | (1<<3) = 13 (0x0D)
+  // Flags for level=5, checksum=1 (CRC32C) => 5 | (1<<4) = 21 (0x15)
   // Block size 65536 = 0x010000
-  // Expected Word1: 0x010000 | 0x0D000000 = 0x0D010000
+  // Expected Word1: 0x010000 | 0x15000000 = 0x15010000
   uint32_t word1 = read_u32_le(buf + 4);
-  assert(word1 == 0x0D010000);
+  assert(word1 == 0x15010000);
+  // Header checksum covers magic + word1
+  assert(read_u32_le(buf + 8) == zyphrax_hash(1, buf, 8));
 
   // Verify Roundtrip
   zyphrax_params_t p2;
@@ -34,12 +36,25 @@ void test_packing() {
   assert(p2.block_size == 65536);
   assert(p2.checksum == 1);
 
+  // A flipped descriptor bit fails the header checksum
+  buf[6] ^= 0x01;
+  assert(zyphrax_read_header_internal(buf, &p2) != 0);
+  buf[6] ^= 0x01;
+
+  // Frames from before checksums set bit 3 alone and no header checksum
+  p.checksum = 0;
+  zyphrax_write_header_internal(buf, &p);
+  buf[7] |= 1 << 3;
+  assert(zyphrax_read_header_internal(buf, &p2) == 0);
+  assert(p2.checksum == 0);
+
   printf("Packing test passed.\n");
 }
 
 void test_public_api() {
   uint8_t src[100];
-  uint8_t dst[100];
+  uint8_t dst[1024];
+  memset(src, 0, sizeof(src));
   zyphrax_params_t p = {.level = 9, .block_size = 1024, .checksum = 0};
 
   // compress_bound check
@@ -47,8 +62,10 @@ void test_public_api() {
   // 100 + 100/255 + 64 = 100 + 0 + 64 = 164
   assert(bound >= 112);
 
-  size_t sz = zyphrax_compress(src, 100, dst, 100, &p);
+  size_t sz = zyphrax_compress(src, 100, dst, bound, &p);
   assert(sz >= 12);
+  // Output that does not fit is an error, never a truncated frame
+  assert(zyphrax_compress(src, 100, dst, 100, &p) == 0);
 
   uint32_t magic = read_u32_le(dst);
   assert(magic == ZYPHRAX_MAGIC);
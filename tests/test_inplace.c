@@ -0,0 +1,85 @@
+#include "zyphrax.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Highly compressible start, incompressible tail: the worst shape for
+// in-place decoding, since early output races ahead of the input.
+static void fill_input(uint8_t *buf, size_t size) {
+  srand(7);
+  for (size_t i = 0; i < size; i++) {
+    if (i < size / 2)
+      buf[i] = (uint8_t)"aaaaaaaabbbbcc"[i % 14];
+    else
+      buf[i] = (uint8_t)(rand() & 0xFF);
+  }
+}
+
+static void roundtrip_inplace(uint32_t flags, uint32_t block_size) {
+  size_t size = 700 * 1000 + 3;
+  uint8_t *src = malloc(size);
+  fill_input(src, size);
+
+  zyphrax_params_t params = {
+      .level = 3, .block_size = block_size, .flags = flags};
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+  assert(csz > 0);
+
+  size_t buf_size = size + zyphrax_inplace_margin(size, &params);
+  assert(buf_size >= csz);
+  uint8_t *buf = malloc(buf_size);
+  memcpy(buf + buf_size - csz, comp, csz);
+
+  size_t dsz = zyphrax_decompress_inplace(buf, buf_size, csz);
+  assert(dsz == size);
+  assert(memcmp(buf, src, size) == 0);
+
+  free(src);
+  free(comp);
+  free(buf);
+}
+
+void test_inplace_roundtrip() {
+  roundtrip_inplace(0, 64 * 1024);
+  roundtrip_inplace(ZYPHRAX_FLAG_CONTENT_SIZE, 64 * 1024);
+  roundtrip_inplace(ZYPHRAX_FLAG_SEEK_TABLE, 16 * 1024);
+  roundtrip_inplace(ZYPHRAX_FLAG_CONTENT_SIZE | ZYPHRAX_FLAG_SEEK_TABLE,
+                    128 * 1024);
+  printf("In-place roundtrip test passed.\n");
+}
+
+void test_inplace_margin_too_small() {
+  size_t size = 256 * 1024;
+  uint8_t *src = malloc(size);
+  for (size_t i = 0; i < size; i++)
+    src[i] = (uint8_t)(i % 7); // Every block compresses
+
+  zyphrax_params_t params = {.level = 3, .block_size = 64 * 1024};
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+  assert(csz > 0 && csz < size);
+
+  // No headroom: the first block's output would overrun its own input.
+  // The decoder must refuse instead of producing garbage.
+  uint8_t *buf = malloc(size);
+  memcpy(buf + size - csz, comp, csz);
+  assert(zyphrax_decompress_inplace(buf, size, csz) == 0);
+
+  // Frame larger than the buffer
+  assert(zyphrax_decompress_inplace(buf, csz - 1, csz) == 0);
+
+  free(src);
+  free(comp);
+  free(buf);
+  printf("In-place margin check test passed.\n");
+}
+
+int main() {
+  test_inplace_roundtrip();
+  test_inplace_margin_too_small();
+  return 0;
+}
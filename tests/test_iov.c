@@ -0,0 +1,189 @@
+#include "zyphrax.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEG_SIZE 4096
+
+// Cuts buf into SEG_SIZE segments (the last one shorter)
+static size_t make_chain(uint8_t *buf, size_t size, zyphrax_iovec_t *iov) {
+  size_t cnt = 0;
+  for (size_t pos = 0; pos < size; pos += SEG_SIZE) {
+    iov[cnt].iov_base = buf + pos;
+    iov[cnt].iov_len = size - pos < SEG_SIZE ? size - pos : SEG_SIZE;
+    cnt++;
+  }
+  return cnt;
+}
+
+static void fill(uint8_t *buf, size_t size) {
+  for (size_t i = 0; i < size; i++)
+    buf[i] = (uint8_t)((i % 251) ^ (i / 997));
+}
+
+static void iov_roundtrip(size_t size, const zyphrax_params_t *params) {
+  size_t cap = zyphrax_compress_bound(size);
+  uint8_t *src = malloc(size);
+  uint8_t *ref = malloc(cap);
+  uint8_t *comp = malloc(cap);
+  uint8_t *dec = malloc(size);
+  zyphrax_iovec_t *src_iov = malloc((size / SEG_SIZE + 1) * sizeof(*src_iov));
+  zyphrax_iovec_t *comp_iov = malloc((cap / SEG_SIZE + 1) * sizeof(*comp_iov));
+  zyphrax_iovec_t *dec_iov = malloc((size / SEG_SIZE + 1) * sizeof(*dec_iov));
+  fill(src, size);
+
+  size_t ref_size = zyphrax_compress(src, size, ref, cap, params);
+  assert(ref_size > 0);
+
+  // Same frame as the coalesced call, spread over the output chain
+  size_t src_cnt = make_chain(src, size, src_iov);
+  size_t comp_cnt = make_chain(comp, cap, comp_iov);
+  size_t comp_size =
+      zyphrax_compressv(src_iov, src_cnt, comp_iov, comp_cnt, params);
+  assert(comp_size == ref_size);
+  assert(memcmp(comp, ref, ref_size) == 0);
+
+  // Back through chains on both sides
+  size_t in_cnt = make_chain(comp, comp_size, comp_iov);
+  size_t dec_cnt = make_chain(dec, size, dec_iov);
+  assert(zyphrax_decompressv(comp_iov, in_cnt, dec_iov, dec_cnt) == size);
+  assert(memcmp(dec, src, size) == 0);
+
+  // Running out of segments fails on either side
+  assert(zyphrax_compressv(src_iov, src_cnt, comp_iov, 1, params) == 0);
+  assert(zyphrax_decompressv(comp_iov, in_cnt, dec_iov, dec_cnt - 1) == 0);
+  assert(zyphrax_decompressv(comp_iov, in_cnt - 1, dec_iov, dec_cnt) == 0);
+
+  free(src);
+  free(ref);
+  free(comp);
+  free(dec);
+  free(src_iov);
+  free(comp_iov);
+  free(dec_iov);
+}
+
+void test_iov_roundtrip() {
+  zyphrax_params_t params = {.level = 3};
+  iov_roundtrip(300 * 1024, &params);
+  params.flags = ZYPHRAX_FLAG_CONTENT_SIZE | ZYPHRAX_FLAG_SEEK_TABLE;
+  iov_roundtrip(300 * 1024, &params);
+  params.block_size = 2048; // Blocks inside one segment
+  iov_roundtrip(50 * 1024 + 17, &params);
+  printf("Scatter-gather roundtrip test passed.\n");
+}
+
+void test_iov_uneven_segments() {
+  size_t size = 100 * 1024;
+  uint8_t *src = malloc(size);
+  uint8_t *comp = malloc(zyphrax_compress_bound(size));
+  uint8_t *dec = malloc(size);
+  fill(src, size);
+
+  // Odd-sized and empty segments on every side
+  zyphrax_iovec_t in[3] = {{src, 1}, {src + 1, 0}, {src + 1, size - 1}};
+  zyphrax_iovec_t out[3] = {{comp, 7}, {comp + 7, 0},
+                            {comp + 7, zyphrax_compress_bound(size) - 7}};
+  zyphrax_params_t params = {.level = 3, .flags = ZYPHRAX_FLAG_CONTENT_SIZE};
+  size_t comp_size = zyphrax_compressv(in, 3, out, 3, &params);
+  assert(comp_size > 0);
+  assert(zyphrax_get_content_size(comp, comp_size) == size);
+
+  zyphrax_iovec_t cin[2] = {{comp, 13}, {comp + 13, comp_size - 13}};
+  zyphrax_iovec_t dout[2] = {{dec, 5000}, {dec + 5000, size - 5000}};
+  assert(zyphrax_decompressv(cin, 2, dout, 2) == size);
+  assert(memcmp(dec, src, size) == 0);
+
+  free(src);
+  free(comp);
+  free(dec);
+  printf("Scatter-gather uneven segments test passed.\n");
+}
+
+// Matches, literals and incompressible stretches: LZ, compressed and raw
+// blocks
+static void fill_mixed(uint8_t *buf, size_t size) {
+  uint32_t x = 12345;
+  for (size_t i = 0; i < size; i++) {
+    x = x * 1103515245u + 12345u;
+    buf[i] = (i / 4096) % 3 == 2 ? (uint8_t)(x >> 24)
+                                 : (uint8_t)((i % 251) ^ (i / 997));
+  }
+}
+
+// Cuts buf into seg-sized segments (the last one shorter)
+static size_t make_segs(uint8_t *buf, size_t size, size_t seg,
+                        zyphrax_iovec_t *iov) {
+  size_t cnt = 0;
+  for (size_t pos = 0; pos < size; pos += seg) {
+    iov[cnt].iov_base = buf + pos;
+    iov[cnt].iov_len = size - pos < seg ? size - pos : seg;
+    cnt++;
+  }
+  return cnt;
+}
+
+void test_iov_segment_sizes() {
+  // Blocks, matches and headers across segment boundaries, down to 1-byte
+  // segments: the frame is still the one zyphrax_compress writes, and
+  // decodes back into segments as small
+  static const size_t seg_sizes[] = {1, 3, 100, 4096, 65543};
+  static const zyphrax_params_t cases[] = {
+      {.level = 1},
+      {.level = 3},
+      {.level = 1,
+       .checksum = ZYPHRAX_CHECKSUM_XXH32,
+       .flags = ZYPHRAX_FLAG_SEEK_TABLE},
+      {.level = 3,
+       .checksum = ZYPHRAX_CHECKSUM_CRC32C,
+       .flags = ZYPHRAX_FLAG_SPLIT_BLOCKS | ZYPHRAX_FLAG_CONTENT_SIZE |
+                ZYPHRAX_FLAG_SEEK_TABLE},
+  };
+  size_t size = 150 * 1024 + 5;
+  size_t cap = zyphrax_compress_bound(size);
+  uint8_t *src = malloc(size);
+  uint8_t *ref = malloc(cap);
+  uint8_t *comp = malloc(cap);
+  uint8_t *dec = malloc(size);
+  zyphrax_iovec_t *src_iov = malloc(size * sizeof(*src_iov));
+  zyphrax_iovec_t *comp_iov = malloc(cap * sizeof(*comp_iov));
+  zyphrax_iovec_t *dec_iov = malloc(size * sizeof(*dec_iov));
+  fill_mixed(src, size);
+
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    size_t ref_size = zyphrax_compress(src, size, ref, cap, &cases[c]);
+    assert(ref_size > 0);
+    for (size_t k = 0; k < sizeof(seg_sizes) / sizeof(seg_sizes[0]); k++) {
+      size_t seg = seg_sizes[k];
+      size_t src_cnt = make_segs(src, size, seg, src_iov);
+      size_t comp_cnt = make_segs(comp, cap, seg, comp_iov);
+      memset(comp, 0, cap);
+      assert(zyphrax_compressv(src_iov, src_cnt, comp_iov, comp_cnt,
+                               &cases[c]) == ref_size);
+      assert(memcmp(comp, ref, ref_size) == 0);
+
+      size_t in_cnt = make_segs(comp, ref_size, seg, comp_iov);
+      size_t dec_cnt = make_segs(dec, size, seg, dec_iov);
+      memset(dec, 0, size);
+      assert(zyphrax_decompressv(comp_iov, in_cnt, dec_iov, dec_cnt) == size);
+      assert(memcmp(dec, src, size) == 0);
+    }
+  }
+
+  free(src);
+  free(ref);
+  free(comp);
+  free(dec);
+  free(src_iov);
+  free(comp_iov);
+  free(dec_iov);
+  printf("Scatter-gather segment sizes test passed.\n");
+}
+
+int main() {
+  test_iov_roundtrip();
+  test_iov_uneven_segments();
+  test_iov_segment_sizes();
+  return 0;
+}
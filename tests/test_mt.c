@@ -0,0 +1,249 @@
+#include "zyphrax.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Mixed input: compressible text interleaved with random runs, so the frame
+// holds both compressed and raw blocks.
+static void fill_mixed(uint8_t *buf, size_t size) {
+  const char *text = "{\"id\":42,\"name\":\"zyphrax\",\"tags\":[\"a\",\"b\"]},";
+  size_t tlen = strlen(text);
+  srand(1234);
+  for (size_t i = 0; i < size; i++) {
+    if ((i / (48 * 1024)) % 3 == 2)
+      buf[i] = (uint8_t)(rand() & 0xFF);
+    else
+      buf[i] = (uint8_t)text[i % tlen];
+  }
+}
+
+void test_mt_roundtrip() {
+  size_t size = 3 * 1024 * 1024 + 777;
+  uint8_t *src = malloc(size);
+  fill_mixed(src, size);
+
+  zyphrax_params_t params = {.level = 3, .block_size = 64 * 1024};
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+  assert(csz > 0);
+
+  uint8_t *dec = malloc(size);
+  unsigned threads[] = {1, 2, 4, 7, 64};
+  for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+    memset(dec, 0, size);
+    size_t dsz = zyphrax_decompress_mt(comp, csz, dec, size, threads[t]);
+    assert(dsz == size);
+    assert(memcmp(src, dec, size) == 0);
+  }
+
+  // Output buffer too small
+  assert(zyphrax_decompress_mt(comp, csz, dec, size - 1, 4) == 0);
+  // Truncated frame
+  assert(zyphrax_decompress_mt(comp, csz - 1, dec, size, 4) == 0);
+
+  free(src);
+  free(comp);
+  free(dec);
+  printf("MT decompression roundtrip test passed.\n");
+}
+
+void test_mt_legacy_raw() {
+  // Legacy frames store raw blocks as [0][bytes] with no explicit length
+  uint8_t frame[12 + 2 * (1 + 8)];
+  zyphrax_params_t params = {.level = 3, .block_size = 8};
+  uint8_t tmp[64];
+  zyphrax_compress((const uint8_t *)"x", 1, tmp, sizeof(tmp), &params);
+  memcpy(frame, tmp, 12); // Reuse a valid header with block_size = 8
+
+  const char *payload = "ABCDEFGHIJKLMNOP";
+  frame[12] = 0;
+  memcpy(frame + 13, payload, 8);
+  frame[21] = 0;
+  memcpy(frame + 22, payload + 8, 8);
+
+  uint8_t dec[16];
+  assert(zyphrax_decompress(frame, sizeof(frame), dec, sizeof(dec)) == 16);
+  assert(memcmp(dec, payload, 16) == 0);
+  memset(dec, 0, sizeof(dec));
+  assert(zyphrax_decompress_mt(frame, sizeof(frame), dec, sizeof(dec), 2) ==
+         16);
+  assert(memcmp(dec, payload, 16) == 0);
+
+  printf("MT legacy raw block test passed.\n");
+}
+
+void test_mt_compress_identical() {
+  size_t size = 2 * 1024 * 1024 + 12345;
+  uint8_t *src = malloc(size);
+  fill_mixed(src, size);
+
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *ref = malloc(bound);
+  uint8_t *comp = malloc(bound);
+
+  uint32_t flags[] = {0, ZYPHRAX_FLAG_CONTENT_SIZE | ZYPHRAX_FLAG_SEEK_TABLE};
+  uint32_t block_sizes[] = {64 * 1024, 16 * 1024};
+  unsigned threads[] = {1, 2, 3, 8, 200};
+  for (size_t f = 0; f < 2; f++) {
+    zyphrax_params_t params = {
+        .level = 3, .block_size = block_sizes[f], .flags = flags[f]};
+    size_t ref_size = zyphrax_compress(src, size, ref, bound, &params);
+    assert(ref_size > 0);
+
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+      memset(comp, 0, bound);
+      size_t csz =
+          zyphrax_compress_mt(src, size, comp, bound, &params, threads[t]);
+      assert(csz == ref_size);
+      assert(memcmp(comp, ref, csz) == 0);
+    }
+
+    // Output buffer too small
+    assert(zyphrax_compress_mt(src, size, comp, ref_size - 1, &params, 4) ==
+           0);
+  }
+
+  free(src);
+  free(ref);
+  free(comp);
+  printf("MT compression identical output test passed.\n");
+}
+
+void test_mt_cctx_reuse() {
+  // One context across calls with different sizes and block sizes
+  zyphrax_cctx_t *cctx = zyphrax_cctx_create(4);
+  assert(cctx);
+
+  size_t sizes[] = {100, 1 << 20, 0, 300 * 1000 + 1};
+  uint32_t block_sizes[] = {4096, 128 * 1024, 0, 32 * 1024};
+  for (size_t i = 0; i < 4; i++) {
+    size_t size = sizes[i];
+    uint8_t *src = malloc(size + 1);
+    fill_mixed(src, size);
+    zyphrax_params_t params = {.level = 3, .block_size = block_sizes[i]};
+
+    size_t bound = zyphrax_compress_bound(size);
+    uint8_t *ref = malloc(bound);
+    uint8_t *comp = malloc(bound);
+    size_t ref_size = zyphrax_compress(src, size, ref, bound, &params);
+    size_t csz = zyphrax_compress_cctx(cctx, src, size, comp, bound, &params);
+    assert(csz == ref_size);
+    assert(memcmp(comp, ref, csz) == 0);
+
+    if (size > 0) {
+      uint8_t *dec = malloc(size);
+      assert(zyphrax_decompress(comp, csz, dec, size) == size);
+      assert(memcmp(dec, src, size) == 0);
+      free(dec);
+    }
+    free(src);
+    free(ref);
+    free(comp);
+  }
+
+  zyphrax_cctx_free(cctx);
+  printf("MT compression context reuse test passed.\n");
+}
+
+// Counts what goes through the context's allocator: all of it, what is still
+// held, and workspace-sized blocks (the workers')
+static size_t nb_allocs, nb_live, nb_big;
+
+static void *count_alloc(void *opaque, size_t size) {
+  (void)opaque;
+  nb_allocs++;
+  nb_live++;
+  nb_big += size >= 64 * 1024;
+  return malloc(size);
+}
+
+static void count_free(void *opaque, void *ptr) {
+  (void)opaque;
+  nb_live -= ptr != NULL;
+  free(ptr);
+}
+
+void test_mt_dctx_reuse() {
+  size_t size = 1024 * 1024 + 99;
+  uint8_t *src = malloc(size);
+  fill_mixed(src, size);
+
+  // Two frames back to back
+  zyphrax_params_t params = {.level = 3, .block_size = 32 * 1024};
+  size_t bound = 2 * zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  size_t a = zyphrax_compress(src, size / 2, comp, bound, &params);
+  size_t b = zyphrax_compress(src + size / 2, size - size / 2, comp + a,
+                              bound - a, &params);
+  assert(a > 0 && b > 0);
+
+  zyphrax_allocator_t alloc = {count_alloc, count_free, NULL};
+  zyphrax_dctx_t *dctx = zyphrax_dctx_create(&alloc);
+  uint8_t *dec = malloc(size);
+  size_t after_create = nb_allocs;
+
+  // The workers are made on the first call and kept; a call only borrows its
+  // block index from the allocator
+  assert(zyphrax_decompress_dctx_mt(dctx, comp, a + b, dec, size, 4) == size);
+  assert(memcmp(dec, src, size) == 0);
+  assert(nb_allocs > after_create);
+  size_t live = nb_live, big = nb_big;
+  assert(big > 0);
+  for (int i = 0; i < 3; i++) {
+    memset(dec, 0, size);
+    assert(zyphrax_decompress_dctx_mt(dctx, comp, a + b, dec, size, 4) ==
+           size);
+    assert(memcmp(dec, src, size) == 0);
+  }
+  assert(nb_live == live && nb_big == big);
+
+  // Errors leave it usable; another thread count replaces it
+  assert(zyphrax_decompress_dctx_mt(dctx, comp, a + b - 1, dec, size, 4) == 0);
+  assert(zyphrax_decompress_dctx_mt(dctx, comp, a, dec, size, 4) == size / 2);
+  assert(nb_live == live && nb_big == big);
+  assert(zyphrax_decompress_dctx_mt(dctx, comp, a + b, dec, size, 2) == size);
+  assert(memcmp(dec, src, size) == 0);
+  assert(nb_big > big);
+  // One thread is zyphrax_decompress_dctx, on the context's workspace and
+  // statistics
+  zyphrax_dctx_set_stats(dctx, 1, NULL, NULL);
+  assert(zyphrax_decompress_dctx_mt(dctx, comp, a + b, dec, size, 1) == size);
+  zyphrax_stats_t stats;
+  zyphrax_dctx_get_stats(dctx, &stats);
+  assert(stats.src_bytes == size && stats.blocks > 0);
+  // The workers count the same blocks
+  zyphrax_stats_t mt;
+  assert(zyphrax_decompress_dctx_mt(dctx, comp, a + b, dec, size, 4) == size);
+  zyphrax_dctx_get_stats(dctx, &mt);
+  assert(mt.blocks == stats.blocks && mt.raw_blocks == stats.raw_blocks);
+  assert(mt.src_bytes == size && mt.dst_bytes == stats.dst_bytes);
+  assert(mt.table_bytes == stats.table_bytes);
+  assert(mt.mem_peak > stats.mem_peak);
+  zyphrax_dctx_free(dctx);
+  assert(nb_live == 0);
+
+  // Static contexts decode the same, on their own workspace
+  size_t ws_size = zyphrax_dctx_workspace_size();
+  void *ws = malloc(ws_size);
+  zyphrax_dctx_t *st = zyphrax_dctx_init_static(ws, ws_size);
+  memset(dec, 0, size);
+  assert(zyphrax_decompress_dctx_mt(st, comp, a + b, dec, size, 3) == size);
+  assert(memcmp(dec, src, size) == 0);
+
+  free(ws);
+  free(src);
+  free(comp);
+  free(dec);
+  printf("MT decompression context reuse test passed.\n");
+}
+
+int main() {
+  test_mt_roundtrip();
+  test_mt_legacy_raw();
+  test_mt_compress_identical();
+  test_mt_cctx_reuse();
+  test_mt_dctx_reuse();
+  return 0;
+}
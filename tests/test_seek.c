@@ -0,0 +1,164 @@
+#include "zyphrax.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t *make_input(size_t size) {
+  uint8_t *buf = malloc(size);
+  srand(99);
+  for (size_t i = 0; i < size; i++) {
+    // Compressible records with an incompressible stretch in the middle
+    if (i > size / 3 && i < size / 3 + 70000)
+      buf[i] = (uint8_t)(rand() & 0xFF);
+    else
+      buf[i] = (uint8_t)("record-0123456789;"[i % 18] + (i / 4096) % 3);
+  }
+  return buf;
+}
+
+static void check_ranges(const uint8_t *comp, size_t csz, const uint8_t *src,
+                         size_t size) {
+  uint8_t *out = malloc(size);
+  struct {
+    uint64_t off;
+    size_t len;
+  } cases[] = {
+      {0, 1},                 // First byte
+      {0, 65536},             // Exactly one block
+      {65535, 2},             // Straddles a block boundary
+      {100000, 300000},       // Several blocks, partial at both ends
+      {size / 3 + 10, 50000}, // Inside the raw stretch
+      {size - 10, 10},        // Tail
+      {0, size},              // Everything
+  };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    memset(out, 0, size);
+    size_t n =
+        zyphrax_decompress_range(comp, csz, cases[i].off, cases[i].len, out);
+    assert(n == cases[i].len);
+    assert(memcmp(out, src + cases[i].off, n) == 0);
+  }
+
+  // Range running past the end is clipped
+  assert(zyphrax_decompress_range(comp, csz, size - 5, 100, out) == 5);
+  assert(memcmp(out, src + size - 5, 5) == 0);
+  // Range entirely past the end
+  assert(zyphrax_decompress_range(comp, csz, size + 1, 10, out) == 0);
+
+  free(out);
+}
+
+void test_seek_table_ranges() {
+  size_t size = 1024 * 1024 + 12345;
+  uint8_t *src = make_input(size);
+
+  zyphrax_params_t params = {.level = 3,
+                             .block_size = 64 * 1024,
+                             .flags = ZYPHRAX_FLAG_SEEK_TABLE};
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+  assert(csz > 0);
+
+  // Seek table trailer magic at the very end ("ZEEK")
+  assert(memcmp(comp + csz - 4, "ZEEK", 4) == 0);
+
+  // Full decompression skips the table block
+  uint8_t *dec = malloc(size);
+  assert(zyphrax_decompress(comp, csz, dec, size) == size);
+  assert(memcmp(src, dec, size) == 0);
+  assert(zyphrax_decompress_mt(comp, csz, dec, size, 4) == size);
+  assert(memcmp(src, dec, size) == 0);
+
+  check_ranges(comp, csz, src, size);
+
+  // Corrupt trailer: range reads fail instead of guessing
+  comp[csz - 1] ^= 0xFF;
+  assert(zyphrax_decompress_range(comp, csz, 0, 10, dec) == 0);
+
+  free(src);
+  free(comp);
+  free(dec);
+  printf("Seek table range test passed.\n");
+}
+
+void test_range_without_table() {
+  size_t size = 1024 * 1024 + 12345;
+  uint8_t *src = make_input(size);
+
+  zyphrax_params_t params = {.level = 3, .block_size = 64 * 1024};
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+  assert(csz > 0);
+
+  check_ranges(comp, csz, src, size);
+
+  free(src);
+  free(comp);
+  printf("Range without seek table test passed.\n");
+}
+
+// Incompressible input in small blocks: every block falls back to raw and
+// carries a seek table entry, the most a frame can add
+void test_bound_small_blocks() {
+  size_t size = 1 << 20;
+  uint8_t *src = malloc(size);
+  uint32_t x = 7;
+  for (size_t i = 0; i < size; i++) {
+    x = x * 1103515245u + 12345u;
+    src[i] = (uint8_t)(x >> 24);
+  }
+  uint32_t blocks[] = {64, 256, 1024, 4096, 64 * 1024};
+  uint32_t flags[] = {0, ZYPHRAX_FLAG_SEEK_TABLE,
+                      ZYPHRAX_FLAG_SEEK_TABLE | ZYPHRAX_FLAG_CONTENT_SIZE,
+                      ZYPHRAX_FLAG_SPLIT_BLOCKS};
+  uint8_t *dec = malloc(size);
+
+  for (size_t b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+    for (size_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+      zyphrax_params_t params = {.level = 3, .block_size = blocks[b],
+                                 .flags = flags[f]};
+      size_t bound = zyphrax_compress_bound_params(size, &params);
+      if (blocks[b] >= 4096)
+        assert(bound <= zyphrax_compress_bound(size));
+      uint8_t *comp = malloc(bound);
+
+      // Exactly the bound is enough, on one thread and on several
+      size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+      assert(csz > 0 && csz <= bound);
+      assert(zyphrax_compress_mt(src, size, comp, bound, &params, 3) == csz);
+      assert(zyphrax_decompress(comp, csz, dec, size) == size);
+      assert(memcmp(dec, src, size) == 0);
+
+      // As is the bound of the appended part
+      size_t half = zyphrax_compress(src, size / 2, comp, bound, &params);
+      assert(half > 0);
+      size_t cap = half + zyphrax_compress_bound_params(size / 2, &params);
+      uint8_t *app = malloc(cap);
+      memcpy(app, comp, half);
+      assert(zyphrax_append(app, half, cap, src + size / 2, size / 2,
+                            NULL) > 0);
+      free(app);
+      free(comp);
+    }
+  }
+
+  // NULL params: the defaults
+  zyphrax_params_t defaults = {0};
+  assert(zyphrax_compress_bound_params(size, NULL) ==
+         zyphrax_compress_bound_params(size, &defaults));
+
+  free(src);
+  free(dec);
+  printf("Compress bound with small blocks test passed.\n");
+}
+
+int main() {
+  test_seek_table_ranges();
+  test_range_without_table();
+  test_bound_small_blocks();
+  return 0;
+}
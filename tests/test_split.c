@@ -0,0 +1,134 @@
+#include "zyphrax.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// JSON records with embedded binary samples, in runs shorter than a block
+static uint8_t *make_mixed(size_t size) {
+  uint8_t *buf = malloc(size);
+  srand(37);
+  size_t pos = 0;
+  while (pos < size) {
+    size_t run = 6000 + (size_t)rand() % 20000;
+    for (size_t end = pos + run; pos < end && pos < size;) {
+      char rec[96];
+      int n = snprintf(rec, sizeof(rec),
+                       "{\"id\":%d,\"event\":\"view\",\"user\":\"u%d\"}\n",
+                       rand() % 100000, rand() % 300);
+      for (int i = 0; i < n && pos < size; i++)
+        buf[pos++] = (uint8_t)rec[i];
+    }
+    // Random walk, 16-bit samples
+    int v = 0;
+    for (size_t end = pos + run; pos + 1 < end && pos + 1 < size; pos += 2) {
+      v += rand() % 31 - 15;
+      buf[pos] = (uint8_t)v;
+      buf[pos + 1] = (uint8_t)(v >> 8);
+    }
+  }
+  return buf;
+}
+
+void test_split_roundtrip() {
+  size_t size = 1000 * 1000 + 7;
+  uint8_t *src = make_mixed(size);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *plain = malloc(bound);
+  uint8_t *split = malloc(bound);
+  uint8_t *comp = malloc(bound);
+  uint8_t *dec = malloc(size);
+
+  zyphrax_params_t params = {.level = 3, .block_size = 128 * 1024,
+                             .flags = ZYPHRAX_FLAG_SEEK_TABLE};
+  size_t plain_size = zyphrax_compress(src, size, plain, bound, &params);
+  params.flags |= ZYPHRAX_FLAG_SPLIT_BLOCKS;
+  size_t split_size = zyphrax_compress(src, size, split, bound, &params);
+  assert(plain_size > 0 && split_size > 0);
+  assert(split_size < plain_size);
+
+  assert(zyphrax_decompress(split, split_size, dec, size) == size);
+  assert(memcmp(dec, src, size) == 0);
+  assert(zyphrax_decompress_mt(split, split_size, dec, size, 4) == size);
+  assert(memcmp(dec, src, size) == 0);
+
+  // The seek table lists every block, including cut ones
+  size_t off = 300 * 1000 + 11;
+  assert(zyphrax_decompress_range(split, split_size, off, 5000, dec) == 5000);
+  assert(memcmp(dec, src + off, 5000) == 0);
+
+  // Same frame from the other compressors
+  zyphrax_cctx_t *cctx = zyphrax_cctx_create(3);
+  assert(zyphrax_compress_cctx(cctx, src, size, comp, bound, &params) ==
+         split_size);
+  assert(memcmp(comp, split, split_size) == 0);
+  zyphrax_cctx_free(cctx);
+
+  zyphrax_cstream_t *cs = zyphrax_cstream_init(&params);
+  zyphrax_in_buffer_t in = {src, size, 0};
+  zyphrax_out_buffer_t out = {comp, bound, 0};
+  assert(zyphrax_cstream_update(cs, &out, &in) != ZYPHRAX_STREAM_ERROR);
+  assert(zyphrax_cstream_end(cs, &out) == 0);
+  assert(out.pos == split_size);
+  assert(memcmp(comp, split, split_size) == 0);
+  zyphrax_cstream_free(cs);
+
+  printf("Split blocks: %zu -> %zu bytes\n", plain_size, split_size);
+  free(src);
+  free(plain);
+  free(split);
+  free(comp);
+  free(dec);
+  printf("Split roundtrip test passed.\n");
+}
+
+void test_split_uniform() {
+  // Homogeneous text keeps its blocks whole
+  size_t size = 256 * 1024;
+  uint8_t *src = malloc(size);
+  for (size_t i = 0; i < size; i++)
+    src[i] = (uint8_t)("the quick brown fox jumps over the lazy dog "[i % 44]);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *a = malloc(bound);
+  uint8_t *b = malloc(bound);
+
+  zyphrax_params_t params = {.level = 3};
+  size_t a_size = zyphrax_compress(src, size, a, bound, &params);
+  params.flags = ZYPHRAX_FLAG_SPLIT_BLOCKS;
+  size_t b_size = zyphrax_compress(src, size, b, bound, &params);
+  assert(a_size == b_size);
+
+  free(src);
+  free(a);
+  free(b);
+  printf("Split uniform test passed.\n");
+}
+
+void test_split_inplace() {
+  size_t size = 500 * 1000;
+  uint8_t *src = make_mixed(size);
+  zyphrax_params_t params = {.level = 3, .block_size = 64 * 1024,
+                             .flags = ZYPHRAX_FLAG_SPLIT_BLOCKS};
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+  assert(csz > 0);
+
+  size_t buf_size = size + zyphrax_inplace_margin(size, &params);
+  uint8_t *buf = malloc(buf_size);
+  memcpy(buf + buf_size - csz, comp, csz);
+  assert(zyphrax_decompress_inplace(buf, buf_size, csz) == size);
+  assert(memcmp(buf, src, size) == 0);
+
+  free(src);
+  free(comp);
+  free(buf);
+  printf("Split in-place test passed.\n");
+}
+
+int main() {
+  test_split_roundtrip();
+  test_split_uniform();
+  test_split_inplace();
+  return 0;
+}
@@ -0,0 +1,190 @@
+#include "zyphrax.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Collects what the callback sees
+typedef struct {
+  size_t calls;
+  zyphrax_stats_t sum;
+} seen_t;
+
+static void on_block(const zyphrax_stats_t *block, void *opaque) {
+  seen_t *seen = (seen_t *)opaque;
+  assert(block->blocks >= 1 && block->mem_peak == 0);
+  seen->calls++;
+  seen->sum.blocks += block->blocks;
+  seen->sum.raw_blocks += block->raw_blocks;
+  seen->sum.src_bytes += block->src_bytes;
+  seen->sum.dst_bytes += block->dst_bytes;
+  seen->sum.match_bytes += block->match_bytes;
+}
+
+// Text, then a stretch of noise that only a raw block can hold
+static uint8_t *make_input(size_t size, size_t noise) {
+  uint8_t *buf = malloc(size);
+  uint32_t x = 12345;
+  for (size_t i = 0; i < size; i++) {
+    x = x * 1103515245u + 12345u;
+    buf[i] = i >= size - noise ? (uint8_t)(x >> 24)
+                               : (uint8_t)("stats for every block "[i % 22] ^
+                                           (i / 8191));
+  }
+  return buf;
+}
+
+static void check_compress_totals(const zyphrax_stats_t *st, size_t size,
+                                  size_t frame_size) {
+  assert(st->src_bytes == size);
+  assert(st->dst_bytes > 0 && st->dst_bytes < frame_size);
+  assert(st->literal_bytes + st->match_bytes == size - 64 * 1024);
+  assert(st->raw_blocks == 1); // The noise
+  assert(st->matches > 0 && st->matches <= st->sequences);
+  assert(st->match_bytes / st->matches >= 4);
+  assert(st->searches > 0 && st->chain_steps > 0);
+  assert(st->table_bytes == 384 * (st->blocks - st->raw_blocks));
+  assert(st->parse_ns > 0 && st->coding_ns > 0);
+  assert(st->mem_peak > 0);
+}
+
+void test_compress_stats() {
+  size_t size = 10 * 64 * 1024;
+  uint8_t *src = make_input(size, 64 * 1024);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *ref = malloc(bound);
+  uint8_t *comp = malloc(bound);
+
+  zyphrax_params_t params = {.level = 4, .checksum = ZYPHRAX_CHECKSUM_XXH32};
+  size_t ref_size = zyphrax_compress(src, size, ref, bound, &params);
+  assert(ref_size > 0);
+
+  for (unsigned workers = 1; workers <= 3; workers += 2) {
+    zyphrax_cctx_t *cctx = zyphrax_cctx_create(workers);
+    zyphrax_stats_t st;
+
+    // Off by default
+    assert(zyphrax_compress_cctx(cctx, src, size, comp, bound, &params) ==
+           ref_size);
+    zyphrax_cctx_get_stats(cctx, &st);
+    assert(st.blocks == 0 && st.src_bytes == 0);
+
+    // On: same output, one call per block in order, totals that add up
+    seen_t seen;
+    memset(&seen, 0, sizeof(seen));
+    zyphrax_cctx_set_stats(cctx, 1, on_block, &seen);
+    assert(zyphrax_compress_cctx(cctx, src, size, comp, bound, &params) ==
+           ref_size);
+    assert(memcmp(comp, ref, ref_size) == 0);
+    zyphrax_cctx_get_stats(cctx, &st);
+    check_compress_totals(&st, size, ref_size);
+    assert(st.blocks == 10 && seen.calls == 10);
+    assert(st.checksum_ns > 0);
+    assert(seen.sum.src_bytes == st.src_bytes &&
+           seen.sum.dst_bytes == st.dst_bytes &&
+           seen.sum.raw_blocks == st.raw_blocks &&
+           seen.sum.match_bytes == st.match_bytes);
+
+    // Totals are per call
+    assert(zyphrax_compress_cctx(cctx, src, size, comp, bound, &params) ==
+           ref_size);
+    zyphrax_cctx_get_stats(cctx, &st);
+    assert(st.src_bytes == size && seen.calls == 20);
+
+    // Batches add to the totals only
+    zyphrax_batch_item_t items[2] = {{src, size / 2, comp, bound, 0},
+                                     {src + size / 2, size / 2, ref, bound, 0}};
+    assert(zyphrax_compress_batch(cctx, items, 2, &params) == 2);
+    zyphrax_cctx_get_stats(cctx, &st);
+    assert(st.src_bytes == size && st.blocks == 10 && seen.calls == 20);
+    assert(zyphrax_compress(src, size, ref, bound, &params) == ref_size);
+
+    // Off again
+    zyphrax_cctx_set_stats(cctx, 0, NULL, NULL);
+    assert(zyphrax_compress_cctx(cctx, src, size, comp, bound, &params) ==
+           ref_size);
+    zyphrax_cctx_get_stats(cctx, &st);
+    assert(st.blocks == 0 && seen.calls == 20);
+    zyphrax_cctx_free(cctx);
+  }
+
+  // Level 1 LZ blocks count their sequences too
+  zyphrax_params_t fast = {.level = 1};
+  zyphrax_cctx_t *cctx = zyphrax_cctx_create(1);
+  zyphrax_cctx_set_stats(cctx, 1, NULL, NULL);
+  size_t n = zyphrax_compress_cctx(cctx, src, size, comp, bound, &fast);
+  assert(n > 0);
+  zyphrax_stats_t st;
+  zyphrax_cctx_get_stats(cctx, &st);
+  assert(st.blocks == 10 && st.raw_blocks == 1 && st.table_bytes == 0);
+  assert(st.literal_bytes + st.match_bytes == size - 64 * 1024);
+  assert(st.matches > 0 && st.searches == 0);
+  zyphrax_cctx_free(cctx);
+
+  free(src);
+  free(ref);
+  free(comp);
+  printf("Compression stats test passed.\n");
+}
+
+void test_decompress_stats() {
+  size_t size = 6 * 64 * 1024 + 100;
+  uint8_t *src = make_input(size, 64 * 1024 + 100);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  uint8_t *dec = malloc(size);
+
+  zyphrax_params_t params = {.level = 3, .checksum = ZYPHRAX_CHECKSUM_CRC32C};
+  size_t comp_size = zyphrax_compress(src, size, comp, bound, &params);
+  assert(comp_size > 0);
+
+  zyphrax_dctx_t *dctx = zyphrax_dctx_create(NULL);
+  seen_t seen;
+  memset(&seen, 0, sizeof(seen));
+  zyphrax_dctx_set_stats(dctx, 1, on_block, &seen);
+  assert(zyphrax_decompress_dctx(dctx, comp, comp_size, dec, size) == size);
+  assert(memcmp(dec, src, size) == 0);
+
+  zyphrax_stats_t st;
+  zyphrax_dctx_get_stats(dctx, &st);
+  assert(st.blocks == 7 && seen.calls == 7);
+  assert(st.src_bytes == size && seen.sum.src_bytes == size);
+  assert(st.dst_bytes < comp_size && seen.sum.dst_bytes == st.dst_bytes);
+  assert(st.raw_blocks >= 1 && st.raw_blocks == seen.sum.raw_blocks);
+  assert(st.table_bytes == 384 * (st.blocks - st.raw_blocks));
+  assert(st.tables_ns > 0 && st.coding_ns > 0 && st.checksum_ns > 0);
+  assert(st.sequences == 0 && st.searches == 0);
+  assert(st.mem_peak > 0 && st.mem_peak <= zyphrax_dctx_workspace_size());
+
+  // Off: nothing collected
+  zyphrax_dctx_set_stats(dctx, 0, NULL, NULL);
+  assert(zyphrax_decompress_dctx(dctx, comp, comp_size, dec, size) == size);
+  zyphrax_dctx_get_stats(dctx, &st);
+  assert(st.blocks == 0 && seen.calls == 7);
+
+  // A block that fails its checksum is not counted, and leaves no
+  // partial times behind: the totals hold the blocks before it only
+  uint8_t *bad = malloc(comp_size);
+  memcpy(bad, comp, comp_size);
+  bad[comp_size / 2] ^= 0x40;
+  memset(&seen, 0, sizeof(seen));
+  zyphrax_dctx_set_stats(dctx, 1, on_block, &seen);
+  assert(zyphrax_decompress_dctx(dctx, bad, comp_size, dec, size) == 0);
+  zyphrax_dctx_get_stats(dctx, &st);
+  assert(st.blocks == seen.calls && st.blocks < 7);
+  assert(st.src_bytes == seen.sum.src_bytes);
+  assert(st.coding_ns < 10000000000ull && st.tables_ns < 10000000000ull);
+  free(bad);
+  zyphrax_dctx_free(dctx);
+
+  free(src);
+  free(comp);
+  free(dec);
+  printf("Decompression stats test passed.\n");
+}
+
+int main() {
+  test_compress_stats();
+  test_decompress_stats();
+  return 0;
+}
@@ -0,0 +1,398 @@
+#include "zyphrax.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t *make_input(size_t size) {
+  uint8_t *buf = malloc(size);
+  srand(11);
+  for (size_t i = 0; i < size; i++) {
+    if ((i / 5000) % 3 == 2)
+      buf[i] = (uint8_t)(rand() & 0xFF);
+    else
+      buf[i] = (uint8_t)"log line: GET /index.html 200\n"[i % 31];
+  }
+  return buf;
+}
+
+// Feeds src in random chunks through an out buffer of out_chunk bytes
+static size_t stream_compress_mt(const uint8_t *src, size_t size,
+                                 const zyphrax_params_t *params, uint8_t *dst,
+                                 size_t dst_cap, size_t out_chunk,
+                                 unsigned workers, unsigned in_flight) {
+  zyphrax_cstream_t *cs =
+      workers ? zyphrax_cstream_init_mt(params, workers, in_flight)
+              : zyphrax_cstream_init(params);
+  assert(cs);
+
+  size_t produced = 0;
+  size_t pos = 0;
+  while (pos < size) {
+    size_t chunk = 1 + (size_t)rand() % 20000;
+    if (chunk > size - pos)
+      chunk = size - pos;
+    zyphrax_in_buffer_t in = {src + pos, chunk, 0};
+    while (in.pos < in.size) {
+      size_t room = dst_cap - produced;
+      zyphrax_out_buffer_t out = {dst + produced,
+                                  room < out_chunk ? room : out_chunk, 0};
+      size_t r = zyphrax_cstream_update(cs, &out, &in);
+      assert(r != ZYPHRAX_STREAM_ERROR);
+      produced += out.pos;
+    }
+    pos += chunk;
+  }
+
+  size_t r;
+  do {
+    zyphrax_out_buffer_t out = {dst + produced, out_chunk, 0};
+    r = zyphrax_cstream_end(cs, &out);
+    assert(r != ZYPHRAX_STREAM_ERROR);
+    produced += out.pos;
+  } while (r != 0);
+
+  zyphrax_cstream_free(cs);
+  return produced;
+}
+
+static size_t stream_compress(const uint8_t *src, size_t size,
+                              const zyphrax_params_t *params, uint8_t *dst,
+                              size_t dst_cap, size_t out_chunk) {
+  return stream_compress_mt(src, size, params, dst, dst_cap, out_chunk, 0, 0);
+}
+
+void test_stream_matches_oneshot() {
+  size_t size = 1000 * 1000 + 17;
+  uint8_t *src = make_input(size);
+  zyphrax_params_t params = {.level = 3, .block_size = 64 * 1024};
+
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *ref = malloc(bound);
+  uint8_t *comp = malloc(bound);
+  size_t ref_size = zyphrax_compress(src, size, ref, bound, &params);
+  assert(ref_size > 0);
+
+  // Same block boundaries -> same bytes, whatever the chunking
+  size_t out_chunks[] = {1, 7, 4096, 1 << 20};
+  for (size_t i = 0; i < 4; i++) {
+    size_t csz =
+        stream_compress(src, size, &params, comp, bound, out_chunks[i]);
+    assert(csz == ref_size);
+    assert(memcmp(comp, ref, csz) == 0);
+  }
+
+  free(src);
+  free(ref);
+  free(comp);
+  printf("Stream vs one-shot test passed.\n");
+}
+
+void test_stream_seek_table() {
+  size_t size = 300 * 1000;
+  uint8_t *src = make_input(size);
+  zyphrax_params_t params = {.level = 3,
+                             .block_size = 16 * 1024,
+                             .flags = ZYPHRAX_FLAG_SEEK_TABLE |
+                                      ZYPHRAX_FLAG_CONTENT_SIZE};
+
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  size_t csz = stream_compress(src, size, &params, comp, bound, 1000);
+
+  // Content size cannot be known up front; it comes from the seek table
+  assert(zyphrax_get_content_size(comp, csz) == size);
+
+  uint8_t *dec = malloc(size);
+  assert(zyphrax_decompress(comp, csz, dec, size) == size);
+  assert(memcmp(dec, src, size) == 0);
+
+  uint8_t part[100];
+  assert(zyphrax_decompress_range(comp, csz, 123456, 100, part) == 100);
+  assert(memcmp(part, src + 123456, 100) == 0);
+
+  free(src);
+  free(comp);
+  free(dec);
+  printf("Stream seek table test passed.\n");
+}
+
+void test_stream_flush() {
+  // Small messages, each flushed: everything sent so far must decode
+  zyphrax_params_t params = {.level = 3, .block_size = 64 * 1024};
+  zyphrax_cstream_t *cs = zyphrax_cstream_init(&params);
+  assert(cs);
+
+  size_t cap = 1 << 16;
+  uint8_t *comp = malloc(cap);
+  uint8_t *sent = malloc(cap);
+  uint8_t *dec = malloc(cap);
+  size_t comp_len = 0, sent_len = 0;
+
+  for (int m = 0; m < 50; m++) {
+    char msg[64];
+    int len = snprintf(msg, sizeof(msg), "message %d: status=ok\n", m);
+    memcpy(sent + sent_len, msg, len);
+    sent_len += len;
+
+    zyphrax_in_buffer_t in = {(const uint8_t *)msg, (size_t)len, 0};
+    zyphrax_out_buffer_t out = {comp + comp_len, cap - comp_len, 0};
+    assert(zyphrax_cstream_update(cs, &out, &in) == 0);
+    assert(in.pos == in.size);
+    assert(zyphrax_cstream_flush(cs, &out) == 0);
+    comp_len += out.pos;
+
+    size_t dsz = zyphrax_decompress(comp, comp_len, dec, cap);
+    assert(dsz == sent_len);
+    assert(memcmp(dec, sent, sent_len) == 0);
+  }
+
+  zyphrax_out_buffer_t out = {comp + comp_len, cap - comp_len, 0};
+  assert(zyphrax_cstream_end(cs, &out) == 0);
+  comp_len += out.pos;
+  assert(zyphrax_decompress(comp, comp_len, dec, cap) == sent_len);
+
+  // Ended streams reject more input
+  zyphrax_in_buffer_t in = {(const uint8_t *)"x", 1, 0};
+  assert(zyphrax_cstream_update(cs, &out, &in) == ZYPHRAX_STREAM_ERROR);
+
+  zyphrax_cstream_free(cs);
+  free(comp);
+  free(sent);
+  free(dec);
+  printf("Stream flush test passed.\n");
+}
+
+void test_stream_pipelined() {
+  size_t size = 1500 * 1000 + 5;
+  uint8_t *src = make_input(size);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *ref = malloc(bound);
+  uint8_t *comp = malloc(bound);
+
+  // Pipelined output is the single-threaded output, whatever the schedule
+  zyphrax_params_t params = {.level = 3,
+                             .block_size = 32 * 1024,
+                             .flags = ZYPHRAX_FLAG_SEEK_TABLE};
+  size_t ref_size = zyphrax_compress(src, size, ref, bound, &params);
+  unsigned workers[] = {2, 4, 3, 8};
+  unsigned in_flight[] = {0, 1, 8, 2};
+  size_t out_chunks[] = {7, 1 << 20, 5000, 64};
+  for (size_t i = 0; i < 4; i++) {
+    memset(comp, 0, bound);
+    size_t csz = stream_compress_mt(src, size, &params, comp, bound,
+                                    out_chunks[i], workers[i], in_flight[i]);
+    assert(csz == ref_size);
+    assert(memcmp(comp, ref, csz) == 0);
+  }
+
+  // Flush waits for the blocks in flight
+  zyphrax_cstream_t *cs = zyphrax_cstream_init_mt(&params, 4, 0);
+  zyphrax_in_buffer_t in = {src, 200 * 1000, 0};
+  zyphrax_out_buffer_t out = {comp, bound, 0};
+  while (in.pos < in.size)
+    assert(zyphrax_cstream_update(cs, &out, &in) != ZYPHRAX_STREAM_ERROR);
+  assert(zyphrax_cstream_flush(cs, &out) == 0);
+  uint8_t *dec = malloc(size);
+  assert(zyphrax_decompress(comp, out.pos, dec, size) == 200 * 1000);
+  assert(memcmp(dec, src, 200 * 1000) == 0);
+  zyphrax_cstream_free(cs);
+
+  // Freed mid-stream with blocks still queued
+  cs = zyphrax_cstream_init_mt(&params, 2, 4);
+  in = (zyphrax_in_buffer_t){src, size, 0};
+  out = (zyphrax_out_buffer_t){comp, 10, 0};
+  zyphrax_cstream_update(cs, &out, &in);
+  zyphrax_cstream_free(cs);
+
+  free(src);
+  free(ref);
+  free(comp);
+  free(dec);
+  printf("Stream pipelined compression test passed.\n");
+}
+
+// Decodes src in random input chunks through an out buffer of out_chunk
+// bytes. Returns the decoded size; *last gets the final return value.
+void test_stream_pledged_size() {
+  size_t size = 200 * 1000;
+  uint8_t *src = make_input(size);
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  zyphrax_params_t params = {.level = 3};
+
+  zyphrax_cstream_t *cs = zyphrax_cstream_init(&params);
+  assert(zyphrax_cstream_pledge_size(cs, size) == 0);
+  zyphrax_in_buffer_t in = {src, size, 0};
+  zyphrax_out_buffer_t out = {comp, bound, 0};
+  assert(zyphrax_cstream_update(cs, &out, &in) != ZYPHRAX_STREAM_ERROR);
+  assert(in.pos == size);
+  assert(zyphrax_cstream_end(cs, &out) == 0);
+  assert(zyphrax_get_content_size(comp, out.pos) == size);
+  zyphrax_cstream_free(cs);
+
+  // Too late once the header is out, and the total must match
+  cs = zyphrax_cstream_init(&params);
+  assert(zyphrax_cstream_pledge_size(cs, size) == 0);
+  in.pos = 1;
+  out.pos = 0;
+  assert(zyphrax_cstream_update(cs, &out, &in) != ZYPHRAX_STREAM_ERROR);
+  assert(zyphrax_cstream_pledge_size(cs, size) == ZYPHRAX_STREAM_ERROR);
+  assert(zyphrax_cstream_end(cs, &out) == ZYPHRAX_STREAM_ERROR);
+  zyphrax_cstream_free(cs);
+
+  free(src);
+  free(comp);
+  printf("Stream pledged size test passed.\n");
+}
+
+static size_t stream_decompress(const uint8_t *src, size_t size, uint8_t *dst,
+                                size_t dst_cap, size_t out_chunk,
+                                size_t *last) {
+  zyphrax_dstream_t *ds = zyphrax_dstream_init();
+  assert(ds);
+
+  size_t produced = 0;
+  size_t pos = 0;
+  size_t r = 0;
+  while (pos < size) {
+    size_t chunk = 1 + (size_t)rand() % 3000;
+    if (chunk > size - pos)
+      chunk = size - pos;
+    zyphrax_in_buffer_t in = {src + pos, chunk, 0};
+    zyphrax_out_buffer_t out;
+    do {
+      size_t room = dst_cap - produced;
+      out = (zyphrax_out_buffer_t){dst + produced,
+                                   room < out_chunk ? room : out_chunk, 0};
+      r = zyphrax_dstream_update(ds, &out, &in);
+      if (r == ZYPHRAX_STREAM_ERROR)
+        break;
+      produced += out.pos;
+      // A full output buffer may hide more decoded bytes
+    } while (in.pos < in.size || (out.pos == out.size && out.size > 0));
+    if (r == ZYPHRAX_STREAM_ERROR)
+      break;
+    pos += chunk;
+  }
+
+  zyphrax_dstream_free(ds);
+  *last = r;
+  return produced;
+}
+
+void test_dstream_roundtrip() {
+  size_t size = 500 * 1000 + 3;
+  uint8_t *src = make_input(size);
+  uint32_t flags[] = {0, ZYPHRAX_FLAG_CONTENT_SIZE, ZYPHRAX_FLAG_SEEK_TABLE,
+                      ZYPHRAX_FLAG_CONTENT_SIZE | ZYPHRAX_FLAG_SEEK_TABLE};
+  size_t out_chunks[] = {1, 100, 1 << 20};
+
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  uint8_t *dec = malloc(size);
+
+  for (size_t f = 0; f < 4; f++) {
+    zyphrax_params_t params = {
+        .level = 3, .block_size = 32 * 1024, .flags = flags[f]};
+    size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+    assert(csz > 0);
+
+    for (size_t c = 0; c < 3; c++) {
+      size_t last;
+      memset(dec, 0, size);
+      size_t dsz =
+          stream_decompress(comp, csz, dec, size, out_chunks[c], &last);
+      assert(last == 0);
+      assert(dsz == size);
+      assert(memcmp(dec, src, size) == 0);
+    }
+  }
+
+  free(src);
+  free(comp);
+  free(dec);
+  printf("Stream decompression roundtrip test passed.\n");
+}
+
+void test_dstream_first_block() {
+  // The first block is delivered before the rest of the frame arrives
+  size_t size = 256 * 1024;
+  uint8_t *src = make_input(size);
+  zyphrax_params_t params = {.level = 3, .block_size = 64 * 1024};
+  size_t bound = zyphrax_compress_bound(size);
+  uint8_t *comp = malloc(bound);
+  size_t csz = zyphrax_compress(src, size, comp, bound, &params);
+
+  uint8_t *dec = malloc(size);
+  zyphrax_dstream_t *ds = zyphrax_dstream_init();
+  zyphrax_in_buffer_t in = {comp, csz / 2, 0};
+  zyphrax_out_buffer_t out = {dec, size, 0};
+  size_t r = zyphrax_dstream_update(ds, &out, &in);
+  assert(r != 0 && r != ZYPHRAX_STREAM_ERROR); // Mid-block
+  assert(out.pos >= 64 * 1024);
+  assert(memcmp(dec, src, out.pos) == 0);
+
+  // A frame with a stored size is not complete until every byte arrived
+  zyphrax_dstream_free(ds);
+  params.flags = ZYPHRAX_FLAG_CONTENT_SIZE;
+  csz = zyphrax_compress(src, size, comp, bound, &params);
+  ds = zyphrax_dstream_init();
+  in = (zyphrax_in_buffer_t){comp, csz - 1, 0};
+  out = (zyphrax_out_buffer_t){dec, size, 0};
+  r = zyphrax_dstream_update(ds, &out, &in);
+  assert(r != 0 && r != ZYPHRAX_STREAM_ERROR);
+  in.size = csz;
+  assert(zyphrax_dstream_update(ds, &out, &in) == 0);
+  assert(out.pos == size);
+
+  // Corrupt block type
+  zyphrax_dstream_free(ds);
+  ds = zyphrax_dstream_init();
+  comp[20] = 9;
+  in.pos = 0;
+  out.pos = 0;
+  assert(zyphrax_dstream_update(ds, &out, &in) == ZYPHRAX_STREAM_ERROR);
+  assert(zyphrax_dstream_update(ds, &out, &in) == ZYPHRAX_STREAM_ERROR);
+
+  zyphrax_dstream_free(ds);
+  free(src);
+  free(comp);
+  free(dec);
+  printf("Stream decompression first block test passed.\n");
+}
+
+void test_dstream_legacy_raw() {
+  // Legacy raw blocks [0][bytes] have no length; the last one ends the frame
+  uint8_t frame[12 + 1 + 8 + 1 + 5];
+  zyphrax_params_t params = {.level = 3, .block_size = 8};
+  uint8_t tmp[64];
+  zyphrax_compress((const uint8_t *)"x", 1, tmp, sizeof(tmp), &params);
+  memcpy(frame, tmp, 12);
+
+  const char *payload = "ABCDEFGHIJKLM";
+  frame[12] = 0;
+  memcpy(frame + 13, payload, 8);
+  frame[21] = 0;
+  memcpy(frame + 22, payload + 8, 5);
+
+  uint8_t dec[16];
+  size_t last;
+  assert(stream_decompress(frame, sizeof(frame), dec, sizeof(dec), 3, &last) ==
+         13);
+  assert(last == 0);
+  assert(memcmp(dec, payload, 13) == 0);
+  printf("Stream decompression legacy raw test passed.\n");
+}
+
+int main() {
+  test_stream_matches_oneshot();
+  test_stream_seek_table();
+  test_stream_flush();
+  test_stream_pipelined();
+  test_stream_pledged_size();
+  test_dstream_roundtrip();
+  test_dstream_first_block();
+  test_dstream_legacy_raw();
+  return 0;
+}